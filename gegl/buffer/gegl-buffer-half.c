@@ -0,0 +1,308 @@
+/* This file is part of GEGL.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib-object.h>
+#include <babl/babl.h>
+
+#include "gegl-cpuaccel.h"
+#include "gegl-buffer-half.h"
+
+#if defined(ARCH_X86) && defined(USE_SSE) && defined(__GNUC__) && \
+    (defined(__clang__) || __GNUC__ >= 5)
+#define HALF_USE_F16C 1
+#include <immintrin.h>
+#endif
+
+/* the models of the float formats which get a half counterpart */
+static const struct
+{
+  const gchar *model;
+  const gchar *components[4];
+} half_models[] =
+{
+  { "RGBA",       { "R",   "G",   "B",   "A" } },
+  { "RaGaBaA",    { "Ra",  "Ga",  "Ba",  "A" } },
+  { "R'G'B'A",    { "R'",  "G'",  "B'",  "A" } },
+  { "R'aG'aB'aA", { "R'a", "G'a", "B'a", "A" } },
+  { "RGB",        { "R",   "G",   "B" } },
+  { "R'G'B'",     { "R'",  "G'",  "B'" } },
+  { "YA",         { "Y",   "A" } },
+  { "YaA",        { "Ya",  "A" } },
+  { "Y'A",        { "Y'",  "A" } },
+  { "Y'aA",       { "Y'a", "A" } },
+  { "Y",          { "Y" } },
+  { "Y'",         { "Y'" } }
+};
+
+/* float format -> half format, filled once by gegl_buffer_half_init () */
+static GHashTable *half_formats = NULL;
+
+static void
+half_to_float_c (const guint16 *src,
+                 gfloat        *dst,
+                 glong          n)
+{
+  glong i;
+
+  for (i = 0; i < n; i++)
+    dst[i] = gegl_half_to_float (src[i]);
+}
+
+static void
+float_to_half_c (const gfloat *src,
+                 guint16      *dst,
+                 glong         n)
+{
+  glong i;
+
+  for (i = 0; i < n; i++)
+    dst[i] = gegl_float_to_half (src[i]);
+}
+
+#ifdef HALF_USE_F16C
+static __attribute__((target ("avx,f16c"))) void
+half_to_float_f16c (const guint16 *src,
+                    gfloat        *dst,
+                    glong          n)
+{
+  for (; n >= 8; n -= 8, src += 8, dst += 8)
+    _mm256_storeu_ps (dst, _mm256_cvtph_ps (_mm_loadu_si128 ((const __m128i *) src)));
+
+  half_to_float_c (src, dst, n);
+}
+
+static __attribute__((target ("avx,f16c"))) void
+float_to_half_f16c (const gfloat *src,
+                    guint16      *dst,
+                    glong         n)
+{
+  for (; n >= 8; n -= 8, src += 8, dst += 8)
+    _mm_storeu_si128 ((__m128i *) dst,
+                      _mm256_cvtps_ph (_mm256_loadu_ps (src),
+                                       _MM_FROUND_TO_NEAREST_INT));
+
+  float_to_half_c (src, dst, n);
+}
+#endif
+
+static void (*half_to_float_func) (const guint16 *, gfloat *, glong) = half_to_float_c;
+static void (*float_to_half_func) (const gfloat *, guint16 *, glong) = float_to_half_c;
+
+void
+gegl_half_to_float_buf (const guint16 *src,
+                        gfloat        *dst,
+                        glong          n)
+{
+  half_to_float_func (src, dst, n);
+}
+
+void
+gegl_float_to_half_buf (const gfloat *src,
+                        guint16      *dst,
+                        glong         n)
+{
+  float_to_half_func (src, dst, n);
+}
+
+/* type conversions, used by babl's reference fishes */
+
+static long
+convert_half_double (char *src,
+                     char *dst,
+                     int   src_pitch,
+                     int   dst_pitch,
+                     long  n)
+{
+  long i;
+
+  for (i = 0; i < n; i++)
+    {
+      *(gdouble *) dst = gegl_half_to_float (*(guint16 *) src);
+      src += src_pitch;
+      dst += dst_pitch;
+    }
+
+  return n;
+}
+
+static long
+convert_double_half (char *src,
+                     char *dst,
+                     int   src_pitch,
+                     int   dst_pitch,
+                     long  n)
+{
+  long i;
+
+  for (i = 0; i < n; i++)
+    {
+      *(guint16 *) dst = gegl_float_to_half (*(gdouble *) src);
+      src += src_pitch;
+      dst += dst_pitch;
+    }
+
+  return n;
+}
+
+/* format conversions between "<model> half" and "<model> float", the
+ * fast path of gegl_buffer_get/set and the iterators
+ */
+#define HALF_LINEAR(components)                                           \
+static long                                                               \
+convert_half_float_##components (char *src,                               \
+                                 char *dst,                               \
+                                 long  n)                                 \
+{                                                                         \
+  half_to_float_func ((const guint16 *) src, (gfloat *) dst,              \
+                      n * components);                                    \
+  return n;                                                               \
+}                                                                         \
+                                                                          \
+static long                                                               \
+convert_float_half_##components (char *src,                               \
+                                 char *dst,                               \
+                                 long  n)                                 \
+{                                                                         \
+  float_to_half_func ((const gfloat *) src, (guint16 *) dst,              \
+                      n * components);                                    \
+  return n;                                                               \
+}
+
+HALF_LINEAR (1)
+HALF_LINEAR (2)
+HALF_LINEAR (3)
+HALF_LINEAR (4)
+
+#undef HALF_LINEAR
+
+static const Babl *
+half_format_new (const gchar        *model,
+                 const gchar * const components[4],
+                 gint                n_components)
+{
+  const Babl *m    = babl_model (model);
+  const Babl *type = babl_type ("half");
+
+  switch (n_components)
+    {
+      case 1:
+        return babl_format_new (m, type,
+                                babl_component (components[0]),
+                                NULL);
+      case 2:
+        return babl_format_new (m, type,
+                                babl_component (components[0]),
+                                babl_component (components[1]),
+                                NULL);
+      case 3:
+        return babl_format_new (m, type,
+                                babl_component (components[0]),
+                                babl_component (components[1]),
+                                babl_component (components[2]),
+                                NULL);
+      default:
+        return babl_format_new (m, type,
+                                babl_component (components[0]),
+                                babl_component (components[1]),
+                                babl_component (components[2]),
+                                babl_component (components[3]),
+                                NULL);
+    }
+}
+
+void
+gegl_buffer_half_init (void)
+{
+  gint i;
+
+  if (half_formats)
+    return;
+
+#ifdef HALF_USE_F16C
+  if (gegl_cpu_accel_get_support () & GEGL_CPU_ACCEL_X86_F16C)
+    {
+      half_to_float_func = half_to_float_f16c;
+      float_to_half_func = float_to_half_f16c;
+    }
+#endif
+
+  babl_type_new ("half",
+                 "bits", 16,
+                 NULL);
+
+  babl_conversion_new (babl_type ("half"), babl_type ("double"),
+                       "plane", convert_half_double,
+                       NULL);
+  babl_conversion_new (babl_type ("double"), babl_type ("half"),
+                       "plane", convert_double_half,
+                       NULL);
+
+  half_formats = g_hash_table_new (NULL, NULL);
+
+  for (i = 0; i < G_N_ELEMENTS (half_models); i++)
+    {
+      const Babl *half;
+      const Babl *flt;
+      gchar      *name;
+      gint        n_components = 0;
+
+      while (n_components < 4 && half_models[i].components[n_components])
+        n_components++;
+
+      half = half_format_new (half_models[i].model,
+                              half_models[i].components,
+                              n_components);
+
+      name = g_strdup_printf ("%s float", half_models[i].model);
+      flt  = babl_format (name);
+      g_free (name);
+
+      switch (n_components)
+        {
+          case 1:
+            babl_conversion_new (half, flt, "linear", convert_half_float_1, NULL);
+            babl_conversion_new (flt, half, "linear", convert_float_half_1, NULL);
+            break;
+          case 2:
+            babl_conversion_new (half, flt, "linear", convert_half_float_2, NULL);
+            babl_conversion_new (flt, half, "linear", convert_float_half_2, NULL);
+            break;
+          case 3:
+            babl_conversion_new (half, flt, "linear", convert_half_float_3, NULL);
+            babl_conversion_new (flt, half, "linear", convert_float_half_3, NULL);
+            break;
+          default:
+            babl_conversion_new (half, flt, "linear", convert_half_float_4, NULL);
+            babl_conversion_new (flt, half, "linear", convert_float_half_4, NULL);
+            break;
+        }
+
+      g_hash_table_insert (half_formats, (gpointer) flt, (gpointer) half);
+    }
+}
+
+const Babl *
+gegl_buffer_half_format (const Babl *format)
+{
+  const Babl *half = NULL;
+
+  if (format && half_formats)
+    half = g_hash_table_lookup (half_formats, format);
+
+  return half ? half : format;
+}
@@ -0,0 +1,112 @@
+/* This file is part of GEGL.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEGL_BUFFER_HALF_H__
+#define __GEGL_BUFFER_HALF_H__
+
+G_BEGIN_DECLS
+
+/* IEEE 754 half precision floats, registered with babl as the "half"
+ * type along with a "<model> half" format for each float format GEGL
+ * operations commonly work in.  Buffers using them take half the tile
+ * cache and swap space of float buffers, gegl_buffer_get/set and the
+ * iterators convert on access.
+ */
+
+void          gegl_buffer_half_init   (void);
+
+/* The half float counterpart of a float format, format itself when it
+ * has none.
+ */
+const Babl  * gegl_buffer_half_format (const Babl    *format);
+
+void          gegl_half_to_float_buf  (const guint16 *src,
+                                       gfloat        *dst,
+                                       glong          n);
+void          gegl_float_to_half_buf  (const gfloat  *src,
+                                       guint16       *dst,
+                                       glong          n);
+
+typedef union
+{
+  guint32 u;
+  gfloat  f;
+} GeglHalfBits;
+
+static inline gfloat
+gegl_half_to_float (guint16 h)
+{
+  const GeglHalfBits magic       = { 113 << 23 };
+  const guint32      shifted_exp = 0x7c00 << 13;
+  GeglHalfBits       o;
+  guint32            exp;
+
+  o.u = (h & 0x7fff) << 13;
+  exp = shifted_exp & o.u;
+  o.u += (127 - 15) << 23;
+
+  if (exp == shifted_exp)      /* inf or nan */
+    {
+      o.u += (128 - 16) << 23;
+    }
+  else if (exp == 0)           /* zero or denormal */
+    {
+      o.u += 1 << 23;
+      o.f -= magic.f;
+    }
+
+  o.u |= (guint32) (h & 0x8000) << 16;
+
+  return o.f;
+}
+
+/* rounds to nearest even, like F16C does */
+static inline guint16
+gegl_float_to_half (gfloat value)
+{
+  const GeglHalfBits denorm_magic = { ((127 - 15) + (23 - 10) + 1) << 23 };
+  GeglHalfBits       f;
+  guint32            sign;
+  guint16            h;
+
+  f.f  = value;
+  sign = f.u & 0x80000000;
+  f.u ^= sign;
+
+  if (f.u >= (127 + 16) << 23)  /* inf or nan, or too large */
+    {
+      h = f.u > 0x7f800000 ? 0x7e00 : 0x7c00;
+    }
+  else if (f.u < 113 << 23)     /* zero or denormal */
+    {
+      f.f += denorm_magic.f;
+      h = f.u - denorm_magic.u;
+    }
+  else
+    {
+      guint32 mant_odd = (f.u >> 13) & 1;
+
+      f.u += ((guint32) (15 - 127) << 23) + 0xfff;
+      f.u += mant_odd;
+      h = f.u >> 13;
+    }
+
+  return h | (sign >> 16);
+}
+
+G_END_DECLS
+
+#endif /* __GEGL_BUFFER_HALF_H__ */
@@ -27,6 +27,7 @@
 
 #include "gegl-types.h"
 #include "gegl-algorithms.h"
+#include "buffer/gegl-buffer-half.h"
 
 #include <math.h>
 
@@ -51,10 +52,55 @@ void gegl_downscale_2x2 (const Babl *format,
     gegl_downscale_2x2_u32 (bpp, src_width, src_height, src_data, src_rowstride, dst_data, dst_rowstride);
   else if (comp_type == babl_type ("double"))
     gegl_downscale_2x2_double (bpp, src_width, src_height, src_data, src_rowstride, dst_data, dst_rowstride);
+  else if (comp_type == babl_type ("half"))
+    gegl_downscale_2x2_half (bpp, src_width, src_height, src_data, src_rowstride, dst_data, dst_rowstride);
   else
     gegl_downscale_2x2_nearest (bpp, src_width, src_height, src_data, src_rowstride, dst_data, dst_rowstride);
 }
 
+void
+gegl_downscale_2x2_half (gint    bpp,
+                         gint    src_width,
+                         gint    src_height,
+                         guchar *src_data,
+                         gint    src_rowstride,
+                         guchar *dst_data,
+                         gint    dst_rowstride)
+{
+  gint y;
+  gint diag = src_rowstride + bpp;
+  const gint components = bpp / sizeof (guint16);
+
+  if (!src_data || !dst_data)
+    return;
+
+  for (y = 0; y < src_height / 2; y++)
+    {
+      gint    x;
+      guchar *src = src_data + src_rowstride * y * 2;
+      guchar *dst = dst_data + dst_rowstride * y;
+
+      for (x = 0; x < src_width / 2; x++)
+        {
+          gint i;
+          guint16 *aa = ((guint16 *)(src));
+          guint16 *ab = ((guint16 *)(src + bpp));
+          guint16 *ba = ((guint16 *)(src + src_rowstride));
+          guint16 *bb = ((guint16 *)(src + diag));
+
+          for (i = 0; i < components; i++)
+            ((guint16 *)dst)[i] =
+              gegl_float_to_half ((gegl_half_to_float (aa[i]) +
+                                   gegl_half_to_float (ab[i]) +
+                                   gegl_half_to_float (ba[i]) +
+                                   gegl_half_to_float (bb[i])) / 4.0f);
+
+          dst += bpp;
+          src += bpp * 2;
+        }
+    }
+}
+
 void
 gegl_downscale_2x2_nearest (gint    bpp,
                             gint    src_width,
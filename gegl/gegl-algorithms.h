@@ -71,6 +71,14 @@ void gegl_downscale_2x2_u8 (gint    bpp,
                             guchar *dst_data,
                             gint    dst_rowstride);
 
+void gegl_downscale_2x2_half (gint    bpp,
+                              gint    src_width,
+                              gint    src_height,
+                              guchar *src_data,
+                              gint    src_rowstride,
+                              guchar *dst_data,
+                              gint    dst_rowstride);
+
 void gegl_downscale_2x2_nearest (gint    bpp,
                                  gint    src_width,
                                  gint    src_height,
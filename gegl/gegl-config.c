@@ -45,7 +45,8 @@ enum
   PROP_THREADS,
   PROP_USE_OPENCL,
   PROP_QUEUE_SIZE,
-  PROP_APPLICATION_LICENSE
+  PROP_APPLICATION_LICENSE,
+  PROP_HALF_FLOAT_STORAGE
 };
 
 gint _gegl_threads = 1; 
@@ -100,6 +101,10 @@ gegl_config_get_property (GObject    *gobject,
         g_value_set_string (value, config->application_license);
         break;
 
+      case PROP_HALF_FLOAT_STORAGE:
+        g_value_set_boolean (value, config->half_float_storage);
+        break;
+
       default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, property_id, pspec);
         break;
@@ -150,6 +155,9 @@ gegl_config_set_property (GObject      *gobject,
           g_free (config->application_license);
         config->application_license = g_value_dup_string (value);
         break;
+      case PROP_HALF_FLOAT_STORAGE:
+        config->half_float_storage = g_value_get_boolean (value);
+        break;
       default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, property_id, pspec);
         break;
@@ -261,6 +269,14 @@ gegl_config_class_init (GeglConfigClass *klass)
                                                         "",
                                                         G_PARAM_READWRITE |
                                                         G_PARAM_CONSTRUCT));
+
+  g_object_class_install_property (gobject_class, PROP_HALF_FLOAT_STORAGE,
+                                   g_param_spec_boolean ("half-float-storage",
+                                                         "Half float storage",
+                                                         "Store float node caches and intermediate buffers as half floats, halving their memory use at reduced precision",
+                                                         FALSE,
+                                                         G_PARAM_READWRITE |
+                                                         G_PARAM_CONSTRUCT));
 }
 
 static void
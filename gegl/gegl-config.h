@@ -44,6 +44,7 @@ struct _GeglConfig
   gboolean use_opencl;
   gint     queue_size;
   gchar   *application_license;
+  gboolean half_float_storage;
 };
 
 struct _GeglConfigClass
@@ -56,6 +57,12 @@ extern gint _gegl_threads;
 
 #define GEGL_MAX_THREADS 16
 
+/* Bytes of format conversion scratch per buffer and thread used by the
+ * threaded point operations, pixels are converted in bands of rows
+ * fitting it.
+ */
+#define GEGL_POINT_SCRATCH_SIZE (128 * 1024)
+
 G_END_DECLS
 
 #endif
@@ -115,7 +115,15 @@ enum
 
 enum
 {
-  ARCH_X86_INTEL_FEATURE_PNI      = 1 << 0
+  ARCH_X86_INTEL_FEATURE_PNI      = 1 << 0,
+  ARCH_X86_INTEL_FEATURE_OSXSAVE  = 1 << 27,
+  ARCH_X86_INTEL_FEATURE_AVX      = 1 << 28,
+  ARCH_X86_INTEL_FEATURE_F16C     = 1 << 29
+};
+
+enum
+{
+  ARCH_X86_INTEL_FEATURE_AVX2     = 1 << 5
 };
 
 #if !defined(ARCH_X86_64) && (defined(PIC) || defined(__PIC__))
@@ -128,6 +136,16 @@ enum
              "=c" (ecx),           \
              "=d" (edx)            \
            : "0" (op))
+#define cpuid_count(op,count,eax,ebx,ecx,edx) \
+  __asm__ ("movl %%ebx, %%esi\n\t" \
+           "cpuid\n\t"             \
+           "xchgl %%ebx,%%esi"     \
+           : "=a" (eax),           \
+             "=S" (ebx),           \
+             "=c" (ecx),           \
+             "=d" (edx)            \
+           : "0" (op),             \
+             "2" (count))
 #else
 #define cpuid(op,eax,ebx,ecx,edx)  \
   __asm__ ("cpuid"                 \
@@ -136,6 +154,14 @@ enum
              "=c" (ecx),           \
              "=d" (edx)            \
            : "0" (op))
+#define cpuid_count(op,count,eax,ebx,ecx,edx) \
+  __asm__ ("cpuid"                 \
+           : "=a" (eax),           \
+             "=b" (ebx),           \
+             "=c" (ecx),           \
+             "=d" (edx)            \
+           : "0" (op),             \
+             "2" (count))
 #endif
 
 
@@ -235,6 +261,35 @@ arch_accel_intel (void)
 
     if (ecx & ARCH_X86_INTEL_FEATURE_PNI)
       caps |= GEGL_CPU_ACCEL_X86_SSE3;
+
+    /* AVX2 and F16C also need the OS to save the ymm registers */
+    if ((ecx & ARCH_X86_INTEL_FEATURE_OSXSAVE) &&
+        (ecx & ARCH_X86_INTEL_FEATURE_AVX))
+      {
+        guint32  xcr0_eax, xcr0_edx;
+        gboolean has_f16c = (ecx & ARCH_X86_INTEL_FEATURE_F16C) != 0;
+
+        __asm__ (".byte 0x0f, 0x01, 0xd0" /* xgetbv */
+                 : "=a" (xcr0_eax),
+                   "=d" (xcr0_edx)
+                 : "c" (0));
+
+        if ((xcr0_eax & 0x6) == 0x6)
+          {
+            if (has_f16c)
+              caps |= GEGL_CPU_ACCEL_X86_F16C;
+
+            cpuid (0, eax, ebx, ecx, edx);
+
+            if (eax >= 7)
+              {
+                cpuid_count (7, 0, eax, ebx, ecx, edx);
+
+                if (ebx & ARCH_X86_INTEL_FEATURE_AVX2)
+                  caps |= GEGL_CPU_ACCEL_X86_AVX2;
+              }
+          }
+      }
 #endif /* USE_SSE */
   }
 #endif /* USE_MMX */
@@ -400,7 +455,8 @@ arch_accel (void)
 
 #ifdef USE_SSE
   if ((caps & GEGL_CPU_ACCEL_X86_SSE) && !arch_accel_sse_os_support ())
-    caps &= ~(GEGL_CPU_ACCEL_X86_SSE | GEGL_CPU_ACCEL_X86_SSE2);
+    caps &= ~(GEGL_CPU_ACCEL_X86_SSE | GEGL_CPU_ACCEL_X86_SSE2 |
+              GEGL_CPU_ACCEL_X86_AVX2 | GEGL_CPU_ACCEL_X86_F16C);
 #endif
 
   return caps;
@@ -34,6 +34,8 @@ typedef enum
   GEGL_CPU_ACCEL_X86_SSE     = 0x10000000,
   GEGL_CPU_ACCEL_X86_SSE2    = 0x08000000,
   GEGL_CPU_ACCEL_X86_SSE3    = 0x02000000,
+  GEGL_CPU_ACCEL_X86_AVX2    = 0x00800000,
+  GEGL_CPU_ACCEL_X86_F16C    = 0x00400000,
 
   /* powerpc accelerations */
   GEGL_CPU_ACCEL_PPC_ALTIVEC = 0x04000000
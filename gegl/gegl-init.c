@@ -98,6 +98,7 @@ guint gegl_debug_flags = 0;
 #include "operation/gegl-operations.h"
 #include "operation/gegl-extension-handler-private.h"
 #include "buffer/gegl-buffer-private.h"
+#include "buffer/gegl-buffer-half.h"
 #include "buffer/gegl-buffer-iterator-private.h"
 #include "buffer/gegl-tile-backend-ram.h"
 #include "buffer/gegl-tile-backend-file.h"
@@ -625,6 +626,7 @@ gegl_post_parse_hook (GOptionContext *context,
   gegl_config_parse_env (config);
 
   babl_init ();
+  gegl_buffer_half_init ();
 
 #ifdef GEGL_ENABLE_DEBUG
   {
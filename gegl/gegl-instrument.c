@@ -109,9 +109,13 @@ real_gegl_instrument (const gchar *parent_name,
                       const gchar *name,
                       long         usecs)
 {
+  /* nodes may be processed on several threads at once */
+  static GRecMutex mutex;
   Timing *iter;
   Timing *parent;
 
+  g_rec_mutex_lock (&mutex);
+
   if (root == NULL)
     {
       root       = g_slice_new0 (Timing);
@@ -134,6 +138,8 @@ real_gegl_instrument (const gchar *parent_name,
       parent->children = iter;
     }
   iter->usecs += usecs;
+
+  g_rec_mutex_unlock (&mutex);
 }
 
 
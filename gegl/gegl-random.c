@@ -213,6 +213,16 @@ gegl_random_get_type (void)
   return our_type;
 }
 
+static inline guint64
+_gegl_random_index (gint x,
+                    gint y,
+                    gint n)
+{
+  return x * XPRIME +
+         y * YPRIME * XPRIME +
+         n * NPRIME * YPRIME * XPRIME;
+}
+
 static inline guint32
 _gegl_random_int (const GeglRandom *rand,
                   gint              x,
@@ -220,9 +230,7 @@ _gegl_random_int (const GeglRandom *rand,
                   gint              z,
                   gint              n)
 {
-  guint64 idx = x * XPRIME +
-                y * YPRIME * XPRIME +
-                n * NPRIME * YPRIME * XPRIME;
+  guint64 idx = _gegl_random_index (x, y, n);
   return
     gegl_random_data[idx % rand->prime0] ^
     gegl_random_data[rand->prime0 + (idx % (rand->prime1))] ^
@@ -275,3 +283,161 @@ gegl_random_float_range (const GeglRandom *rand,
 {
   return gegl_random_float (rand, x, y, z, n) * (max - min) + min;
 }
+
+/* The conversions of the span functions go through a buffer this large */
+#define GEGL_RANDOM_SPAN_CHUNK 256
+
+/* Successive x coordinates (and n's growing along with them) are a
+ * constant step apart in the index, so instead of three 64 bit divisions
+ * per number the positions in the LUTs are stepped along, wrapping around
+ * the primes. Only when the index itself wraps around 2^64 (at the sign
+ * change of the signed sum it is made of) do the positions have to be
+ * computed again.
+ */
+static inline guint32
+_gegl_random_step (gint64  step,
+                   guint32 prime)
+{
+  gint64 rem = step % prime;
+
+  return rem < 0 ? rem + prime : rem;
+}
+
+static void
+_gegl_random_int_span (const GeglRandom *rand,
+                       gint              x,
+                       gint              y,
+                       gint              z,
+                       gint              n,
+                       gint              n_step,
+                       gint              length,
+                       guint32          *dest)
+{
+  const gint64   step   = XPRIME + n_step * NPRIME * YPRIME * XPRIME;
+  const guint32  prime0 = rand->prime0;
+  const guint32  prime1 = rand->prime1;
+  const guint32  prime2 = rand->prime2;
+  const guint32  step0  = _gegl_random_step (step, prime0);
+  const guint32  step1  = _gegl_random_step (step, prime1);
+  const guint32  step2  = _gegl_random_step (step, prime2);
+  const guint32 *data0  = gegl_random_data;
+  const guint32 *data1  = data0 + prime0;
+  const guint32 *data2  = data1 + prime1;
+  guint64        idx    = _gegl_random_index (x, y, n);
+  guint32        i0     = idx % prime0;
+  guint32        i1     = idx % prime1;
+  guint32        i2     = idx % prime2;
+  gint           i;
+
+  for (i = 0; i < length; i++)
+    {
+      guint64 next = idx + (guint64) step;
+
+      dest[i] = data0[i0] ^ data1[i1] ^ data2[i2];
+
+      if (G_UNLIKELY (step > 0 ? next < idx : next > idx))
+        {
+          i0 = next % prime0;
+          i1 = next % prime1;
+          i2 = next % prime2;
+        }
+      else
+        {
+          i0 += step0;
+          i1 += step1;
+          i2 += step2;
+          if (i0 >= prime0) i0 -= prime0;
+          if (i1 >= prime1) i1 -= prime1;
+          if (i2 >= prime2) i2 -= prime2;
+        }
+
+      idx = next;
+    }
+}
+
+void
+gegl_random_int_span (const GeglRandom *rand,
+                      gint              x,
+                      gint              y,
+                      gint              z,
+                      gint              n,
+                      gint              n_step,
+                      gint              length,
+                      guint32          *dest)
+{
+  _gegl_random_int_span (rand, x, y, z, n, n_step, length, dest);
+}
+
+void
+gegl_random_int_range_span (const GeglRandom *rand,
+                            gint              x,
+                            gint              y,
+                            gint              z,
+                            gint              n,
+                            gint              n_step,
+                            gint              min,
+                            gint              max,
+                            gint              length,
+                            gint32           *dest)
+{
+  guint32 ret[GEGL_RANDOM_SPAN_CHUNK];
+  gint    done;
+  gint    i;
+
+  for (done = 0; done < length; done += GEGL_RANDOM_SPAN_CHUNK)
+    {
+      gint chunk = MIN (length - done, GEGL_RANDOM_SPAN_CHUNK);
+
+      _gegl_random_int_span (rand, x + done, y, z, n + done * n_step,
+                             n_step, chunk, ret);
+
+      for (i = 0; i < chunk; i++)
+        dest[done + i] = (ret[i] % (max - min)) + min;
+    }
+}
+
+void
+gegl_random_float_span (const GeglRandom *rand,
+                        gint              x,
+                        gint              y,
+                        gint              z,
+                        gint              n,
+                        gint              n_step,
+                        gint              length,
+                        gfloat           *dest)
+{
+  guint32 ret[GEGL_RANDOM_SPAN_CHUNK];
+  gint    done;
+  gint    i;
+
+  for (done = 0; done < length; done += GEGL_RANDOM_SPAN_CHUNK)
+    {
+      gint chunk = MIN (length - done, GEGL_RANDOM_SPAN_CHUNK);
+
+      _gegl_random_int_span (rand, x + done, y, z, n + done * n_step,
+                             n_step, chunk, ret);
+
+      for (i = 0; i < chunk; i++)
+        dest[done + i] = (ret[i] & 0xffff) * G_RAND_FLOAT_TRANSFORM;
+    }
+}
+
+void
+gegl_random_float_range_span (const GeglRandom *rand,
+                              gint              x,
+                              gint              y,
+                              gint              z,
+                              gint              n,
+                              gint              n_step,
+                              gfloat            min,
+                              gfloat            max,
+                              gint              length,
+                              gfloat           *dest)
+{
+  gint i;
+
+  gegl_random_float_span (rand, x, y, z, n, n_step, length, dest);
+
+  for (i = 0; i < length; i++)
+    dest[i] = dest[i] * (max - min) + min;
+}
@@ -157,6 +157,111 @@ gfloat gegl_random_float (const GeglRandom *rand,
                           gint              z,
                           gint              n);
 
+/**
+ * gegl_random_int_span:
+ * @rand: a GeglRandom
+ * @x: x coordinate of the first number
+ * @y: y coordinate
+ * @z: z coordinate (mipmap level)
+ * @n: number no (each x,y coordinate provides its own sequence of
+ * numbers
+ * @n_step: how much n grows from one x coordinate to the next
+ * @length: the number of coordinates
+ * @dest: (out caller-allocates) (array length=length): the numbers
+ *
+ * Store in @dest[i] what gegl_random_int() returns for the coordinates
+ * x + i, y and the number n + i * n_step, for a whole row of pixels at
+ * once. This is considerably faster than generating them one by one.
+ */
+void gegl_random_int_span (const GeglRandom *rand,
+                           gint              x,
+                           gint              y,
+                           gint              z,
+                           gint              n,
+                           gint              n_step,
+                           gint              length,
+                           guint32          *dest);
+
+/**
+ * gegl_random_int_range_span:
+ * @rand: a GeglRandom
+ * @x: x coordinate of the first number
+ * @y: y coordinate
+ * @z: z coordinate (mipmap level)
+ * @n: number no (each x,y coordinate provides its own sequence of
+ * numbers
+ * @n_step: how much n grows from one x coordinate to the next
+ * @min: minimum value
+ * @max: maxmimum value+1
+ * @length: the number of coordinates
+ * @dest: (out caller-allocates) (array length=length): the numbers
+ *
+ * Store in @dest[i] what gegl_random_int_range() returns for the
+ * coordinates x + i, y and the number n + i * n_step.
+ */
+void gegl_random_int_range_span (const GeglRandom *rand,
+                                 gint              x,
+                                 gint              y,
+                                 gint              z,
+                                 gint              n,
+                                 gint              n_step,
+                                 gint              min,
+                                 gint              max,
+                                 gint              length,
+                                 gint32           *dest);
+
+/**
+ * gegl_random_float_span:
+ * @rand: a GeglRandom
+ * @x: x coordinate of the first number
+ * @y: y coordinate
+ * @z: z coordinate (mipmap level)
+ * @n: number no (each x,y coordinate provides its own sequence of
+ * numbers
+ * @n_step: how much n grows from one x coordinate to the next
+ * @length: the number of coordinates
+ * @dest: (out caller-allocates) (array length=length): the numbers
+ *
+ * Store in @dest[i] what gegl_random_float() returns for the
+ * coordinates x + i, y and the number n + i * n_step.
+ */
+void gegl_random_float_span (const GeglRandom *rand,
+                             gint              x,
+                             gint              y,
+                             gint              z,
+                             gint              n,
+                             gint              n_step,
+                             gint              length,
+                             gfloat           *dest);
+
+/**
+ * gegl_random_float_range_span:
+ * @rand: a GeglRandom
+ * @x: x coordinate of the first number
+ * @y: y coordinate
+ * @z: z coordinate (mipmap level)
+ * @n: number no (each x,y coordinate provides its own sequence of
+ * numbers
+ * @n_step: how much n grows from one x coordinate to the next
+ * @min: minimum value
+ * @max: maxmimum value
+ * @length: the number of coordinates
+ * @dest: (out caller-allocates) (array length=length): the numbers
+ *
+ * Store in @dest[i] what gegl_random_float_range() returns for the
+ * coordinates x + i, y and the number n + i * n_step.
+ */
+void gegl_random_float_range_span (const GeglRandom *rand,
+                                   gint              x,
+                                   gint              y,
+                                   gint              z,
+                                   gint              n,
+                                   gint              n_step,
+                                   gfloat            min,
+                                   gfloat            max,
+                                   gint              length,
+                                   gfloat           *dest);
+
 G_END_DECLS
 
 #endif /* __GEGL_RANDOM_H__ */
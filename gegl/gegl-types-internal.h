@@ -70,6 +70,14 @@ static inline int gegl_level_from_scale (gfloat scale)
   return level;
 }
 
+static inline gboolean gegl_mipmap_rendering_enabled (void)
+{
+  static int enabled = -1;
+  if (enabled == -1)
+    enabled = g_getenv("GEGL_MIPMAP_RENDERING")!=NULL;
+  return enabled;
+}
+
 G_END_DECLS
 
 #endif /* __GEGL_TYPES_INTERNAL_H__ */
@@ -39,6 +39,7 @@
 #include <gegl-random.h>
 #include <gegl-node.h>
 #include <gegl-processor.h>
+#include <gegl-blit-job.h>
 #include <gegl-apply.h>
 #include <gegl-c.h>
 
@@ -77,10 +77,26 @@ struct _GeglNode
 
   gboolean        use_opencl;
 
+  /* Whether float caches and intermediate results are stored as half
+   * floats, inherited by children
+   */
+  gboolean        half_float_storage;
+
   GMutex          mutex;
 
   gint            passthrough;
 
+  /* If TRUE invalidations are queued instead of propagated at once */
+  gboolean        defer_invalidations;
+
+  /* If TRUE the surroundings of cached blits are rendered in advance */
+  gboolean        prefetch;
+
+  /* Bumped whenever the operation or its properties change, the
+   * operation must then be prepared again.
+   */
+  guint           prepare_serial;
+
   /*< private >*/
   GeglNodePrivate *priv;
 };
@@ -122,9 +138,16 @@ void          gegl_node_insert_before       (GeglNode      *self,
                                              GeglNode      *to_be_inserted);
 
 GeglCache   * gegl_node_get_cache           (GeglNode      *node);
+/* The format buffers holding the output of node in format are stored in */
+const Babl  * gegl_node_get_storage_format  (GeglNode      *node,
+                                             const Babl    *format);
 void          gegl_node_invalidated         (GeglNode      *node,
                                              const GeglRectangle *rect,
                                              gboolean             clean_cache);
+/* TRUE while any node has invalidations queued for flushing */
+gboolean      gegl_node_invalidations_pending (void);
+/* Changes whenever the pads or connections of any node change */
+guint         gegl_node_get_topology_serial (void);
 
 const gchar * gegl_node_get_name            (GeglNode      *self);
 void          gegl_node_set_name            (GeglNode      *self,
@@ -133,6 +156,15 @@ void
 gegl_node_emit_computed (GeglNode *node,
                          const GeglRectangle *rect);
 
+void          gegl_node_blit_full           (GeglNode            *self,
+                                             GeglEvalManager     *eval_manager,
+                                             gdouble              scale,
+                                             const GeglRectangle *roi,
+                                             const Babl          *format,
+                                             gpointer             destination_buf,
+                                             gint                 rowstride,
+                                             GeglBlitFlags        flags);
+
 
 G_END_DECLS
 
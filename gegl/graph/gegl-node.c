@@ -37,11 +37,15 @@
 
 #include "graph/gegl-visitor.h"
 
+#include "buffer/gegl-region.h"
+#include "buffer/gegl-buffer-half.h"
+
 #include "operation/gegl-operation.h"
 #include "operation/gegl-operations.h"
 #include "operation/gegl-operation-meta.h"
 
 #include "process/gegl-eval-manager.h"
+#include "process/gegl-prefetcher.h"
 
 enum
 {
@@ -51,7 +55,10 @@ enum
   PROP_NAME,
   PROP_DONT_CACHE,
   PROP_USE_OPENCL,
-  PROP_PASSTHROUGH
+  PROP_PASSTHROUGH,
+  PROP_DEFER_INVALIDATIONS,
+  PROP_PREFETCH,
+  PROP_HALF_FLOAT_STORAGE
 };
 
 enum
@@ -71,11 +78,20 @@ struct _GeglNodePrivate
   gchar           *name;
   gchar           *debug_name;
   GeglEvalManager *eval_manager;
+  GeglRegion      *pending_invalidations;
 };
 
 
 static guint gegl_node_signals[LAST_SIGNAL] = {0};
 
+/* The number of nodes with invalidations queued, see gegl_node_invalidated */
+static gint nodes_with_pending_invalidations = 0;
+
+/* Bumped whenever the pads or connections of any node change, see
+ * gegl_node_get_topology_serial
+ */
+static gint topology_serial = 0;
+
 
 static void            gegl_node_class_init               (GeglNodeClass *klass);
 static void            gegl_node_init                     (GeglNode      *self);
@@ -181,6 +197,30 @@ gegl_node_class_init (GeglNodeClass *klass)
                                                         G_PARAM_CONSTRUCT |
                                                         G_PARAM_READWRITE));
 
+  g_object_class_install_property (gobject_class, PROP_DEFER_INVALIDATIONS,
+                                   g_param_spec_boolean ("defer-invalidations",
+                                                         "Defer invalidations",
+                                                         "Queue invalidations of this node and only propagate them to the rest of the graph, coalesced, before the next render or when gegl_node_flush_invalidations is called.",
+                                                         FALSE,
+                                                         G_PARAM_CONSTRUCT |
+                                                         G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_PREFETCH,
+                                   g_param_spec_boolean ("prefetch",
+                                                         "Prefetch",
+                                                         "Speculatively render the surroundings of the rectangles blitted with GEGL_BLIT_CACHE into the cache, in the background.",
+                                                         FALSE,
+                                                         G_PARAM_CONSTRUCT |
+                                                         G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_HALF_FLOAT_STORAGE,
+                                   g_param_spec_boolean ("half-float-storage",
+                                                         "Half float storage",
+                                                         "Store the cache and the intermediate results of this node as half floats when they are float, the property is inherited by children created from a node.",
+                                                         FALSE,
+                                                         G_PARAM_CONSTRUCT |
+                                                         G_PARAM_READWRITE));
+
   gegl_node_signals[INVALIDATED] =
     g_signal_new ("invalidated",
                   G_TYPE_FROM_CLASS (klass),
@@ -234,6 +274,9 @@ gegl_node_dispose (GObject *gobject)
 {
   GeglNode *self = GEGL_NODE (gobject);
 
+  /* traversals listing this node must not walk it again */
+  g_atomic_int_inc (&topology_serial);
+
   if (self->priv->parent != NULL)
     {
       GeglNode *parent = self->priv->parent;
@@ -291,6 +334,12 @@ gegl_node_finalize (GObject *gobject)
       g_free (self->priv->debug_name);
     }
 
+  if (self->priv->pending_invalidations)
+    {
+      gegl_region_destroy (self->priv->pending_invalidations);
+      g_atomic_int_add (&nodes_with_pending_invalidations, -1);
+    }
+
   g_mutex_clear (&self->mutex);
 
   G_OBJECT_CLASS (gegl_node_parent_class)->finalize (gobject);
@@ -318,10 +367,26 @@ gegl_node_local_set_property (GObject      *gobject,
         node->passthrough = g_value_get_boolean (value);
         break;
 
+      case PROP_DEFER_INVALIDATIONS:
+        node->defer_invalidations = g_value_get_boolean (value);
+        if (!node->defer_invalidations)
+          gegl_node_flush_invalidations (node);
+        break;
+
+      case PROP_PREFETCH:
+        node->prefetch = g_value_get_boolean (value);
+        if (!node->prefetch && node->cache)
+          gegl_prefetcher_cancel (gegl_prefetcher_get (node));
+        break;
+
       case PROP_USE_OPENCL:
         node->use_opencl = g_value_get_boolean (value);
         break;
 
+      case PROP_HALF_FLOAT_STORAGE:
+        node->half_float_storage = g_value_get_boolean (value);
+        break;
+
       case PROP_OP_CLASS:
         {
           va_list null; /* dummy to pass along, it's not used anyways since
@@ -368,10 +433,22 @@ gegl_node_local_get_property (GObject    *gobject,
         g_value_set_boolean (value, node->passthrough);
         break;
 
+      case PROP_DEFER_INVALIDATIONS:
+        g_value_set_boolean (value, node->defer_invalidations);
+        break;
+
+      case PROP_PREFETCH:
+        g_value_set_boolean (value, node->prefetch);
+        break;
+
       case PROP_USE_OPENCL:
         g_value_set_boolean (value, node->use_opencl);
         break;
 
+      case PROP_HALF_FLOAT_STORAGE:
+        g_value_set_boolean (value, node->half_float_storage);
+        break;
+
       case PROP_NAME:
         g_value_set_string (value, gegl_node_get_name (node));
         break;
@@ -506,6 +583,8 @@ gegl_node_add_pad (GeglNode *self,
 
   if (gegl_pad_is_input (pad))
     self->input_pads = g_slist_prepend (self->input_pads, pad);
+
+  g_atomic_int_inc (&topology_serial);
 }
 
 void
@@ -525,6 +604,8 @@ gegl_node_remove_pad (GeglNode *self,
   if (gegl_pad_is_input (pad))
     self->input_pads = g_slist_remove (self->input_pads, pad);
 
+  g_atomic_int_inc (&topology_serial);
+
   pad_node = gegl_pad_get_node (pad);
 
   /* This was a proxy pad, also remove the nop node */
@@ -611,6 +692,10 @@ gegl_node_invalidated (GeglNode            *node,
 
   if (node->cache)
     {
+      /* What is being prefetched would be stale */
+      if (node->prefetch)
+        gegl_prefetcher_cancel (gegl_prefetcher_get (node));
+
       if (rect && clear_cache)
         gegl_buffer_clear (GEGL_BUFFER (node->cache), rect);
 
@@ -618,10 +703,86 @@ gegl_node_invalidated (GeglNode            *node,
     }
   node->valid_have_rect = FALSE;
 
+  if (node->defer_invalidations)
+    {
+      /* Only this node is touched now, the rest of the graph learns
+       * about the union of all queued rectangles when flushed.
+       */
+      g_mutex_lock (&node->mutex);
+
+      if (!node->priv->pending_invalidations)
+        {
+          node->priv->pending_invalidations = gegl_region_new ();
+          g_atomic_int_inc (&nodes_with_pending_invalidations);
+        }
+      gegl_region_union_with_rect (node->priv->pending_invalidations, rect);
+
+      g_mutex_unlock (&node->mutex);
+      return;
+    }
+
   g_signal_emit (node, gegl_node_signals[INVALIDATED], 0,
                  rect, NULL);
 }
 
+/* Above this many rectangles the bounding box of the queued region is
+ * propagated instead, every rectangle costs a walk of the graph.
+ */
+#define GEGL_NODE_MAX_FLUSHED_RECTS 16
+
+void
+gegl_node_flush_invalidations (GeglNode *node)
+{
+  GeglRegion    *region;
+  GeglRectangle *rects   = NULL;
+  gint           n_rects = 0;
+  gint           i;
+
+  g_return_if_fail (GEGL_IS_NODE (node));
+
+  g_mutex_lock (&node->mutex);
+
+  region = node->priv->pending_invalidations;
+  node->priv->pending_invalidations = NULL;
+
+  g_mutex_unlock (&node->mutex);
+
+  if (!region)
+    return;
+
+  g_atomic_int_add (&nodes_with_pending_invalidations, -1);
+
+  gegl_region_get_rectangles (region, &rects, &n_rects);
+
+  if (n_rects > GEGL_NODE_MAX_FLUSHED_RECTS)
+    {
+      gegl_region_get_clipbox (region, &rects[0]);
+      n_rects = 1;
+    }
+
+  GEGL_NOTE (GEGL_DEBUG_INVALIDATION, "flushing %i queued invalidations of %s",
+             n_rects, gegl_node_get_debug_name (node));
+
+  for (i = 0; i < n_rects; i++)
+    g_signal_emit (node, gegl_node_signals[INVALIDATED], 0,
+                   &rects[i], NULL);
+
+  g_free (rects);
+  gegl_region_destroy (region);
+}
+
+gboolean
+gegl_node_invalidations_pending (void)
+{
+  return g_atomic_int_get (&nodes_with_pending_invalidations) > 0;
+}
+
+guint
+gegl_node_get_topology_serial (void)
+{
+  return g_atomic_int_get (&topology_serial);
+}
+
 static void
 gegl_node_source_invalidated (GeglNode            *source,
                               const GeglRectangle *rect,
@@ -696,6 +857,8 @@ gegl_node_connect_from (GeglNode    *sink,
   g_return_val_if_fail (GEGL_IS_NODE (source), FALSE);
   g_return_val_if_fail (source_pad_name != NULL, FALSE);
 
+  gegl_prefetcher_cancel_all ();
+
   if (gegl_node_has_source (source, sink))
     {
       g_warning ("Construction of loop requested, bailing\n");
@@ -752,6 +915,7 @@ gegl_node_connect_from (GeglNode    *sink,
 
       real_sink->priv->source_connections = g_slist_prepend (real_sink->priv->source_connections, connection);
       real_source->priv->sink_connections = g_slist_prepend (real_source->priv->sink_connections, connection);
+      g_atomic_int_inc (&topology_serial);
 
       g_signal_connect (G_OBJECT (real_source), "invalidated",
                         G_CALLBACK (gegl_node_source_invalidated), sink_pad);
@@ -774,6 +938,8 @@ gegl_node_disconnect (GeglNode    *sink,
   g_return_val_if_fail (GEGL_IS_NODE (sink), FALSE);
   g_return_val_if_fail (sink_pad_name != NULL, FALSE);
 
+  gegl_prefetcher_cancel_all ();
+
   /* For graph nodes we implicitly use the proxy nodes */
   if (sink->is_graph)
     {
@@ -817,6 +983,7 @@ gegl_node_disconnect (GeglNode    *sink,
 
       real_sink->priv->source_connections = g_slist_remove (real_sink->priv->source_connections, connection);
       source->priv->sink_connections = g_slist_remove (source->priv->sink_connections, connection);
+      g_atomic_int_inc (&topology_serial);
 
       gegl_connection_destroy (connection);
 
@@ -945,39 +1112,20 @@ gegl_node_get_eval_manager (GeglNode *self)
   return self->priv->eval_manager;
 }
 
-static GeglBuffer *
-gegl_node_apply_roi (GeglNode            *self,
-                     const GeglRectangle *roi,
-                     gint                 level)
-{
-  GeglEvalManager *eval_manager = gegl_node_get_eval_manager (self);
-
-  if (roi)
-    {
-      return gegl_eval_manager_apply (eval_manager, roi, level);
-    }
-  else
-    {
-      GeglRectangle node_bbox = gegl_node_get_bounding_box (self);
-      return gegl_eval_manager_apply (eval_manager, &node_bbox, level);
-    }
-}
-
-void
-gegl_node_blit_buffer (GeglNode            *self,
-                       GeglBuffer          *buffer,
-                       const GeglRectangle *roi,
-                       gint                 level,
-                       GeglAbyssPolicy      abyss_policy) 
+/* Render @roi of @self with @eval_manager, copying it into @buffer if
+ * given. Returns FALSE if nothing was rendered, because @self is a sink
+ * or because processing was cancelled.
+ */
+static gboolean
+gegl_node_blit_buffer_full (GeglNode            *self,
+                            GeglEvalManager     *eval_manager,
+                            GeglBuffer          *buffer,
+                            const GeglRectangle *roi,
+                            gint                 level)
 {
-  // XXX: make use of abyss_policy
-
-  GeglEvalManager *eval_manager;
   GeglBuffer      *result;
   GeglRectangle    request;
 
-  eval_manager = gegl_node_get_eval_manager (self);
-
   if (roi)
     request = *roi;
   else if (buffer)
@@ -992,25 +1140,38 @@ gegl_node_blit_buffer (GeglNode            *self,
       if (buffer)
         gegl_buffer_copy (result, &request, GEGL_ABYSS_NONE, buffer, NULL);
       g_object_unref (result);
+      return TRUE;
     }
+
+  return FALSE;
 }
 
-static inline gboolean gegl_mipmap_rendering_enabled (void)
+void
+gegl_node_blit_buffer (GeglNode            *self,
+                       GeglBuffer          *buffer,
+                       const GeglRectangle *roi,
+                       gint                 level,
+                       GeglAbyssPolicy      abyss_policy) 
 {
-  static int enabled = -1;
-  if (enabled == -1)
-    enabled = g_getenv("GEGL_MIPMAP_RENDERING")!=NULL;
-  return enabled;
+  // XXX: make use of abyss_policy
+
+  gegl_node_blit_buffer_full (self, gegl_node_get_eval_manager (self),
+                              buffer, roi, level);
 }
 
+/* gegl_node_blit with an eval manager of the caller's choosing, so that
+ * a node can be rendered from another thread than the one using the
+ * node's own eval manager.
+ */
 void
-gegl_node_blit (GeglNode            *self,
-                gdouble              scale,
-                const GeglRectangle *roi,
-                const Babl          *format,
-                gpointer             destination_buf,
-                gint                 rowstride,
-                GeglBlitFlags        flags)
+gegl_node_blit_full (GeglNode            *self,
+                     GeglEvalManager     *eval_manager,
+                     gdouble              scale,
+                     const GeglRectangle *roi,
+                     const Babl          *format,
+                     gpointer             destination_buf,
+                     gint                 rowstride,
+                     GeglBlitFlags        flags)
 {
   g_return_if_fail (GEGL_IS_NODE (self));
   g_return_if_fail (roi != NULL);
@@ -1020,19 +1181,18 @@ gegl_node_blit (GeglNode            *self,
 
   if (!flags)
     {
-      GeglBuffer *buffer;
+      GeglBuffer    *buffer;
+      GeglRectangle  request = *roi;
+      gint           level   = 0;
 
       if (scale != 1.0)
         {
-          const GeglRectangle unscaled_roi = _gegl_get_required_for_scale (format, roi, scale);
-
-          buffer = gegl_node_apply_roi (self, &unscaled_roi,
-              gegl_mipmap_rendering_enabled()?gegl_level_from_scale (scale):0);
-        }
-      else
-        {
-          buffer = gegl_node_apply_roi (self, roi, 0);
+          request = _gegl_get_required_for_scale (format, roi, scale);
+          level   = gegl_mipmap_rendering_enabled()?gegl_level_from_scale (scale):0;
         }
+
+      buffer = gegl_eval_manager_apply (eval_manager, &request, level);
+
       if (buffer && destination_buf)
         gegl_buffer_get (buffer, roi, scale, format, destination_buf, rowstride, GEGL_ABYSS_NONE);
 
@@ -1051,13 +1211,13 @@ gegl_node_blit (GeglNode            *self,
               const GeglRectangle unscaled_roi = _gegl_get_required_for_scale (format, roi, scale);
               gint  level = gegl_mipmap_rendering_enabled()?gegl_level_from_scale (scale):0;
 
-              gegl_node_blit_buffer (self, buffer, &unscaled_roi, level, GEGL_ABYSS_NONE);
-              gegl_cache_computed (cache, &unscaled_roi, level);
+              if (gegl_node_blit_buffer_full (self, eval_manager, buffer, &unscaled_roi, level))
+                gegl_cache_computed (cache, &unscaled_roi, level);
             }
           else
             {
-              gegl_node_blit_buffer (self, buffer, roi, 0, GEGL_ABYSS_NONE);
-              gegl_cache_computed (cache, roi, 0);
+              if (gegl_node_blit_buffer_full (self, eval_manager, buffer, roi, 0))
+                gegl_cache_computed (cache, roi, 0);
             }
         }
 
@@ -1070,6 +1230,246 @@ gegl_node_blit (GeglNode            *self,
     }
 }
 
+void
+gegl_node_blit (GeglNode            *self,
+                gdouble              scale,
+                const GeglRectangle *roi,
+                const Babl          *format,
+                gpointer             destination_buf,
+                gint                 rowstride,
+                GeglBlitFlags        flags)
+{
+  GeglPrefetcher *prefetcher = NULL;
+
+  g_return_if_fail (GEGL_IS_NODE (self));
+
+  /* Speculative work must not compete with what is asked for now */
+  if (self->prefetch && (flags & GEGL_BLIT_CACHE))
+    {
+      prefetcher = gegl_prefetcher_get (self);
+      gegl_prefetcher_cancel (prefetcher);
+    }
+
+  gegl_node_blit_full (self, gegl_node_get_eval_manager (self), scale, roi,
+                       format, destination_buf, rowstride, flags);
+
+  if (prefetcher && roi)
+    gegl_prefetcher_request (prefetcher, scale, roi);
+}
+
+/* The level gegl_node_blit renders at for @scale */
+static gint
+gegl_node_get_blit_level (gdouble scale)
+{
+  if (scale == 1.0 || !gegl_mipmap_rendering_enabled ())
+    return 0;
+
+  return gegl_level_from_scale (scale);
+}
+
+/* The nodes rendering @node also renders, by following its sources.
+ * Looked up in, or added to, @upstream which maps nodes to such sets.
+ */
+static GHashTable *
+gegl_node_blit_get_upstream (GHashTable *upstream,
+                             GeglNode   *node)
+{
+  GHashTable *nodes = g_hash_table_lookup (upstream, node);
+  GeglPad    *pad;
+  GSList     *queue;
+
+  if (nodes)
+    return nodes;
+
+  nodes = g_hash_table_new (NULL, NULL);
+  g_hash_table_insert (upstream, node, nodes);
+
+  pad   = gegl_node_get_pad (node, "output");
+  queue = g_slist_prepend (NULL, pad ? gegl_pad_get_node (pad) : node);
+
+  while (queue)
+    {
+      GeglNode *current = queue->data;
+
+      queue = g_slist_delete_link (queue, queue);
+
+      if (g_hash_table_contains (nodes, current))
+        continue;
+
+      g_hash_table_add (nodes, current);
+      queue = g_slist_concat (gegl_node_get_depends_on (current), queue);
+    }
+
+  return nodes;
+}
+
+/* Whether rendering @root also renders @node */
+static gboolean
+gegl_node_blit_renders (GHashTable *upstream,
+                        GeglNode   *root,
+                        GeglNode   *node)
+{
+  GeglPad *pad = gegl_node_get_pad (node, "output");
+
+  return g_hash_table_contains (gegl_node_blit_get_upstream (upstream, root),
+                                pad ? gegl_pad_get_node (pad) : node);
+}
+
+/* Whether rendering @rect of a node along with the rects in @rects
+ * would make it render much more than what was asked for.
+ */
+static gboolean
+gegl_node_blit_request_is_sparse (GArray              *rects,
+                                  const GeglRectangle *rect)
+{
+  GeglRectangle bounds = *rect;
+  gdouble       area   = (gdouble) rect->width * rect->height;
+  gint          i;
+
+  for (i = 0; i < rects->len; i++)
+    {
+      GeglRectangle *other = &g_array_index (rects, GeglRectangle, i);
+
+      gegl_rectangle_bounding_box (&bounds, &bounds, other);
+      area += (gdouble) other->width * other->height;
+    }
+
+  return (gdouble) bounds.width * bounds.height > 2.0 * area;
+}
+
+void
+gegl_node_blit_many (const GeglBlitRequest *requests,
+                     gint                   n_requests)
+{
+  gboolean       *done;
+  gint           *members;
+  GeglNode      **nodes;
+  GeglRectangle  *rois;
+  GeglBuffer    **results;
+  GHashTable     *upstream;
+  gint            i;
+
+  g_return_if_fail (requests != NULL || n_requests == 0);
+
+  for (i = 0; i < n_requests; i++)
+    g_return_if_fail (GEGL_IS_NODE (requests[i].node));
+
+  /* What each requested node renders, computed once for all requests */
+  upstream = g_hash_table_new_full (NULL, NULL, NULL,
+                                    (GDestroyNotify) g_hash_table_unref);
+
+  done    = g_new0 (gboolean, n_requests);
+  members = g_new (gint, n_requests);
+  nodes   = g_new (GeglNode *, n_requests);
+  rois    = g_new (GeglRectangle, n_requests);
+  results = g_new (GeglBuffer *, n_requests);
+
+  for (i = 0; i < n_requests; i++)
+    {
+      GeglEvalManager *eval_manager;
+      GeglNode        *root;
+      GHashTable      *node_rects;
+      gint             level;
+      gint             n_members = 0;
+      gint             j;
+
+      if (done[i])
+        continue;
+
+      level = gegl_node_get_blit_level (requests[i].scale);
+
+      /* Render from the node furthest downstream that the others feed */
+      root = requests[i].node;
+      for (j = i + 1; j < n_requests; j++)
+        {
+          GeglNode *node = requests[j].node;
+
+          if (!done[j] && node != root &&
+              gegl_node_get_blit_level (requests[j].scale) == level &&
+              gegl_node_blit_renders (upstream, node, root))
+            root = node;
+        }
+
+      eval_manager = gegl_node_get_eval_manager (root);
+      node_rects   = g_hash_table_new_full (NULL, NULL, NULL,
+                                            (GDestroyNotify) g_array_unref);
+
+      for (j = i; j < n_requests; j++)
+        {
+          const GeglBlitRequest *request = &requests[j];
+          GeglRectangle          rect;
+          GArray                *rects;
+
+          if (done[j] ||
+              gegl_node_get_blit_level (request->scale) != level ||
+              (request->node != root &&
+               !gegl_node_blit_renders (upstream, root, request->node)))
+            continue;
+
+          rect = request->roi;
+          if (request->scale != 1.0)
+            rect = _gegl_get_required_for_scale (request->format, &request->roi,
+                                                 request->scale);
+
+          rects = g_hash_table_lookup (node_rects, request->node);
+          if (!rects)
+            {
+              rects = g_array_new (FALSE, FALSE, sizeof (GeglRectangle));
+              g_hash_table_insert (node_rects, request->node, rects);
+            }
+          /* Left for a later pass rather than rendering what lies between */
+          else if (gegl_node_blit_request_is_sparse (rects, &rect))
+            {
+              continue;
+            }
+
+          g_array_append_val (rects, rect);
+
+          members[n_members] = j;
+          nodes[n_members]   = request->node;
+          rois[n_members]    = rect;
+          n_members++;
+
+          done[j] = TRUE;
+        }
+
+      g_hash_table_unref (node_rects);
+
+      GEGL_NOTE (GEGL_DEBUG_PROCESS, "Rendering %d of %d blit requests in one pass of %s",
+                 n_members, n_requests, gegl_node_get_debug_name (root));
+
+      gegl_eval_manager_apply_many (eval_manager, nodes, rois, n_members,
+                                    level, results);
+
+      for (j = 0; j < n_members; j++)
+        {
+          const GeglBlitRequest *request   = &requests[members[j]];
+          gint                   rowstride = request->rowstride;
+
+          if (results[j] && request->destination_buf)
+            {
+              if (rowstride == GEGL_AUTO_ROWSTRIDE && request->format)
+                rowstride = babl_format_get_bytes_per_pixel (request->format) *
+                            request->roi.width;
+
+              gegl_buffer_get (results[j], &request->roi, request->scale,
+                               request->format, request->destination_buf,
+                               rowstride, GEGL_ABYSS_NONE);
+            }
+
+          if (results[j])
+            g_object_unref (results[j]);
+        }
+    }
+
+  g_hash_table_unref (upstream);
+  g_free (results);
+  g_free (rois);
+  g_free (nodes);
+  g_free (members);
+  g_free (done);
+}
+
 static GSList *
 gegl_node_get_depends_on (GeglNode *self)
 {
@@ -1174,7 +1574,10 @@ gegl_node_invalidate_have_rect (GObject    *gobject,
                                 gpointer    foo,
                                 gpointer    user_data)
 {
-  GEGL_NODE (user_data)->valid_have_rect = FALSE;
+  GeglNode *self = GEGL_NODE (user_data);
+
+  self->valid_have_rect = FALSE;
+  self->prepare_serial++;
   return TRUE;
 }
 
@@ -1245,10 +1648,13 @@ gegl_node_set_operation_object (GeglNode      *self,
 
   g_return_if_fail (GEGL_IS_OPERATION (operation));
 
+  gegl_prefetcher_cancel_all ();
+
   if (self->operation)
     g_object_unref (self->operation);
 
   self->operation = g_object_ref (operation);
+  self->prepare_serial++;
 
   if (gegl_node_has_pad (self, "output"))
     gegl_node_get_consumers (self, "output", &consumer_nodes, &consumer_names);
@@ -1335,6 +1741,9 @@ gegl_node_set_valist (GeglNode    *self,
 
   g_return_if_fail (GEGL_IS_NODE (self));
 
+  /* prefetch jobs may be rendering with the operation */
+  gegl_prefetcher_cancel_all ();
+
   g_object_freeze_notify (G_OBJECT (self));
 
   property_name = first_property_name;
@@ -1448,6 +1857,8 @@ gegl_node_set_property (GeglNode     *self,
   g_return_if_fail (property_name != NULL);
   g_return_if_fail (value != NULL);
 
+  gegl_prefetcher_cancel_all ();
+
   pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (self), property_name);
   if (pspec)
     {
@@ -1856,6 +2267,8 @@ gegl_node_get_cache (GeglNode *node)
       format = babl_format ("RGBA float");
     }
 
+  format = gegl_node_get_storage_format (node, format);
+
   if (node->cache && gegl_buffer_get_format ((GeglBuffer *)(node->cache)) != format)
     {
       g_object_unref (node->cache);
@@ -1890,6 +2303,16 @@ gegl_node_get_cache (GeglNode *node)
   return node->cache;
 }
 
+const Babl *
+gegl_node_get_storage_format (GeglNode   *node,
+                              const Babl *format)
+{
+  if (node->half_float_storage || gegl_config ()->half_float_storage)
+    return gegl_buffer_half_format (format);
+
+  return format;
+}
+
 const gchar *
 gegl_node_get_name (GeglNode *self)
 {
@@ -1943,6 +2366,7 @@ gegl_node_add_child (GeglNode *self,
 
   child->dont_cache = self->dont_cache;
   child->use_opencl = self->use_opencl;
+  child->half_float_storage = self->half_float_storage;
 
   return child;
 }
@@ -2053,6 +2477,7 @@ gegl_node_create_child (GeglNode    *self,
     {
       ret->dont_cache = self->dont_cache;
       ret->use_opencl = self->use_opencl;
+      ret->half_float_storage = self->half_float_storage;
     }
   return ret;
 }
@@ -303,6 +303,49 @@ void          gegl_node_blit_buffer      (GeglNode            *node,
                                           int                  level,
                                           GeglAbyssPolicy      abyss_policy);
 
+/**
+ * GeglBlitRequest:
+ * @node: the #GeglNode to render from
+ * @scale: the scale to render at, 1.0 is default
+ * @roi: the rectangle to render, in scaled coordinates
+ * @format: the #BablFormat desired
+ * @destination_buf: memory large enough to contain the data, or NULL
+ * @rowstride: rowstride in bytes, or GEGL_AUTO_ROWSTRIDE
+ *
+ * One of the regions rendered by #gegl_node_blit_many, the fields have
+ * the meaning of the arguments of #gegl_node_blit.
+ */
+typedef struct
+{
+  GeglNode      *node;
+  gdouble        scale;
+  GeglRectangle  roi;
+  const Babl    *format;
+  gpointer       destination_buf;
+  gint           rowstride;
+} GeglBlitRequest;
+
+/**
+ * gegl_node_blit_many: (skip)
+ * @requests: the regions to render
+ * @n_requests: the number of @requests
+ *
+ * Render several regions, of one or more nodes of the same graph, as
+ * #gegl_node_blit with GEGL_BLIT_DEFAULT does for each of them.
+ *
+ * Requests rendered at the same level of detail are combined when all
+ * of their nodes are upstream of one of them (or are that node), the
+ * graph is then processed once for all of them and the work they have
+ * in common is only done once. A sink node can be part of the requests
+ * to get the region of its input processed along with the others.
+ *
+ * Requests at different levels are not combined. A scaled down overview
+ * and full resolution regions of the same graph are rendered in
+ * separate passes, which only share what the node caches already hold.
+ */
+void          gegl_node_blit_many        (const GeglBlitRequest *requests,
+                                          gint                   n_requests);
+
 /**
  * gegl_node_process:
  * @sink_node: a #GeglNode without outputs.
@@ -342,6 +385,18 @@ void          gegl_node_blit_buffer      (GeglNode            *node,
  */
 void          gegl_node_process          (GeglNode      *sink_node);
 
+/**
+ * gegl_node_flush_invalidations:
+ * @node: a #GeglNode
+ *
+ * Propagate the invalidations queued on a node with the
+ * "defer-invalidations" property set to the nodes depending on it.
+ * Queued rectangles are coalesced, so many small changes, like the dabs
+ * of a brush stroke, only cause a few walks of the graph. Rendering
+ * flushes the nodes involved automatically.
+ */
+void          gegl_node_flush_invalidations (GeglNode   *node);
+
 
 /***
  * Reparenting:
@@ -21,6 +21,8 @@
 #ifndef __GEGL_OPERATION_CONTEXT_PRIVATE_H__
 #define __GEGL_OPERATION_CONTEXT_PRIVATE_H__
 
+#include "process/gegl-buffer-pool.h"
+
 G_BEGIN_DECLS
 
 
@@ -60,6 +62,9 @@ struct _GeglOperationContext
                                                                    2 = 1:4,
                                                                    4 = 1:8,
                                                                    6 = 1:16 .. */
+  GeglBufferPool *pool;         /* if set, new output buffers come from this
+                                   pool, and go back to it once no context
+                                   holds them */
 };
 
 GeglOperationContext *gegl_operation_context_new       (GeglOperation        *operation);
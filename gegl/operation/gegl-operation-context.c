@@ -119,6 +119,26 @@ property_destroy (Property *property)
   g_slice_free (Property, property);
 }
 
+/* Drop the buffer in @value, handing it back to the pool of @self if
+ * no other context holds it.
+ */
+static void
+gegl_operation_context_release_value (GeglOperationContext *self,
+                                      GValue               *value)
+{
+  GObject *object = g_value_dup_object (value);
+
+  g_value_reset (value);
+
+  if (!object)
+    return;
+
+  if (self->pool)
+    gegl_buffer_pool_release (self->pool, GEGL_BUFFER (object));
+  else
+    g_object_unref (object);
+}
+
 static gint
 lookup_property (gconstpointer a,
                  gconstpointer property_name)
@@ -165,6 +185,7 @@ gegl_operation_context_remove_property (GeglOperationContext *self,
       return;
     }
   self->property = g_slist_remove (self->property, property);
+  gegl_operation_context_release_value (self, &property->value);
   property_destroy (property);
 }
 
@@ -184,7 +205,7 @@ gegl_operation_context_add_value (GeglOperationContext *self,
 
   if (property)
     {
-      g_value_reset (&property->value);
+      gegl_operation_context_release_value (self, &property->value);
       return &property->value;
     }
 
@@ -211,6 +232,7 @@ gegl_operation_context_purge (GeglOperationContext *self)
     {
       Property *property = self->property->data;
       self->property = g_slist_remove (self->property, property);
+      gegl_operation_context_release_value (self, &property->value);
       property_destroy (property);
     }
 }
@@ -246,6 +268,9 @@ gegl_operation_context_take_object (GeglOperationContext *context,
   g_return_if_fail (!data || GEGL_IS_BUFFER (data));
 
   storage = gegl_operation_context_add_value (context, padname);
+
+  if (data && context->pool)
+    gegl_buffer_pool_hold (context->pool, GEGL_BUFFER (data));
   g_value_take_object (storage, data);
 }
 
@@ -316,6 +341,8 @@ gegl_operation_context_get_target (GeglOperationContext *context,
   g_assert (format != NULL);
   g_assert (!strcmp (padname, "output"));
 
+  format = gegl_node_get_storage_format (node, format);
+
   result = &context->result_rect;
 
   if (result->width == 0 ||
@@ -344,6 +371,8 @@ gegl_operation_context_get_target (GeglOperationContext *context,
         {
           if (linear_buffers)
             output = gegl_buffer_linear_new (result, format);
+          else if (context->pool)
+            output = gegl_buffer_pool_get (context->pool, result, format);
           else
             output = gegl_buffer_new (result, format);
         }
@@ -352,6 +381,8 @@ gegl_operation_context_get_target (GeglOperationContext *context,
     {
       if (linear_buffers)
         output = gegl_buffer_linear_new (result, format);
+      else if (context->pool)
+        output = gegl_buffer_pool_get (context->pool, result, format);
       else
         output = gegl_buffer_new (result, format);
     }
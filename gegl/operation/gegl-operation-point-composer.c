@@ -29,9 +29,16 @@
 #include <unistd.h>
 #include <string.h>
 
+typedef struct
+{
+  const gchar                    *format;
+  const gchar                    *aux_format;
+  GeglOperationPointComposerFunc  process;
+} PointComposerFormat;
+
 typedef struct ThreadData
 {
-  GeglOperationPointComposerClass *klass;
+  GeglOperationPointComposerFunc   process;
   GeglOperation                   *operation;
   guchar                          *input;
   guchar                          *aux;
@@ -48,38 +55,60 @@ typedef struct ThreadData
   const Babl *input_fish;
   const Babl *aux_fish;
   const Babl *output_fish;
+  gint        in_buf_bpp;
+  gint        aux_buf_bpp;
+  gint        out_buf_bpp;
+  gint        chunk_pixels;
 } ThreadData;
 
 static void thread_process (gpointer thread_data, gpointer unused)
 {
   ThreadData *data = thread_data;
+  GeglRectangle roi = data->roi;
+  gint rows = data->roi.height;
+  gint y;
 
-  guchar *input = data->input;
-  guchar *aux = data->aux;
-  guchar *output = data->output;
-  glong samples = data->roi.width * data->roi.height;
+  /* with conversions, go through the scratch buffers a band of rows
+   * at a time, it stays in cache between the conversions and process
+   */
+  if (data->input_fish || data->aux_fish || data->output_fish)
+    rows = MAX (data->chunk_pixels / data->roi.width, 1);
 
-  if (data->input_fish && input)
-    {
-      babl_process (data->input_fish, data->input, data->in_tmp, samples);
-      input = data->in_tmp;
-    }
-  if (data->aux_fish && aux)
+  for (y = 0; y < data->roi.height; y += rows)
     {
-      babl_process (data->aux_fish, data->aux, data->aux_tmp, samples);
-      aux = data->aux_tmp;
+      glong offset = (glong) y * data->roi.width;
+      guchar *input = data->input ? data->input + offset * data->in_buf_bpp : NULL;
+      guchar *aux = data->aux ? data->aux + offset * data->aux_buf_bpp : NULL;
+      guchar *output = data->output + offset * data->out_buf_bpp;
+      guchar *output_buf = output;
+      glong samples;
+
+      roi.y = data->roi.y + y;
+      roi.height = MIN (rows, data->roi.height - y);
+      samples = roi.width * roi.height;
+
+      if (data->input_fish && input)
+        {
+          babl_process (data->input_fish, input, data->in_tmp, samples);
+          input = data->in_tmp;
+        }
+      if (data->aux_fish && aux)
+        {
+          babl_process (data->aux_fish, aux, data->aux_tmp, samples);
+          aux = data->aux_tmp;
+        }
+      if (data->output_fish)
+        output = data->output_tmp;
+
+      if (!data->process (data->operation,
+                           input, aux,
+                           output, samples,
+                           &roi, data->level))
+        data->success = FALSE;
+
+      if (data->output_fish)
+        babl_process (data->output_fish, data->output_tmp, output_buf, samples);
     }
-  if (data->output_fish)
-    output = data->output_tmp;
-
-  if (!data->klass->process (data->operation,
-                       input, aux,
-                       output, samples,
-                       &data->roi, data->level))
-    data->success = FALSE;
-  
-  if (data->output_fish)
-    babl_process (data->output_fish, data->output_tmp, data->output, samples);
 
   g_atomic_int_add (data->pending, -1);
 }
@@ -170,9 +199,13 @@ G_DEFINE_TYPE (GeglOperationPointComposer, gegl_operation_point_composer, GEGL_T
 
 static void prepare (GeglOperation *operation)
 {
-  const Babl *format = babl_format ("RGBA float");
+  const Babl *aux_format = babl_format ("RGBA float");
+  const Babl *format;
+
+  format = gegl_operation_point_composer_select_format (operation, aux_format,
+                                                        &aux_format);
   gegl_operation_set_format (operation, "input", format);
-  gegl_operation_set_format (operation, "aux", format);
+  gegl_operation_set_format (operation, "aux", aux_format);
   gegl_operation_set_format (operation, "output", format);
 }
 
@@ -196,6 +229,63 @@ gegl_operation_point_composer_init (GeglOperationPointComposer *self)
 
 }
 
+void
+gegl_operation_point_composer_class_add_format (GeglOperationPointComposerClass *klass,
+                                                const gchar                     *format,
+                                                const gchar                     *aux_format,
+                                                GeglOperationPointComposerFunc   process)
+{
+  PointComposerFormat *variant = g_new (PointComposerFormat, 1);
+
+  variant->format     = format;
+  variant->aux_format = aux_format ? aux_format : format;
+  variant->process    = process;
+
+  klass->formats = g_slist_prepend (klass->formats, variant);
+}
+
+static PointComposerFormat *
+lookup_format (GeglOperationPointComposerClass *klass,
+               const Babl                      *format)
+{
+  GSList *iter;
+
+  for (iter = klass->formats; iter; iter = iter->next)
+    {
+      PointComposerFormat *variant = iter->data;
+
+      if (babl_format (variant->format) == format)
+        return variant;
+    }
+  return NULL;
+}
+
+const Babl *
+gegl_operation_point_composer_select_format (GeglOperation  *operation,
+                                             const Babl     *format,
+                                             const Babl    **aux_format)
+{
+  GeglOperationPointComposerClass *klass = GEGL_OPERATION_POINT_COMPOSER_GET_CLASS (operation);
+  const Babl *source     = gegl_operation_get_source_format (operation, "input");
+  const Babl *aux_source = gegl_operation_get_source_format (operation, "aux");
+  PointComposerFormat *variant = NULL;
+
+  if (source &&
+      babl_format_get_model (source) == babl_format_get_model (format))
+    variant = lookup_format (klass, source);
+
+  /* a more precise aux would be quantized to the format of the variant */
+  if (variant && aux_source &&
+      aux_source != babl_format (variant->aux_format))
+    variant = NULL;
+
+  if (!variant)
+    return format;
+
+  *aux_format = babl_format (variant->aux_format);
+  return source;
+}
+
 static gboolean
 gegl_operation_point_composer_process (GeglOperation       *operation,
                                        GeglBuffer          *input,
@@ -208,7 +298,10 @@ gegl_operation_point_composer_process (GeglOperation       *operation,
   const Babl *in_format   = gegl_operation_get_format (operation, "input");
   const Babl *aux_format  = gegl_operation_get_format (operation, "aux");
   const Babl *out_format  = gegl_operation_get_format (operation, "output");
+  PointComposerFormat *variant = lookup_format (point_composer_class, in_format);
+  GeglOperationPointComposerFunc process;
 
+  process = variant ? variant->process : point_composer_class->process;
 
   if ((result->width > 0) && (result->height > 0))
     {
@@ -234,6 +327,10 @@ gegl_operation_point_composer_process (GeglOperation       *operation,
         gint out_buf_bpp = babl_format_get_bytes_per_pixel (output_buf_format);
         gint temp_id = 0;
 
+        /* the scratch of a thread holds at least a row of result */
+        gint chunk_pixels = MAX (GEGL_POINT_SCRATCH_SIZE / MAX (MAX (in_bpp, aux_bpp), out_bpp),
+                                 result->width);
+
         if (input)
         {
           read = gegl_buffer_iterator_add (i, input, result, level, in_buf_format,
@@ -243,7 +340,7 @@ gegl_operation_point_composer_process (GeglOperation       *operation,
             if (in_buf_format != in_format)
             {
               thread_data[j].input_fish = babl_fish (in_buf_format, in_format);
-              thread_data[j].in_tmp = gegl_temp_buffer (temp_id++, in_bpp * result->width * result->height);
+              thread_data[j].in_tmp = gegl_temp_buffer (temp_id++, in_bpp * chunk_pixels);
             }
             else
             {
@@ -263,7 +360,7 @@ gegl_operation_point_composer_process (GeglOperation       *operation,
             if (aux_buf_format != aux_format)
             {
               thread_data[j].aux_fish = babl_fish (aux_buf_format, aux_format);
-              thread_data[j].aux_tmp = gegl_temp_buffer (temp_id++, aux_bpp * result->width * result->height);
+              thread_data[j].aux_tmp = gegl_temp_buffer (temp_id++, aux_bpp * chunk_pixels);
             }
             else
             {
@@ -279,15 +376,19 @@ gegl_operation_point_composer_process (GeglOperation       *operation,
 
         for (gint j = 0; j < threads; j ++)
         {
-          if (output_buf_format != gegl_buffer_get_format (output))
+          if (output_buf_format != out_format)
           {
             thread_data[j].output_fish = babl_fish (out_format, output_buf_format);
-            thread_data[j].output_tmp = gegl_temp_buffer (temp_id++, out_bpp * result->width * result->height);
+            thread_data[j].output_tmp = gegl_temp_buffer (temp_id++, out_bpp * chunk_pixels);
           }
           else
           {
             thread_data[j].output_fish = NULL;
           }
+          thread_data[j].in_buf_bpp = in_buf_bpp;
+          thread_data[j].aux_buf_bpp = aux_buf_bpp;
+          thread_data[j].out_buf_bpp = out_buf_bpp;
+          thread_data[j].chunk_pixels = chunk_pixels;
         }
 
         while (gegl_buffer_iterator_next (i))
@@ -315,7 +416,7 @@ gegl_operation_point_composer_process (GeglOperation       *operation,
             
             for (gint j = 0; j < threads; j++)
             {
-              thread_data[j].klass = point_composer_class;
+              thread_data[j].process = process;
               thread_data[j].operation = operation;
               thread_data[j].input = input?((guchar*)i->data[read]) + (bit * j * i->roi[0].width * in_buf_bpp):NULL;
               thread_data[j].aux = aux?((guchar*)i->data[foo]) + (bit * j * i->roi[0].width * aux_buf_bpp):NULL;
@@ -347,9 +448,9 @@ gegl_operation_point_composer_process (GeglOperation       *operation,
 
         while (gegl_buffer_iterator_next (i))
           {
-            point_composer_class->process (operation, input?i->data[read]:NULL,
-                                                      aux?i->data[foo]:NULL,
-                                                      i->data[0], i->length, &(i->roi[0]), level);
+            process (operation, input?i->data[read]:NULL,
+                                aux?i->data[foo]:NULL,
+                                i->data[0], i->length, &(i->roi[0]), level);
           }
         return TRUE;
       }
@@ -45,6 +45,14 @@ struct _GeglOperationPointComposer
   /*< private >*/
 };
 
+typedef gboolean (* GeglOperationPointComposerFunc) (GeglOperation       *self,
+                                                     void                *in,
+                                                     void                *aux,
+                                                     void                *out,
+                                                     glong                samples,
+                                                     const GeglRectangle *roi,
+                                                     gint                 level);
+
 typedef struct _GeglOperationPointComposerClass GeglOperationPointComposerClass;
 struct _GeglOperationPointComposerClass
 {
@@ -65,11 +73,48 @@ struct _GeglOperationPointComposerClass
                            size_t               global_worksize,
                            const GeglRectangle *roi,
                            gint                 level);
-  gpointer                 pad[4];
+
+  /*< private >*/
+  GSList                  *formats;
+  gpointer                 pad[3];
 };
 
 GType gegl_operation_point_composer_get_type (void) G_GNUC_CONST;
 
+/**
+ * gegl_operation_point_composer_class_add_format:
+ * @klass: a point composer class
+ * @format: name of the babl format of input and output @process works in
+ * @aux_format: name of the babl format of aux, or NULL for @format
+ * @process: the process function for buffers of @format
+ *
+ * Registers a variant of the process function working directly on pixels
+ * of @format, saving the conversions to and from the float format of the
+ * operation when the input already is in @format.
+ */
+void         gegl_operation_point_composer_class_add_format
+                                 (GeglOperationPointComposerClass *klass,
+                                  const gchar                     *format,
+                                  const gchar                     *aux_format,
+                                  GeglOperationPointComposerFunc   process);
+
+/**
+ * gegl_operation_point_composer_select_format:
+ * @operation: a point composer
+ * @format: the format the operation would process in
+ * @aux_format: (inout): the aux format the operation would process in
+ *
+ * To be called from prepare. Returns the format of the input when a
+ * variant was registered for it, it has the same components as @format
+ * and aux is either not connected or already in the aux format of the
+ * variant, and sets @aux_format to that format. Returns @format
+ * otherwise.
+ */
+const Babl * gegl_operation_point_composer_select_format
+                                 (GeglOperation                   *operation,
+                                  const Babl                      *format,
+                                  const Babl                     **aux_format);
+
 G_END_DECLS
 
 #endif
@@ -51,44 +51,67 @@ typedef struct ThreadData
   const Babl *aux_fish;
   const Babl *aux2_fish;
   const Babl *output_fish;
+  gint        in_buf_bpp;
+  gint        aux_buf_bpp;
+  gint        aux2_buf_bpp;
+  gint        out_buf_bpp;
+  gint        chunk_pixels;
 } ThreadData;
 
 static void thread_process (gpointer thread_data, gpointer unused)
 {
   ThreadData *data = thread_data;
+  GeglRectangle roi = data->roi;
+  gint rows = data->roi.height;
+  gint y;
 
-  guchar *input = data->input;
-  guchar *aux = data->aux;
-  guchar *aux2 = data->aux2;
-  guchar *output = data->output;
-  glong samples = data->roi.width * data->roi.height;
+  /* with conversions, go through the scratch buffers a band of rows
+   * at a time, it stays in cache between the conversions and process
+   */
+  if (data->input_fish || data->aux_fish || data->aux2_fish || data->output_fish)
+    rows = MAX (data->chunk_pixels / data->roi.width, 1);
 
-  if (data->input_fish && input)
-    {
-      babl_process (data->input_fish, data->input, data->in_tmp, samples);
-      input = data->in_tmp;
-    }
-  if (data->aux_fish && aux)
+  for (y = 0; y < data->roi.height; y += rows)
     {
-      babl_process (data->aux_fish, data->aux, data->aux_tmp, samples);
-      aux = data->aux_tmp;
-    }
-  if (data->aux2_fish && aux2)
-    {
-      babl_process (data->aux2_fish, data->aux2, data->aux2_tmp, samples);
-      aux2 = data->aux2_tmp;
+      glong offset = (glong) y * data->roi.width;
+      guchar *input = data->input ? data->input + offset * data->in_buf_bpp : NULL;
+      guchar *aux = data->aux ? data->aux + offset * data->aux_buf_bpp : NULL;
+      guchar *aux2 = data->aux2 ? data->aux2 + offset * data->aux2_buf_bpp : NULL;
+      guchar *output = data->output + offset * data->out_buf_bpp;
+      guchar *output_buf = output;
+      glong samples;
+
+      roi.y = data->roi.y + y;
+      roi.height = MIN (rows, data->roi.height - y);
+      samples = roi.width * roi.height;
+
+      if (data->input_fish && input)
+        {
+          babl_process (data->input_fish, input, data->in_tmp, samples);
+          input = data->in_tmp;
+        }
+      if (data->aux_fish && aux)
+        {
+          babl_process (data->aux_fish, aux, data->aux_tmp, samples);
+          aux = data->aux_tmp;
+        }
+      if (data->aux2_fish && aux2)
+        {
+          babl_process (data->aux2_fish, aux2, data->aux2_tmp, samples);
+          aux2 = data->aux2_tmp;
+        }
+      if (data->output_fish)
+        output = data->output_tmp;
+
+      if (!data->klass->process (data->operation,
+                                 input, aux, aux2,
+                                 output, samples,
+                                 &roi, data->level))
+        data->success = FALSE;
+
+      if (data->output_fish)
+        babl_process (data->output_fish, data->output_tmp, output_buf, samples);
     }
-  if (data->output_fish)
-    output = data->output_tmp;
-
-  if (!data->klass->process (data->operation,
-                       input, aux, aux2, 
-                       output, samples,
-                       &data->roi, data->level))
-    data->success = FALSE;
-  
-  if (data->output_fish)
-    babl_process (data->output_fish, data->output_tmp, data->output, samples);
 
   g_atomic_int_add (data->pending, -1);
 }
@@ -255,6 +278,11 @@ gegl_operation_point_composer3_process (GeglOperation       *operation,
 
         gint temp_id = 0;
 
+        /* the scratch of a thread holds at least a row of result */
+        gint chunk_pixels = MAX (GEGL_POINT_SCRATCH_SIZE /
+                                 MAX (MAX (in_bpp, aux_bpp), MAX (aux2_bpp, out_bpp)),
+                                 result->width);
+
         if (input)
         {
           read = gegl_buffer_iterator_add (i, input, result, level, in_buf_format, GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
@@ -263,7 +291,7 @@ gegl_operation_point_composer3_process (GeglOperation       *operation,
             if (in_buf_format != in_format)
             {
               thread_data[j].input_fish = babl_fish (in_buf_format, in_format);
-              thread_data[j].in_tmp = gegl_temp_buffer (temp_id++, in_bpp * result->width * result->height);
+              thread_data[j].in_tmp = gegl_temp_buffer (temp_id++, in_bpp * chunk_pixels);
             }
             else
             {
@@ -283,7 +311,7 @@ gegl_operation_point_composer3_process (GeglOperation       *operation,
             if (aux_buf_format != aux_format)
             {
               thread_data[j].aux_fish = babl_fish (aux_buf_format, aux_format);
-              thread_data[j].aux_tmp = gegl_temp_buffer (temp_id++, aux_bpp * result->width * result->height);
+              thread_data[j].aux_tmp = gegl_temp_buffer (temp_id++, aux_bpp * chunk_pixels);
             }
             else
             {
@@ -305,7 +333,7 @@ gegl_operation_point_composer3_process (GeglOperation       *operation,
             if (aux2_buf_format != aux2_format)
             {
               thread_data[j].aux2_fish = babl_fish (aux2_buf_format, aux2_format);
-              thread_data[j].aux2_tmp = gegl_temp_buffer (temp_id++, aux2_bpp * result->width * result->height);
+              thread_data[j].aux2_tmp = gegl_temp_buffer (temp_id++, aux2_bpp * chunk_pixels);
             }
             else
             {
@@ -321,15 +349,20 @@ gegl_operation_point_composer3_process (GeglOperation       *operation,
 
         for (gint j = 0; j < threads; j ++)
         {
-          if (output_buf_format != gegl_buffer_get_format (output))
+          if (output_buf_format != out_format)
           {
             thread_data[j].output_fish = babl_fish (out_format, output_buf_format);
-            thread_data[j].output_tmp = gegl_temp_buffer (temp_id++, out_bpp * result->width * result->height);
+            thread_data[j].output_tmp = gegl_temp_buffer (temp_id++, out_bpp * chunk_pixels);
           }
           else
           {
             thread_data[j].output_fish = NULL;
           }
+          thread_data[j].in_buf_bpp = in_buf_bpp;
+          thread_data[j].aux_buf_bpp = aux_buf_bpp;
+          thread_data[j].aux2_buf_bpp = aux2_buf_bpp;
+          thread_data[j].out_buf_bpp = out_buf_bpp;
+          thread_data[j].chunk_pixels = chunk_pixels;
         }
 
         while (gegl_buffer_iterator_next (i))
@@ -33,9 +33,40 @@
 #include "opencl/gegl-cl.h"
 #include "gegl-buffer-cl-iterator.h"
 
+typedef struct
+{
+  const gchar                  *format;
+  GeglOperationPointFilterFunc  process;
+} PointFilterFormat;
+
+/* A lookup table mapping all the values of an integer format, for each
+ * value the converted result of process for a pixel with all components
+ * set to it.
+ */
+typedef struct
+{
+  gint        ref_count;
+  const Babl *format;
+  const Babl *float_format;
+  gint        components;
+  gint        entries;
+  guchar     *table;
+} PointFilterLut;
+
+typedef struct
+{
+  const Babl     *lut_format;  /* the float format the table maps through */
+  PointFilterLut *lut;
+  GMutex          lut_mutex;   /* protects lut, threads process with a ref */
+} GeglOperationPointFilterPrivate;
+
+#define GEGL_OPERATION_POINT_FILTER_GET_PRIVATE(obj) \
+  G_TYPE_INSTANCE_GET_PRIVATE (obj, GEGL_TYPE_OPERATION_POINT_FILTER, GeglOperationPointFilterPrivate)
+
 typedef struct ThreadData
 {
-  GeglOperationPointFilterClass *klass;
+  GeglOperationPointFilterFunc     process;
+  PointFilterLut                  *lut;
   GeglOperation                   *operation;
   guchar                          *input;
   guchar                          *output;
@@ -49,32 +80,60 @@ typedef struct ThreadData
   guchar                          *output_tmp;
   const Babl *input_fish;
   const Babl *output_fish;
+  gint        in_buf_bpp;
+  gint        out_buf_bpp;
+  gint        chunk_pixels;
 } ThreadData;
 
+static void process_lut (PointFilterLut *lut,
+                         void           *in_buf,
+                         void           *out_buf,
+                         glong           samples);
+
 static void thread_process (gpointer thread_data, gpointer unused)
 {
   ThreadData *data = thread_data;
+  GeglRectangle roi = data->roi;
+  gint rows = data->roi.height;
+  gint y;
 
-  guchar *input = data->input;
-  guchar *output = data->output;
-  glong samples = data->roi.width * data->roi.height;
+  /* with conversions, go through the scratch buffers a band of rows
+   * at a time, it stays in cache between the conversions and process
+   */
+  if (data->input_fish || data->output_fish)
+    rows = MAX (data->chunk_pixels / data->roi.width, 1);
 
-  if (data->input_fish && input)
+  for (y = 0; y < data->roi.height; y += rows)
     {
-      babl_process (data->input_fish, data->input, data->in_tmp, samples);
-      input = data->in_tmp;
+      glong offset = (glong) y * data->roi.width;
+      guchar *input = data->input ? data->input + offset * data->in_buf_bpp : NULL;
+      guchar *output = data->output + offset * data->out_buf_bpp;
+      guchar *output_buf = output;
+      glong samples;
+
+      roi.y = data->roi.y + y;
+      roi.height = MIN (rows, data->roi.height - y);
+      samples = roi.width * roi.height;
+
+      if (data->input_fish && input)
+        {
+          babl_process (data->input_fish, input, data->in_tmp, samples);
+          input = data->in_tmp;
+        }
+      if (data->output_fish)
+        output = data->output_tmp;
+
+      if (data->lut)
+        process_lut (data->lut, input, output, samples);
+      else if (!data->process (data->operation,
+                                input,
+                                output, samples,
+                                &roi, data->level))
+        data->success = FALSE;
+
+      if (data->output_fish)
+        babl_process (data->output_fish, data->output_tmp, output_buf, samples);
     }
-  if (data->output_fish)
-    output = data->output_tmp;
-
-  if (!data->klass->process (data->operation,
-                       input, 
-                       output, samples,
-                       &data->roi, data->level))
-    data->success = FALSE;
-  
-  if (data->output_fish)
-    babl_process (data->output_fish, data->output_tmp, data->output, samples);
 
   g_atomic_int_add (data->pending, -1);
 }
@@ -155,7 +214,10 @@ G_DEFINE_TYPE (GeglOperationPointFilter, gegl_operation_point_filter, GEGL_TYPE_
 
 static void prepare (GeglOperation *operation)
 {
-  const Babl *format = babl_format ("RGBA float");
+  const Babl *format;
+
+  format = gegl_operation_point_filter_select_format (operation,
+                                                      babl_format ("RGBA float"));
   gegl_operation_set_format (operation, "input", format);
   gegl_operation_set_format (operation, "output", format);
 }
@@ -245,12 +307,63 @@ error:
   return FALSE;
 }
 
+static PointFilterLut *
+lut_ref (PointFilterLut *lut)
+{
+  g_atomic_int_inc (&lut->ref_count);
+  return lut;
+}
+
+static void
+lut_unref (PointFilterLut *lut)
+{
+  if (!g_atomic_int_dec_and_test (&lut->ref_count))
+    return;
+
+  g_free (lut->table);
+  g_free (lut);
+}
+
+static void
+drop_lut (GObject    *object,
+          GParamSpec *pspec,
+          gpointer    user_data)
+{
+  GeglOperationPointFilterPrivate *priv = GEGL_OPERATION_POINT_FILTER_GET_PRIVATE (object);
+  PointFilterLut                  *lut;
+
+  g_mutex_lock (&priv->lut_mutex);
+  lut = priv->lut;
+  priv->lut = NULL;
+  g_mutex_unlock (&priv->lut_mutex);
+
+  /* threads still processing with it hold their own reference */
+  if (lut)
+    lut_unref (lut);
+}
+
+static void
+finalize (GObject *object)
+{
+  GeglOperationPointFilterPrivate *priv = GEGL_OPERATION_POINT_FILTER_GET_PRIVATE (object);
+
+  g_clear_pointer (&priv->lut, lut_unref);
+  g_mutex_clear (&priv->lut_mutex);
+
+  G_OBJECT_CLASS (gegl_operation_point_filter_parent_class)->finalize (object);
+}
+
 static void
 gegl_operation_point_filter_class_init (GeglOperationPointFilterClass *klass)
 {
+  GObjectClass                *object_class    = G_OBJECT_CLASS (klass);
   GeglOperationClass          *operation_class = GEGL_OPERATION_CLASS (klass);
   GeglOperationFilterClass *filter_class  = GEGL_OPERATION_FILTER_CLASS (klass);
 
+  g_type_class_add_private (klass, sizeof (GeglOperationPointFilterPrivate));
+
+  object_class->finalize = finalize;
+
   filter_class->process = gegl_operation_point_filter_process;
   operation_class->process = gegl_operation_filter_process;
   operation_class->prepare = prepare;
@@ -262,7 +375,167 @@ gegl_operation_point_filter_class_init (GeglOperationPointFilterClass *klass)
 static void
 gegl_operation_point_filter_init (GeglOperationPointFilter *self)
 {
+  GeglOperationPointFilterPrivate *priv = GEGL_OPERATION_POINT_FILTER_GET_PRIVATE (self);
+
+  g_mutex_init (&priv->lut_mutex);
 
+  /* the table depends on the properties */
+  g_signal_connect (self, "notify", G_CALLBACK (drop_lut), NULL);
+}
+
+void
+gegl_operation_point_filter_class_add_format (GeglOperationPointFilterClass *klass,
+                                              const gchar                   *format,
+                                              GeglOperationPointFilterFunc   process)
+{
+  PointFilterFormat *variant = g_new (PointFilterFormat, 1);
+
+  variant->format  = format;
+  variant->process = process;
+
+  klass->formats = g_slist_prepend (klass->formats, variant);
+}
+
+static GeglOperationPointFilterFunc
+lookup_format (GeglOperationPointFilterClass *klass,
+               const Babl                    *format)
+{
+  GSList *iter;
+
+  for (iter = klass->formats; iter; iter = iter->next)
+    {
+      PointFilterFormat *variant = iter->data;
+
+      if (babl_format (variant->format) == format)
+        return variant->process;
+    }
+  return NULL;
+}
+
+static gint
+lut_entries (const Babl *format)
+{
+  const Babl *type = babl_format_get_type (format, 0);
+
+  if (type == babl_type ("u8"))
+    return 256;
+  else if (type == babl_type ("u16"))
+    return 65536;
+  return 0;
+}
+
+const Babl *
+gegl_operation_point_filter_select_format (GeglOperation *operation,
+                                           const Babl    *format)
+{
+  GeglOperationPointFilterClass   *klass = GEGL_OPERATION_POINT_FILTER_GET_CLASS (operation);
+  GeglOperationPointFilterPrivate *priv  = GEGL_OPERATION_POINT_FILTER_GET_PRIVATE (operation);
+  const Babl *source = gegl_operation_get_source_format (operation, "input");
+
+  priv->lut_format = NULL;
+
+  if (source &&
+      babl_format_get_model (source) == babl_format_get_model (format))
+    {
+      if (lookup_format (klass, source))
+        return source;
+
+      if (klass->per_channel && lut_entries (source))
+        {
+          priv->lut_format = format;
+          return source;
+        }
+    }
+
+  return format;
+}
+
+/* Computes the table by running process on a ramp of all the values of
+ * format, the ramp and the results are converted the same way they would
+ * be without the table.
+ */
+static PointFilterLut *
+lut_new (GeglOperation *operation,
+         const Babl    *format,
+         const Babl    *float_format)
+{
+  GeglOperationPointFilterClass *klass = GEGL_OPERATION_POINT_FILTER_GET_CLASS (operation);
+  PointFilterLut *lut = g_new0 (PointFilterLut, 1);
+  gfloat         *ramp;
+  gfloat         *mapped;
+  gint            i, c;
+
+  lut->ref_count    = 1;
+  lut->format       = format;
+  lut->float_format = float_format;
+  lut->components   = babl_format_get_n_components (format);
+  lut->entries      = lut_entries (format);
+  lut->table        = g_malloc (lut->entries * babl_format_get_bytes_per_pixel (format));
+
+  ramp   = g_new (gfloat, lut->entries * lut->components);
+  mapped = g_new (gfloat, lut->entries * lut->components);
+
+  for (i = 0; i < lut->entries; i++)
+    for (c = 0; c < lut->components; c++)
+      {
+        if (lut->entries == 256)
+          ((guint8 *) lut->table)[i * lut->components + c] = i;
+        else
+          ((guint16 *) lut->table)[i * lut->components + c] = i;
+      }
+
+  babl_process (babl_fish (format, lut->float_format), lut->table, ramp,
+                lut->entries);
+
+  klass->process (operation, ramp, mapped, lut->entries,
+                  GEGL_RECTANGLE (0, 0, lut->entries, 1), 0);
+
+  babl_process (babl_fish (lut->float_format, format), mapped, lut->table,
+                lut->entries);
+
+  g_free (ramp);
+  g_free (mapped);
+
+  return lut;
+}
+
+static void
+process_lut (PointFilterLut *lut,
+             void           *in_buf,
+             void           *out_buf,
+             glong           samples)
+{
+  gint            components = lut->components;
+  gint            c;
+
+  if (lut->entries == 256)
+    {
+      const guint8 *table = (const guint8 *) lut->table;
+      const guint8 *in    = in_buf;
+      guint8       *out   = out_buf;
+
+      while (samples--)
+        {
+          for (c = 0; c < components; c++)
+            out[c] = table[in[c] * components + c];
+          in  += components;
+          out += components;
+        }
+    }
+  else
+    {
+      const guint16 *table = (const guint16 *) lut->table;
+      const guint16 *in    = in_buf;
+      guint16       *out   = out_buf;
+
+      while (samples--)
+        {
+          for (c = 0; c < components; c++)
+            out[c] = table[in[c] * components + c];
+          in  += components;
+          out += components;
+        }
+    }
 }
 
 static gboolean
@@ -276,14 +549,36 @@ gegl_operation_point_filter_process (GeglOperation       *operation,
   GeglOperationPointFilterClass *point_filter_class = GEGL_OPERATION_POINT_FILTER_GET_CLASS (operation);
   const Babl *in_format   = gegl_operation_get_format (operation, "input");
   const Babl *out_format  = gegl_operation_get_format (operation, "output");
+  GeglOperationPointFilterPrivate *priv = GEGL_OPERATION_POINT_FILTER_GET_PRIVATE (operation);
+  GeglOperationPointFilterFunc process = lookup_format (point_filter_class, in_format);
+  PointFilterLut *lut = NULL;
+
+  if (!process && point_filter_class->per_channel && priv->lut_format &&
+      in_format == out_format && lut_entries (in_format))
+    {
+      g_mutex_lock (&priv->lut_mutex);
+      if (!priv->lut || priv->lut->format != in_format ||
+          priv->lut->float_format != priv->lut_format)
+        {
+          g_clear_pointer (&priv->lut, lut_unref);
+          priv->lut = lut_new (operation, in_format, priv->lut_format);
+        }
+      /* a property change may drop the table while we use it */
+      lut = lut_ref (priv->lut);
+      g_mutex_unlock (&priv->lut_mutex);
+    }
 
+  if (!process)
+    process = point_filter_class->process;
 
   if ((result->width > 0) && (result->height > 0))
     {
       const Babl *in_buf_format  = input?gegl_buffer_get_format(input):NULL;
       const Babl *output_buf_format = output?gegl_buffer_get_format(output):NULL;
 
-      if (gegl_operation_use_opencl (operation) && (operation_class->cl_data || point_filter_class->cl_process))
+      /* the kernels only know the float format of the operation */
+      if (!lut && process == point_filter_class->process &&
+          gegl_operation_use_opencl (operation) && (operation_class->cl_data || point_filter_class->cl_process))
       {
         if (gegl_operation_point_filter_cl_process (operation, input, output, result, level))
             return TRUE;
@@ -303,6 +598,10 @@ gegl_operation_point_filter_process (GeglOperation       *operation,
         gint out_buf_bpp = babl_format_get_bytes_per_pixel (output_buf_format);
         gint temp_id = 0;
 
+        /* the scratch of a thread holds at least a row of result */
+        gint chunk_pixels = MAX (GEGL_POINT_SCRATCH_SIZE / MAX (in_bpp, out_bpp),
+                                 result->width);
+
         if (input)
         {
           read = gegl_buffer_iterator_add (i, input, result, level, in_buf_format, GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
@@ -311,7 +610,7 @@ gegl_operation_point_filter_process (GeglOperation       *operation,
             if (in_buf_format != in_format)
             {
               thread_data[j].input_fish = babl_fish (in_buf_format, in_format);
-              thread_data[j].in_tmp = gegl_temp_buffer (temp_id++, in_bpp * result->width * result->height);
+              thread_data[j].in_tmp = gegl_temp_buffer (temp_id++, in_bpp * chunk_pixels);
             }
             else
             {
@@ -325,15 +624,18 @@ gegl_operation_point_filter_process (GeglOperation       *operation,
 
         for (gint j = 0; j < threads; j ++)
         {
-          if (output_buf_format != gegl_buffer_get_format (output))
+          if (output_buf_format != out_format)
           {
             thread_data[j].output_fish = babl_fish (out_format, output_buf_format);
-            thread_data[j].output_tmp = gegl_temp_buffer (temp_id++, out_bpp * result->width * result->height);
+            thread_data[j].output_tmp = gegl_temp_buffer (temp_id++, out_bpp * chunk_pixels);
           }
           else
           {
             thread_data[j].output_fish = NULL;
           }
+          thread_data[j].in_buf_bpp = in_buf_bpp;
+          thread_data[j].out_buf_bpp = out_buf_bpp;
+          thread_data[j].chunk_pixels = chunk_pixels;
         }
 
         while (gegl_buffer_iterator_next (i))
@@ -361,7 +663,8 @@ gegl_operation_point_filter_process (GeglOperation       *operation,
             
             for (gint j = 0; j < threads; j++)
             {
-              thread_data[j].klass = point_filter_class;
+              thread_data[j].process = process;
+              thread_data[j].lut = lut;
               thread_data[j].operation = operation;
               thread_data[j].input = input?((guchar*)i->data[read]) + (bit * j * i->roi[0].width * in_buf_bpp):NULL;
               thread_data[j].output = ((guchar*)i->data[0]) + (bit * j * i->roi[0].width * out_buf_bpp);
@@ -377,8 +680,6 @@ gegl_operation_point_filter_process (GeglOperation       *operation,
 
             while (g_atomic_int_get (&pending)) {};
           }
-
-        return TRUE;
       }
       else
       {
@@ -392,11 +693,17 @@ gegl_operation_point_filter_process (GeglOperation       *operation,
 
         while (gegl_buffer_iterator_next (i))
           {
-            point_filter_class->process (operation, input?i->data[read]:NULL,
-                                                    i->data[0], i->length, &(i->roi[0]), level);
+            if (lut)
+              process_lut (lut, input?i->data[read]:NULL, i->data[0], i->length);
+            else
+              process (operation, input?i->data[read]:NULL,
+                                  i->data[0], i->length, &(i->roi[0]), level);
           }
-        return TRUE;
       }
     }
+
+  if (lut)
+    lut_unref (lut);
+
   return TRUE;
 }
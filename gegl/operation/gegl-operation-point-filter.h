@@ -45,6 +45,13 @@ struct _GeglOperationPointFilter
   GeglOperationFilter parent_instance;
 };
 
+typedef gboolean (* GeglOperationPointFilterFunc) (GeglOperation       *self,
+                                                   void                *in_buf,
+                                                   void                *out_buf,
+                                                   glong                samples,
+                                                   const GeglRectangle *roi,
+                                                   gint                 level);
+
 typedef struct _GeglOperationPointFilterClass GeglOperationPointFilterClass;
 struct _GeglOperationPointFilterClass
 {
@@ -65,11 +72,49 @@ struct _GeglOperationPointFilterClass
                            size_t               global_worksize,
                            const GeglRectangle *roi,
                            gint                 level);
-  gpointer                 pad[4];
+
+  /* set when each output component only depends on the same input
+   * component, integer inputs are then mapped through a lookup table
+   * computed with process
+   */
+  gboolean                 per_channel;
+
+  /*< private >*/
+  GSList                  *formats;
+  gpointer                 pad[2];
 };
 
 GType gegl_operation_point_filter_get_type (void) G_GNUC_CONST;
 
+/**
+ * gegl_operation_point_filter_class_add_format:
+ * @klass: a point filter class
+ * @format: name of the babl format @process works in
+ * @process: the process function for buffers of @format
+ *
+ * Registers a variant of the process function working directly on pixels
+ * of @format, saving the conversions to and from the float format of the
+ * operation when the input already is in @format.
+ */
+void         gegl_operation_point_filter_class_add_format
+                                 (GeglOperationPointFilterClass *klass,
+                                  const gchar                   *format,
+                                  GeglOperationPointFilterFunc   process);
+
+/**
+ * gegl_operation_point_filter_select_format:
+ * @operation: a point filter
+ * @format: the format the operation would process in
+ *
+ * To be called from prepare. Returns the format of the input when a
+ * variant was registered for it, or when it is a u8 or u16 format and the
+ * class is per_channel, and it has the same components as @format.
+ * Returns @format otherwise.
+ */
+const Babl * gegl_operation_point_filter_select_format
+                                 (GeglOperation                 *operation,
+                                  const Babl                    *format);
+
 G_END_DECLS
 
 #endif
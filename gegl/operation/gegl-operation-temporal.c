@@ -22,9 +22,15 @@
 #include <string.h>
 
 #include "gegl.h"
+#include "gegl-config.h"
 #include "gegl-operation-temporal.h"
 #include "gegl-operation-context.h"
 
+/* The history is kept as a ring of buffers, one per frame, so that a
+ * frame can be handed out as is rather than through a shifted view of a
+ * shared store. A slot that is no longer referenced from the outside is
+ * overwritten in place when it is evicted, reusing its tiles.
+ */
 struct _GeglOperationTemporalPrivate
 {
   gint                count;
@@ -33,7 +39,8 @@ struct _GeglOperationTemporalPrivate
   gint                width;
   gint                height;
   gint                next_to_write;
-  GeglBuffer         *frame_store;
+  gint                n_frames;
+  GeglBuffer        **frames;
 };
 
 static void gegl_operation_temporal_prepare (GeglOperation *operation);
@@ -46,6 +53,39 @@ G_DEFINE_TYPE (GeglOperationTemporal,
   G_TYPE_INSTANCE_GET_PRIVATE (obj, GEGL_TYPE_OPERATION_TEMPORAL, GeglOperationTemporalPrivate)
 
 
+static void
+gegl_operation_temporal_clear_frames (GeglOperationTemporalPrivate *priv)
+{
+  gint i;
+
+  for (i = 0; i < priv->n_frames; i++)
+    g_clear_object (&priv->frames[i]);
+  g_free (priv->frames);
+
+  priv->frames        = NULL;
+  priv->n_frames      = 0;
+  priv->count         = 0;
+  priv->next_to_write = 0;
+}
+
+/* The number of frames actually kept, the requested history length
+ * limited to what fits in the tile cache.
+ */
+static gint
+gegl_operation_temporal_ring_length (GeglOperationTemporalPrivate *priv,
+                                     const Babl                   *format)
+{
+  guint64 frame_size = (guint64) priv->width * priv->height *
+                       babl_format_get_bytes_per_pixel (format);
+  guint64 max_frames;
+
+  if (frame_size == 0)
+    return priv->history_length;
+
+  max_frames = gegl_config ()->tile_cache_size / frame_size;
+
+  return CLAMP ((gint64) max_frames, 1, priv->history_length);
+}
 
 GeglBuffer *
 gegl_operation_temporal_get_frame (GeglOperation *op,
@@ -53,31 +93,17 @@ gegl_operation_temporal_get_frame (GeglOperation *op,
 {
   GeglOperationTemporal *temporal= GEGL_OPERATION_TEMPORAL (op);
   GeglOperationTemporalPrivate *priv = temporal->priv;
-  GeglBuffer   *buffer;
-
-   if (frame > priv->count)
-     {
-       frame = (priv->count-1);
-       if (frame<0)
-         frame=0;
-       g_print ("%i > priv->count(%i), using frame %i", frame, priv->count,
-        frame);
-     }
-   else
-     {
-       frame = (priv->next_to_write - 1 + priv->history_length + frame) % priv->history_length;
-       g_print ("using frame %i", frame);
-     }
-  /* build in shift */
-  buffer = g_object_new (GEGL_TYPE_BUFFER,
-                         "source",  priv->frame_store,
-                         "shift-y", frame * priv->height,
-                         "width", priv->width,
-                         "height", priv->height,
-                         "x", 0,
-                         "y", 0,
-                         NULL);
-  return buffer;
+  gint available;
+
+  if (priv->n_frames == 0)
+    return NULL;
+
+  /* 0 is the most recent frame, -1 the one before it and so on */
+  available = MIN (priv->count, priv->n_frames);
+  frame = CLAMP (frame, -(available - 1), 0);
+  frame = (priv->next_to_write - 1 + priv->n_frames + frame) % priv->n_frames;
+
+  return g_object_ref (priv->frames[frame]);
 }
 
 static gboolean gegl_operation_temporal_process (GeglOperation       *self,
@@ -89,22 +115,40 @@ static gboolean gegl_operation_temporal_process (GeglOperation       *self,
   GeglOperationTemporal *temporal = GEGL_OPERATION_TEMPORAL (self);
   GeglOperationTemporalPrivate *priv = temporal->priv;
   GeglOperationTemporalClass *temporal_class;
+  const Babl *format = gegl_buffer_get_format (input);
+  GeglBuffer **slot;
 
   temporal_class = GEGL_OPERATION_TEMPORAL_GET_CLASS (self);
 
+  if (priv->width != result->width || priv->height != result->height)
+    gegl_operation_temporal_clear_frames (priv);
+
   priv->width  = result->width;
   priv->height = result->height;
 
-  {
-   GeglRectangle write_rect = *result;
-   write_rect.y = priv->next_to_write * priv->height;
+  if (!priv->frames)
+    {
+      priv->n_frames = gegl_operation_temporal_ring_length (priv, format);
+      priv->frames   = g_new0 (GeglBuffer *, priv->n_frames);
+    }
+
+  slot = &priv->frames[priv->next_to_write];
+
+  /* a frame still held by someone else must not change under them */
+  if (*slot && (G_OBJECT (*slot)->ref_count > 1 ||
+                gegl_buffer_get_format (*slot) != format ||
+                !gegl_rectangle_equal (gegl_buffer_get_extent (*slot), result)))
+    g_clear_object (slot);
 
-   gegl_buffer_copy (input, result, GEGL_ABYSS_NONE, priv->frame_store, &write_rect);
-   priv->count++;
-   priv->next_to_write++;
-   if (priv->next_to_write >= priv->history_length)
-     priv->next_to_write=0;
-  }
+  if (!*slot)
+    *slot = gegl_buffer_new (result, format);
+
+  gegl_buffer_copy (input, result, GEGL_ABYSS_NONE, *slot, result);
+
+  priv->count++;
+  priv->next_to_write++;
+  if (priv->next_to_write >= priv->n_frames)
+    priv->next_to_write = 0;
 
  if (temporal_class->process)
    return temporal_class->process (self, input, output, result, level);
@@ -117,12 +161,24 @@ static void gegl_operation_temporal_prepare (GeglOperation *operation)
   gegl_operation_set_format (operation, "input", babl_format ("RGB u8"));
 }
 
+static void
+gegl_operation_temporal_finalize (GObject *object)
+{
+  GeglOperationTemporal *self = GEGL_OPERATION_TEMPORAL (object);
+
+  gegl_operation_temporal_clear_frames (self->priv);
+
+  G_OBJECT_CLASS (gegl_operation_temporal_parent_class)->finalize (object);
+}
+
 static void
 gegl_operation_temporal_class_init (GeglOperationTemporalClass *klass)
 {
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
   GeglOperationClass *operation_class = GEGL_OPERATION_CLASS (klass);
   GeglOperationFilterClass *operation_filter_class = GEGL_OPERATION_FILTER_CLASS (klass);
 
+  object_class->finalize = gegl_operation_temporal_finalize;
   operation_class->prepare = gegl_operation_temporal_prepare;
   operation_filter_class->process = gegl_operation_temporal_process;
 
@@ -133,22 +189,16 @@ static void
 gegl_operation_temporal_init (GeglOperationTemporal *self)
 {
   GeglOperationTemporalPrivate *priv;
-  GeglRectangle rect = { 0, 0, 4096, 4096*600 };
 
   self->priv = GEGL_OPERATION_TEMPORAL_GET_PRIVATE(self);
   priv=self->priv;
   priv->count          = 0;
   priv->history_length = 500;
-  priv->width          = 1024;
-  priv->height         = 1024;
+  priv->width          = 0;
+  priv->height         = 0;
   priv->next_to_write  = 0;
-
-  /* FIXME: the format used for the frame_store should be autodetected from
-   * input
-   */
-  priv->frame_store    =
-      gegl_buffer_new (&rect, babl_format ("RGB u8"));
-;
+  priv->n_frames       = 0;
+  priv->frames         = NULL;
 }
 
 void gegl_operation_temporal_set_history_length (GeglOperation *op,
@@ -156,7 +206,15 @@ void gegl_operation_temporal_set_history_length (GeglOperation *op,
 {
   GeglOperationTemporal *self = GEGL_OPERATION_TEMPORAL (op);
   GeglOperationTemporalPrivate *priv = self->priv;
-  priv->history_length = history_length;
+
+  history_length = MAX (history_length, 1);
+
+  if (history_length != priv->history_length)
+    {
+      /* the ring is sized again for the next frame */
+      gegl_operation_temporal_clear_frames (priv);
+      priv->history_length = history_length;
+    }
 }
 
 guint gegl_operation_temporal_get_history_length (GeglOperation *op)
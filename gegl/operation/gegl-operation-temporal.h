@@ -19,7 +19,8 @@
 /* GeglOperationTemporal
  * Base class for operations that want access to previous frames in a video sequence,
  * it contains API to configure the amounts of frames to store as well as getting a
- * GeglBuffer pointing to any of the previously stored frames.
+ * GeglBuffer pointing to any of the previously stored frames. The number of frames
+ * kept is further limited to what fits in the tile cache.
  */
 
 #ifndef __GEGL_OPERATION_TEMPORAL_H__
@@ -63,7 +64,11 @@ void gegl_operation_temporal_set_history_length (GeglOperation *op,
 
 guint gegl_operation_temporal_get_history_length (GeglOperation *op);
 
-/* you need to unref the buffer when you're done with it */
+/* Get the stored @frame, 0 being the most recent frame and negative
+ * values going back in history, or NULL before the first frame. The
+ * buffer is the stored frame itself rather than a copy, you need to
+ * unref it when you're done with it.
+ */
 GeglBuffer *gegl_operation_temporal_get_frame (GeglOperation *op,
                                                gint           frame);
 
@@ -464,6 +464,26 @@ gegl_operation_detect (GeglOperation *operation,
   return NULL;
 }
 
+/* Only meaningful after the operation was prepared, the answer may
+ * depend on the formats and bounding boxes it was prepared for.
+ */
+gboolean
+gegl_operation_is_identity (GeglOperation *operation)
+{
+  GeglOperationClass *klass;
+
+  g_return_val_if_fail (GEGL_IS_OPERATION (operation), FALSE);
+
+  klass = GEGL_OPERATION_GET_CLASS (operation);
+
+  if (!klass->is_identity ||
+      !gegl_node_has_pad (operation->node, "input") ||
+      !gegl_node_has_pad (operation->node, "output"))
+    return FALSE;
+
+  return klass->is_identity (operation);
+}
+
 void
 gegl_operation_set_format (GeglOperation *self,
                            const gchar   *pad_name,
@@ -801,30 +821,51 @@ gegl_operation_use_threading (GeglOperation *operation,
   return FALSE;
 }
 
-static guchar *gegl_temp_alloc[GEGL_MAX_THREADS * 4]={NULL,};
-static gint    gegl_temp_size[GEGL_MAX_THREADS * 4]={0,};
+/* Every thread gets its own set, nodes of independent branches of a
+ * graph may be processed at the same time.
+ */
+typedef struct
+{
+  guchar *alloc[GEGL_MAX_THREADS * 4];
+  gint    size[GEGL_MAX_THREADS * 4];
+} GeglTempBuffers;
+
+static void
+gegl_temp_buffers_destroy (gpointer data)
+{
+  GeglTempBuffers *temp = data;
+  int no;
+
+  for (no = 0; no < GEGL_MAX_THREADS * 4; no++)
+    if (temp->alloc[no])
+      gegl_free (temp->alloc[no]);
+  g_free (temp);
+}
+
+static GPrivate gegl_temp_buffers = G_PRIVATE_INIT (gegl_temp_buffers_destroy);
 
 guchar *gegl_temp_buffer (int no, int size)
 {
-  if (!gegl_temp_alloc[no] || gegl_temp_size[no] < size)
+  GeglTempBuffers *temp = g_private_get (&gegl_temp_buffers);
+
+  if (!temp)
   {
-    if (gegl_temp_alloc[no])
-      gegl_free (gegl_temp_alloc[no]);
-    gegl_temp_alloc[no] = gegl_malloc (size);
-    gegl_temp_size[no] = size;
+    temp = g_new0 (GeglTempBuffers, 1);
+    g_private_set (&gegl_temp_buffers, temp);
   }
-  return gegl_temp_alloc[no];
+
+  if (!temp->alloc[no] || temp->size[no] < size)
+  {
+    if (temp->alloc[no])
+      gegl_free (temp->alloc[no]);
+    temp->alloc[no] = gegl_malloc (size);
+    temp->size[no] = size;
+  }
+  return temp->alloc[no];
 }
 
 void gegl_temp_buffer_free (void);
 void gegl_temp_buffer_free (void)
 {
-  int no;
-  for (no = 0; no < GEGL_MAX_THREADS * 4; no++)
-    if (gegl_temp_alloc[no])
-    {
-      gegl_free (gegl_temp_alloc[no]);
-      gegl_temp_alloc[no] = NULL;
-      gegl_temp_size[no] = 0;
-    }
+  g_private_replace (&gegl_temp_buffers, NULL);
 }
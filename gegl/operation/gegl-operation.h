@@ -151,7 +151,14 @@ struct _GeglOperationClass
 
   GeglClRunData *cl_data;
 
-  gpointer      pad[9];
+  /* Whether the output of this operation is its "input" unchanged, given
+   * the current properties and input. The graph traversal skips
+   * processing of operations that report being an identity, without
+   * touching the graph itself.
+   */
+  gboolean      (*is_identity)               (GeglOperation       *operation);
+
+  gpointer      pad[8];
 };
 
 
@@ -181,6 +188,8 @@ GeglNode       *gegl_operation_detect        (GeglOperation *operation,
                                               gint           x,
                                               gint           y);
 
+gboolean        gegl_operation_is_identity   (GeglOperation *operation);
+
 
 /* virtual method invokers that change behavior based on the roi being computed,
  * needs a context_id being based that is used for storing context data.
@@ -271,6 +280,7 @@ gboolean gegl_operation_cl_set_kernel_args (GeglOperation *operation,
 gboolean gegl_can_do_inplace_processing      (GeglOperation       *operation,
                                               GeglBuffer          *input,
                                               const GeglRectangle *result);
+void     gegl_object_unset_has_forked        (GObject             *object);
 
 /**
  * gegl_object_set_has_forked: (skip)
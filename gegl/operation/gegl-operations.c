@@ -344,6 +344,11 @@ gegl_object_set_has_forked (GObject *object)
   g_object_set_qdata (object, gegl_has_forked_quark (), (void*)0xf);
 }
 
+void
+gegl_object_unset_has_forked (GObject *object)
+{
+  g_object_set_qdata (object, gegl_has_forked_quark (), NULL);
+}
 
 gboolean
 gegl_object_get_has_forked (GObject *object)
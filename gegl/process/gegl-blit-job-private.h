@@ -0,0 +1,29 @@
+/* This file is part of GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEGL_BLIT_JOB_PRIVATE_H__
+#define __GEGL_BLIT_JOB_PRIVATE_H__
+
+G_BEGIN_DECLS
+
+/* TRUE while the calling thread renders a tile of a job, waiting for a
+ * job from there would never return.
+ */
+gboolean gegl_blit_job_in_render_thread (void);
+
+G_END_DECLS
+
+#endif /* __GEGL_BLIT_JOB_PRIVATE_H__ */
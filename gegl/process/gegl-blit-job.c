@@ -0,0 +1,361 @@
+/* This file is part of GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib-object.h>
+#include <gio/gio.h>
+
+#include "gegl.h"
+#include "gegl-types-internal.h"
+#include "gegl-config.h"
+#include "gegl-debug.h"
+
+#include "graph/gegl-node-private.h"
+
+#include "process/gegl-eval-manager.h"
+#include "process/gegl-blit-job.h"
+#include "process/gegl-blit-job-private.h"
+
+struct _GeglBlitJob
+{
+  gint                ref_count;
+
+  GeglNode           *node;
+  gdouble             scale;
+  GeglRectangle       roi;
+  const Babl         *format;
+  guchar             *destination_buf;
+  gint                rowstride;
+  GeglBlitFlags       flags;
+  gint                priority;
+  gint                serial;      /* keeps jobs of equal priority in order */
+
+  GCancellable       *cancellable;
+  GeglBlitJobCallback callback;
+  gpointer            user_data;
+  GMainContext       *context;
+
+  /* Only used from the render thread */
+  GeglEvalManager    *eval_manager;
+
+  GMutex              mutex;
+  GCond               cond;
+  gint                tiles_left;
+  gint                tiles_rendered;
+  gint                n_tiles;
+  gboolean            done;
+  gboolean            completed;
+};
+
+typedef struct
+{
+  GeglBlitJob   *job;
+  GeglRectangle  rect;
+  gint           index;
+} GeglBlitTile;
+
+/* Set while a tile is rendered, waiting for a job from there would never
+ * return.
+ */
+static GPrivate render_thread_key;
+
+gboolean
+gegl_blit_job_in_render_thread (void)
+{
+  return g_private_get (&render_thread_key) != NULL;
+}
+
+static gint
+gegl_blit_tile_compare (gconstpointer a,
+                        gconstpointer b,
+                        gpointer      user_data)
+{
+  const GeglBlitTile *tile_a = a;
+  const GeglBlitTile *tile_b = b;
+
+  if (tile_a->job->priority != tile_b->job->priority)
+    return tile_a->job->priority < tile_b->job->priority ? -1 : 1;
+
+  if (tile_a->job->serial != tile_b->job->serial)
+    return tile_a->job->serial < tile_b->job->serial ? -1 : 1;
+
+  return tile_a->index - tile_b->index;
+}
+
+static gboolean
+gegl_blit_job_dispatch (gpointer data)
+{
+  GeglBlitJob *job = data;
+
+  job->callback (job, job->completed, job->user_data);
+
+  return FALSE;
+}
+
+static void
+gegl_blit_job_finish (GeglBlitJob *job)
+{
+  if (job->eval_manager)
+    {
+      g_object_unref (job->eval_manager);
+      job->eval_manager = NULL;
+    }
+
+  g_mutex_lock (&job->mutex);
+  job->completed = job->tiles_rendered == job->n_tiles;
+  job->done      = TRUE;
+  g_cond_broadcast (&job->cond);
+  g_mutex_unlock (&job->mutex);
+
+  GEGL_NOTE (GEGL_DEBUG_PROCESS, "Blit job of %s %s",
+             gegl_node_get_debug_name (job->node),
+             job->completed ? "completed" : "cancelled");
+
+  if (job->callback)
+    g_main_context_invoke_full (job->context, G_PRIORITY_DEFAULT,
+                                gegl_blit_job_dispatch,
+                                gegl_blit_job_ref (job),
+                                (GDestroyNotify) gegl_blit_job_unref);
+
+  /* A finished job must not keep the node alive, whoever holds on to the
+   * job might be owned by the node.
+   */
+  g_clear_object (&job->node);
+
+  /* The reference held while rendering */
+  gegl_blit_job_unref (job);
+}
+
+static void
+gegl_blit_job_run_tile (gpointer data,
+                        gpointer user_data)
+{
+  GeglBlitTile *tile = data;
+  GeglBlitJob  *job  = tile->job;
+  gboolean      last;
+
+  if (!g_cancellable_is_cancelled (job->cancellable))
+    {
+      guchar *destination = NULL;
+
+      if (job->destination_buf)
+        destination = job->destination_buf +
+                      (tile->rect.y - job->roi.y) * job->rowstride +
+                      (tile->rect.x - job->roi.x) * babl_format_get_bytes_per_pixel (job->format);
+
+      if (!job->eval_manager)
+        job->eval_manager = gegl_eval_manager_new (job->node, "output");
+
+      /* Checked by the graph traversal between nodes */
+      g_cancellable_push_current (job->cancellable);
+      g_private_set (&render_thread_key, job);
+      gegl_node_blit_full (job->node, job->eval_manager, job->scale,
+                           &tile->rect, job->format, destination,
+                           job->rowstride, job->flags);
+      g_private_set (&render_thread_key, NULL);
+      g_cancellable_pop_current (job->cancellable);
+
+      if (!g_cancellable_is_cancelled (job->cancellable))
+        job->tiles_rendered++;
+    }
+
+  g_slice_free (GeglBlitTile, tile);
+
+  g_mutex_lock (&job->mutex);
+  last = --job->tiles_left == 0;
+  g_mutex_unlock (&job->mutex);
+
+  if (last)
+    gegl_blit_job_finish (job);
+}
+
+/* The first tile boundary after @v */
+static inline gint
+gegl_blit_job_next_edge (gint v,
+                         gint size)
+{
+  gint tile = v >= 0 ? v / size : -((size - 1 - v) / size);
+
+  return (tile + 1) * size;
+}
+
+/* A single render thread, the graph traversal and the operations
+ * spread the work of each tile over the other threads.
+ */
+static GThreadPool *
+gegl_blit_job_thread_pool (void)
+{
+  static GThreadPool *pool = NULL;
+
+  if (g_once_init_enter (&pool))
+    {
+      GThreadPool *new_pool = g_thread_pool_new (gegl_blit_job_run_tile, NULL,
+                                                 1, FALSE, NULL);
+
+      g_thread_pool_set_sort_function (new_pool, gegl_blit_tile_compare, NULL);
+      g_once_init_leave (&pool, new_pool);
+    }
+
+  return pool;
+}
+
+GeglBlitJob *
+gegl_node_blit_async (GeglNode            *node,
+                      gdouble              scale,
+                      const GeglRectangle *roi,
+                      const Babl          *format,
+                      gpointer             destination_buf,
+                      gint                 rowstride,
+                      GeglBlitFlags        flags,
+                      gint                 priority,
+                      GeglBlitJobCallback  callback,
+                      gpointer             user_data)
+{
+  static gint   serial = 0;
+  GThreadPool  *pool;
+  GeglBlitJob  *job;
+  GSList       *tiles = NULL;
+  GSList       *iter;
+  gint          tile_width  = gegl_config ()->tile_width;
+  gint          tile_height = gegl_config ()->tile_height;
+  gint          x, y;
+
+  g_return_val_if_fail (GEGL_IS_NODE (node), NULL);
+  g_return_val_if_fail (roi != NULL, NULL);
+
+  if (rowstride == GEGL_AUTO_ROWSTRIDE && format)
+    rowstride = babl_format_get_bytes_per_pixel (format) * roi->width;
+
+  job = g_slice_new0 (GeglBlitJob);
+  job->ref_count       = 2; /* ours, and the one held while rendering */
+  job->node            = g_object_ref (node);
+  job->scale           = scale;
+  job->roi             = *roi;
+  job->format          = format;
+  job->destination_buf = destination_buf;
+  job->rowstride       = rowstride;
+  job->flags           = flags;
+  job->priority        = priority;
+  job->serial          = g_atomic_int_add (&serial, 1);
+  job->cancellable     = g_cancellable_new ();
+  job->callback        = callback;
+  job->user_data       = user_data;
+  job->context         = g_main_context_ref_thread_default ();
+
+  g_mutex_init (&job->mutex);
+  g_cond_init (&job->cond);
+
+  /* Along the tile grid, so that tiles of the cache are computed whole */
+  for (y = roi->y; y < roi->y + roi->height; y = gegl_blit_job_next_edge (y, tile_height))
+    for (x = roi->x; x < roi->x + roi->width; x = gegl_blit_job_next_edge (x, tile_width))
+      {
+        GeglBlitTile *tile = g_slice_new (GeglBlitTile);
+
+        tile->job         = job;
+        tile->index       = job->n_tiles++;
+        tile->rect.x      = x;
+        tile->rect.y      = y;
+        tile->rect.width  = MIN (gegl_blit_job_next_edge (x, tile_width),
+                                 roi->x + roi->width) - x;
+        tile->rect.height = MIN (gegl_blit_job_next_edge (y, tile_height),
+                                 roi->y + roi->height) - y;
+
+        tiles = g_slist_prepend (tiles, tile);
+      }
+
+  job->tiles_left = job->n_tiles;
+
+  if (job->n_tiles == 0)
+    {
+      gegl_blit_job_finish (job);
+      return job;
+    }
+
+  pool  = gegl_blit_job_thread_pool ();
+  tiles = g_slist_reverse (tiles);
+
+  for (iter = tiles; iter; iter = iter->next)
+    g_thread_pool_push (pool, iter->data, NULL);
+
+  g_slist_free (tiles);
+
+  return job;
+}
+
+GeglBlitJob *
+gegl_blit_job_ref (GeglBlitJob *job)
+{
+  g_return_val_if_fail (job != NULL, NULL);
+
+  g_atomic_int_inc (&job->ref_count);
+
+  return job;
+}
+
+void
+gegl_blit_job_unref (GeglBlitJob *job)
+{
+  g_return_if_fail (job != NULL);
+
+  if (!g_atomic_int_dec_and_test (&job->ref_count))
+    return;
+
+  g_clear_object (&job->node);
+  g_object_unref (job->cancellable);
+  g_main_context_unref (job->context);
+  g_mutex_clear (&job->mutex);
+  g_cond_clear (&job->cond);
+  g_slice_free (GeglBlitJob, job);
+}
+
+void
+gegl_blit_job_cancel (GeglBlitJob *job)
+{
+  g_return_if_fail (job != NULL);
+
+  g_cancellable_cancel (job->cancellable);
+}
+
+gboolean
+gegl_blit_job_wait (GeglBlitJob *job)
+{
+  gboolean completed;
+
+  g_return_val_if_fail (job != NULL, FALSE);
+
+  g_mutex_lock (&job->mutex);
+  while (!job->done)
+    g_cond_wait (&job->cond, &job->mutex);
+  completed = job->completed;
+  g_mutex_unlock (&job->mutex);
+
+  return completed;
+}
+
+gboolean
+gegl_blit_job_is_done (GeglBlitJob *job)
+{
+  gboolean done;
+
+  g_return_val_if_fail (job != NULL, FALSE);
+
+  g_mutex_lock (&job->mutex);
+  done = job->done;
+  g_mutex_unlock (&job->mutex);
+
+  return done;
+}
@@ -0,0 +1,117 @@
+/* This file is part of GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEGL_BLIT_JOB_H__
+#define __GEGL_BLIT_JOB_H__
+
+G_BEGIN_DECLS
+
+/***
+ * GeglBlitJob:
+ *
+ * A #GeglBlitJob is the handle of a rendering started with
+ * #gegl_node_blit_async. Rendering happens on a background thread, tile
+ * by tile, and can be cancelled between tiles and between the nodes of
+ * the graph.
+ */
+typedef struct _GeglBlitJob GeglBlitJob;
+
+/**
+ * GeglBlitJobCallback:
+ * @job: the #GeglBlitJob that finished
+ * @completed: TRUE if the whole rectangle was rendered, FALSE if the
+ * job was cancelled
+ * @user_data: the user data passed to #gegl_node_blit_async
+ */
+typedef void (*GeglBlitJobCallback) (GeglBlitJob *job,
+                                     gboolean     completed,
+                                     gpointer     user_data);
+
+/**
+ * gegl_node_blit_async:
+ * @node: a #GeglNode
+ * @scale: the scale to render at, 1.0 is default
+ * @roi: the rectangle to render, in scaled coordinates
+ * @format: the #BablFormat desired
+ * @destination_buf: (allow-none): the buffer to render into, it must stay
+ * valid until the job finished
+ * @rowstride: rowstride in bytes, or GEGL_AUTO_ROWSTRIDE to compute it
+ * @flags: #GeglBlitFlags, as for #gegl_node_blit
+ * @priority: the priority of the job, jobs with a lower value are rendered
+ * first, e.g. G_PRIORITY_HIGH for the visible part of a view and
+ * G_PRIORITY_LOW for prefetching
+ * @callback: (allow-none) (scope async): called when the job finished or
+ * was cancelled
+ * @user_data: user data for @callback
+ *
+ * Start rendering like #gegl_node_blit does, without waiting for the
+ * result. The tiles of jobs with a higher priority are rendered before
+ * the remaining tiles of jobs with a lower priority, even when those
+ * were started earlier.
+ *
+ * @callback is invoked in the thread-default main context of the
+ * thread calling this function. The graph must not be changed while a
+ * job renders it. Prefetch jobs are the exception, changing operations,
+ * properties or connections through the #GeglNode API stops them first.
+ *
+ * Return value: (transfer full): a #GeglBlitJob, to be released with
+ * #gegl_blit_job_unref
+ */
+GeglBlitJob * gegl_node_blit_async   (GeglNode            *node,
+                                      gdouble              scale,
+                                      const GeglRectangle *roi,
+                                      const Babl          *format,
+                                      gpointer             destination_buf,
+                                      gint                 rowstride,
+                                      GeglBlitFlags        flags,
+                                      gint                 priority,
+                                      GeglBlitJobCallback  callback,
+                                      gpointer             user_data);
+
+GeglBlitJob * gegl_blit_job_ref      (GeglBlitJob         *job);
+void          gegl_blit_job_unref    (GeglBlitJob         *job);
+
+/**
+ * gegl_blit_job_cancel:
+ * @job: a #GeglBlitJob
+ *
+ * Ask @job to stop. Tiles that were not started are skipped, and the
+ * tile being rendered is abandoned at the next node of the graph. The
+ * contents of the destination buffer are undefined for a cancelled job.
+ */
+void          gegl_blit_job_cancel   (GeglBlitJob         *job);
+
+/**
+ * gegl_blit_job_wait:
+ * @job: a #GeglBlitJob
+ *
+ * Block until @job finished or was cancelled.
+ *
+ * Return value: TRUE if the whole rectangle was rendered
+ */
+gboolean      gegl_blit_job_wait     (GeglBlitJob         *job);
+
+/**
+ * gegl_blit_job_is_done:
+ * @job: a #GeglBlitJob
+ *
+ * Return value: TRUE if @job finished or was cancelled
+ */
+gboolean      gegl_blit_job_is_done  (GeglBlitJob         *job);
+
+G_END_DECLS
+
+#endif /* __GEGL_BLIT_JOB_H__ */
@@ -0,0 +1,238 @@
+/* This file is part of GEGL.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib-object.h>
+
+#include "gegl.h"
+#include "gegl-types-internal.h"
+
+#include "operation/gegl-operation.h"
+
+#include "process/gegl-buffer-pool.h"
+
+/* Buffers in the pool only cost memory while nothing reuses them */
+#define GEGL_BUFFER_POOL_MAX_BUFFERS 4
+
+struct _GeglBufferPool
+{
+  GMutex      mutex;
+  GSList     *buffers;  /* waiting to be handed out again */
+  GHashTable *holds;    /* buffers handed out, to the number of
+                           contexts holding them */
+};
+
+GeglBufferPool *
+gegl_buffer_pool_new (void)
+{
+  GeglBufferPool *pool = g_slice_new0 (GeglBufferPool);
+
+  g_mutex_init (&pool->mutex);
+  pool->holds = g_hash_table_new (NULL, NULL);
+
+  return pool;
+}
+
+void
+gegl_buffer_pool_free (GeglBufferPool *pool)
+{
+  GHashTableIter iter;
+  gpointer       buffer;
+
+  gegl_buffer_pool_clear (pool);
+
+  g_hash_table_iter_init (&iter, pool->holds);
+  while (g_hash_table_iter_next (&iter, &buffer, NULL))
+    g_object_unref (buffer);
+  g_hash_table_unref (pool->holds);
+  g_mutex_clear (&pool->mutex);
+  g_slice_free (GeglBufferPool, pool);
+}
+
+void
+gegl_buffer_pool_clear (GeglBufferPool *pool)
+{
+  GSList *buffers;
+
+  g_mutex_lock (&pool->mutex);
+  buffers = pool->buffers;
+  pool->buffers = NULL;
+  g_mutex_unlock (&pool->mutex);
+
+  g_slist_free_full (buffers, g_object_unref);
+}
+
+/**
+ * gegl_buffer_pool_get:
+ * @pool: a #GeglBufferPool
+ * @extent: the extent of the buffer
+ * @format: the format of the buffer
+ *
+ * Get a cleared buffer, reusing one from @pool if there is one with
+ * the same @format and @extent. It goes back to @pool once every
+ * context it was handed to released it, see gegl_buffer_pool_hold.
+ *
+ * Return value: (transfer full): a buffer
+ */
+GeglBuffer *
+gegl_buffer_pool_get (GeglBufferPool      *pool,
+                      const GeglRectangle *extent,
+                      const Babl          *format)
+{
+  GeglBuffer *buffer = NULL;
+  GSList     *iter;
+
+  g_mutex_lock (&pool->mutex);
+
+  for (iter = pool->buffers; iter; iter = iter->next)
+    {
+      GeglBuffer *candidate = iter->data;
+
+      if (gegl_buffer_get_format (candidate) == format &&
+          gegl_rectangle_equal (gegl_buffer_get_extent (candidate), extent))
+        {
+          buffer = candidate;
+          pool->buffers = g_slist_delete_link (pool->buffers, iter);
+          break;
+        }
+    }
+
+  g_mutex_unlock (&pool->mutex);
+
+  if (buffer)
+    {
+      /* The tiles stay allocated, but the previous contents belong to
+       * another node, operations may rely on a fresh output being
+       * transparent.
+       */
+      gegl_buffer_clear (buffer, NULL);
+      gegl_object_unset_has_forked (G_OBJECT (buffer));
+    }
+  else
+    {
+      buffer = gegl_buffer_new (extent, format);
+    }
+
+  /* The reference of the pool, until the buffer comes back */
+  g_mutex_lock (&pool->mutex);
+  g_hash_table_insert (pool->holds, buffer, GINT_TO_POINTER (0));
+  g_mutex_unlock (&pool->mutex);
+
+  return g_object_ref (buffer);
+}
+
+/**
+ * gegl_buffer_pool_hold:
+ * @pool: a #GeglBufferPool
+ * @buffer: a buffer
+ *
+ * Record that a context holds @buffer, to be matched by a call to
+ * gegl_buffer_pool_release. Does nothing for buffers that did not come
+ * from @pool.
+ */
+void
+gegl_buffer_pool_hold (GeglBufferPool *pool,
+                       GeglBuffer     *buffer)
+{
+  gpointer holds;
+
+  g_mutex_lock (&pool->mutex);
+
+  if (g_hash_table_lookup_extended (pool->holds, buffer, NULL, &holds))
+    g_hash_table_insert (pool->holds, buffer,
+                         GINT_TO_POINTER (GPOINTER_TO_INT (holds) + 1));
+
+  g_mutex_unlock (&pool->mutex);
+}
+
+/**
+ * gegl_buffer_pool_release:
+ * @pool: a #GeglBufferPool
+ * @buffer: (transfer full): a buffer
+ *
+ * Give up a reference to @buffer held by a context. When no context
+ * holds a buffer from @pool anymore, it is kept to be handed out again.
+ * Unless references were taken outside of contexts, like the result of
+ * a pass or one an operation keeps, in which case the pool forgets it.
+ */
+void
+gegl_buffer_pool_release (GeglBufferPool *pool,
+                          GeglBuffer     *buffer)
+{
+  GeglBuffer *dropped = NULL;
+  gpointer    holds;
+
+  g_mutex_lock (&pool->mutex);
+
+  if (g_hash_table_lookup_extended (pool->holds, buffer, NULL, &holds))
+    {
+      if (GPOINTER_TO_INT (holds) > 1)
+        {
+          g_hash_table_insert (pool->holds, buffer,
+                               GINT_TO_POINTER (GPOINTER_TO_INT (holds) - 1));
+        }
+      else
+        {
+          /* No context can take another reference now, only ours and
+           * the one of the pool are left if it was not kept elsewhere.
+           */
+          g_hash_table_remove (pool->holds, buffer);
+
+          if (G_OBJECT (buffer)->ref_count == 2)
+            {
+              pool->buffers = g_slist_prepend (pool->buffers, buffer);
+
+              if (g_slist_length (pool->buffers) > GEGL_BUFFER_POOL_MAX_BUFFERS)
+                {
+                  GSList *last = g_slist_last (pool->buffers);
+
+                  dropped = last->data;
+                  pool->buffers = g_slist_delete_link (pool->buffers, last);
+                }
+            }
+          else
+            {
+              dropped = buffer;
+            }
+        }
+    }
+
+  g_mutex_unlock (&pool->mutex);
+
+  if (dropped)
+    g_object_unref (dropped);
+  g_object_unref (buffer);
+}
+
+/**
+ * gegl_buffer_pool_get_n_buffers:
+ * @pool: a #GeglBufferPool
+ *
+ * Return value: the number of buffers waiting in @pool to be handed out
+ * again
+ */
+guint
+gegl_buffer_pool_get_n_buffers (GeglBufferPool *pool)
+{
+  guint n_buffers;
+
+  g_mutex_lock (&pool->mutex);
+  n_buffers = g_slist_length (pool->buffers);
+  g_mutex_unlock (&pool->mutex);
+
+  return n_buffers;
+}
@@ -0,0 +1,45 @@
+/* This file is part of GEGL.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEGL_BUFFER_POOL_H__
+#define __GEGL_BUFFER_POOL_H__
+
+G_BEGIN_DECLS
+
+/* A small set of intermediate buffers no context holds anymore, kept
+ * around to be handed out again as the output of a later node with the
+ * same format and extent.
+ */
+typedef struct _GeglBufferPool GeglBufferPool;
+
+GeglBufferPool *gegl_buffer_pool_new     (void);
+void            gegl_buffer_pool_free    (GeglBufferPool      *pool);
+void            gegl_buffer_pool_clear   (GeglBufferPool      *pool);
+
+GeglBuffer     *gegl_buffer_pool_get     (GeglBufferPool      *pool,
+                                          const GeglRectangle *extent,
+                                          const Babl          *format);
+void            gegl_buffer_pool_hold    (GeglBufferPool      *pool,
+                                          GeglBuffer          *buffer);
+void            gegl_buffer_pool_release (GeglBufferPool      *pool,
+                                          GeglBuffer          *buffer);
+
+guint           gegl_buffer_pool_get_n_buffers
+                                         (GeglBufferPool      *pool);
+
+G_END_DECLS
+
+#endif /* __GEGL_BUFFER_POOL_H__ */
@@ -28,6 +28,7 @@
 #include "gegl-instrument.h"
 
 #include "graph/gegl-node-private.h"
+#include "graph/gegl-pad.h"
 
 #include "process/gegl-graph-traversal.h"
 
@@ -81,7 +82,9 @@ gegl_eval_manager_change_notification (GObject             *gobject,
                                        gpointer             user_data)
 {
   GeglEvalManager *manager = GEGL_EVAL_MANAGER (user_data);
-  manager->state = INVALID;
+
+  /* may be emitted on another thread than the one rendering with us */
+  g_atomic_int_set ((gint *) &manager->state, INVALID);
 
   return FALSE;
 }
@@ -92,16 +95,32 @@ gegl_eval_manager_prepare (GeglEvalManager *self)
   g_return_if_fail (GEGL_IS_EVAL_MANAGER (self));
   g_return_if_fail (GEGL_IS_NODE (self->node));
 
-  if (self->state != READY)
+  /* Deferred invalidations must reach the caches before we render, this
+   * may also mark us as INVALID.  A stale traversal may list nodes that
+   * are gone, it is rebuilt before anything is flushed through it.
+   */
+  if (self->traversal && gegl_graph_is_stale (self->traversal))
+    g_atomic_int_set ((gint *) &self->state, INVALID);
+  else if (self->traversal)
+    gegl_graph_flush_invalidations (self->traversal);
+
+  /* Become READY before preparing, so that an invalidation arriving
+   * from another thread while we prepare makes the next call prepare
+   * again instead of being overwritten.
+   */
+  if (g_atomic_int_compare_and_exchange ((gint *) &self->state,
+                                         INVALID, READY))
     {
+      /* Property and data changes leave the traversal intact, only
+       * rebuild it when the connections in the graph changed.
+       */
       if (!self->traversal)
         self->traversal = gegl_graph_build (self->node);
-      else
+      else if (gegl_graph_is_stale (self->traversal))
         gegl_graph_rebuild (self->traversal, self->node);
 
+      gegl_graph_flush_invalidations (self->traversal);
       gegl_graph_prepare (self->traversal);
-
-      self->state = READY;
     }
 }
 
@@ -140,6 +159,89 @@ gegl_eval_manager_apply (GeglEvalManager     *self,
   return object;
 }
 
+/* The node doing the work for @node, which might be a proxy */
+static GeglNode *
+gegl_eval_manager_real_node (GeglNode *node)
+{
+  GeglPad *pad = gegl_node_get_pad (node, "output");
+
+  return pad ? gegl_pad_get_node (pad) : node;
+}
+
+/**
+ * gegl_eval_manager_apply_many:
+ * @self: a #GeglEvalManager
+ * @nodes: nodes contained in the graph of @self
+ * @rois: the rect needed from each of @nodes
+ * @n_requests: the number of requests
+ * @level: the level to render at
+ * @results: (out): location for the output of each of @nodes
+ *
+ * Render all the requests in a single pass over the graph of @self,
+ * work the requests have in common is only done once. Several requests
+ * can be made of the same node, they all get the same buffer.
+ */
+void
+gegl_eval_manager_apply_many (GeglEvalManager      *self,
+                              GeglNode            **nodes,
+                              const GeglRectangle  *rois,
+                              gint                  n_requests,
+                              gint                  level,
+                              GeglBuffer          **results)
+{
+  GeglNode       **real_nodes;
+  GHashTable      *captures;
+  GHashTableIter   iter;
+  gpointer         buffer;
+  GeglBuffer      *result;
+  gint             i;
+
+  g_return_if_fail (GEGL_IS_EVAL_MANAGER (self));
+  g_return_if_fail (GEGL_IS_NODE (self->node));
+
+  if (level >= GEGL_CACHE_VALID_MIPMAPS)
+    level = GEGL_CACHE_VALID_MIPMAPS-1;
+
+  GEGL_INSTRUMENT_START();
+  gegl_eval_manager_prepare (self);
+  GEGL_INSTRUMENT_END ("gegl", "prepare-graph");
+
+  real_nodes = g_new (GeglNode *, n_requests);
+  captures   = g_hash_table_new (NULL, NULL);
+
+  for (i = 0; i < n_requests; i++)
+    {
+      real_nodes[i] = gegl_eval_manager_real_node (nodes[i]);
+      g_hash_table_insert (captures, real_nodes[i], NULL);
+    }
+
+  GEGL_INSTRUMENT_START();
+  gegl_graph_prepare_requests (self->traversal, real_nodes, rois,
+                               n_requests, level);
+  GEGL_INSTRUMENT_END ("gegl", "prepare-request");
+
+  GEGL_INSTRUMENT_START();
+  result = gegl_graph_process_full (self->traversal, level, captures);
+  GEGL_INSTRUMENT_END ("gegl", "process");
+
+  for (i = 0; i < n_requests; i++)
+    {
+      results[i] = g_hash_table_lookup (captures, real_nodes[i]);
+      if (results[i])
+        g_object_ref (results[i]);
+    }
+
+  g_hash_table_iter_init (&iter, captures);
+  while (g_hash_table_iter_next (&iter, NULL, &buffer))
+    if (buffer)
+      g_object_unref (buffer);
+  g_hash_table_unref (captures);
+  g_free (real_nodes);
+
+  if (result)
+    g_object_unref (result);
+}
+
 GeglEvalManager * gegl_eval_manager_new     (GeglNode    *node,
                                              const gchar *pad_name)
 {
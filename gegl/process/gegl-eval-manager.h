@@ -69,6 +69,12 @@ GeglRectangle     gegl_eval_manager_get_bounding_box (GeglEvalManager     *self)
 GeglBuffer *      gegl_eval_manager_apply    (GeglEvalManager     *self,
                                               const GeglRectangle *roi,
                                               gint                 level);
+void              gegl_eval_manager_apply_many (GeglEvalManager      *self,
+                                                GeglNode            **nodes,
+                                                const GeglRectangle  *rois,
+                                                gint                  n_requests,
+                                                gint                  level,
+                                                GeglBuffer          **results);
 GeglEvalManager * gegl_eval_manager_new      (GeglNode        *node,
                                               const gchar     *pad_name);
 
@@ -23,7 +23,8 @@
  * gegl_graph_dump_outputs:
  * @node: The final node of the graph
  *
- * Dump the bounds and format of each node in the graph to stdout.
+ * Dump the bounds and format of each node in the graph to stdout,
+ * marking the nodes that are elided from processing.
  */
 void gegl_graph_dump_outputs (GeglNode *node);
 
@@ -50,8 +50,9 @@ gegl_graph_dump_outputs (GeglNode *node)
     if (gegl_node_get_pad (cur_node, "output"))
       {
         const Babl *format = gegl_operation_get_format (cur_node->operation, "output");
-        printf ("%s: output=%s\n", gegl_node_get_debug_name (cur_node),
-                                   format ? babl_get_name (format) : "N/A");
+        printf ("%s: output=%s%s\n", gegl_node_get_debug_name (cur_node),
+                                     format ? babl_get_name (format) : "N/A",
+                                     g_hash_table_contains (path->elided, cur_node) ? " (elided)" : "");
       }
     else
       {
@@ -83,7 +84,9 @@ gegl_graph_dump_request (GeglNode            *node,
     GeglNode *cur_node = GEGL_NODE (list_iter->data);
     GeglOperationContext *context = g_hash_table_lookup (path->contexts, cur_node);
     
-    if (!context->cached)
+    if (g_hash_table_contains (path->elided, cur_node))
+      printf ("%s: result (elided): ", gegl_node_get_debug_name (cur_node));
+    else if (!context->cached)
       printf ("%s: result: ", gegl_node_get_debug_name (cur_node));
     else
       printf ("%s: result (cached): ", gegl_node_get_debug_name (cur_node));
@@ -19,6 +19,10 @@
 #ifndef __GEGL_GRAPH_TRAVERSAL_PRIVATE_H__
 #define __GEGL_GRAPH_TRAVERSAL_PRIVATE_H__
 
+#include "process/gegl-buffer-pool.h"
+
+typedef struct _GeglGraphSchedule GeglGraphSchedule;
+
 struct _GeglGraphTraversal
 {
   GHashTable *contexts;
@@ -26,6 +30,14 @@ struct _GeglGraphTraversal
   GList *bfs_path;
   gboolean rects_dirty;
   GeglBuffer *shared_empty;
+  guint topology_serial;
+  GHashTable *prepare_states;
+  GeglGraphSchedule *schedule;
+  GeglBufferPool *pool;
+  GHashTable *elided;
+  GHashTable *request_plans;
+  GHashTable *captures;
+  guint parallel_passes; /* passes run by gegl_graph_process_parallel */
 };
 
 #endif /* __GEGL_GRAPH_TRAVERSAL_PRIVATE_H__ */
@@ -19,10 +19,14 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <glib-object.h>
+#include <gio/gio.h>
 
 #include "gegl-types-internal.h"
 #include "gegl.h"
+#include "gegl-config.h"
 #include "gegl-debug.h"
 #include "gegl-instrument.h"
 
@@ -33,6 +37,7 @@
 #include "graph/gegl-visitable.h"
 #include "graph/gegl-connection.h"
 
+#include "process/gegl-buffer-pool.h"
 #include "process/gegl-graph-traversal.h"
 #include "process/gegl-graph-traversal-private.h"
 #include "process/gegl-list-visitor.h"
@@ -47,12 +52,101 @@ typedef struct
   GeglOperationContext *context;
 } ContextConnection;
 
+/* State shared by the threads running a traversal in parallel, all
+ * fields are protected by the mutex.
+ */
+struct _GeglGraphSchedule
+{
+  GMutex      mutex;
+  GCond       cond;
+  GHashTable *deps;        /* node -> number of inputs not yet delivered */
+  GQueue      ready;       /* nodes with all their inputs delivered */
+  gint        running;
+  gint        remaining;
+  guint64     in_flight;   /* estimated bytes of outputs being computed */
+  gint        level;
+  GeglNode   *last_node;
+  GeglBuffer *last_result;
+};
+
+typedef struct
+{
+  GeglGraphTraversal *path;
+  GeglNode           *node;
+  guint64             size;
+} GeglGraphTask;
+
+/* What a node looked like the last time this traversal prepared it */
+typedef struct
+{
+  guint          serial;
+  const Babl    *format;
+  GeglRectangle  have_rect;
+} PrepareState;
+
+/* Viewers request the same tiles over and over, the outcome of
+ * gegl_graph_prepare_request only changes when the graph does.
+ */
+#define GEGL_GRAPH_MAX_REQUEST_PLANS 256
+
+typedef struct
+{
+  GeglRectangle need_rect;
+  GeglRectangle result_rect;
+  GeglRectangle request;     /* what was looked up in the cache */
+  gboolean      cached;
+} RequestPlanEntry;
+
+/* The context rects of every node in bfs_path order */
+typedef struct
+{
+  GeglRectangle    roi;
+  gint             level;
+  gint             n_entries;
+  RequestPlanEntry entries[];
+} RequestPlan;
+
 static void   free_context_connection                  (gpointer concon);
 static GList *gegl_graph_get_connected_output_contexts (GeglGraphTraversal *path,
                                                         GeglPad            *output_pad);
 static void   _gegl_graph_do_build                     (GeglGraphTraversal *path,
                                                         GeglNode           *node);
 static GeglBuffer *gegl_graph_get_shared_empty         (GeglGraphTraversal *path);
+static guint   gegl_graph_get_prepare_serial           (GeglNode           *node);
+
+static guint
+request_plan_hash (gconstpointer key)
+{
+  const RequestPlan *plan = key;
+
+  return ((plan->roi.x * 31 + plan->roi.y) * 31 +
+          plan->roi.width * 17 + plan->roi.height) * 31 + plan->level;
+}
+
+static gboolean
+request_plan_equal (gconstpointer a,
+                    gconstpointer b)
+{
+  const RequestPlan *plan_a = a;
+  const RequestPlan *plan_b = b;
+
+  return plan_a->level == plan_b->level &&
+         gegl_rectangle_equal (&plan_a->roi, &plan_b->roi);
+}
+
+/* Meta-operations are prepared along with their children, so a change
+ * to any parent counts as a change to the node.
+ */
+static guint
+gegl_graph_get_prepare_serial (GeglNode *node)
+{
+  guint serial = 0;
+
+  for (; node != NULL && node->operation != NULL; node = gegl_node_get_parent (node))
+    serial += node->prepare_serial;
+
+  return serial;
+}
 
 static void
 _gegl_graph_do_build (GeglGraphTraversal *path, GeglNode *node)
@@ -60,6 +154,11 @@ _gegl_graph_do_build (GeglGraphTraversal *path, GeglNode *node)
   GeglPad *pad = NULL;
   GeglListVisitor *list_visitor = g_object_new (GEGL_TYPE_LIST_VISITOR, NULL);
 
+  /* Taken before walking the graph, so that a change made while we walk
+   * it leaves the traversal stale.
+   */
+  path->topology_serial = gegl_node_get_topology_serial ();
+
   /* We need to check the real node of the output/input pad in case this is a proxy node */
   pad = gegl_node_get_pad (node, "output");
   if (pad)
@@ -79,6 +178,11 @@ _gegl_graph_do_build (GeglGraphTraversal *path, GeglNode *node)
                                           NULL,
                                           NULL,
                                           (GDestroyNotify)gegl_operation_context_destroy);
+  path->prepare_states = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+  path->elided = g_hash_table_new (NULL, NULL);
+  path->request_plans = g_hash_table_new_full (request_plan_hash,
+                                               request_plan_equal,
+                                               g_free, NULL);
   path->rects_dirty = FALSE;
   g_object_unref (list_visitor);
 }
@@ -96,6 +200,7 @@ gegl_graph_build (GeglNode *node)
 {
   GeglGraphTraversal *result = g_new0 (GeglGraphTraversal, 1);
 
+  result->pool = gegl_buffer_pool_new ();
   _gegl_graph_do_build (result, node);
 
   return result;
@@ -115,8 +220,14 @@ gegl_graph_rebuild (GeglGraphTraversal *path, GeglNode *node)
   g_list_free (path->dfs_path);
   g_list_free (path->bfs_path);
   g_hash_table_unref (path->contexts);
+  g_hash_table_unref (path->prepare_states);
+  g_hash_table_unref (path->elided);
+  g_hash_table_unref (path->request_plans);
 
-  /* Replaces everything but shared_empty */
+  /* The buffers kept for the next pass were sized for the old graph */
+  gegl_buffer_pool_clear (path->pool);
+
+  /* Replaces everything but shared_empty and pool */
   _gegl_graph_do_build (path, node);
 }
 
@@ -126,6 +237,10 @@ gegl_graph_free (GeglGraphTraversal *path)
   g_list_free (path->dfs_path);
   g_list_free (path->bfs_path);
   g_hash_table_unref (path->contexts);
+  g_hash_table_unref (path->prepare_states);
+  g_hash_table_unref (path->elided);
+  g_hash_table_unref (path->request_plans);
+  gegl_buffer_pool_free (path->pool);
   if (path->shared_empty)
     g_object_unref (path->shared_empty);
 
@@ -153,84 +268,257 @@ gegl_graph_get_bounding_box (GeglGraphTraversal *path)
   return *GEGL_RECTANGLE(0, 0, 0, 0);
 }
 
+/**
+ * gegl_graph_flush_invalidations:
+ * @path: The traversal path
+ *
+ * Propagate the invalidations queued on any of the nodes in @path,
+ * sources first so that the queues of the nodes they reach are
+ * flushed in the same pass.
+ */
+void
+gegl_graph_flush_invalidations (GeglGraphTraversal *path)
+{
+  GList *list_iter;
+
+  for (list_iter = path->dfs_path; list_iter; list_iter = list_iter->next)
+    gegl_node_flush_invalidations (GEGL_NODE (list_iter->data));
+}
+
+/**
+ * gegl_graph_is_stale:
+ * @path: The traversal path
+ *
+ * Check whether the pads or connections of any node changed since
+ * @path was built, in which case it must be rebuilt with
+ * gegl_graph_rebuild before it can be prepared again.  The nodes in a
+ * stale @path are not referenced and may already be gone, so nothing
+ * may walk it.
+ *
+ * Return value: TRUE if the topology may have changed
+ */
+gboolean
+gegl_graph_is_stale (GeglGraphTraversal *path)
+{
+  return gegl_node_get_topology_serial () != path->topology_serial;
+}
+
 /**
  * gegl_graph_prepare:
  * @path: The traversal path
  *
  * Prepare all nodes, initializing their output formats and have rects.
+ *
+ * Only nodes whose operation changed since the last call, or that are
+ * fed by a node whose format or have rect changed, are prepared again.
+ * Nodes that were merely invalidated only get their have rect updated.
+ *
+ * Nodes whose operation reports being an identity for its current
+ * properties are elided from processing, their input is handed on as
+ * their output. The final node of @path is always processed.
  */
 void
 gegl_graph_prepare (GeglGraphTraversal *path)
 {
   GList *list_iter = NULL;
+  GHashTable *changed = g_hash_table_new (NULL, NULL);
+  gboolean keep_plans = TRUE;
+
+  g_hash_table_remove_all (path->elided);
 
   for (list_iter = path->dfs_path; list_iter; list_iter = list_iter->next)
   {
     GeglNode *node = GEGL_NODE (list_iter->data);
     GeglNode *parent;
     GeglOperation *operation = node->operation;
+    guint serial = gegl_graph_get_prepare_serial (node);
+    PrepareState *state = g_hash_table_lookup (path->prepare_states, node);
+    gboolean need_prepare;
+    GSList *input_pads;
 
-    g_mutex_lock (&node->mutex);
+    need_prepare = !state || state->serial != serial;
 
-    gegl_operation_prepare (operation);
-    node->have_rect = gegl_operation_get_bounding_box (operation);
-    node->valid_have_rect = TRUE;
+    for (input_pads = node->input_pads;
+         input_pads && !need_prepare;
+         input_pads = input_pads->next)
+      {
+        GeglPad *source_pad = gegl_pad_get_connected_to (input_pads->data);
+
+        if (source_pad &&
+            g_hash_table_contains (changed, gegl_pad_get_node (source_pad)))
+          need_prepare = TRUE;
+      }
 
-    if (node->cache)
+    if (need_prepare || !node->valid_have_rect)
       {
-        gegl_buffer_set_extent (GEGL_BUFFER (node->cache),
-                                &node->have_rect);
+        g_mutex_lock (&node->mutex);
+
+        if (need_prepare)
+          gegl_operation_prepare (operation);
+        node->have_rect = gegl_operation_get_bounding_box (operation);
+        node->valid_have_rect = TRUE;
+
+        if (node->cache)
+          {
+            gegl_buffer_set_extent (GEGL_BUFFER (node->cache),
+                                    &node->have_rect);
+          }
+
+        g_mutex_unlock (&node->mutex);
+
+        if (need_prepare)
+          {
+            /* What the node requires from its inputs may have changed */
+            keep_plans = FALSE;
+
+            parent = gegl_node_get_parent (node);
+            while (parent != NULL && parent->operation != NULL)
+              {
+                gegl_operation_prepare (parent->operation);
+                parent = gegl_node_get_parent (parent);
+              }
+          }
       }
 
-    g_mutex_unlock (&node->mutex);
+    /* Another traversal sharing this node may have prepared it in the
+     * meantime, so compare against what we saw last rather than what
+     * the node held before this pass.
+     */
+    {
+      GeglPad    *output_pad = gegl_node_get_pad (node, "output");
+      const Babl *format     = output_pad ? gegl_pad_get_format (output_pad) : NULL;
+
+      if (!state)
+        {
+          state = g_new0 (PrepareState, 1);
+          g_hash_table_insert (path->prepare_states, node, state);
+          g_hash_table_add (changed, node);
+          keep_plans = FALSE;
+        }
+      else if (state->format != format ||
+               !gegl_rectangle_equal (&state->have_rect, &node->have_rect))
+        {
+          g_hash_table_add (changed, node);
+          keep_plans = FALSE;
+        }
+
+      if (need_prepare)
+        state->serial = serial;
+      state->format    = format;
+      state->have_rect = node->have_rect;
+    }
 
-    parent = gegl_node_get_parent (node);
-    while (parent != NULL && parent->operation != NULL)
+    if (list_iter->next && gegl_operation_is_identity (operation))
       {
-        gegl_operation_prepare (parent->operation);
-        parent = gegl_node_get_parent (parent);
+        GEGL_NOTE (GEGL_DEBUG_PROCESS,
+                   "Eliding %s, it is an identity with its current properties",
+                   gegl_node_get_debug_name (node));
+        g_hash_table_add (path->elided, node);
       }
 
     if (!g_hash_table_contains (path->contexts, node))
       {
         GeglOperationContext *context = gegl_operation_context_new (node->operation);
 
+        context->pool = path->pool;
         g_hash_table_insert (path->contexts,
                              node,
                              context);
       }
   }
+
+  /* Plans survive invalidations of data, which leave the rects alone,
+   * gegl_graph_apply_request_plan checks them against the caches.
+   */
+  if (!keep_plans)
+    g_hash_table_remove_all (path->request_plans);
+
+  g_hash_table_unref (changed);
 }
 
-/**
- * gegl_graph_prepare_request:
- * @path: The traversal path
- * @request_roi: The request rect
- *
- * Prepare the graph to render request_roi, this will calculate
- * the area that needs to be rendered from each node in the
- * graph to fulfill this request.
+/* Restore the context rects of a previous request, unless a cache
+ * changed for a node of the plan: it became able to serve a node the
+ * plan computes, or no longer holds what the plan takes from it.
+ */
+static gboolean
+gegl_graph_apply_request_plan (GeglGraphTraversal *path,
+                               const RequestPlan  *plan)
+{
+  GList *list_iter;
+  gint   i;
+
+  for (list_iter = path->bfs_path, i = 0; list_iter; list_iter = list_iter->next, i++)
+    {
+      GeglNode               *node  = GEGL_NODE (list_iter->data);
+      const RequestPlanEntry *entry = &plan->entries[i];
+      gboolean                in_cache;
+
+      if (entry->request.width <= 0 || entry->request.height <= 0)
+        continue;
+
+      in_cache = node->cache &&
+                 gegl_region_rect_in (node->cache->valid_region[plan->level],
+                                      &entry->request) == GEGL_OVERLAP_RECTANGLE_IN;
+
+      if (in_cache != entry->cached)
+        return FALSE;
+    }
+
+  for (list_iter = path->bfs_path, i = 0; list_iter; list_iter = list_iter->next, i++)
+    {
+      GeglOperationContext   *context = g_hash_table_lookup (path->contexts, list_iter->data);
+      const RequestPlanEntry *entry   = &plan->entries[i];
+
+      gegl_operation_context_set_need_rect (context, &entry->need_rect);
+      gegl_operation_context_set_result_rect (context, &entry->result_rect);
+      context->cached = entry->cached;
+    }
+
+  return TRUE;
+}
+
+/* Record the context rects computed for @plan, its request fields
+ * were filled in while computing them.
  */
+static void
+gegl_graph_store_request_plan (GeglGraphTraversal *path,
+                               RequestPlan        *plan)
+{
+  GList *list_iter;
+  gint   i;
 
-void
-gegl_graph_prepare_request (GeglGraphTraversal  *path,
-                            const GeglRectangle *request_roi,
-                            gint                 level)
+  if (g_hash_table_size (path->request_plans) >= GEGL_GRAPH_MAX_REQUEST_PLANS)
+    g_hash_table_remove_all (path->request_plans);
+
+  for (list_iter = path->bfs_path, i = 0; list_iter; list_iter = list_iter->next, i++)
+    {
+      GeglOperationContext *context = g_hash_table_lookup (path->contexts, list_iter->data);
+      RequestPlanEntry     *entry   = &plan->entries[i];
+
+      entry->need_rect   = *gegl_operation_context_get_need_rect (context);
+      entry->result_rect = *gegl_operation_context_get_result_rect (context);
+      entry->cached      = context->cached;
+    }
+
+  g_hash_table_replace (path->request_plans, plan, plan);
+}
+
+/* Zero all the need rects so we can intersect with them, the result
+ * rects will always get overwritten.
+ */
+static void
+gegl_graph_reset_request (GeglGraphTraversal *path)
 {
-  GList *list_iter = NULL;
   static const GeglRectangle empty_rect = {0, 0, 0, 0};
-
-  g_return_if_fail (path->bfs_path);
+  GList *list_iter;
 
   if (path->rects_dirty)
     {
-      /* Zero all the needs rects so we can intersect with them below */
       for (list_iter = path->bfs_path; list_iter; list_iter = list_iter->next)
         {
           GeglNode *node = GEGL_NODE (list_iter->data);
           GeglOperationContext *context = g_hash_table_lookup (path->contexts, node);
 
-          /* We only need to reset the need rect, result will always get overwritten */
           gegl_operation_context_set_need_rect (context, &empty_rect);
 
           /* Reset cached status, because the rect we need may have changed */
@@ -239,23 +527,41 @@ gegl_graph_prepare_request (GeglGraphTraversal  *path,
     }
 
   path->rects_dirty = TRUE;
+}
 
-  {
-    /* Prep the first node */
-    GeglNode *node = GEGL_NODE (path->bfs_path->data);
-    GeglOperationContext *context = g_hash_table_lookup (path->contexts, node);
-    GeglRectangle new_need;
+/* Add @request_roi to what is needed from @node */
+static void
+gegl_graph_request_node (GeglGraphTraversal  *path,
+                         GeglNode            *node,
+                         const GeglRectangle *request_roi)
+{
+  GeglOperationContext *context = g_hash_table_lookup (path->contexts, node);
+  GeglRectangle new_need;
 
-    g_return_if_fail (context);
+  g_return_if_fail (context);
 
-    gegl_rectangle_intersect (&new_need, &node->have_rect, request_roi);
+  gegl_rectangle_intersect (&new_need, &node->have_rect, request_roi);
+  gegl_rectangle_bounding_box (&new_need, &new_need,
+                               gegl_operation_context_get_need_rect (context));
+
+  gegl_operation_context_set_need_rect (context, &new_need);
+  gegl_operation_context_set_result_rect (context, &new_need);
+}
+
+/* Propagate the need rects of the requested nodes upstream, filling in
+ * the request fields of @plan if there is one.
+ */
+static void
+gegl_graph_propagate_request (GeglGraphTraversal *path,
+                              gint                level,
+                              RequestPlan        *plan)
+{
+  GList *list_iter = NULL;
+  static const GeglRectangle empty_rect = {0, 0, 0, 0};
+  gint   i;
 
-    gegl_operation_context_set_need_rect (context, &new_need);
-    gegl_operation_context_set_result_rect (context, &new_need);
-  }
-  
   /* Iterate over all the nodes and propagate the requested rectangle */
-  for (list_iter = path->bfs_path; list_iter; list_iter = list_iter->next)
+  for (list_iter = path->bfs_path, i = 0; list_iter; list_iter = list_iter->next, i++)
     {
       GeglNode             *node      = GEGL_NODE (list_iter->data);
       GeglOperation        *operation = node->operation;
@@ -273,11 +579,15 @@ gegl_graph_prepare_request (GeglGraphTraversal  *path,
           gegl_operation_context_set_result_rect (context, &empty_rect);
           continue;
         }
+
+      if (plan)
+        plan->entries[i].request = *request;
       
       if (node->cache)
         {
-          gint i;
-          for (i = level; i >=0 && !context->cached; i--)
+          gint cache_level;
+
+          for (cache_level = level; cache_level >=0 && !context->cached; cache_level--)
           {
             if (gegl_region_rect_in (node->cache->valid_region[level], request) == GEGL_OVERLAP_RECTANGLE_IN)
             {
@@ -327,6 +637,91 @@ gegl_graph_prepare_request (GeglGraphTraversal  *path,
     }
 }
 
+/**
+ * gegl_graph_prepare_request:
+ * @path: The traversal path
+ * @request_roi: The request rect
+ *
+ * Prepare the graph to render request_roi, this will calculate
+ * the area that needs to be rendered from each node in the
+ * graph to fulfill this request.
+ *
+ * The outcome is remembered per request rectangle and level until a
+ * node of the graph is prepared again or changes its format or extent.
+ */
+void
+gegl_graph_prepare_request (GeglGraphTraversal  *path,
+                            const GeglRectangle *request_roi,
+                            gint                 level)
+{
+  RequestPlan  key;
+  RequestPlan *plan;
+  gint         n_entries;
+
+  g_return_if_fail (path->bfs_path);
+
+  key.roi   = *request_roi;
+  key.level = level;
+  plan = g_hash_table_lookup (path->request_plans, &key);
+
+  if (plan && gegl_graph_apply_request_plan (path, plan))
+    {
+      GEGL_NOTE (GEGL_DEBUG_PROCESS,
+                 "Reusing the request plan for %d, %d %d×%d",
+                 request_roi->x, request_roi->y,
+                 request_roi->width, request_roi->height);
+      path->rects_dirty = TRUE;
+      return;
+    }
+
+  gegl_graph_reset_request (path);
+
+  /* Prep the first node */
+  gegl_graph_request_node (path, GEGL_NODE (path->bfs_path->data), request_roi);
+  
+  n_entries = g_list_length (path->bfs_path);
+  plan = g_malloc0 (sizeof (RequestPlan) + n_entries * sizeof (RequestPlanEntry));
+  plan->roi       = *request_roi;
+  plan->level     = level;
+  plan->n_entries = n_entries;
+
+  gegl_graph_propagate_request (path, level, plan);
+
+  gegl_graph_store_request_plan (path, plan);
+}
+
+/**
+ * gegl_graph_prepare_requests:
+ * @path: The traversal path
+ * @nodes: Nodes of @path
+ * @request_rois: The rect requested from each of @nodes
+ * @n_requests: The number of requests
+ * @level: The level to render at
+ *
+ * Like gegl_graph_prepare_request, but for any number of nodes of
+ * @path at once. A node that feeds several of the requests is asked
+ * for the bounding box of what they need from it, so that a single
+ * gegl_graph_process computes it once for all of them.
+ */
+void
+gegl_graph_prepare_requests (GeglGraphTraversal   *path,
+                             GeglNode            **nodes,
+                             const GeglRectangle  *request_rois,
+                             gint                  n_requests,
+                             gint                  level)
+{
+  gint i;
+
+  g_return_if_fail (path->bfs_path);
+
+  gegl_graph_reset_request (path);
+
+  for (i = 0; i < n_requests; i++)
+    gegl_graph_request_node (path, nodes[i], &request_rois[i]);
+
+  gegl_graph_propagate_request (path, level, NULL);
+}
+
 void
 free_context_connection (gpointer concon)
 {
@@ -373,6 +768,365 @@ gegl_graph_get_shared_empty (GeglGraphTraversal *path)
 }
 
 
+/* Run @node and hand its output to the contexts of its consumers.
+ * Returns the output of the node, not referenced, or NULL.
+ */
+static GeglBuffer *
+gegl_graph_process_node (GeglGraphTraversal   *path,
+                         GeglNode             *node,
+                         GeglOperationContext *context,
+                         gint                  level)
+{
+  GeglOperation *operation = node->operation;
+  GeglBuffer    *operation_result = NULL;
+
+  GEGL_INSTRUMENT_START();
+
+  GEGL_NOTE (GEGL_DEBUG_PROCESS,
+             "Will process %s result_rect = %d, %d %d×%d",
+             gegl_node_get_debug_name (node),
+             context->result_rect.x, context->result_rect.y, context->result_rect.width, context->result_rect.height);
+
+  if (context->need_rect.width > 0 && context->need_rect.height > 0)
+    {
+      if (context->cached)
+        {
+          GEGL_NOTE (GEGL_DEBUG_PROCESS,
+                     "Using cached result for %s",
+                     gegl_node_get_debug_name (node));
+          operation_result = GEGL_BUFFER (node->cache);
+        }
+      else
+        {
+          /* Guarantee input pad */
+          if (gegl_node_has_pad (node, "input") &&
+              !gegl_operation_context_get_object (context, "input"))
+            {
+              gegl_operation_context_set_object (context, "input", G_OBJECT (gegl_graph_get_shared_empty(path)));
+            }
+
+          context->level = level;
+
+          if (g_hash_table_contains (path->elided, node))
+            gegl_operation_context_set_object (context, "output",
+                                               gegl_operation_context_get_object (context, "input"));
+          else
+            gegl_operation_process (operation, context, "output", &context->need_rect, context->level);
+
+          operation_result = GEGL_BUFFER (gegl_operation_context_get_object (context, "output"));
+
+          if (operation_result && operation_result == (GeglBuffer *)operation->node->cache)
+            gegl_cache_computed (operation->node->cache, &context->need_rect, level);
+        }
+    }
+
+  if (operation_result)
+    {
+      GeglPad *output_pad = gegl_node_get_pad (node, "output");
+      GList   *targets = gegl_graph_get_connected_output_contexts (path, output_pad);
+      GList   *targets_iter;
+
+      GEGL_NOTE (GEGL_DEBUG_PROCESS,
+                 "Will deliver the results of %s:%s to %d targets",
+                 gegl_node_get_debug_name (node),
+                 "output",
+                 g_list_length (targets));
+
+      if (g_list_length (targets) > 1)
+        gegl_object_set_has_forked (G_OBJECT (operation_result));
+
+      if (path->schedule)
+        g_mutex_lock (&path->schedule->mutex);
+
+      for (targets_iter = targets; targets_iter; targets_iter = g_list_next (targets_iter))
+        {
+          ContextConnection *target_con = targets_iter->data;
+          gegl_operation_context_set_object (target_con->context, target_con->name, G_OBJECT (operation_result));
+        }
+
+      if (path->captures && g_hash_table_contains (path->captures, node))
+        g_hash_table_insert (path->captures, node, g_object_ref (operation_result));
+
+      if (path->schedule)
+        g_mutex_unlock (&path->schedule->mutex);
+
+      g_list_free_full (targets, free_context_connection);
+    }
+
+  GEGL_INSTRUMENT_END ("process", gegl_node_get_operation (node));
+
+  return operation_result;
+}
+
+/* Whether @path contains a node fed by more than one node that has
+ * work to do, only then is there anything to run side by side.
+ */
+static gboolean
+gegl_graph_has_parallel_branches (GeglGraphTraversal *path)
+{
+  GList *list_iter;
+
+  for (list_iter = path->dfs_path; list_iter; list_iter = list_iter->next)
+    {
+      GeglNode *node = GEGL_NODE (list_iter->data);
+      GSList   *input_pads;
+      gint      busy_sources = 0;
+
+      for (input_pads = node->input_pads; input_pads; input_pads = input_pads->next)
+        {
+          GeglPad *source_pad = gegl_pad_get_connected_to (input_pads->data);
+          GeglOperationContext *source_context;
+
+          if (!source_pad)
+            continue;
+
+          source_context = g_hash_table_lookup (path->contexts,
+                                                gegl_pad_get_node (source_pad));
+
+          if (source_context && !source_context->cached &&
+              source_context->need_rect.width > 0 &&
+              source_context->need_rect.height > 0)
+            busy_sources++;
+        }
+
+      if (busy_sources > 1)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/* Marks the threads of the graph pool, a graph processed from within
+ * one of them (an operation rendering a sub graph) must not wait on
+ * the pool it is running on.
+ */
+static GPrivate graph_worker_key = G_PRIVATE_INIT (NULL);
+
+/* in gegl-operation.c, releases the calling thread's gegl_temp_buffer set */
+void gegl_temp_buffer_free (void);
+
+static void
+gegl_graph_task_run (gpointer task_data,
+                     gpointer user_data)
+{
+  GeglGraphTask      *task     = task_data;
+  GeglGraphTraversal *path     = task->path;
+  GeglGraphSchedule  *schedule = path->schedule;
+  GeglOperationContext *context = g_hash_table_lookup (path->contexts, task->node);
+  GeglBuffer         *operation_result;
+  GeglPad            *output_pad;
+  GSList             *targets;
+
+  g_private_set (&graph_worker_key, GINT_TO_POINTER (TRUE));
+
+  operation_result = gegl_graph_process_node (path, task->node, context, schedule->level);
+
+  /* The point operations dispatched from here sized scratch for all
+   * their threads in our set, do not keep it while the pool is idle.
+   */
+  gegl_temp_buffer_free ();
+
+  g_mutex_lock (&schedule->mutex);
+
+  /* Our inputs are no longer needed, and the consumers hold their own
+   * references to our output.
+   */
+  if (task->node == schedule->last_node)
+    schedule->last_result = operation_result;
+  else
+    gegl_operation_context_purge (context);
+
+  output_pad = gegl_node_get_pad (task->node, "output");
+  targets    = output_pad ? gegl_pad_get_connections (output_pad) : NULL;
+
+  for (; targets; targets = targets->next)
+    {
+      GeglNode *target = gegl_connection_get_sink_node (targets->data);
+      gint      deps;
+
+      if (!g_hash_table_contains (schedule->deps, target))
+        continue;
+
+      deps = GPOINTER_TO_INT (g_hash_table_lookup (schedule->deps, target)) - 1;
+      g_hash_table_insert (schedule->deps, target, GINT_TO_POINTER (deps));
+
+      if (deps == 0)
+        g_queue_push_tail (&schedule->ready, target);
+    }
+
+  schedule->running--;
+  schedule->remaining--;
+  schedule->in_flight -= task->size;
+  g_cond_signal (&schedule->cond);
+
+  g_mutex_unlock (&schedule->mutex);
+
+  g_slice_free (GeglGraphTask, task);
+}
+
+static GThreadPool *
+gegl_graph_thread_pool (void)
+{
+  static GThreadPool *pool = NULL;
+  if (!pool)
+    {
+      pool = g_thread_pool_new (gegl_graph_task_run, NULL, gegl_config_threads (),
+                                FALSE, NULL);
+    }
+  return pool;
+}
+
+/* Bytes the output of @node will take, to keep the amount of
+ * intermediate data alive at once within the tile cache.
+ */
+static guint64
+gegl_graph_estimate_output_size (GeglNode             *node,
+                                 GeglOperationContext *context)
+{
+  GeglPad    *output_pad = gegl_node_get_pad (node, "output");
+  const Babl *format     = output_pad ? gegl_pad_get_format (output_pad) : NULL;
+
+  if (!format || context->cached)
+    return 0;
+
+  return (guint64) context->need_rect.width * context->need_rect.height *
+         babl_format_get_bytes_per_pixel (format);
+}
+
+/* A cancelled pass leaves the inputs delivered to nodes that never ran */
+static void
+gegl_graph_abandon_pass (GeglGraphTraversal *path)
+{
+  GHashTableIter iter;
+  gpointer       context;
+
+  g_hash_table_iter_init (&iter, path->contexts);
+  while (g_hash_table_iter_next (&iter, NULL, &context))
+    gegl_operation_context_purge (context);
+}
+
+/* Run the nodes of @path on the graph thread pool as soon as all of
+ * their inputs are available, so that independent branches execute at
+ * the same time.
+ */
+static GeglBuffer *
+gegl_graph_process_parallel (GeglGraphTraversal *path,
+                             gint                level,
+                             GCancellable       *cancellable)
+{
+  GeglGraphSchedule     schedule;
+  GThreadPool          *pool = gegl_graph_thread_pool ();
+  GList                *list_iter;
+  GeglOperationContext *last_context;
+  GeglBuffer           *result = NULL;
+  guint64               max_in_flight = gegl_config ()->tile_cache_size;
+
+  g_mutex_init (&schedule.mutex);
+  g_cond_init (&schedule.cond);
+  g_queue_init (&schedule.ready);
+  schedule.deps      = g_hash_table_new (NULL, NULL);
+  schedule.level     = level;
+  schedule.running   = 0;
+  schedule.remaining = 0;
+  schedule.in_flight = 0;
+  schedule.last_result = NULL;
+  schedule.last_node = GEGL_NODE (g_list_last (path->dfs_path)->data);
+
+  /* Created up front, the workers must not race to do it */
+  gegl_graph_get_shared_empty (path);
+
+  for (list_iter = path->dfs_path; list_iter; list_iter = list_iter->next)
+    {
+      GeglNode *node = GEGL_NODE (list_iter->data);
+      GSList   *input_pads;
+      gint      deps = 0;
+
+      for (input_pads = node->input_pads; input_pads; input_pads = input_pads->next)
+        {
+          GeglPad *source_pad = gegl_pad_get_connected_to (input_pads->data);
+
+          /* Only "output" is delivered, see gegl_graph_process_node */
+          if (source_pad &&
+              !strcmp (gegl_pad_get_name (source_pad), "output") &&
+              g_hash_table_contains (path->contexts, gegl_pad_get_node (source_pad)))
+            deps++;
+        }
+
+      g_hash_table_insert (schedule.deps, node, GINT_TO_POINTER (deps));
+      if (deps == 0)
+        g_queue_push_tail (&schedule.ready, node);
+      schedule.remaining++;
+    }
+
+  path->schedule = &schedule;
+  path->parallel_passes++;
+
+  g_mutex_lock (&schedule.mutex);
+
+  while (schedule.remaining > 0)
+    {
+      /* Wait for what is running, and start nothing new */
+      if (g_cancellable_is_cancelled (cancellable))
+        {
+          if (schedule.running == 0)
+            break;
+          g_cond_wait (&schedule.cond, &schedule.mutex);
+          continue;
+        }
+
+      while (!g_queue_is_empty (&schedule.ready) &&
+             schedule.running < gegl_config_threads ())
+        {
+          GeglNode      *node = g_queue_peek_head (&schedule.ready);
+          GeglGraphTask *task;
+          guint64        size;
+
+          size = gegl_graph_estimate_output_size (node,
+                   g_hash_table_lookup (path->contexts, node));
+
+          /* Let what is running finish before going over the limit */
+          if (schedule.running > 0 &&
+              schedule.in_flight + size > max_in_flight)
+            break;
+
+          g_queue_pop_head (&schedule.ready);
+
+          task       = g_slice_new (GeglGraphTask);
+          task->path = path;
+          task->node = node;
+          task->size = size;
+
+          schedule.running++;
+          schedule.in_flight += size;
+          g_thread_pool_push (pool, task, NULL);
+        }
+
+      if (schedule.remaining > 0)
+        g_cond_wait (&schedule.cond, &schedule.mutex);
+    }
+
+  g_mutex_unlock (&schedule.mutex);
+
+  path->schedule = NULL;
+
+  last_context = g_hash_table_lookup (path->contexts, schedule.last_node);
+
+  if (schedule.remaining > 0)
+    gegl_graph_abandon_pass (path);
+  else if (schedule.last_result)
+    result = g_object_ref (schedule.last_result);
+  else if (gegl_node_has_pad (schedule.last_node, "output"))
+    result = g_object_ref (gegl_graph_get_shared_empty (path));
+  gegl_operation_context_purge (last_context);
+
+  g_hash_table_unref (schedule.deps);
+  g_queue_clear (&schedule.ready);
+  g_cond_clear (&schedule.cond);
+  g_mutex_clear (&schedule.mutex);
+
+  return result;
+}
+
 /**
  * gegl_graph_process:
  * @path: The traversal path
@@ -384,18 +1138,59 @@ gegl_graph_get_shared_empty (GeglGraphTraversal *path)
  * If gegl_graph_prepare_request has not been called
  * the behavior of this function is undefined.
  *
+ * When more than one thread is configured and the graph has
+ * independent branches, the nodes are run on a thread pool in
+ * dependency order rather than one after the other.
+ *
+ * The pass stops between two nodes once the #GCancellable that is
+ * current for the calling thread (see g_cancellable_push_current) is
+ * cancelled, NULL is returned in that case.
+ *
  * Return value: (transfer full): The result of the graph, or NULL if
- * there is no output pad.
+ * there is no output pad or processing was cancelled.
  */
 GeglBuffer *
 gegl_graph_process (GeglGraphTraversal *path,
                     gint                level)
+{
+  return gegl_graph_process_full (path, level, NULL);
+}
+
+/**
+ * gegl_graph_process_full:
+ * @path: The traversal path
+ * @level: The level to render at
+ * @captures: (allow-none): A table with nodes of @path as keys
+ *
+ * Like gegl_graph_process, and the value for each node in @captures
+ * is replaced by a reference to the output the node produced during the
+ * pass. Nodes that produced nothing keep their value.
+ *
+ * Return value: (transfer full): The result of the graph, or NULL if
+ * there is no output pad or processing was cancelled.
+ */
+GeglBuffer *
+gegl_graph_process_full (GeglGraphTraversal *path,
+                         gint                level,
+                         GHashTable         *captures)
 {
   GList *list_iter = NULL;
   GeglBuffer *result = NULL;
   GeglOperationContext *context = NULL;
   GeglOperationContext *last_context = NULL;
   GeglBuffer *operation_result = NULL;
+  GCancellable *cancellable = g_cancellable_get_current ();
+
+  path->captures = captures;
+
+  if (gegl_config_threads () > 1 &&
+      !g_private_get (&graph_worker_key) &&
+      gegl_graph_has_parallel_branches (path))
+    {
+      result = gegl_graph_process_parallel (path, level, cancellable);
+      path->captures = NULL;
+      return result;
+    }
 
   for (list_iter = path->dfs_path; list_iter; list_iter = list_iter->next)
     {
@@ -403,80 +1198,28 @@ gegl_graph_process (GeglGraphTraversal *path,
       GeglOperation *operation = node->operation;
       g_return_val_if_fail (node, NULL);
       g_return_val_if_fail (operation, NULL);
-      
-      GEGL_INSTRUMENT_START();
 
-      operation_result = NULL;
+      if (g_cancellable_is_cancelled (cancellable))
+        {
+          GEGL_NOTE (GEGL_DEBUG_PROCESS, "Processing cancelled before %s",
+                     gegl_node_get_debug_name (node));
+          gegl_graph_abandon_pass (path);
+          path->captures = NULL;
+          return NULL;
+        }
 
+      /* Done with the inputs of the previous node, and its consumers
+       * hold their own references to its output.
+       */
       if (last_context)
         gegl_operation_context_purge (last_context);
       
       context = g_hash_table_lookup (path->contexts, node);
       g_return_val_if_fail (context, NULL);
 
-      GEGL_NOTE (GEGL_DEBUG_PROCESS,
-                 "Will process %s result_rect = %d, %d %d×%d",
-                 gegl_node_get_debug_name (node),
-                 context->result_rect.x, context->result_rect.y, context->result_rect.width, context->result_rect.height);
-      
-      if (context->need_rect.width > 0 && context->need_rect.height > 0)
-        {
-          if (context->cached)
-            {
-              GEGL_NOTE (GEGL_DEBUG_PROCESS,
-                         "Using cached result for %s",
-                         gegl_node_get_debug_name (node));
-              operation_result = GEGL_BUFFER (node->cache);
-            }
-          else
-            {
-              /* Guarantee input pad */
-              if (gegl_node_has_pad (node, "input") &&
-                  !gegl_operation_context_get_object (context, "input"))
-                {
-                  gegl_operation_context_set_object (context, "input", G_OBJECT (gegl_graph_get_shared_empty(path)));
-                }
-
-              context->level = level;
-              gegl_operation_process (operation, context, "output", &context->need_rect, context->level);
-              operation_result = GEGL_BUFFER (gegl_operation_context_get_object (context, "output"));
-
-              if (operation_result && operation_result == (GeglBuffer *)operation->node->cache)
-                gegl_cache_computed (operation->node->cache, &context->need_rect, level);
-            }
-        }
-      else
-        {
-          operation_result = NULL;
-        }
-
-      if (operation_result)
-        {
-          GeglPad *output_pad = gegl_node_get_pad (node, "output");
-          GList   *targets = gegl_graph_get_connected_output_contexts (path, output_pad);
-          GList   *targets_iter;
-
-          GEGL_NOTE (GEGL_DEBUG_PROCESS,
-                     "Will deliver the results of %s:%s to %d targets",
-                     gegl_node_get_debug_name (node),
-                     "output",
-                     g_list_length (targets));
-          
-          if (g_list_length (targets) > 1)
-            gegl_object_set_has_forked (G_OBJECT (operation_result));
+      operation_result = gegl_graph_process_node (path, node, context, level);
 
-          for (targets_iter = targets; targets_iter; targets_iter = g_list_next (targets_iter))
-            {
-              ContextConnection *target_con = targets_iter->data;
-              gegl_operation_context_set_object (target_con->context, target_con->name, G_OBJECT (operation_result));
-            }
-          
-          g_list_free_full (targets, free_context_connection);
-        }
-      
       last_context = context;
-
-      GEGL_INSTRUMENT_END ("process", gegl_node_get_operation (node));
     }
   
   if (last_context)
@@ -488,5 +1231,7 @@ gegl_graph_process (GeglGraphTraversal *path,
       gegl_operation_context_purge (last_context);
     }
 
+  path->captures = NULL;
+
   return result;
 }
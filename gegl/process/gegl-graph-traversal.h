@@ -24,13 +24,24 @@ GeglGraphTraversal *gegl_graph_build            (GeglNode            *node);
 void                gegl_graph_rebuild          (GeglGraphTraversal  *path,
                                                  GeglNode            *node);
 void                gegl_graph_free             (GeglGraphTraversal  *path);
+void                gegl_graph_flush_invalidations
+                                                (GeglGraphTraversal  *path);
+gboolean            gegl_graph_is_stale         (GeglGraphTraversal  *path);
 
 void                gegl_graph_prepare          (GeglGraphTraversal  *path);
 void                gegl_graph_prepare_request  (GeglGraphTraversal  *path,
                                                  const GeglRectangle *roi,
                                                  gint                 level);
+void                gegl_graph_prepare_requests (GeglGraphTraversal  *path,
+                                                 GeglNode           **nodes,
+                                                 const GeglRectangle *request_rois,
+                                                 gint                 n_requests,
+                                                 gint                 level);
 GeglBuffer         *gegl_graph_process          (GeglGraphTraversal  *path,
                                                  gint                 level);
+GeglBuffer         *gegl_graph_process_full     (GeglGraphTraversal  *path,
+                                                 gint                 level,
+                                                 GHashTable          *captures);
 
 GeglRectangle       gegl_graph_get_bounding_box (GeglGraphTraversal  *path);
 
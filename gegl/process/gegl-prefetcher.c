@@ -0,0 +1,346 @@
+/* This file is part of GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <math.h>
+
+#include <glib-object.h>
+
+#include "gegl.h"
+#include "gegl-types-internal.h"
+#include "gegl-debug.h"
+
+#include "buffer/gegl-buffer-private.h"
+#include "buffer/gegl-region.h"
+#include "graph/gegl-node-private.h"
+
+#include "process/gegl-blit-job-private.h"
+#include "process/gegl-prefetcher.h"
+
+/* Jobs still waiting or running, anything beyond is not worth it, the
+ * view will have moved on by the time they are done.
+ */
+#define GEGL_PREFETCHER_MAX_JOBS 8
+
+struct _GeglPrefetcher
+{
+  GMutex    mutex;
+  GeglNode *node;      /* owns the cache we are attached to */
+  GSList   *jobs;
+
+  gboolean  have_last;
+  gdouble   last_scale;
+  gdouble   last_x;    /* center of the last request */
+  gdouble   last_y;
+  gdouble   x_delta;   /* smoothed movement between requests */
+  gdouble   y_delta;
+};
+
+/* Every prefetcher, so that a change anywhere in a graph can stop the
+ * jobs rendering it, see gegl_prefetcher_cancel_all.
+ */
+static GMutex  prefetchers_mutex;
+static GSList *prefetchers = NULL;
+
+static GQuark
+gegl_prefetcher_quark (void)
+{
+  static GQuark the_quark = 0;
+
+  if (G_UNLIKELY (the_quark == 0))
+    the_quark = g_quark_from_static_string ("gegl-prefetcher");
+
+  return the_quark;
+}
+
+/* Cancel @jobs, wait for them and release them. Cancelled tiles are
+ * skipped, so this only waits for the tile being rendered. The render
+ * thread itself would wait for itself.
+ */
+static void
+gegl_prefetcher_stop_jobs (GSList *jobs)
+{
+  GSList *iter;
+
+  for (iter = jobs; iter; iter = iter->next)
+    gegl_blit_job_cancel (iter->data);
+
+  if (!gegl_blit_job_in_render_thread ())
+    {
+      for (iter = jobs; iter; iter = iter->next)
+        gegl_blit_job_wait (iter->data);
+    }
+
+  for (iter = jobs; iter; iter = iter->next)
+    gegl_blit_job_unref (iter->data);
+
+  g_slist_free (jobs);
+}
+
+static void
+gegl_prefetcher_free (gpointer data)
+{
+  GeglPrefetcher *prefetcher = data;
+
+  g_mutex_lock (&prefetchers_mutex);
+  prefetchers = g_slist_remove (prefetchers, prefetcher);
+  g_mutex_unlock (&prefetchers_mutex);
+
+  gegl_prefetcher_cancel (prefetcher);
+  g_mutex_clear (&prefetcher->mutex);
+  g_slice_free (GeglPrefetcher, prefetcher);
+}
+
+/**
+ * gegl_prefetcher_get:
+ * @node: a #GeglNode
+ *
+ * Get the prefetcher attached to the cache of @node, creating the cache
+ * and the prefetcher if needed. It lives as long as the cache does, its
+ * jobs only hold on to @node until they finished.
+ */
+GeglPrefetcher *
+gegl_prefetcher_get (GeglNode *node)
+{
+  GeglCache      *cache = gegl_node_get_cache (node);
+  GeglPrefetcher *prefetcher;
+
+  prefetcher = g_object_get_qdata (G_OBJECT (cache), gegl_prefetcher_quark ());
+
+  if (!prefetcher)
+    {
+      prefetcher = g_slice_new0 (GeglPrefetcher);
+      g_mutex_init (&prefetcher->mutex);
+      prefetcher->node = node;
+
+      g_object_set_qdata_full (G_OBJECT (cache), gegl_prefetcher_quark (),
+                               prefetcher, gegl_prefetcher_free);
+
+      g_mutex_lock (&prefetchers_mutex);
+      prefetchers = g_slist_prepend (prefetchers, prefetcher);
+      g_mutex_unlock (&prefetchers_mutex);
+    }
+
+  return prefetcher;
+}
+
+/**
+ * gegl_prefetcher_cancel:
+ * @prefetcher: a #GeglPrefetcher
+ *
+ * Abandon all prefetching, to be called before a foreground request is
+ * rendered so that it does not compete with speculative work. Returns
+ * once the jobs stopped touching the cache, unless called while one of
+ * them is being rendered.
+ */
+void
+gegl_prefetcher_cancel (GeglPrefetcher *prefetcher)
+{
+  GSList *jobs;
+
+  g_mutex_lock (&prefetcher->mutex);
+  jobs = prefetcher->jobs;
+  prefetcher->jobs = NULL;
+  g_mutex_unlock (&prefetcher->mutex);
+
+  gegl_prefetcher_stop_jobs (jobs);
+}
+
+/**
+ * gegl_prefetcher_cancel_all:
+ *
+ * Abandon the prefetching of every node, to be called before any
+ * operation, property or connection is changed, since the jobs may be
+ * rendering through the node being changed. Returns once the jobs
+ * stopped rendering, unless called while one of them is being rendered.
+ */
+void
+gegl_prefetcher_cancel_all (void)
+{
+  GSList *jobs = NULL;
+  GSList *iter;
+
+  if (!g_atomic_pointer_get (&prefetchers))
+    return;
+
+  /* The jobs are stopped outside the lock, a prefetcher whose cache goes
+   * away meanwhile does not own them anymore.
+   */
+  g_mutex_lock (&prefetchers_mutex);
+  for (iter = prefetchers; iter; iter = iter->next)
+    {
+      GeglPrefetcher *prefetcher = iter->data;
+
+      g_mutex_lock (&prefetcher->mutex);
+      jobs = g_slist_concat (prefetcher->jobs, jobs);
+      prefetcher->jobs = NULL;
+      g_mutex_unlock (&prefetcher->mutex);
+    }
+  g_mutex_unlock (&prefetchers_mutex);
+
+  gegl_prefetcher_stop_jobs (jobs);
+}
+
+static void
+gegl_prefetcher_prune (GeglPrefetcher *prefetcher)
+{
+  GSList *iter = prefetcher->jobs;
+
+  while (iter)
+    {
+      GSList *next = iter->next;
+
+      if (gegl_blit_job_is_done (iter->data))
+        {
+          gegl_blit_job_unref (iter->data);
+          prefetcher->jobs = g_slist_delete_link (prefetcher->jobs, iter);
+        }
+
+      iter = next;
+    }
+}
+
+/* Start rendering @rect at @scale into the cache, unless it is outside
+ * the node or already there.
+ */
+static void
+gegl_prefetcher_fetch (GeglPrefetcher      *prefetcher,
+                       gdouble              scale,
+                       const GeglRectangle *rect)
+{
+  GeglNode      *node  = prefetcher->node;
+  GeglCache     *cache = gegl_node_get_cache (node);
+  GeglRectangle  unscaled;
+  gint           level = 0;
+
+  if (g_slist_length (prefetcher->jobs) >= GEGL_PREFETCHER_MAX_JOBS)
+    return;
+
+  unscaled = _gegl_get_required_for_scale (NULL, rect, scale);
+  if (scale != 1.0 && gegl_mipmap_rendering_enabled ())
+    level = MIN (gegl_level_from_scale (scale), GEGL_CACHE_VALID_MIPMAPS - 1);
+
+  if (!gegl_rectangle_intersect (NULL, &unscaled, &node->have_rect))
+    return;
+
+  if (gegl_region_rect_in (cache->valid_region[level], &unscaled) == GEGL_OVERLAP_RECTANGLE_IN)
+    return;
+
+  GEGL_NOTE (GEGL_DEBUG_PROCESS, "Prefetching %d, %d %d×%d at %f of %s",
+             rect->x, rect->y, rect->width, rect->height, scale,
+             gegl_node_get_debug_name (node));
+
+  prefetcher->jobs =
+    g_slist_prepend (prefetcher->jobs,
+                     gegl_node_blit_async (node, scale, rect, NULL, NULL,
+                                           GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_CACHE,
+                                           G_PRIORITY_LOW, NULL, NULL));
+}
+
+/**
+ * gegl_prefetcher_request:
+ * @prefetcher: a #GeglPrefetcher
+ * @scale: the scale @roi was rendered at
+ * @roi: the rectangle that was rendered, in scaled coordinates
+ *
+ * Record a foreground request and start prefetching around it: the
+ * next rectangle along the direction the requests have been moving in,
+ * or all four neighbours when they have not been moving, and the same
+ * area one mipmap level down.
+ */
+void
+gegl_prefetcher_request (GeglPrefetcher      *prefetcher,
+                         gdouble              scale,
+                         const GeglRectangle *roi)
+{
+  gdouble x = roi->x + roi->width  / 2.0;
+  gdouble y = roi->y + roi->height / 2.0;
+  gint    x_step = 0;
+  gint    y_step = 0;
+
+  if (roi->width <= 0 || roi->height <= 0)
+    return;
+
+  g_mutex_lock (&prefetcher->mutex);
+
+  gegl_prefetcher_prune (prefetcher);
+
+  if (prefetcher->have_last && prefetcher->last_scale == scale)
+    {
+      gdouble x_delta = x - prefetcher->last_x;
+      gdouble y_delta = y - prefetcher->last_y;
+
+      /* Jumps are several tiles of one frame being requested in turn,
+       * not movement of the view.
+       */
+      if (fabs (x_delta) <= roi->width && fabs (y_delta) <= roi->height)
+        {
+          prefetcher->x_delta = prefetcher->x_delta * 0.5 + x_delta * 0.5;
+          prefetcher->y_delta = prefetcher->y_delta * 0.5 + y_delta * 0.5;
+        }
+    }
+  else
+    {
+      prefetcher->x_delta = 0.0;
+      prefetcher->y_delta = 0.0;
+    }
+
+  prefetcher->have_last  = TRUE;
+  prefetcher->last_scale = scale;
+  prefetcher->last_x     = x;
+  prefetcher->last_y     = y;
+
+  if (fabs (prefetcher->x_delta) >= 1.0)
+    x_step = prefetcher->x_delta > 0.0 ? 1 : -1;
+  if (fabs (prefetcher->y_delta) >= 1.0)
+    y_step = prefetcher->y_delta > 0.0 ? 1 : -1;
+
+  if (x_step || y_step)
+    {
+      gegl_prefetcher_fetch (prefetcher, scale,
+                             GEGL_RECTANGLE (roi->x + x_step * roi->width,
+                                             roi->y + y_step * roi->height,
+                                             roi->width, roi->height));
+    }
+  else
+    {
+      gegl_prefetcher_fetch (prefetcher, scale,
+                             GEGL_RECTANGLE (roi->x + roi->width, roi->y,
+                                             roi->width, roi->height));
+      gegl_prefetcher_fetch (prefetcher, scale,
+                             GEGL_RECTANGLE (roi->x - roi->width, roi->y,
+                                             roi->width, roi->height));
+      gegl_prefetcher_fetch (prefetcher, scale,
+                             GEGL_RECTANGLE (roi->x, roi->y + roi->height,
+                                             roi->width, roi->height));
+      gegl_prefetcher_fetch (prefetcher, scale,
+                             GEGL_RECTANGLE (roi->x, roi->y - roi->height,
+                                             roi->width, roi->height));
+    }
+
+  /* Zooming out only pays off when it renders from a coarser level */
+  if (gegl_mipmap_rendering_enabled ())
+    {
+      gegl_prefetcher_fetch (prefetcher, scale / 2.0,
+                             GEGL_RECTANGLE (floor (roi->x / 2.0),
+                                             floor (roi->y / 2.0),
+                                             roi->width  / 2 + 1,
+                                             roi->height / 2 + 1));
+    }
+
+  g_mutex_unlock (&prefetcher->mutex);
+}
@@ -0,0 +1,37 @@
+/* This file is part of GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEGL_PREFETCHER_H__
+#define __GEGL_PREFETCHER_H__
+
+G_BEGIN_DECLS
+
+/* Renders into the cache of a node what is likely to be requested next,
+ * extrapolated from the requests made so far, with low priority blit
+ * jobs.
+ */
+typedef struct _GeglPrefetcher GeglPrefetcher;
+
+GeglPrefetcher * gegl_prefetcher_get     (GeglNode            *node);
+void             gegl_prefetcher_cancel  (GeglPrefetcher      *prefetcher);
+void             gegl_prefetcher_cancel_all (void);
+void             gegl_prefetcher_request (GeglPrefetcher      *prefetcher,
+                                          gdouble              scale,
+                                          const GeglRectangle *roi);
+
+G_END_DECLS
+
+#endif /* __GEGL_PREFETCHER_H__ */
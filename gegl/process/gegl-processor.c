@@ -18,6 +18,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <glib-object.h>
 
 #include "gegl.h"
@@ -82,6 +84,9 @@ struct _GeglProcessor
   GSList          *dirty_rectangles;
   gint             chunk_size;
 
+  gint             progressive;      /* coarser levels to render first */
+  gint             pass;             /* coarser levels still to render */
+
   gdouble          progress;
 };
 
@@ -139,6 +144,8 @@ gegl_processor_init (GeglProcessor *processor)
   processor->queued_region    = NULL;
   processor->dirty_rectangles = NULL;
   processor->chunk_size       = 128 * 128;
+  processor->progressive      = 0;
+  processor->pass             = 0;
 }
 
 static void
@@ -346,6 +353,9 @@ gegl_processor_set_rectangle (GeglProcessor       *processor,
       processor->dirty_rectangles = NULL;
     }
 
+  /* start over from the coarsest pass */
+  processor->pass = processor->progressive;
+
   /* if the node's operation is a sink and it needs the full content then
    * a context will be set up together with a cache and
    * needed and result rectangles */
@@ -411,6 +421,116 @@ gegl_processor_get_band_size (gint size)
   return band_size;
 }
 
+/* The level the current pass renders at, coarser than the processor's
+ * level while progressive rendering has passes left.
+ */
+static inline gint
+gegl_processor_pass_level (GeglProcessor *processor)
+{
+  return MIN (processor->level + processor->pass, GEGL_CACHE_VALID_MIPMAPS - 1);
+}
+
+/* The processor's rectangle in the coordinates of the current pass */
+static GeglRectangle
+gegl_processor_pass_rectangle (GeglProcessor *processor)
+{
+  GeglRectangle rect  = processor->rectangle;
+  gint          shift = gegl_processor_pass_level (processor) - processor->level;
+
+  if (shift > 0)
+    {
+      gint x1 = rect.x >> shift;
+      gint y1 = rect.y >> shift;
+      gint x2 = (rect.x + rect.width  + (1 << shift) - 1) >> shift;
+      gint y2 = (rect.y + rect.height + (1 << shift) - 1) >> shift;
+
+      gegl_rectangle_set (&rect, x1, y1, x2 - x1, y2 - y1);
+    }
+
+  return rect;
+}
+
+/* Scales the result of a coarse pass up to the processor's level, where
+ * it stands in for what has not been rendered yet. The placeholder is not
+ * marked as computed, so the refining passes still replace it.
+ */
+static void
+gegl_processor_set_placeholder (GeglProcessor       *processor,
+                                GeglCache           *cache,
+                                const GeglRectangle *coarse,
+                                const Babl          *format,
+                                const guchar        *buf)
+{
+  const gint     factor = 1 << (gegl_processor_pass_level (processor) -
+                                processor->level);
+  const gint     pxsize = babl_format_get_bytes_per_pixel (format);
+  GeglRectangle  fine;
+  GeglRectangle  visible;
+  GeglRegion    *region;
+  GeglRectangle *rectangles;
+  gint           n_rectangles;
+  guchar        *band;
+  gint           y;
+
+  gegl_rectangle_set (&fine, coarse->x * factor, coarse->y * factor,
+                      coarse->width * factor, coarse->height * factor);
+
+  if (!gegl_rectangle_intersect (&visible, &fine, &processor->rectangle))
+    return;
+
+  /* never cover what already is rendered in full detail */
+  region = gegl_region_rectangle (&visible);
+  g_mutex_lock (&cache->mutex);
+  gegl_region_subtract (region, cache->valid_region[processor->level]);
+  g_mutex_unlock (&cache->mutex);
+  gegl_region_get_rectangles (region, &rectangles, &n_rectangles);
+  gegl_region_destroy (region);
+
+  if (!n_rectangles)
+    {
+      g_free (rectangles);
+      return;
+    }
+
+  band = g_malloc (fine.width * factor * pxsize);
+
+  /* one row of the coarse result at a time, repeated factor times in
+   * both directions
+   */
+  for (y = 0; y < coarse->height; y++)
+    {
+      const guchar  *src = buf + y * coarse->width * pxsize;
+      GeglRectangle  band_rect;
+      gint           x;
+      gint           i;
+
+      for (x = 0; x < fine.width; x++)
+        memcpy (band + x * pxsize, src + (x / factor) * pxsize, pxsize);
+      for (i = 1; i < factor; i++)
+        memcpy (band + i * fine.width * pxsize, band, fine.width * pxsize);
+
+      gegl_rectangle_set (&band_rect,
+                          fine.x, fine.y + y * factor, fine.width, factor);
+
+      for (i = 0; i < n_rectangles; i++)
+        {
+          GeglRectangle part;
+
+          if (gegl_rectangle_intersect (&part, &band_rect, &rectangles[i]))
+            gegl_buffer_set (GEGL_BUFFER (cache), &part, processor->level,
+                             format,
+                             band + ((part.y - band_rect.y) * fine.width +
+                                     (part.x - band_rect.x)) * pxsize,
+                             fine.width * pxsize);
+        }
+    }
+
+  g_free (band);
+  g_free (rectangles);
+
+  g_signal_emit_by_name (cache, "computed", &visible);
+}
+
 /* If the processor's dirty rectangle is too big then it will be cut, added
  * to the processor's list of dirty rectangles and TRUE will be returned.
  * If the rectangle is small enough it will be processed, using a buffer or
@@ -420,6 +540,7 @@ render_rectangle (GeglProcessor *processor)
 {
   gboolean    buffered;
   const gint  max_area = processor->chunk_size * (1<<processor->level) * (1<<processor->level);
+  const gint  pass_level = gegl_processor_pass_level (processor);
   GeglCache  *cache    = NULL;
   const Babl *format   = NULL;
   gint        pxsize;
@@ -484,7 +605,9 @@ render_rectangle (GeglProcessor *processor)
       if (buffered)
         {
           gboolean found_full = FALSE;
-          for (gint level = processor->level; level >= 0; level--)
+          /* coarse passes are in coordinates of their own level only */
+          gint     finest     = pass_level != processor->level ? pass_level : 0;
+          for (gint level = pass_level; level >= finest; level--)
           {
             if (gegl_region_rect_in (cache->valid_region[level], dr) == GEGL_OVERLAP_RECTANGLE_IN)
             {
@@ -507,15 +630,27 @@ render_rectangle (GeglProcessor *processor)
               /* FIXME: Check if the node caches naturaly, if so the buffer_set call isn't needed */
 
               /* do the image calculations using the buffer */
-              gegl_node_blit (processor->input, 1.0/(1<<processor->level),
+              gegl_node_blit (processor->input, 1.0/(1<<pass_level),
                               dr, format, buf,
                               GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
 
               /* copy the buffer data into the cache */
-              gegl_buffer_set (GEGL_BUFFER (cache), dr, processor->level, format, buf, GEGL_AUTO_ROWSTRIDE);
+              gegl_buffer_set (GEGL_BUFFER (cache), dr, pass_level, format, buf, GEGL_AUTO_ROWSTRIDE);
+
+              if (pass_level != processor->level)
+                {
+                  /* a coarse pass only shows up as a placeholder */
+                  g_mutex_lock (&cache->mutex);
+                  gegl_region_union_with_rect (cache->valid_region[pass_level], dr);
+                  g_mutex_unlock (&cache->mutex);
 
-              /* tells the cache that the rectangle (dr) has been computed */
-              gegl_cache_computed (cache, dr, processor->level);
+                  gegl_processor_set_placeholder (processor, cache, dr, format, buf);
+                }
+              else
+                {
+                  /* tells the cache that the rectangle (dr) has been computed */
+                  gegl_cache_computed (cache, dr, processor->level);
+                }
 
               /* release the buffer */
               g_free (buf);
@@ -627,6 +762,26 @@ gegl_processor_progress (GeglProcessor *processor)
   return ret;
 }
 
+/* Removes @roi, in the coordinates of the current pass, from the region
+ * still queued, which is in the coordinates of the processor's level.
+ */
+static void
+gegl_processor_unqueue (GeglProcessor       *processor,
+                        const GeglRectangle *roi)
+{
+  const gint     factor = 1 << (gegl_processor_pass_level (processor) -
+                                processor->level);
+  GeglRectangle  rect;
+  GeglRegion    *tr;
+
+  gegl_rectangle_set (&rect, roi->x * factor, roi->y * factor,
+                      roi->width * factor, roi->height * factor);
+
+  tr = gegl_region_rectangle (&rect);
+  gegl_region_subtract (processor->queued_region, tr);
+  gegl_region_destroy (tr);
+}
+
 /* Processes the rectangle (might be only splitting it to smaller ones) and
  * updates the progress indicator */
 static gboolean
@@ -643,7 +798,7 @@ gegl_processor_render (GeglProcessor *processor,
   else
     {
       g_return_val_if_fail (processor->input != NULL, FALSE);
-      valid_region = gegl_node_get_cache (processor->input)->valid_region[processor->level];
+      valid_region = gegl_node_get_cache (processor->input)->valid_region[gegl_processor_pass_level (processor)];
     }
 
   {
@@ -694,9 +849,8 @@ gegl_processor_render (GeglProcessor *processor,
       for (i = 0; i < n_rectangles && i < 1; i++)
         {
           GeglRectangle  roi = rectangles[i];
-          GeglRegion    *tr = gegl_region_rectangle (&roi);
-          gegl_region_subtract (processor->queued_region, tr);
-          gegl_region_destroy (tr);
+
+          gegl_processor_unqueue (processor, &roi);
 
           processor->dirty_rectangles = g_slist_prepend (processor->dirty_rectangles,
                                                          g_slice_dup (GeglRectangle, &roi));
@@ -748,6 +902,55 @@ gegl_processor_render (GeglProcessor *processor,
   return !gegl_processor_is_rendered (processor);
 }
 
+/* Maps the progress of the current pass onto the whole of a progressive
+ * rendering, each pass weighted by its area.
+ */
+static gdouble
+gegl_processor_pass_progress (GeglProcessor *processor,
+                              gdouble        progress)
+{
+  gdouble done   = 0.0;
+  gdouble total  = 0.0;
+  gdouble weight = 1.0;
+  gint    pass;
+
+  for (pass = 0; pass <= processor->progressive; pass++, weight /= 4.0)
+    {
+      total += weight;
+
+      if (pass > processor->pass)
+        done += weight;
+      else if (pass == processor->pass)
+        done += weight * progress;
+    }
+
+  return done / total;
+}
+
+/* Invalidations queued on nodes with "defer-invalidations" set only
+ * reach the cache of our input when flushed, do that before its valid
+ * region is trusted.
+ */
+static void
+gegl_processor_flush_invalidations (GeglProcessor *processor)
+{
+  GeglListVisitor *visitor;
+  GList           *visits_list;
+  GList           *iterator;
+
+  if (!gegl_node_invalidations_pending ())
+    return;
+
+  visitor = g_object_new (GEGL_TYPE_LIST_VISITOR, NULL);
+  visits_list = gegl_list_visitor_get_dfs_path (visitor, GEGL_VISITABLE (processor->node));
+
+  for (iterator = visits_list; iterator; iterator = iterator->next)
+    gegl_node_flush_invalidations (GEGL_NODE (iterator->data));
+
+  g_list_free (visits_list);
+  g_object_unref (visitor);
+}
+
 /* Will call gegl_processor_render and when there is no more work to be done,
  * it will write the result to the destination */
 gboolean
@@ -756,6 +959,8 @@ gegl_processor_work (GeglProcessor *processor,
 {
   gboolean   more_work = FALSE;
 
+  gegl_processor_flush_invalidations (processor);
+
   if (gegl_config()->use_opencl)
     {
       if (gegl_cl_is_accelerated ()
@@ -782,9 +987,39 @@ gegl_processor_work (GeglProcessor *processor,
         }
     }
 
+  /* Coarse passes only pay off when mipmap rendering makes them cheaper,
+   * and when there is something left to refine.
+   */
+  if (processor->pass &&
+      (!gegl_mipmap_rendering_enabled () ||
+       processor->input != processor->node ||
+       gegl_region_rect_in (gegl_node_get_cache (processor->input)->valid_region[processor->level],
+                            &processor->rectangle) == GEGL_OVERLAP_RECTANGLE_IN))
+    {
+      processor->pass = 0;
+    }
+
+  if (processor->pass)
+    {
+      GeglRectangle rectangle = gegl_processor_pass_rectangle (processor);
+
+      more_work = gegl_processor_render (processor, &rectangle, progress);
+      if (!more_work)
+        processor->pass--;
+
+      if (progress)
+        *progress = gegl_processor_pass_progress (processor,
+                                                  more_work ? *progress : 0.0);
+
+      return TRUE;
+    }
+
   more_work = gegl_processor_render (processor, &processor->rectangle, progress);
   if (more_work)
     {
+      if (progress)
+        *progress = gegl_processor_pass_progress (processor, *progress);
+
       return TRUE;
     }
 
@@ -831,3 +1066,13 @@ void gegl_processor_set_scale (GeglProcessor *processor,
 {
   processor->level = gegl_level_from_scale (scale);
 }
+
+void
+gegl_processor_set_progressive (GeglProcessor *processor,
+                                gint           levels)
+{
+  g_return_if_fail (GEGL_IS_PROCESSOR (processor));
+
+  processor->progressive = CLAMP (levels, 0, GEGL_CACHE_VALID_MIPMAPS - 1);
+  processor->pass        = processor->progressive;
+}
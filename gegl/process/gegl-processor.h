@@ -47,6 +47,23 @@ void gegl_processor_set_level (GeglProcessor *processor,
 void gegl_processor_set_scale (GeglProcessor *processor,
                                gdouble        scale);
 
+/**
+ * gegl_processor_set_progressive:
+ * @processor: a #GeglProcessor
+ * @levels: the number of coarser mipmap levels to render first, or 0
+ * to render at the processor's level only.
+ *
+ * Make the processor render its whole rectangle @levels mipmap levels
+ * coarser than its level first, and then refine it one level at a time.
+ * While refining, the cache holds the coarse results scaled up as
+ * placeholders, and "computed" is emitted for each pass, so a first
+ * frame can be shown long before the rendering is done. Only has an
+ * effect when mipmap rendering is enabled, and when processing a node
+ * that is not a sink.
+ */
+void gegl_processor_set_progressive (GeglProcessor *processor,
+                                     gint           levels);
+
 /**
  * gegl_processor_set_rectangle:
  * @processor: a #GeglProcessor
@@ -31,6 +31,24 @@
 
 #define BEZIER_SEGMENTS 64
 
+/* number of segments in each leaf of the segment index */
+#define INDEX_LEAF_SIZE 8
+
+/* A line segment of the flattened path */
+typedef struct
+{
+  gdouble x0, y0;
+  gdouble x1, y1;
+  gdouble start;  /*< distance along the path where the segment begins */
+  gdouble length;
+} GeglPathSegment;
+
+typedef struct
+{
+  gdouble x0, y0;
+  gdouble x1, y1;
+} GeglPathBox;
+
 struct _GeglPathClass
 {
   GObjectClass parent_class;
@@ -47,9 +65,12 @@ struct _GeglPathPrivate
   gdouble       length;
   gboolean      length_clean;
 
-  GeglPathList *calc_stop;
-  gdouble       calc_leftover;
-  gboolean      calc_clean;
+  GArray       *segments; /*< segments of the flat path, for queries */
+  GeglPathBox  *boxes;    /*< bounding box tree over runs of segments */
+  gint          n_leaves;
+  gdouble       min_x, max_x;
+  gdouble       min_y, max_y;
+  gboolean      index_clean;
 
   GeglRectangle dirtied;
   GeglRectangle cached_extent;
@@ -114,6 +135,7 @@ static const gchar *    parse_float_pair              (const gchar      *p,
 static void             gegl_path_emit_changed        (GeglPath         *self,
                                                        const GeglRectangle *bounds);
 static void             ensure_flattened              (GeglPath         *vector);
+static void             ensure_index                  (GeglPath         *vector);
 static GeglPathList *   ensure_tail                   (GeglPathPrivate  *priv);
 
 static GeglPathList *   flatten_copy                  (GeglMatrix3      *matrix,
@@ -149,12 +171,6 @@ static GeglPathList *   gegl_path_list_append_item    (GeglPathList     *head,
                                                        GeglPathList     *tail);
 static GeglPathList *   gegl_path_list_flatten        (GeglMatrix3      *matrix,
                                                        GeglPathList     *original);
-static gboolean         gegl_path_list_calc           (GeglPathList     *path,
-                                                       gdouble           pos,
-                                                       gdouble          *xd,
-                                                       gdouble          *yd,
-                                                       GeglPathList    **stop,
-                                                       gdouble          *leftover);
 static void             gegl_path_list_calc_values    (GeglPathList     *path,
                                                        guint             num_samples,
                                                        gdouble          *xs,
@@ -224,6 +240,9 @@ finalize (GObject *gobject)
     gegl_path_list_destroy (priv->path);
   if (priv->flat_path)
     gegl_path_list_destroy (priv->flat_path);
+  if (priv->segments)
+    g_array_free (priv->segments, TRUE);
+  g_free (priv->boxes);
   priv = NULL;
 
   G_OBJECT_CLASS (gegl_path_parent_class)->finalize (gobject);
@@ -266,7 +285,7 @@ gegl_path_new (void)
   gegl_path_init (self);
   priv->flat_path_clean = FALSE;
   priv->length_clean = FALSE;
-  priv->calc_clean = FALSE;
+  priv->index_clean = FALSE;
 
   return self;
 }
@@ -423,6 +442,102 @@ void gegl_path_get_matrix (GeglPath    *path,
   gegl_matrix3_copy_into (matrix, &priv->matrix);
 }
 
+static gdouble
+index_box_distance (const GeglPathBox *box,
+                    gdouble            x,
+                    gdouble            y)
+{
+  gdouble dx = MAX (MAX (box->x0 - x, x - box->x1), 0.0);
+  gdouble dy = MAX (MAX (box->y0 - y, y - box->y1), 0.0);
+
+  return dx * dx + dy * dy;
+}
+
+/* Find the point of the flat path closest to (x, y) by descending the
+ * box tree, nearest box first, and skipping boxes that are further away
+ * than the closest point found so far. Returns the squared distance, or
+ * G_MAXDOUBLE for a path without segments.
+ */
+static gdouble
+index_closest_point (GeglPathPrivate *priv,
+                     gdouble          x,
+                     gdouble          y,
+                     gdouble         *closest_x,
+                     gdouble         *closest_y,
+                     gdouble         *position)
+{
+  gint    stack[128];
+  gint    depth = 0;
+  gdouble best  = G_MAXDOUBLE;
+
+  if (!priv->segments->len)
+    return best;
+
+  stack[depth++] = 1;
+
+  while (depth)
+    {
+      gint node = stack[--depth];
+
+      if (index_box_distance (&priv->boxes[node], x, y) > best)
+        continue;
+
+      if (node >= priv->n_leaves)
+        {
+          guint j;
+
+          for (j = (node - priv->n_leaves) * INDEX_LEAF_SIZE;
+               j < MIN ((node - priv->n_leaves + 1) * INDEX_LEAF_SIZE,
+                        priv->segments->len);
+               j++)
+            {
+              GeglPathSegment *segment = &g_array_index (priv->segments,
+                                                         GeglPathSegment, j);
+              gdouble dx = segment->x1 - segment->x0;
+              gdouble dy = segment->y1 - segment->y0;
+              gdouble t  = 0.0;
+              gdouble px, py, dist;
+
+              if (segment->length > 0.0)
+                t = CLAMP (((x - segment->x0) * dx + (y - segment->y0) * dy) /
+                           (segment->length * segment->length), 0.0, 1.0);
+
+              px   = segment->x0 + t * dx;
+              py   = segment->y0 + t * dy;
+              dist = (px - x) * (px - x) + (py - y) * (py - y);
+
+              /* the first of equally close points along the path wins */
+              if (dist < best ||
+                  (dist == best &&
+                   segment->start + t * segment->length < *position))
+                {
+                  best       = dist;
+                  *closest_x = px;
+                  *closest_y = py;
+                  *position  = segment->start + t * segment->length;
+                }
+            }
+        }
+      else
+        {
+          gint near = 2 * node;
+          gint far  = 2 * node + 1;
+
+          if (index_box_distance (&priv->boxes[far], x, y) <
+              index_box_distance (&priv->boxes[near], x, y))
+            {
+              near = 2 * node + 1;
+              far  = 2 * node;
+            }
+
+          stack[depth++] = far;
+          stack[depth++] = near;
+        }
+    }
+
+  return best;
+}
+
 gdouble
 gegl_path_closest_point (GeglPath *path,
                          gdouble   x,
@@ -431,14 +546,22 @@ gegl_path_closest_point (GeglPath *path,
                          gdouble  *dy,
                          gint     *node_pos_before)
 {
-  gdouble length = gegl_path_get_length (path);
-  gint     i, n;
-  gdouble closest_dist = 100000;
-  gint   closest_val = 0;
-  gdouble  *samples_x;
-  gdouble  *samples_y;
+  GeglPathPrivate *priv;
+  GeglPathSegment *first;
+  GeglPathSegment *last;
+  gdouble          closest_x = 0.0;
+  gdouble          closest_y = 0.0;
+  gdouble          position  = 0.0;
+  gdouble          length;
+  gint             i;
 
-  if (length == 0)
+  if (!path)
+    return 0.0;
+
+  priv = GEGL_PATH_GET_PRIVATE (path);
+  ensure_index (path);
+
+  if (!priv->segments->len)
     {
       if (node_pos_before)
         {
@@ -447,43 +570,32 @@ gegl_path_closest_point (GeglPath *path,
       return 0.0;
     }
 
-  n = ceil(length);
-  samples_x = g_malloc (sizeof (gdouble)* n);
-  samples_y = g_malloc (sizeof (gdouble)* n);
+  index_closest_point (priv, x, y, &closest_x, &closest_y, &position);
 
-  gegl_path_calc_values (path, n, samples_x, samples_y);
+  first  = &g_array_index (priv->segments, GeglPathSegment, 0);
+  last   = &g_array_index (priv->segments, GeglPathSegment,
+                           priv->segments->len - 1);
+  length = last->start + last->length;
 
-  for (i=0;i<n;i++)
+  /* the end of a path that returns to its start counts as the start */
+  if (fabs (last->x1 - first->x0) < 2.1 && length - position < 0.5)
     {
-      gdouble dist = (samples_x[i]-x) * (samples_x[i]-x)  +
-                     (samples_y[i]-y) * (samples_y[i]-y);
-      if (dist < closest_dist)
-        {
-          closest_dist = dist;
-          closest_val = i;
-        }
-    }
-
-  if (fabs (samples_x[n-1] - samples_x[0]) < 2.1)
-    {
-      if (closest_val == n-1)
-        {
-          closest_val = 0;
-        }
+      position  = 0.0;
+      closest_x = first->x0;
+      closest_y = first->y0;
     }
 
   if (dx)
     {
-      *dx = samples_x[closest_val];
+      *dx = closest_x;
     }
   if (dy)
     {
-      *dy = samples_y[closest_val];
+      *dy = closest_y;
     }
 
   if (node_pos_before)
     {
-      GeglPathPrivate *priv = GEGL_PATH_GET_PRIVATE (path);
       GeglPathList *iter;
       /* what node was the one before us ? */
 
@@ -497,22 +609,15 @@ gegl_path_closest_point (GeglPath *path,
                                    iter->d.point[0].y,
                                    NULL, NULL, NULL);
           *node_pos_before = i;
-          if(dist >= closest_val - 2)
+          if(dist >= position - 2)
             {
               *node_pos_before = i-1;
               break;
             }
-          /*if(dist > closest_val)
-            {
-              break;
-            }*/
         }
     }
 
-  g_free (samples_x);
-  g_free (samples_y);
-
-  return closest_val * 1.0;
+  return position;
 }
 
 gboolean
@@ -521,42 +626,48 @@ gegl_path_calc (GeglPath   *self,
                 gdouble    *xd,
                 gdouble    *yd)
 {
-  GeglPathPrivate *priv = GEGL_PATH_GET_PRIVATE (self);
-  GeglPathList *entry = priv->flat_path;
-  GeglPathList *stop  = NULL;
-  gdouble rel_pos  = 0.0;
-  gdouble leftover = 0.0;
-  gboolean result = FALSE;
+  GeglPathPrivate *priv;
+  GeglPathSegment *segments;
+  GeglPathSegment *segment;
+  gdouble          ratio = 0.0;
+  gint             lo, hi;
 
   if (!self)
     return FALSE;
-  ensure_flattened (self);
 
-  if (priv->calc_clean && (pos > priv->calc_leftover))
-    {
-      entry    = priv->calc_stop;
-      leftover = priv->calc_leftover;
-      rel_pos  = pos - leftover;
-    }
-  else
-    {
-      rel_pos = pos;
-    }
+  priv = GEGL_PATH_GET_PRIVATE (self);
+  ensure_index (self);
 
-  if (gegl_path_list_calc (entry,rel_pos,xd,yd,&stop,&leftover))
-    {
-      priv->calc_stop = stop;
-      priv->calc_leftover = leftover;
-      priv->calc_clean = TRUE;
+  if (!priv->segments->len)
+    return FALSE;
 
-      result = TRUE;
-    }
-  else
+  segments = (GeglPathSegment *) priv->segments->data;
+  segment  = &segments[priv->segments->len - 1];
+
+  if (pos > segment->start + segment->length)
+    return FALSE;
+
+  /* the first segment that ends at or after pos */
+  lo = 0;
+  hi = priv->segments->len - 1;
+  while (lo < hi)
     {
-      priv->calc_clean = FALSE;
-      result = FALSE;
+      gint mid = (lo + hi) / 2;
+
+      if (segments[mid].start + segments[mid].length < pos)
+        lo = mid + 1;
+      else
+        hi = mid;
     }
-  return result;
+
+  segment = &segments[lo];
+  if (segment->length > 0.0)
+    ratio = (pos - segment->start) / segment->length;
+
+  *xd = segment->x0 + (segment->x1 - segment->x0) * ratio;
+  *yd = segment->y0 + (segment->y1 - segment->y0) * ratio;
+
+  return TRUE;
 }
 
 void
@@ -580,7 +691,6 @@ gegl_path_get_bounds (GeglPath *self,
                       gdouble  *max_y)
 {
   GeglPathPrivate *priv;
-  GeglPathList *iter;
 
   *min_x = 256.0;
   *min_y = 256.0;
@@ -592,37 +702,12 @@ gegl_path_get_bounds (GeglPath *self,
 
   priv = GEGL_PATH_GET_PRIVATE (self);
 
-  ensure_flattened (self);
-  iter = priv->flat_path;
-
-  while (iter)
-    {
-      gint i;
-      gint max = 0;
-
-      if (iter->d.type == 'M')
-        max = 1;
-      else if (iter->d.type == 'L')
-        max = 1;
-      else if (iter->d.type == 'C')
-        max = 3;
-      else if (iter->d.type == 'z')
-        max = 0;
-
-      for (i=0;i<max;i++)
-        {
-          if (iter->d.point[i].x < *min_x)
-            *min_x = iter->d.point[i].x;
-          if (iter->d.point[i].x > *max_x)
-            *max_x = iter->d.point[i].x;
-          if (iter->d.point[i].y < *min_y)
-            *min_y = iter->d.point[i].y;
-          if (iter->d.point[i].y > *max_y)
-            *max_y = iter->d.point[i].y;
+  ensure_index (self);
 
-        }
-      iter=iter->next;
-    }
+  *min_x = priv->min_x;
+  *max_x = priv->max_x;
+  *min_y = priv->min_y;
+  *max_y = priv->max_y;
 }
 
 void
@@ -1037,6 +1122,8 @@ gegl_path_emit_changed (GeglPath            *self,
   gdouble min_y;
   gdouble max_y;
 
+  priv->index_clean = FALSE;
+
   if (priv->frozen)
     return;
 
@@ -1097,7 +1184,180 @@ ensure_flattened (GeglPath *vector)
     gegl_path_list_destroy (path);
   priv->flat_path_clean = TRUE;
   priv->length_clean = FALSE;
-  priv->calc_clean = FALSE;
+  priv->index_clean = FALSE;
+}
+
+static void
+index_box_clear (GeglPathBox *box)
+{
+  box->x0 = box->y0 = G_MAXDOUBLE;
+  box->x1 = box->y1 = -G_MAXDOUBLE;
+}
+
+static void
+index_box_union (GeglPathBox       *dest,
+                 const GeglPathBox *a,
+                 const GeglPathBox *b)
+{
+  dest->x0 = MIN (a->x0, b->x0);
+  dest->y0 = MIN (a->y0, b->y0);
+  dest->x1 = MAX (a->x1, b->x1);
+  dest->y1 = MAX (a->y1, b->y1);
+}
+
+/**
+ * ensure_index:
+ * @vector: a #GeglPath
+ *
+ * Check if the segment index of the flat path and its bounds are up to
+ * date, and update them if needed. The leaves of the box tree hold runs
+ * of consecutive segments, only the leaves from the first segment that
+ * differs from the previous flat path on, and their parents, are
+ * recomputed; appending to a long path stays cheap.
+ */
+static void
+ensure_index (GeglPath *vector)
+{
+  GeglPathPrivate *priv = GEGL_PATH_GET_PRIVATE (vector);
+  GeglPathList    *iter;
+  GArray          *segments;
+  guint            n_segments = 0;
+  guint            changed;
+  gboolean         has_point  = FALSE;
+  gdouble          x = 0, y = 0;
+  gdouble          position   = 0;
+  gint             n_leaves;
+  gint             first, last, i;
+
+  ensure_flattened (vector);
+
+  if (priv->index_clean)
+    return;
+
+  if (!priv->segments)
+    priv->segments = g_array_new (FALSE, FALSE, sizeof (GeglPathSegment));
+  segments = priv->segments;
+  changed  = segments->len;
+
+  priv->min_x = 256.0;
+  priv->min_y = 256.0;
+  priv->max_x = -256.0;
+  priv->max_y = -256.0;
+
+  for (iter = priv->flat_path; iter; iter = iter->next)
+    {
+      GeglPathSegment segment;
+      gint            max = 0;
+
+      if (iter->d.type == 'M')
+        max = 1;
+      else if (iter->d.type == 'L')
+        max = 1;
+      else if (iter->d.type == 'C')
+        max = 3;
+
+      for (i = 0; i < max; i++)
+        {
+          priv->min_x = MIN (priv->min_x, iter->d.point[i].x);
+          priv->max_x = MAX (priv->max_x, iter->d.point[i].x);
+          priv->min_y = MIN (priv->min_y, iter->d.point[i].y);
+          priv->max_y = MAX (priv->max_y, iter->d.point[i].y);
+        }
+
+      if (iter->d.type != 'M' && iter->d.type != 'L')
+        continue;
+
+      if (iter->d.type == 'M' || !has_point)
+        {
+          x = iter->d.point[0].x;
+          y = iter->d.point[0].y;
+          has_point = TRUE;
+          continue;
+        }
+
+      segment.x0     = x;
+      segment.y0     = y;
+      segment.x1     = iter->d.point[0].x;
+      segment.y1     = iter->d.point[0].y;
+      segment.start  = position;
+      segment.length = sqrt ((segment.x1 - x) * (segment.x1 - x) +
+                             (segment.y1 - y) * (segment.y1 - y));
+      position += segment.length;
+
+      if (n_segments < segments->len)
+        {
+          GeglPathSegment *old = &g_array_index (segments, GeglPathSegment,
+                                                 n_segments);
+
+          if (n_segments < changed &&
+              memcmp (old, &segment, sizeof (GeglPathSegment)))
+            changed = n_segments;
+          *old = segment;
+        }
+      else
+        {
+          g_array_append_val (segments, segment);
+        }
+
+      n_segments++;
+      x = segment.x1;
+      y = segment.y1;
+    }
+
+  if (n_segments < segments->len)
+    {
+      changed = MIN (changed, n_segments);
+      g_array_set_size (segments, n_segments);
+    }
+
+  n_leaves = 1;
+  while (n_leaves * INDEX_LEAF_SIZE < n_segments)
+    n_leaves *= 2;
+
+  if (n_leaves != priv->n_leaves)
+    {
+      g_free (priv->boxes);
+      priv->boxes    = g_new (GeglPathBox, 2 * n_leaves);
+      priv->n_leaves = n_leaves;
+      changed        = 0;
+    }
+
+  /* the leaves at n_leaves.., the children of box i at 2i and 2i + 1 */
+  first = n_leaves + changed / INDEX_LEAF_SIZE;
+  last  = 2 * n_leaves - 1;
+
+  for (i = first; i <= last; i++)
+    {
+      GeglPathBox *box = &priv->boxes[i];
+      guint        j;
+
+      index_box_clear (box);
+
+      for (j = (i - n_leaves) * INDEX_LEAF_SIZE;
+           j < MIN ((i - n_leaves + 1) * INDEX_LEAF_SIZE, n_segments);
+           j++)
+        {
+          GeglPathSegment *segment = &g_array_index (segments,
+                                                     GeglPathSegment, j);
+
+          box->x0 = MIN (box->x0, MIN (segment->x0, segment->x1));
+          box->y0 = MIN (box->y0, MIN (segment->y0, segment->y1));
+          box->x1 = MAX (box->x1, MAX (segment->x0, segment->x1));
+          box->y1 = MAX (box->y1, MAX (segment->y0, segment->y1));
+        }
+    }
+
+  while (first > 1)
+    {
+      first /= 2;
+      last  /= 2;
+
+      for (i = first; i <= last; i++)
+        index_box_union (&priv->boxes[i],
+                         &priv->boxes[2 * i], &priv->boxes[2 * i + 1]);
+    }
+
+  priv->index_clean = TRUE;
 }
 
 /**
@@ -1394,89 +1654,6 @@ gegl_path_list_flatten (GeglMatrix3  *matrix,
   return self;
 }
 
-static gboolean
-gegl_path_list_calc (GeglPathList *path,
-                     gdouble       pos,
-                     gdouble      *xd,
-                     gdouble      *yd,
-                     GeglPathList **stop,
-                     gdouble      *leftover)
-{
-  GeglPathList *iter = path, *prev = NULL;
-  gfloat traveled = 0.0, next_pos = 0.0;
-
-  while (iter && !prev)
-  /* fetch the start point of the path */
-    {
-      /* fprintf (stderr, "%c, %f %f\n", iter->d.type, iter->d.point[0].x, iter->d.point[0].y);*/
-      switch (iter->d.type)
-        {
-          case 'M':
-          case 'L':
-            prev = iter;
-            break;
-          default :
-            break;
-        }
-      iter = iter->next;
-    }
-
-  while (iter)
-  /* travel along the path */
-    {
-      /* fprintf (stderr, "%c, %f %f\n", iter->d.type, iter->d.point[0].x, iter->d.point[0].y);*/
-      switch (iter->d.type)
-        {
-          case 'M':
-            prev = iter;
-            break;
-
-          case 'L':
-            {
-              GeglPathPoint a,b;
-              gfloat distance;
-
-              a.x = prev->d.point[0].x;
-              a.y = prev->d.point[0].y;
-
-              b.x = iter->d.point[0].x;
-              b.y = iter->d.point[0].y;
-
-              distance = gegl_path_point_dist (&a, &b);
-              next_pos += distance;
-
-              if (pos <= next_pos)
-                {
-                  GeglPathPoint spot;
-                  gfloat ratio = (pos - traveled) / (next_pos - traveled);
-
-                  gegl_path_point_lerp (&spot, &a, &b, ratio);
-
-                  *xd = spot.x;
-                  *yd = spot.y;
-
-                  *stop = prev;
-                  *leftover += traveled;
-                  return TRUE;
-                }
-
-              traveled = next_pos;
-
-              prev = iter;
-            }
-            break;
-          case 's':
-            break;
-          default:
-            g_warning ("can't compute length for instruction: %c\n", iter->d.type);
-            break;
-        }
-      iter=iter->next;
-    }
-  /*fprintf (stderr, "outside iterator bounds");*/
-  return FALSE;
-}
-
 static void
 gegl_path_list_calc_values (GeglPathList *path,
                             guint         num_samples,
@@ -124,18 +124,21 @@ p2tr_triangle_new (P2trEdge *AB,
   return p2tr_triangle_ref (self);
 }
 
+/* Point location takes and drops references from several threads at
+ * once while rendering, so the reference count is atomic
+ */
 P2trTriangle*
 p2tr_triangle_ref (P2trTriangle *self)
 {
-  ++self->refcount;
+  g_atomic_int_inc ((gint *) &self->refcount);
   return self;
 }
 
 void
 p2tr_triangle_unref (P2trTriangle *self)
 {
-  g_assert (self->refcount > 0);
-  if (--self->refcount == 0)
+  g_assert (g_atomic_int_get ((gint *) &self->refcount) > 0);
+  if (g_atomic_int_dec_and_test ((gint *) &self->refcount))
     p2tr_triangle_free (self);
 }
 
@@ -67,8 +67,12 @@ property_double (brightness, _("Brightness"), 0.0)
  */
 static void prepare (GeglOperation *operation)
 {
-  gegl_operation_set_format (operation, "input", babl_format ("RGBA float"));
-  gegl_operation_set_format (operation, "output", babl_format ("RGBA float"));
+  const Babl *format;
+
+  format = gegl_operation_point_filter_select_format (operation,
+                                                      babl_format ("RGBA float"));
+  gegl_operation_set_format (operation, "input", format);
+  gegl_operation_set_format (operation, "output", format);
 }
 
 /* For GeglOperationPointFilter subclasses, we operate on linear
@@ -144,6 +148,10 @@ gegl_op_class_init (GeglOpClass *klass)
    * of our superclasses deal with the handling on their level of abstraction)
    */
   point_filter_class->process = process;
+  /* every channel is mapped independently, integer inputs are processed
+   * through a lookup table built by the point filter class
+   */
+  point_filter_class->per_channel = TRUE;
 
   gegl_operation_class_set_keys (operation_class,
       "name",       "gegl:brightness-contrast",
@@ -256,17 +256,21 @@ process_row_random_covariant (GeglBufferIterator *gi,
                               guint               channel_mask [4],
                               guint               channel_bits [4],
                               gint                y,
-                              GeglRandom         *rand)
+                              GeglRandom         *rand,
+                              guint32            *random)
 {
   guint16 *data_in  = (guint16*) gi->data [0];
   guint16 *data_out = (guint16*) gi->data [1];
   guint x;
+
+  gegl_random_int_span (rand, gi->roi->x, gi->roi->y + y, 0, 0, 0,
+                        gi->roi->width, random);
+
   for (x = 0; x < gi->roi->width; x++)
     {
       guint pixel = 4 * (gi->roi->width * y + x);
       guint ch;
-      gint  r = REDUCE_16B (gegl_random_int (rand, gi->roi->x + x,
-                                             gi->roi->y + y, 0, 0));
+      gint  r = REDUCE_16B (random [x]);
       for (ch = 0; ch < 4; ch++)
         {
           gdouble value;
@@ -284,16 +288,34 @@ process_row_random_covariant (GeglBufferIterator *gi,
     }
 }
 
+/* The random numbers for each channel of a row, one row after the other */
+static void
+random_row_channels (GeglBufferIterator *gi,
+                     gint                y,
+                     GeglRandom         *rand,
+                     guint32            *random)
+{
+  guint ch;
+
+  for (ch = 0; ch < 4; ch++)
+    gegl_random_int_span (rand, gi->roi->x, gi->roi->y + y, 0, ch, 0,
+                          gi->roi->width, random + ch * gi->roi->width);
+}
+
 static void
 process_row_random (GeglBufferIterator *gi,
                     guint               channel_mask [4],
                     guint               channel_bits [4],
                     gint                y,
-                    GeglRandom         *rand)
+                    GeglRandom         *rand,
+                    guint32            *random)
 {
   guint16 *data_in  = (guint16*) gi->data [0];
   guint16 *data_out = (guint16*) gi->data [1];
   guint x;
+
+  random_row_channels (gi, y, rand, random);
+
   for (x = 0; x < gi->roi->width; x++)
     {
       guint pixel = 4 * (gi->roi->width * y + x);
@@ -303,8 +325,7 @@ process_row_random (GeglBufferIterator *gi,
           gdouble value;
           gdouble value_clamped;
           gdouble quantized;
-          gint    r = REDUCE_16B (gegl_random_int (rand, gi->roi->x + x,
-                                                   gi->roi->y + y, 0, ch));
+          gint    r = REDUCE_16B (random [ch * gi->roi->width + x]);
 
           value         = data_in [pixel + ch] + (r / (1 << channel_bits [ch]));
           value_clamped = CLAMP (value, 0.0, 65535.0);
@@ -322,11 +343,15 @@ process_row_resilient (GeglBufferIterator *gi,
                        guint               channel_mask [4],
                        guint               channel_bits [4],
                        gint                y,
-                       GeglRandom         *rand)
+                       GeglRandom         *rand,
+                       guint32            *random)
 {
   guint16 *data_in  = (guint16*) gi->data [0];
   guint16 *data_out = (guint16*) gi->data [1];
   guint    x;
+
+  random_row_channels (gi, y, rand, random);
+
   for (x = 0; x < gi->roi->width; x++)
     {
       guint pixel = 4 * (gi->roi->width * y + x);
@@ -336,8 +361,7 @@ process_row_resilient (GeglBufferIterator *gi,
           gdouble value;
           gdouble value_clamped;
           gdouble quantized;
-          gint    r = REDUCE_16B (gegl_random_int (rand, gi->roi->x + x,
-                                                   gi->roi->y + y, 0, ch));
+          gint    r = REDUCE_16B (random [ch * gi->roi->width + x]);
           value         = data_in [pixel + ch];
           value         = value + ((65535.0 / (8 * value + 48 * 65535)) + 1.2) *
                                   (r / (1 << channel_bits [ch]));
@@ -383,9 +407,12 @@ process_standard (GeglBuffer          *input,
 {
   GeglBufferIterator *gi;
   guint               channel_mask [4];
+  guint32            *random;
 
   generate_channel_masks (channel_bits, channel_mask);
 
+  random = g_new (guint32, 4 * result->width);
+
   gi = gegl_buffer_iterator_new (input, result, 0, babl_format ("R'G'B'A u16"),
                                  GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
 
@@ -403,13 +430,14 @@ process_standard (GeglBuffer          *input,
               process_row_no_dither (gi, channel_mask, channel_bits, y);
               break;
             case GEGL_DITHER_RANDOM:
-              process_row_random (gi, channel_mask, channel_bits, y, rand);
+              process_row_random (gi, channel_mask, channel_bits, y, rand, random);
               break;
             case GEGL_DITHER_RESILIENT:
-              process_row_resilient (gi, channel_mask, channel_bits, y, rand);
+              process_row_resilient (gi, channel_mask, channel_bits, y, rand, random);
               break;
             case GEGL_DITHER_RANDOM_COVARIANT:
-              process_row_random_covariant (gi, channel_mask, channel_bits, y, rand);
+              process_row_random_covariant (gi, channel_mask, channel_bits, y, rand,
+                                            random);
               break;
             case GEGL_DITHER_BAYER:
               process_row_bayer (gi, channel_mask, channel_bits, y);
@@ -422,6 +450,8 @@ process_standard (GeglBuffer          *input,
             }
         }
     }
+
+  g_free (random);
 }
 
 static GeglRectangle
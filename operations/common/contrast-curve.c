@@ -38,8 +38,10 @@ property_curve (curve, _("Curve"), NULL)
 
 static void prepare (GeglOperation *operation)
 {
-  const Babl *format = babl_format ("YA float");
+  const Babl *format;
 
+  format = gegl_operation_point_filter_select_format (operation,
+                                                      babl_format ("YA float"));
   gegl_operation_set_format (operation, "input", format);
   gegl_operation_set_format (operation, "output", format);
 }
@@ -247,6 +249,7 @@ gegl_op_class_init (GeglOpClass *klass)
   point_filter_class = GEGL_OPERATION_POINT_FILTER_CLASS (klass);
 
   point_filter_class->process = process;
+  point_filter_class->per_channel = TRUE;
   point_filter_class->cl_process = cl_process;
   operation_class->prepare = prepare;
   operation_class->opencl_support = TRUE;
@@ -49,8 +49,12 @@ property_double (gamma, _("Gamma correction"), 1.0)
 static void
 prepare (GeglOperation *operation)
 {
-  gegl_operation_set_format (operation, "input", babl_format ("RGBA float"));
-  gegl_operation_set_format (operation, "output", babl_format ("RGBA float"));
+  const Babl *format;
+
+  format = gegl_operation_point_filter_select_format (operation,
+                                                      babl_format ("RGBA float"));
+  gegl_operation_set_format (operation, "input", format);
+  gegl_operation_set_format (operation, "output", format);
 }
 
 /* GeglOperationPointFilter gives us a linear buffer to operate on
@@ -179,6 +183,7 @@ gegl_op_class_init (GeglOpClass *klass)
   operation_class->prepare        = prepare;
 
   point_filter_class->process    = process;
+  point_filter_class->per_channel = TRUE;
   point_filter_class->cl_process = cl_process;
 
   gegl_operation_class_set_keys (operation_class,
@@ -34,8 +34,12 @@
 static void
 prepare (GeglOperation *operation)
 {
-  gegl_operation_set_format (operation, "input", babl_format ("R'G'B'A float"));
-  gegl_operation_set_format (operation, "output", babl_format ("R'G'B'A float"));
+  const Babl *format;
+
+  format = gegl_operation_point_filter_select_format (operation,
+                                                      babl_format ("R'G'B'A float"));
+  gegl_operation_set_format (operation, "input", format);
+  gegl_operation_set_format (operation, "output", format);
 }
 
 static gboolean
@@ -62,6 +66,54 @@ process (GeglOperation       *op,
   return TRUE;
 }
 
+static gboolean
+process_u8 (GeglOperation       *op,
+            void                *in_buf,
+            void                *out_buf,
+            glong                samples,
+            const GeglRectangle *roi,
+            gint                 level)
+{
+  guint8 *in  = in_buf;
+  guint8 *out = out_buf;
+
+  while (samples--)
+    {
+      out[0] = 255 - in[0];
+      out[1] = 255 - in[1];
+      out[2] = 255 - in[2];
+      out[3] = in[3];
+
+      in += 4;
+      out+= 4;
+    }
+  return TRUE;
+}
+
+static gboolean
+process_u16 (GeglOperation       *op,
+             void                *in_buf,
+             void                *out_buf,
+             glong                samples,
+             const GeglRectangle *roi,
+             gint                 level)
+{
+  guint16 *in  = in_buf;
+  guint16 *out = out_buf;
+
+  while (samples--)
+    {
+      out[0] = 65535 - in[0];
+      out[1] = 65535 - in[1];
+      out[2] = 65535 - in[2];
+      out[3] = in[3];
+
+      in += 4;
+      out+= 4;
+    }
+  return TRUE;
+}
+
 static void
 gegl_op_class_init (GeglOpClass *klass)
 {
@@ -73,6 +125,10 @@ gegl_op_class_init (GeglOpClass *klass)
 
   operation_class->prepare     = prepare;
   point_filter_class->process  = process;
+  gegl_operation_point_filter_class_add_format (point_filter_class,
+                                                "R'G'B'A u8", process_u8);
+  gegl_operation_point_filter_class_add_format (point_filter_class,
+                                                "R'G'B'A u16", process_u16);
 
   gegl_operation_class_set_keys (operation_class,
     "name"       , "gegl:invert-gamma",
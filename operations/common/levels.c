@@ -166,6 +166,15 @@ error:
 }
 
 
+static gboolean
+is_identity (GeglOperation *operation)
+{
+  GeglProperties *o = GEGL_PROPERTIES (operation);
+
+  return o->in_low  == o->out_low &&
+         o->in_high == o->out_high &&
+         o->in_low  != o->in_high;
+}
 
 static void
 gegl_op_class_init (GeglOpClass *klass)
@@ -193,8 +202,11 @@ gegl_op_class_init (GeglOpClass *klass)
   point_filter_class = GEGL_OPERATION_POINT_FILTER_CLASS (klass);
 
   point_filter_class->process = process;
+  point_filter_class->per_channel = TRUE;
   point_filter_class->cl_process = cl_process;
 
+  operation_class->is_identity = is_identity;
+
   operation_class->opencl_support = TRUE;
 
   gegl_operation_class_set_keys (operation_class,
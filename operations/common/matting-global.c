@@ -26,12 +26,20 @@ property_int (iterations, _("Iterations"), 10)
     value_range (1, 10000)
     ui_range (1, 200)
 
+property_int (levels, _("Levels"), 0)
+    description (_("Number of coarser levels to search first, to initialize "
+                   "the search of the finer levels"))
+    value_range (0, 8)
+
+property_seed (seed, _("Random seed"), rand)
+
 #else
 
 #define GEGL_OP_COMPOSER
 #define GEGL_OP_C_SOURCE matting-global.c
 
 #include "gegl-op.h"
+#include "gegl-config.h"
 #include "gegl-debug.h"
 
 #define max(a,b) \
@@ -171,23 +179,51 @@ static inline float get_cost (ColorSample foreground, ColorSample background, Co
   return cost;
 }
 
-static inline void do_propagate(GArray *foreground_samples, GArray *background_samples, gfloat *input, BufferRecord *buffer, guchar *trimap, int x, int y, int w, int h) {
+/* The state of the search shared by the threads. Only the pixels on a
+ * grid of step pixels are searched, step being larger than one for the
+ * coarser levels.
+ */
+typedef struct {
+  GArray           *foreground_samples;
+  GArray           *background_samples;
+  gfloat           *input;
+  guchar           *trimap;
+  BufferRecord     *buffer;
+  const GeglRandom *rand;
+  int               w;
+  int               h;
+  int               step;
+  int               level;
+  int               iteration;
+  int               phase;
+} SearchContext;
+
+#define IS_UNKNOWN(trimap, index) (!((trimap)[index] == 0 || (trimap)[index] == 255))
+
+static inline void do_propagate(SearchContext *ctx, int x, int y) {
+  GArray *foreground_samples = ctx->foreground_samples;
+  GArray *background_samples = ctx->background_samples;
+  BufferRecord *buffer = ctx->buffer;
+  guchar *trimap = ctx->trimap;
+  int w = ctx->w;
+  int h = ctx->h;
+  int step = ctx->step;
   int index_orig = y * w + x;
   int index_new;
 
-  if (!(trimap[index_orig] == 0 || trimap[index_orig] == 255))
+  if (IS_UNKNOWN(trimap, index_orig))
     {
       int xdiff, ydiff;
       float best_cost = FLT_MAX;
       float *best_fg_distance = &buffer[index_orig].fg_distance;
       float *best_bg_distance = &buffer[index_orig].bg_distance;
 
-      for (ydiff = -1; ydiff <= 1; ydiff++)
+      for (ydiff = -step; ydiff <= step; ydiff += step)
         {
           // Borders
           if (y+ydiff < 0 || y+ydiff >= h)
             continue;
-          for (xdiff = -1; xdiff <= 1; xdiff++)
+          for (xdiff = -step; xdiff <= step; xdiff += step)
             {
               // Borders
               if (x+xdiff < 0 || x+xdiff >= w)
@@ -195,7 +231,7 @@ static inline void do_propagate(GArray *foreground_samples, GArray *background_s
 
               index_new = (y + ydiff) * w + (x + xdiff);
 
-              if (!(trimap[index_new] == 0 || trimap[index_new] == 255))
+              if (IS_UNKNOWN(trimap, index_new))
                 {
                   int fi = buffer[index_new].fg_index;
                   int bi = buffer[index_new].bg_index;
@@ -203,7 +239,7 @@ static inline void do_propagate(GArray *foreground_samples, GArray *background_s
                   ColorSample foreground = g_array_index(foreground_samples, ColorSample, fi);
                   ColorSample background = g_array_index(background_samples, ColorSample, bi);
 
-                  float cost = get_cost(foreground, background, &input[index_orig * 3], x, y, best_fg_distance, best_bg_distance);
+                  float cost = get_cost(foreground, background, &ctx->input[index_orig * 3], x, y, best_fg_distance, best_bg_distance);
                   if (cost < best_cost)
                     {
                       buffer[index_orig].fg_index = fi;
@@ -216,10 +252,14 @@ static inline void do_propagate(GArray *foreground_samples, GArray *background_s
     }
 }
 
-static inline void do_random_search(GArray *foreground_samples, GArray *background_samples, gfloat *input, BufferRecord *buffer, int x, int y, int w) {
+static inline void do_random_search(SearchContext *ctx, int x, int y) {
+  GArray *foreground_samples = ctx->foreground_samples;
+  GArray *background_samples = ctx->background_samples;
+  BufferRecord *buffer = ctx->buffer;
   int dist_f = foreground_samples->len;
   int dist_b = background_samples->len;
-  int index = y * w + x;
+  int index = y * ctx->w + x;
+  int n = ctx->iteration * 64 + 2;
 
   int best_fi = buffer[index].fg_index;
   int best_bi = buffer[index].bg_index;
@@ -235,20 +275,21 @@ static inline void do_random_search(GArray *foreground_samples, GArray *backgrou
   ColorSample background = g_array_index(background_samples, ColorSample, best_bi);
 
   // Get cost
-  float best_cost = get_cost(foreground, background, &input[index * 3], x, y, best_fg_distance, best_bg_distance);
+  float best_cost = get_cost(foreground, background, &ctx->input[index * 3], x, y, best_fg_distance, best_bg_distance);
 
   while (dist_f > 0 || dist_b > 0)
     {
-      // Get new indices to check
+      // Get new indices to check, the random numbers only depend on the
+      // pixel and the iteration, not on the thread or the order
       int fl = foreground_samples->len;
       int bl = background_samples->len;
-      int fi = (start_fi + (rand () % (dist_f * 2 + 1)) + fl - dist_f) % fl;
-      int bi = (start_bi + (rand () % (dist_b * 2 + 1)) + bl - dist_b) % bl;
+      int fi = (start_fi + (gegl_random_int (ctx->rand, x, y, ctx->level, n++) % (dist_f * 2 + 1)) + fl - dist_f) % fl;
+      int bi = (start_bi + (gegl_random_int (ctx->rand, x, y, ctx->level, n++) % (dist_b * 2 + 1)) + bl - dist_b) % bl;
 
       ColorSample foreground = g_array_index(foreground_samples, ColorSample, fi);
       ColorSample background = g_array_index(background_samples, ColorSample, bi);
 
-      float cost = get_cost(foreground, background, &input[index * 3], x, y, best_fg_distance, best_bg_distance);
+      float cost = get_cost(foreground, background, &ctx->input[index * 3], x, y, best_fg_distance, best_bg_distance);
 
       if (cost < best_cost)
         {
@@ -264,6 +305,109 @@ static inline void do_random_search(GArray *foreground_samples, GArray *backgrou
   buffer[index].bg_index = best_bi;
 }
 
+static void search_rows(SearchContext *ctx, int y0, int y1) {
+  int x, y;
+
+  for (y = y0; y < y1; y++)
+    {
+      if (y % ctx->step)
+        continue;
+      for (x = 0; x < ctx->w; x += ctx->step)
+        if (IS_UNKNOWN(ctx->trimap, y * ctx->w + x))
+          do_random_search(ctx, x, y);
+    }
+}
+
+/* Propagation reads the neighbours of a pixel, so it is done in four
+ * phases, one for each parity of the grid coordinates. No two neighbours
+ * are in the same phase, which keeps the result independent of the
+ * threads.
+ */
+static void propagate_rows(SearchContext *ctx, int y0, int y1) {
+  int x, y;
+
+  for (y = y0; y < y1; y++)
+    {
+      if (y % ctx->step || (y / ctx->step) % 2 != ctx->phase / 2)
+        continue;
+      for (x = (ctx->phase % 2) * ctx->step; x < ctx->w; x += 2 * ctx->step)
+        do_propagate(ctx, x, y);
+    }
+}
+
+typedef void (*SearchFunc) (SearchContext *ctx, int y0, int y1);
+
+typedef struct {
+  SearchFunc     func;
+  SearchContext *ctx;
+  int            y0;
+  int            y1;
+  gint          *pending;
+} ThreadData;
+
+static void thread_process (gpointer thread_data, gpointer unused)
+{
+  ThreadData *data = thread_data;
+  data->func (data->ctx, data->y0, data->y1);
+  g_atomic_int_add (data->pending, -1);
+}
+
+static GThreadPool *thread_pool (void)
+{
+  static GThreadPool *pool = NULL;
+  if (!pool)
+    {
+      pool =  g_thread_pool_new (thread_process, NULL, gegl_config_threads (),
+                                 FALSE, NULL);
+    }
+  return pool;
+}
+
+/* Run func over all the rows, in bands spread over the GEGL threads */
+static void search_parallel(SearchContext *ctx, SearchFunc func) {
+  ThreadData thread_data[GEGL_MAX_THREADS];
+  gint threads = CLAMP (ctx->h / 32, 1, gegl_config_threads ());
+  gint pending = threads;
+  gint i;
+
+  for (i = 0; i < threads; i++)
+    {
+      thread_data[i].func = func;
+      thread_data[i].ctx = ctx;
+      thread_data[i].y0 = ctx->h * i / threads;
+      thread_data[i].y1 = ctx->h * (i + 1) / threads;
+      thread_data[i].pending = &pending;
+    }
+
+  for (i = 1; i < threads; i++)
+    g_thread_pool_push (thread_pool (), &thread_data[i], NULL);
+  thread_process (&thread_data[0], NULL);
+
+  while (g_atomic_int_get (&pending)) {};
+}
+
+// Start the pixels of the finer grid from the result of their coarse
+// grid pixel
+static void refine_level(SearchContext *ctx, int coarse) {
+  int x, y;
+  int fine = coarse / 2;
+
+  for (y = 0; y < ctx->h; y += fine)
+    for (x = 0; x < ctx->w; x += fine)
+      {
+        int index = y * ctx->w + x;
+        int parent = (y - y % coarse) * ctx->w + (x - x % coarse);
+
+        if (index != parent &&
+            IS_UNKNOWN(ctx->trimap, index) &&
+            IS_UNKNOWN(ctx->trimap, parent))
+          {
+            ctx->buffer[index].fg_index = ctx->buffer[parent].fg_index;
+            ctx->buffer[index].bg_index = ctx->buffer[parent].bg_index;
+          }
+      }
+}
+
 // Compare color intensities
 static gint color_compare(gconstpointer p1, gconstpointer p2)
 {
@@ -295,7 +439,7 @@ matting_process (GeglOperation       *operation,
   int               w, h, i, x, y, xdiff, ydiff, neighbour_mask;
 
   GArray           *foreground_samples, *background_samples;
-  GArray           *unknown_positions;
+  SearchContext     ctx;
 
   g_return_val_if_fail (babl_format_get_n_components (babl_format (FORMAT_INPUT )) == COMPONENTS_INPUT,  FALSE);
   g_return_val_if_fail (babl_format_get_n_components (babl_format (FORMAT_AUX   )) == COMPONENTS_AUX,    FALSE);
@@ -320,7 +464,6 @@ matting_process (GeglOperation       *operation,
 
   foreground_samples = g_array_new(FALSE, FALSE, sizeof(ColorSample));
   background_samples = g_array_new(FALSE, FALSE, sizeof(ColorSample));
-  unknown_positions = g_array_new(FALSE, FALSE, sizeof(Position));
 
   // Get mask
   for (y = 0; y < h; y++)
@@ -388,14 +531,10 @@ matting_process (GeglOperation       *operation,
 
           if (trimap[index] != 0 && trimap[index] != 255)
             {
-              Position p;
-              p.x = x;
-              p.y = y;
-              g_array_append_val(unknown_positions, p);
               buffer[index].fg_distance = FLT_MAX;
               buffer[index].bg_distance = FLT_MAX;
-              buffer[index].fg_index = rand() % foreground_samples->len;
-              buffer[index].bg_index = rand() % background_samples->len;
+              buffer[index].fg_index = gegl_random_int_range (o->rand, x, y, 0, 0, 0, foreground_samples->len);
+              buffer[index].bg_index = gegl_random_int_range (o->rand, x, y, 0, 1, 0, background_samples->len);
             }
         }
     }
@@ -403,23 +542,32 @@ matting_process (GeglOperation       *operation,
   g_array_sort(foreground_samples, color_compare);
   g_array_sort(background_samples, color_compare);
 
-  // Do real iterations
-  for (i = 0; i < o->iterations; i++)
+  ctx.foreground_samples = foreground_samples;
+  ctx.background_samples = background_samples;
+  ctx.input = input;
+  ctx.trimap = trimap;
+  ctx.buffer = buffer;
+  ctx.rand = o->rand;
+  ctx.w = w;
+  ctx.h = h;
+
+  // Do real iterations, from the coarsest level to the full resolution
+  for (ctx.level = o->levels; ctx.level >= 0; ctx.level--)
     {
-      unsigned j;
+      ctx.step = 1 << ctx.level;
 
-      GEGL_NOTE (GEGL_DEBUG_PROCESS, "Iteration %i", i);
+      if (ctx.level < o->levels)
+        refine_level (&ctx, ctx.step * 2);
 
-      for (j=0; j<unknown_positions->len; j++)
+      for (i = 0; i < o->iterations; i++)
         {
-          Position p = g_array_index(unknown_positions, Position, j);
-          do_random_search(foreground_samples, background_samples, input, buffer, p.x, p.y, w);
-        }
+          GEGL_NOTE (GEGL_DEBUG_PROCESS, "Level %i iteration %i", ctx.level, i);
 
-      for (j=0; j<unknown_positions->len; j++)
-        {
-          Position p = g_array_index(unknown_positions, Position, j);
-          do_propagate(foreground_samples, background_samples, input, buffer, trimap, p.x, p.y, w, h);
+          ctx.iteration = i;
+          search_parallel (&ctx, search_rows);
+
+          for (ctx.phase = 0; ctx.phase < 4; ctx.phase++)
+            search_parallel (&ctx, propagate_rows);
         }
     }
 
@@ -465,7 +613,6 @@ cleanup:
   g_free (buffer);
   g_array_free (foreground_samples, TRUE);
   g_array_free (background_samples, TRUE);
-  g_array_free (unknown_positions, TRUE);
 
   return success;
 }
@@ -482,6 +629,8 @@ static void gegl_op_class_init (GeglOpClass *klass)
   operation_class->prepare                 = matting_prepare;
   operation_class->get_required_for_output = matting_get_required_for_output;
   operation_class->get_cached_region       = matting_get_cached_region;
+  /* the search is global to the image, it threads by itself */
+  operation_class->threaded                = FALSE;
 
   gegl_operation_class_set_keys (operation_class,
     "name"       , "gegl:matting-global",
@@ -48,32 +48,33 @@ property_seed   (seed, _("Random seed"), rand)
 #include <math.h>
 #include <stdlib.h>
 
+/* @random holds the random numbers n, n+1, ... of the pixel, @stride
+ * apart
+ */
 static gfloat
-randomize_value (gfloat      now,
-                 gfloat      min,
-                 gfloat      max,
-                 gboolean    wraps_around,
-                 gfloat      rand_max,
-                 gint        holdness,
-                 gint        x,
-                 gint        y,
-                 gint        n,
-                 GeglRandom *rand)
+randomize_value (gfloat        now,
+                 gfloat        min,
+                 gfloat        max,
+                 gboolean      wraps_around,
+                 gfloat        rand_max,
+                 gint          holdness,
+                 const gfloat *random,
+                 gint          stride)
 {
   gint    flag, i;
   gfloat rand_val, new_val, steps;
 
   steps = max - min;
-  rand_val = gegl_random_float (rand, x, y, 0, n++);
+  rand_val = random[0];
 
   for (i = 1; i < holdness; i++)
   {
-    gfloat tmp = gegl_random_float (rand, x, y, 0, n++);
+    gfloat tmp = random[i * stride];
     if (tmp < rand_val)
       rand_val = tmp;
   }
 
-  flag = (gegl_random_float (rand, x, y, 0, n) < 0.5) ? -1 : 1;
+  flag = (random[holdness * stride] < 0.5) ? -1 : 1;
   new_val = now + flag * fmod (rand_max * rand_val, steps);
 
   if (new_val < min)
@@ -112,7 +113,7 @@ process (GeglOperation       *operation,
 {
   GeglProperties *o  = GEGL_PROPERTIES (operation);
   GeglRectangle whole_region;
-  gint i;
+  gint i, k;
   gint x, y;
 
   gfloat   * GEGL_ALIGNED in_pixel;
@@ -120,60 +121,67 @@ process (GeglOperation       *operation,
 
   gfloat    hue, saturation, value, alpha;
 
+  /* the random numbers of a pixel, for a row of pixels */
+  const gint n_random = 3 * o->holdness + 4;
+  gfloat    *random;
+
   in_pixel      = in_buf;
   out_pixel     = out_buf;
 
-  x = roi->x;
-  y = roi->y;
-
   whole_region = *(gegl_operation_source_get_bounding_box (operation, "input"));
 
-  for (i = 0; i < n_pixels; i++)
+  random = g_new (gfloat, n_random * roi->width);
+
+  for (y = roi->y; y < roi->y + roi->height; y++)
   {
     /* n is independent from the roi, but from the whole image */
-    gint n = (3 * o->holdness + 4) * (x + whole_region.width * y);
-
-    hue        = in_pixel[0];
-    saturation = in_pixel[1];
-    value      = in_pixel[2];
-    alpha      = in_pixel[3];
-
-    /* there is no need for scattering hue of desaturated pixels here */
-    if ((o->hue_distance > 0) && (saturation > 0))
-      hue = randomize_value (hue, 0.0, 1.0, TRUE, o->hue_distance / 360.0,
-                             o->holdness, x, y, n, o->rand);
-
-    n += o->holdness + 1;
-    /* desaturated pixels get random hue before increasing saturation */
-    if (o->saturation_distance > 0) {
-      if (saturation == 0)
-        hue = gegl_random_float_range (o->rand, x, y, 0, n, 0.0, 1.0);
-      saturation = randomize_value (saturation, 0.0, 1.0, FALSE,
-                                    o->saturation_distance, o->holdness,
-                                    x, y, n+1, o->rand);
-    }
-
-    n += o->holdness + 2;
-    if (o->value_distance > 0)
-      value = randomize_value (value, 0.0, 1.0, FALSE, o->value_distance,
-                               o->holdness, x, y, n, o->rand);
+    gint n = n_random * (roi->x + whole_region.width * y);
+
+    for (k = 0; k < n_random; k++)
+      gegl_random_float_span (o->rand, roi->x, y, 0, n + k, n_random,
+                              roi->width, random + k * roi->width);
+
+    for (i = 0; i < roi->width; i++)
+    {
+      const gfloat *pixel_random = random + i;
+
+      hue        = in_pixel[0];
+      saturation = in_pixel[1];
+      value      = in_pixel[2];
+      alpha      = in_pixel[3];
+
+      /* there is no need for scattering hue of desaturated pixels here */
+      if ((o->hue_distance > 0) && (saturation > 0))
+        hue = randomize_value (hue, 0.0, 1.0, TRUE, o->hue_distance / 360.0,
+                               o->holdness, pixel_random, roi->width);
+
+      pixel_random += (o->holdness + 1) * roi->width;
+      /* desaturated pixels get random hue before increasing saturation */
+      if (o->saturation_distance > 0) {
+        if (saturation == 0)
+          hue = pixel_random[0];
+        saturation = randomize_value (saturation, 0.0, 1.0, FALSE,
+                                      o->saturation_distance, o->holdness,
+                                      pixel_random + roi->width, roi->width);
+      }
 
-    out_pixel[0] = hue;
-    out_pixel[1] = saturation;
-    out_pixel[2] = value;
-    out_pixel[3] = alpha;
+      pixel_random += (o->holdness + 2) * roi->width;
+      if (o->value_distance > 0)
+        value = randomize_value (value, 0.0, 1.0, FALSE, o->value_distance,
+                                 o->holdness, pixel_random, roi->width);
 
-    in_pixel  += 4;
-    out_pixel += 4;
+      out_pixel[0] = hue;
+      out_pixel[1] = saturation;
+      out_pixel[2] = value;
+      out_pixel[3] = alpha;
 
-    x++;
-    if (x >= roi->x + roi->width)
-      {
-        x = roi->x;
-        y++;
-      }
+      in_pixel  += 4;
+      out_pixel += 4;
+    }
   }
 
+  g_free (random);
+
   return TRUE;
 }
 
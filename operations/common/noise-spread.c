@@ -47,28 +47,34 @@ property_seed (seed, _("Random seed"), rand)
 
 #include "gegl-op.h"
 #include <math.h>
+#include <string.h>
 
+/* Random angles, x distances and y distances for a row of pixels */
 static inline void
-calc_sample_coords (gint        src_x,
-                    gint        src_y,
-                    gint        amount_x,
-                    gint        amount_y,
-                    GeglRandom *rand,
-                    gint       *x,
-                    gint       *y)
+calc_sample_offsets (gint        src_x,
+                     gint        src_y,
+                     gint        width,
+                     gint        amount_x,
+                     gint        amount_y,
+                     GeglRandom *rand,
+                     gint       *xdist,
+                     gint       *ydist,
+                     gfloat     *angle)
 {
-  gdouble angle;
-  gint    xdist, ydist;
-
-  /* get random angle, x distance, and y distance */
-  xdist = amount_x > 0 ? gegl_random_int_range (rand, src_x, src_y, 0, 0,
-                                                -amount_x, amount_x + 1) : 0;
-  ydist = amount_y > 0 ? gegl_random_int_range (rand, src_x, src_y, 0, 1,
-                                                -amount_y, amount_y + 1) : 0;
-  angle = gegl_random_float_range (rand, src_x, src_y, 0, 2, -G_PI, G_PI);
-
-  *x = src_x + floor (sin (angle) * xdist);
-  *y = src_y + floor (cos (angle) * ydist);
+  if (amount_x > 0)
+    gegl_random_int_range_span (rand, src_x, src_y, 0, 0, 0,
+                                -amount_x, amount_x + 1, width, xdist);
+  else
+    memset (xdist, 0, width * sizeof (gint));
+
+  if (amount_y > 0)
+    gegl_random_int_range_span (rand, src_x, src_y, 0, 1, 0,
+                                -amount_y, amount_y + 1, width, ydist);
+  else
+    memset (ydist, 0, width * sizeof (gint));
+
+  gegl_random_float_range_span (rand, src_x, src_y, 0, 2, 0, -G_PI, G_PI,
+                                width, angle);
 }
 
 
@@ -103,6 +109,9 @@ process (GeglOperation       *operation,
   GeglBufferIterator *gi;
   gint                amount_x;
   gint                amount_y;
+  gint               *xdist;
+  gint               *ydist;
+  gfloat             *angle;
 
   o = GEGL_PROPERTIES (operation);
 
@@ -112,6 +121,10 @@ process (GeglOperation       *operation,
   format = gegl_operation_get_source_format (operation, "input");
   bpp = babl_format_get_bytes_per_pixel (format);
 
+  xdist = g_new (gint, result->width);
+  ydist = g_new (gint, result->width);
+  angle = g_new (gfloat, result->width);
+
   gi = gegl_buffer_iterator_new (output, result, 0, format,
                                  GEGL_ACCESS_WRITE, GEGL_ABYSS_CLAMP);
 
@@ -122,18 +135,26 @@ process (GeglOperation       *operation,
       gint          i, j;
 
       for (j = roi.y; j < roi.y + roi.height ; j++)
-        for (i = roi.x; i < roi.x + roi.width ; i++)
-          {
-            gint x, y;
-
-            calc_sample_coords (i, j, amount_x, amount_y, o->rand, &x, &y);
-
-            gegl_buffer_sample_at_level (input, x, y, NULL, data, format, level,
-                                GEGL_SAMPLER_NEAREST, GEGL_ABYSS_CLAMP);
-            data += bpp;
-          }
+        {
+          calc_sample_offsets (roi.x, j, roi.width, amount_x, amount_y,
+                               o->rand, xdist, ydist, angle);
+
+          for (i = 0; i < roi.width ; i++)
+            {
+              gint x = roi.x + i + floor (sin (angle[i]) * xdist[i]);
+              gint y = j + floor (cos (angle[i]) * ydist[i]);
+
+              gegl_buffer_sample_at_level (input, x, y, NULL, data, format, level,
+                                  GEGL_SAMPLER_NEAREST, GEGL_ABYSS_CLAMP);
+              data += bpp;
+            }
+        }
     }
 
+  g_free (xdist);
+  g_free (ydist);
+  g_free (angle);
+
   return TRUE;
 }
 
@@ -40,6 +40,7 @@ static void
 prepare (GeglOperation *self)
 {
   const Babl *fmt = gegl_operation_get_source_format (self, "input");
+  const Babl *aux_fmt = babl_format ("Y float");
   GeglProperties *o = GEGL_PROPERTIES (self);
 
   if (fmt)
@@ -78,9 +79,11 @@ prepare (GeglOperation *self)
       fmt = babl_format ("RGBA float");
     }
 
+  fmt = gegl_operation_point_composer_select_format (self, fmt, &aux_fmt);
+
   gegl_operation_set_format (self, "input", fmt);
   gegl_operation_set_format (self, "output", fmt);
-  gegl_operation_set_format (self, "aux", babl_format ("Y float"));
+  gegl_operation_set_format (self, "aux", aux_fmt);
 
   return;
 }
@@ -203,6 +206,103 @@ process (GeglOperation       *op,
   return TRUE;
 }
 
+/* Integer variants, the components before first are copied, the rest
+ * are scaled by the opacity.
+ */
+static inline void
+process_u8 (guint8 *in,
+            gfloat *aux,
+            guint8 *out,
+            glong   samples,
+            gfloat  value,
+            gint    first)
+{
+  while (samples--)
+    {
+      gfloat v = aux ? (*aux++) * value : value;
+      gint j;
+      for (j=0; j<first; j++)
+        out[j] = in[j];
+      for (j=first; j<4; j++)
+        out[j] = CLAMP (in[j] * v + 0.5f, 0.0f, 255.0f);
+      in  += 4;
+      out += 4;
+    }
+}
+
+static inline void
+process_u16 (guint16 *in,
+             gfloat  *aux,
+             guint16 *out,
+             glong    samples,
+             gfloat   value,
+             gint     first)
+{
+  while (samples--)
+    {
+      gfloat v = aux ? (*aux++) * value : value;
+      gint j;
+      for (j=0; j<first; j++)
+        out[j] = in[j];
+      for (j=first; j<4; j++)
+        out[j] = CLAMP (in[j] * v + 0.5f, 0.0f, 65535.0f);
+      in  += 4;
+      out += 4;
+    }
+}
+
+static gboolean
+process_RGBAu8 (GeglOperation       *op,
+                void                *in_buf,
+                void                *aux_buf,
+                void                *out_buf,
+                glong                samples,
+                const GeglRectangle *roi,
+                gint                 level)
+{
+  process_u8 (in_buf, aux_buf, out_buf, samples, GEGL_PROPERTIES (op)->value, 3);
+  return TRUE;
+}
+
+static gboolean
+process_RaGaBaAu8 (GeglOperation       *op,
+                   void                *in_buf,
+                   void                *aux_buf,
+                   void                *out_buf,
+                   glong                samples,
+                   const GeglRectangle *roi,
+                   gint                 level)
+{
+  process_u8 (in_buf, aux_buf, out_buf, samples, GEGL_PROPERTIES (op)->value, 0);
+  return TRUE;
+}
+
+static gboolean
+process_RGBAu16 (GeglOperation       *op,
+                 void                *in_buf,
+                 void                *aux_buf,
+                 void                *out_buf,
+                 glong                samples,
+                 const GeglRectangle *roi,
+                 gint                 level)
+{
+  process_u16 (in_buf, aux_buf, out_buf, samples, GEGL_PROPERTIES (op)->value, 3);
+  return TRUE;
+}
+
+static gboolean
+process_RaGaBaAu16 (GeglOperation       *op,
+                    void                *in_buf,
+                    void                *aux_buf,
+                    void                *out_buf,
+                    glong                samples,
+                    const GeglRectangle *roi,
+                    gint                 level)
+{
+  process_u16 (in_buf, aux_buf, out_buf, samples, GEGL_PROPERTIES (op)->value, 0);
+  return TRUE;
+}
+
 #include "opencl/gegl-cl.h"
 
 #include "opencl/opacity.cl.h"
@@ -283,6 +383,13 @@ static gboolean operation_process (GeglOperation        *operation,
                                   gegl_operation_context_get_level (context));
 }
 
+static gboolean
+is_identity (GeglOperation *operation)
+{
+  return GEGL_PROPERTIES (operation)->value == 1.0 &&
+         !gegl_operation_get_source_node (operation, "aux");
+}
+
 
 static void
 gegl_op_class_init (GeglOpClass *klass)
@@ -295,9 +402,35 @@ gegl_op_class_init (GeglOpClass *klass)
 
   operation_class->prepare = prepare;
   operation_class->process = operation_process;
+  operation_class->is_identity = is_identity;
   point_composer_class->process = process;
   point_composer_class->cl_process = cl_process;
 
+  gegl_operation_point_composer_class_add_format (point_composer_class,
+                                                  "RGBA u8", "Y float",
+                                                  process_RGBAu8);
+  gegl_operation_point_composer_class_add_format (point_composer_class,
+                                                  "R'G'B'A u8", "Y float",
+                                                  process_RGBAu8);
+  gegl_operation_point_composer_class_add_format (point_composer_class,
+                                                  "RaGaBaA u8", "Y float",
+                                                  process_RaGaBaAu8);
+  gegl_operation_point_composer_class_add_format (point_composer_class,
+                                                  "R'aG'aB'aA u8", "Y float",
+                                                  process_RaGaBaAu8);
+  gegl_operation_point_composer_class_add_format (point_composer_class,
+                                                  "RGBA u16", "Y float",
+                                                  process_RGBAu16);
+  gegl_operation_point_composer_class_add_format (point_composer_class,
+                                                  "R'G'B'A u16", "Y float",
+                                                  process_RGBAu16);
+  gegl_operation_point_composer_class_add_format (point_composer_class,
+                                                  "RaGaBaA u16", "Y float",
+                                                  process_RaGaBaAu16);
+  gegl_operation_point_composer_class_add_format (point_composer_class,
+                                                  "R'aG'aB'aA u16", "Y float",
+                                                  process_RaGaBaAu16);
+
   operation_class->opencl_support = TRUE;
 
   gegl_operation_class_set_keys (operation_class,
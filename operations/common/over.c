@@ -37,14 +37,19 @@ static void prepare (GeglOperation *operation)
   GeglProperties *o = GEGL_PROPERTIES (operation);
 
   const Babl *format;
+  const Babl *aux_format;
 
   if (o->srgb)
     format = babl_format ("R'aG'aB'aA float");
   else
     format = babl_format ("RaGaBaA float");
 
+  aux_format = format;
+  format = gegl_operation_point_composer_select_format (operation, format,
+                                                        &aux_format);
+
   gegl_operation_set_format (operation, "input", format);
-  gegl_operation_set_format (operation, "aux", format);
+  gegl_operation_set_format (operation, "aux", aux_format);
   gegl_operation_set_format (operation, "output", format);
 }
 
@@ -78,6 +83,71 @@ process (GeglOperation       *op,
   return TRUE;
 }
 
+/* Premultiplied alpha composites like the color components,
+ * d = cA + cB * (1 - aA) holds for all four of them.
+ */
+static gboolean
+process_u8 (GeglOperation       *op,
+            void                *in_buf,
+            void                *aux_buf,
+            void                *out_buf,
+            glong                n_pixels,
+            const GeglRectangle *roi,
+            gint                 level)
+{
+  guint8 *in = in_buf;
+  guint8 *aux = aux_buf;
+  guint8 *out = out_buf;
+
+  if (aux==NULL)
+    return TRUE;
+
+  while (n_pixels--)
+    {
+      gfloat rest = 1.0f - aux[3] * (1.0f / 255.0f);
+      gint   j;
+
+      for (j = 0; j < 4; j++)
+        out[j] = MIN (aux[j] + in[j] * rest + 0.5f, 255.0f);
+
+      in  += 4;
+      aux += 4;
+      out += 4;
+    }
+  return TRUE;
+}
+
+static gboolean
+process_u16 (GeglOperation       *op,
+             void                *in_buf,
+             void                *aux_buf,
+             void                *out_buf,
+             glong                n_pixels,
+             const GeglRectangle *roi,
+             gint                 level)
+{
+  guint16 *in = in_buf;
+  guint16 *aux = aux_buf;
+  guint16 *out = out_buf;
+
+  if (aux==NULL)
+    return TRUE;
+
+  while (n_pixels--)
+    {
+      gfloat rest = 1.0f - aux[3] * (1.0f / 65535.0f);
+      gint   j;
+
+      for (j = 0; j < 4; j++)
+        out[j] = MIN (aux[j] + in[j] * rest + 0.5f, 65535.0f);
+
+      in  += 4;
+      aux += 4;
+      out += 4;
+    }
+  return TRUE;
+}
+
 #include "opencl/svg-src-over.cl.h"
 
 static gboolean
@@ -176,6 +246,19 @@ gegl_op_class_init (GeglOpClass *klass)
   point_composer_class->cl_process = cl_process;
   point_composer_class->process    = process;
 
+  gegl_operation_point_composer_class_add_format (point_composer_class,
+                                                  "RaGaBaA u8", NULL,
+                                                  process_u8);
+  gegl_operation_point_composer_class_add_format (point_composer_class,
+                                                  "R'aG'aB'aA u8", NULL,
+                                                  process_u8);
+  gegl_operation_point_composer_class_add_format (point_composer_class,
+                                                  "RaGaBaA u16", NULL,
+                                                  process_u16);
+  gegl_operation_point_composer_class_add_format (point_composer_class,
+                                                  "R'aG'aB'aA u16", NULL,
+                                                  process_u16);
+
   gegl_operation_class_set_keys (operation_class,
     "name"       , "svg:src-over",
     "title",       _("Normal compositing"),
@@ -80,6 +80,7 @@ process (GeglOperation       *operation,
   GeglProperties    *o = GEGL_PROPERTIES (operation);
   gint           size, i, pos;
   GeglRectangle  dst_rect;
+  gint          *shifts;
 
 
   if (o->direction == GEGL_ORIENTATION_HORIZONTAL)
@@ -100,11 +101,14 @@ process (GeglOperation       *operation,
   dst_rect.x = result->x;
   dst_rect.y = result->y;
 
+  shifts = g_new (gint, size);
+  gegl_random_int_range_span (o->rand, pos, 0, 0, 0, 0,
+                              -o->shift, o->shift + 1, size, shifts);
+
   for (i = 0; i < size; i++)
     {
       GeglRectangle src_rect;
-      gint shift = gegl_random_int_range (o->rand, i + pos, 0, 0, 0,
-                                          -o->shift, o->shift + 1);
+      gint shift = shifts[i];
 
       if (o->direction == GEGL_ORIENTATION_HORIZONTAL)
         {
@@ -123,6 +127,8 @@ process (GeglOperation       *operation,
                         output, &dst_rect);
     }
 
+  g_free (shifts);
+
   return  TRUE;
 }
 
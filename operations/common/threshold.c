@@ -36,9 +36,16 @@ property_double (value, _("Threshold"), 0.5)
 
 static void prepare (GeglOperation *operation)
 {
-  gegl_operation_set_format (operation, "input",  babl_format ("YA float"));
-  gegl_operation_set_format (operation, "aux",    babl_format ("Y float"));
-  gegl_operation_set_format (operation, "output", babl_format ("YA float"));
+  const Babl *aux_format = babl_format ("Y float");
+  const Babl *format;
+
+  format = gegl_operation_point_composer_select_format (operation,
+                                                        babl_format ("YA float"),
+                                                        &aux_format);
+
+  gegl_operation_set_format (operation, "input",  format);
+  gegl_operation_set_format (operation, "aux",    aux_format);
+  gegl_operation_set_format (operation, "output", format);
 }
 
 static gboolean
@@ -91,6 +98,62 @@ process (GeglOperation       *op,
   return TRUE;
 }
 
+static gboolean
+process_u8 (GeglOperation       *op,
+            void                *in_buf,
+            void                *aux_buf,
+            void                *out_buf,
+            glong                n_pixels,
+            const GeglRectangle *roi,
+            gint                 level)
+{
+  guint8 *in = in_buf;
+  guint8 *out = out_buf;
+  gfloat *aux = aux_buf;
+  gfloat  value = GEGL_PROPERTIES (op)->value;
+  glong   i;
+
+  for (i=0; i<n_pixels; i++)
+    {
+      if (aux)
+        value = *aux++;
+
+      out[0] = in[0] / 255.0f >= value ? 255 : 0;
+      out[1] = in[1];
+      in  += 2;
+      out += 2;
+    }
+  return TRUE;
+}
+
+static gboolean
+process_u16 (GeglOperation       *op,
+             void                *in_buf,
+             void                *aux_buf,
+             void                *out_buf,
+             glong                n_pixels,
+             const GeglRectangle *roi,
+             gint                 level)
+{
+  guint16 *in = in_buf;
+  guint16 *out = out_buf;
+  gfloat  *aux = aux_buf;
+  gfloat   value = GEGL_PROPERTIES (op)->value;
+  glong    i;
+
+  for (i=0; i<n_pixels; i++)
+    {
+      if (aux)
+        value = *aux++;
+
+      out[0] = in[0] / 65535.0f >= value ? 65535 : 0;
+      out[1] = in[1];
+      in  += 2;
+      out += 2;
+    }
+  return TRUE;
+}
+
 #include "opencl/threshold.cl.h"
 
 static const gchar *composition =
@@ -120,6 +183,13 @@ gegl_op_class_init (GeglOpClass *klass)
   point_composer_class->process = process;
   operation_class->prepare = prepare;
 
+  gegl_operation_point_composer_class_add_format (point_composer_class,
+                                                  "YA u8", "Y float",
+                                                  process_u8);
+  gegl_operation_point_composer_class_add_format (point_composer_class,
+                                                  "YA u16", "Y float",
+                                                  process_u16);
+
   gegl_operation_class_set_keys (operation_class,
     "name" ,       "gegl:threshold",
     "title",       _("Threshold"),
@@ -133,6 +133,25 @@ gegl_crop_get_required_for_output (GeglOperation       *operation,
   return result;
 }
 
+/* A crop that does not cut anything away from its input */
+static gboolean
+gegl_crop_is_identity (GeglOperation *operation)
+{
+  GeglProperties *o       = GEGL_PROPERTIES (operation);
+  GeglRectangle  *in_rect = gegl_operation_source_get_bounding_box (operation, "input");
+  GeglRectangle   extent;
+
+  if (!in_rect)
+    return FALSE;
+
+  extent.x      = o->x;
+  extent.y      = o->y;
+  extent.width  = o->width;
+  extent.height = o->height;
+
+  return gegl_rectangle_equal (&extent, in_rect);
+}
+
 static gboolean
 gegl_crop_process (GeglOperation        *operation,
                    GeglOperationContext *context,
@@ -202,6 +221,7 @@ gegl_op_class_init (GeglOpClass *klass)
   operation_class->detect                    = gegl_crop_detect;
   operation_class->get_invalidated_by_change = gegl_crop_get_invalidated_by_change;
   operation_class->get_required_for_output   = gegl_crop_get_required_for_output;
+  operation_class->is_identity               = gegl_crop_is_identity;
 
   gegl_operation_class_set_keys (operation_class,
       "name",        "gegl:crop",
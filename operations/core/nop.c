@@ -65,6 +65,12 @@ gegl_nop_process (GeglOperation        *operation,
   return TRUE;
 }
 
+static gboolean
+gegl_nop_is_identity (GeglOperation *operation)
+{
+  return TRUE;
+}
+
 static void
 gegl_op_class_init (GeglOpClass *klass)
 {
@@ -73,6 +79,7 @@ gegl_op_class_init (GeglOpClass *klass)
   operation_class = GEGL_OPERATION_CLASS (klass);
   operation_class->process = gegl_nop_process;
   operation_class->prepare = gegl_nop_prepare;
+  operation_class->is_identity = gegl_nop_is_identity;
 
   gegl_operation_class_set_keys (operation_class,
               "name",        "gegl:nop",
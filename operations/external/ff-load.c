@@ -84,11 +84,25 @@ typedef struct
   AVCodec         *video_codec;
   AVFrame         *lavc_frame;
   AVFrame         *rgb_frame;
-  glong            prevframe;      /* previously decoded frame number */
-  gdouble          prevpts;        /* timestamp in seconds of last decoded frame */
+  struct SwsContext *img_convert_ctx;
+  gdouble          prevpts;        /* timestamp in seconds of last shown frame */
+
+  /* the decoder thread, see decoder_thread () */
+  GThread         *decoder;
+  GMutex           mutex;
+  GCond            cond;
+  GQueue           decoded_frames;
+  glong            wanted;         /* frame last asked for */
+  glong            next_frame;     /* frame the next picture decoded is for */
+  gdouble          decode_pts;     /* timestamp in seconds of last decoded picture */
+  gboolean         running;        /* decoding since a seek */
+  gboolean         eof;
+  gboolean         quit;
 
 } Priv;
 
+static void stop_decoder (Priv *p);
+
 static void
 print_error (const char *filename, int err)
 {
@@ -128,6 +142,7 @@ ff_cleanup (GeglProperties *o)
   Priv *p = (Priv*)o->user_data;
   if (p)
     {
+      stop_decoder (p);
       clear_audio_track (o);
       if (p->loadedfilename)
         g_free (p->loadedfilename);
@@ -143,11 +158,14 @@ ff_cleanup (GeglProperties *o)
         av_free (p->rgb_frame);
       if (p->lavc_frame)
         av_free (p->lavc_frame);
+      if (p->img_convert_ctx)
+        sws_freeContext (p->img_convert_ctx);
 
       p->video_fcontext = NULL;
       p->audio_fcontext = NULL;
       p->lavc_frame = NULL;
       p->rgb_frame = NULL;
+      p->img_convert_ctx = NULL;
       p->loadedfilename = NULL;
     }
 }
@@ -166,6 +184,9 @@ init (GeglProperties *o)
   if (p == NULL)
     {
       p = g_new0 (Priv, 1);
+      g_mutex_init (&p->mutex);
+      g_cond_init (&p->cond);
+      g_queue_init (&p->decoded_frames);
       o->user_data = (void*) p;
     }
 
@@ -294,101 +315,337 @@ decode_audio (GeglOperation *operation,
   return 0;
 }
 
-static int
-decode_frame (GeglOperation *operation,
-              glong          frame)
+static AVFrame *
+alloc_picture (int pix_fmt, int width, int height)
 {
-  GeglProperties *o = GEGL_PROPERTIES (operation);
-  Priv       *p = (Priv*)o->user_data;
-  glong       prevframe = p->prevframe;
-  glong       decodeframe = prevframe; 
+  AVFrame  *picture;
+  uint8_t  *picture_buf;
+  int       size;
 
-  if (frame < 0)
+  picture = av_frame_alloc ();
+  if (!picture)
+    return NULL;
+  size = avpicture_get_size (pix_fmt, width + 1, height + 1);
+  picture_buf = malloc (size);
+  if (!picture_buf)
     {
-      frame = 0;
+      av_free (picture);
+      return NULL;
     }
-  else if (frame >= o->frames)
+  avpicture_fill ((AVPicture *) picture, picture_buf, pix_fmt, width, height);
+  return picture;
+}
+
+/* Video frames are decoded by a thread of their own, which keeps up to
+ * READ_AHEAD frames after the one last asked for ready as buffers, and
+ * holds on to KEEP_BEHIND frames before it for stepping back.
+ */
+#define READ_AHEAD  8
+#define KEEP_BEHIND 4
+
+/* decoding restarts from a keyframe for frames further ahead than this */
+#define MAX_DECODE_AHEAD 64
+
+typedef struct
+{
+  glong       first;  /* the frames this picture is shown for */
+  glong       last;
+  gdouble     pts;    /* timestamp in seconds */
+  GeglBuffer *buffer;
+} DecodedFrame;
+
+static void
+decoded_frame_free (DecodedFrame *decoded)
+{
+  g_object_unref (decoded->buffer);
+  g_slice_free (DecodedFrame, decoded);
+}
+
+/* called with p->mutex held */
+static DecodedFrame *
+lookup_frame (Priv  *p,
+              glong  frame)
+{
+  GList *l;
+
+  for (l = p->decoded_frames.head; l; l = l->next)
     {
-      frame = o->frames - 1;
+      DecodedFrame *decoded = l->data;
+
+      if (decoded->first <= frame && frame <= decoded->last)
+        return decoded;
     }
-  if (frame == prevframe)
+  return NULL;
+}
+
+/* called with p->mutex held */
+static void
+trim_frames (Priv *p)
+{
+  GList *l = p->decoded_frames.head;
+
+  while (l)
     {
-      return 0;
+      DecodedFrame *decoded = l->data;
+      GList        *next    = l->next;
+
+      if (decoded->last < p->wanted - KEEP_BEHIND ||
+          decoded->first > p->wanted + READ_AHEAD)
+        {
+          decoded_frame_free (decoded);
+          g_queue_delete_link (&p->decoded_frames, l);
+        }
+      l = next;
     }
+}
 
-  decodeframe = frame;
-  if (frame < 2 || frame > prevframe + 64 || frame < prevframe )
-  {
- 
-    int64_t seek_target = av_rescale_q (((frame) * AV_TIME_BASE * 1.0) / o->frame_rate
+static void
+seek_frame (Priv  *p,
+            glong  frame)
+{
+  int64_t seek_target = av_rescale_q (((frame) * AV_TIME_BASE * 1.0) / p->fps
 , AV_TIME_BASE_Q, p->video_stream->time_base) / p->video_stream->codec->ticks_per_frame;
 
-    if (av_seek_frame (p->video_fcontext, p->video_index, seek_target, (AVSEEK_FLAG_BACKWARD )) < 0)
-      fprintf (stderr, "video seek error!\n");
-    else
-      avcodec_flush_buffers (p->video_stream->codec);
+  /* lands on the closest keyframe before the frame */
+  if (av_seek_frame (p->video_fcontext, p->video_index, seek_target, (AVSEEK_FLAG_BACKWARD )) < 0)
+    fprintf (stderr, "video seek error!\n");
+  else
+    avcodec_flush_buffers (p->video_stream->codec);
+}
 
-    prevframe = -1;
-  }
+/* Decode the next picture of the video into p->lavc_frame and store the
+ * number of the frame it shows in @frame, which is negative for pictures
+ * the codec delay puts before the start. Returns FALSE at the end of the
+ * stream.
+ */
+static gboolean
+decode_picture (Priv  *p,
+                glong *frame)
+{
+  glong decodeframe = 0;
+  int   got_picture = 0;
 
   do
     {
-      int       got_picture = 0;
+      int       decoded_bytes;
+      AVPacket  pkt = {0,};
+
       do
+      {
+        av_free_packet (&pkt);
+        if (av_read_frame (p->video_fcontext, &pkt) < 0)
         {
-          int       decoded_bytes;
-          AVPacket  pkt = {0,};
-
-          do
-          {
-            av_free_packet (&pkt);
-            if (av_read_frame (p->video_fcontext, &pkt) < 0)
-            {
-              av_free_packet (&pkt);
-              return -1;
-            }
-          }
-          while (pkt.stream_index != p->video_index);
+          av_free_packet (&pkt);
+          return FALSE;
+        }
+      }
+      while (pkt.stream_index != p->video_index);
 
-          decoded_bytes = avcodec_decode_video2 (
-                 p->video_stream->codec, p->lavc_frame,
-                 &got_picture, &pkt);
-          if (decoded_bytes < 0)
-            {
-              fprintf (stderr, "avcodec_decode_video failed for %s\n",
-                       o->path);
-              return -1;
-            }
+      decoded_bytes = avcodec_decode_video2 (
+             p->video_stream->codec, p->lavc_frame,
+             &got_picture, &pkt);
+      if (decoded_bytes < 0)
+        {
+          fprintf (stderr, "avcodec_decode_video failed for %s\n",
+                   p->loadedfilename);
+          av_free_packet (&pkt);
+          return FALSE;
+        }
 
-          if(got_picture)
-          {
-             if ((pkt.dts == pkt.pts) || (p->lavc_frame->key_frame!=0))
-             {
-               p->lavc_frame->pts = 
+      if(got_picture)
+      {
+         if ((pkt.dts == pkt.pts) || (p->lavc_frame->key_frame!=0))
+         {
+           p->lavc_frame->pts =
 (p->video_stream->cur_dts - p->video_stream->first_dts);
-               p->prevpts =
-     av_rescale_q ( p->lavc_frame->pts, p->video_stream->time_base,
+           p->decode_pts =
+ av_rescale_q ( p->lavc_frame->pts, p->video_stream->time_base,
 AV_TIME_BASE_Q) * 1.0 / AV_TIME_BASE ;
-               decodeframe = roundf( p->prevpts * o->frame_rate);
-             }
-             else
-             {
-               p->prevpts += 1.0 / o->frame_rate;
-               decodeframe = roundf ( p->prevpts * o->frame_rate);
-             }
-          }
-#if 0
-          if (decoded_bytes != pkt.size)
-            fprintf (stderr, "bytes left!\n");
-#endif
-          av_free_packet (&pkt);
+           decodeframe = roundf( p->decode_pts * p->fps);
+         }
+         else
+         {
+           p->decode_pts += 1.0 / p->fps;
+           decodeframe = roundf ( p->decode_pts * p->fps);
+         }
+      }
+      av_free_packet (&pkt);
+    }
+  while (!got_picture);
+
+  /* the picture decoded is codec_delay + 1 frames behind */
+  *frame = decodeframe - p->codec_delay - 1;
+
+  return TRUE;
+}
+
+static GeglBuffer *
+picture_to_buffer (Priv *p)
+{
+  GeglRectangle  extent = {0, 0, p->width, p->height};
+  GeglBuffer    *buffer = gegl_buffer_new (&extent, babl_format ("R'G'B' u8"));
+
+  if (p->video_stream->codec->pix_fmt == AV_PIX_FMT_RGB24)
+    {
+      gegl_buffer_set (buffer, &extent, 0, babl_format ("R'G'B' u8"),
+                       p->lavc_frame->data[0], p->lavc_frame->linesize[0]);
+    }
+  else
+    {
+      p->img_convert_ctx = sws_getCachedContext (p->img_convert_ctx,
+                               p->width, p->height, p->video_stream->codec->pix_fmt,
+                               p->width, p->height, AV_PIX_FMT_RGB24,
+                               SWS_BICUBIC, NULL, NULL, NULL);
+      if (!p->rgb_frame)
+        p->rgb_frame = alloc_picture (AV_PIX_FMT_RGB24, p->width, p->height);
+      sws_scale (p->img_convert_ctx, (void*)p->lavc_frame->data,
+                 p->lavc_frame->linesize, 0, p->height, p->rgb_frame->data, p->rgb_frame->linesize);
+      gegl_buffer_set (buffer, &extent, 0, babl_format ("R'G'B' u8"),
+                       p->rgb_frame->data[0], p->rgb_frame->linesize[0]);
+    }
+  return buffer;
+}
+
+static gpointer
+decoder_thread (gpointer data)
+{
+  Priv *p = data;
+
+  g_mutex_lock (&p->mutex);
+
+  while (!p->quit)
+    {
+      glong       wanted = p->wanted;
+      glong       frame  = -1;
+      gboolean    eof;
+      GeglBuffer *buffer = NULL;
+
+      if (wanted < 0)
+        {
+          g_cond_wait (&p->cond, &p->mutex);
+          continue;
         }
-      while (!got_picture);
+
+      if (!p->running ||
+          wanted > p->next_frame + MAX_DECODE_AHEAD ||
+          (wanted < p->next_frame && !lookup_frame (p, wanted)))
+        {
+          seek_frame (p, wanted);
+          p->next_frame = wanted;
+          p->running = TRUE;
+          p->eof = FALSE;
+        }
+      else if (p->eof || p->next_frame > wanted + READ_AHEAD)
+        {
+          g_cond_wait (&p->cond, &p->mutex);
+          continue;
+        }
+
+      g_mutex_unlock (&p->mutex);
+
+      eof = !decode_picture (p, &frame);
+      /* pictures before the seeked to frame, or before the start of the
+       * video, are only decoded
+       */
+      if (!eof && frame >= 0 && frame >= p->next_frame)
+        buffer = picture_to_buffer (p);
+
+      g_mutex_lock (&p->mutex);
+
+      if (eof)
+        {
+          p->eof = TRUE;
+        }
+      else if (buffer)
+        {
+          DecodedFrame *decoded = g_slice_new (DecodedFrame);
+
+          decoded->first  = p->next_frame;
+          decoded->last   = frame;
+          decoded->pts    = p->decode_pts;
+          decoded->buffer = buffer;
+          g_queue_push_tail (&p->decoded_frames, decoded);
+
+          p->next_frame = frame + 1;
+          trim_frames (p);
+        }
+
+      g_cond_broadcast (&p->cond);
     }
-    while (decodeframe <= frame + p->codec_delay);
 
-  p->prevframe = frame;
-  return 0;
+  g_mutex_unlock (&p->mutex);
+
+  return NULL;
+}
+
+static void
+start_decoder (Priv *p)
+{
+  p->wanted     = -1;
+  p->next_frame = 0;
+  p->running    = FALSE;
+  p->eof        = FALSE;
+  p->quit       = FALSE;
+  p->decoder    = g_thread_new ("ff-load", decoder_thread, p);
+}
+
+static void
+stop_decoder (Priv *p)
+{
+  if (p->decoder)
+    {
+      g_mutex_lock (&p->mutex);
+      p->quit = TRUE;
+      g_cond_broadcast (&p->cond);
+      g_mutex_unlock (&p->mutex);
+
+      g_thread_join (p->decoder);
+      p->decoder = NULL;
+    }
+
+  while (!g_queue_is_empty (&p->decoded_frames))
+    decoded_frame_free (g_queue_pop_head (&p->decoded_frames));
+}
+
+/* Get the buffer of @frame from the decoder, returns NULL when it can
+ * not be decoded.
+ */
+static GeglBuffer *
+decode_frame (GeglOperation *operation,
+              glong          frame)
+{
+  GeglProperties *o = GEGL_PROPERTIES (operation);
+  Priv           *p = (Priv*)o->user_data;
+  DecodedFrame   *decoded;
+  GeglBuffer     *buffer = NULL;
+
+  if (frame < 0)
+    {
+      frame = 0;
+    }
+  else if (frame >= o->frames)
+    {
+      frame = o->frames - 1;
+    }
+
+  g_mutex_lock (&p->mutex);
+
+  p->wanted = frame;
+  p->eof    = FALSE;
+  g_cond_broadcast (&p->cond);
+
+  while (!(decoded = lookup_frame (p, frame)) && !p->eof)
+    g_cond_wait (&p->cond, &p->mutex);
+
+  if (decoded)
+    {
+      buffer = g_object_ref (decoded->buffer);
+      p->prevpts = decoded->pts;
+    }
+
+  g_mutex_unlock (&p->mutex);
+
+  return buffer;
 }
 
 static void
@@ -406,9 +663,7 @@ prepare (GeglOperation *operation)
   gegl_operation_set_format (operation, "output", babl_format ("R'G'B' u8"));
 
   if (!p->loadedfilename ||
-      strcmp (p->loadedfilename, o->path) ||
-       p->prevframe > o->frame  /* a bit heavy handed, but improves consistency */
-      )
+      strcmp (p->loadedfilename, o->path))
     {
       gint i;
       gint err;
@@ -506,7 +761,6 @@ prepare (GeglOperation *operation)
       if (p->loadedfilename)
         g_free (p->loadedfilename);
       p->loadedfilename = g_strdup (o->path);
-      p->prevframe = -1;
       p->a_prevframe = -1;
 
       o->frames = p->video_stream->nb_frames;
@@ -519,6 +773,7 @@ prepare (GeglOperation *operation)
 	if (o->frames < 1)
           o->frames = 23;
       }
+      p->fps = o->frame_rate;
 #if 0
       {
         int m ,h;
@@ -547,6 +802,7 @@ prepare (GeglOperation *operation)
     }
 
     clear_audio_track (o);
+    start_decoder (p);
   }
 }
 
@@ -636,27 +892,6 @@ static void get_sample_data (Priv *p, long sample_no, float *left, float *right)
   *right = 0;
 }
 
-static AVFrame *
-alloc_picture (int pix_fmt, int width, int height)
-{
-  AVFrame  *picture;
-  uint8_t  *picture_buf;
-  int       size;
-
-  picture = av_frame_alloc ();
-  if (!picture)
-    return NULL;
-  size = avpicture_get_size (pix_fmt, width + 1, height + 1);
-  picture_buf = malloc (size);
-  if (!picture_buf)
-    {
-      av_free (picture);
-      return NULL;
-    }
-  avpicture_fill ((AVPicture *) picture, picture_buf, pix_fmt, width, height);
-  return picture;
-}
-
 static gboolean
 process (GeglOperation       *operation,
          GeglBuffer          *output,
@@ -665,57 +900,42 @@ process (GeglOperation       *operation,
 {
   GeglProperties *o = GEGL_PROPERTIES (operation);
   Priv       *p = (Priv*)o->user_data;
+  GeglBuffer *buffer = NULL;
 
-  {
-    if (p->video_fcontext && !decode_frame (operation, o->frame))
-      {
-        long sample_start = 0;
+  if (p->decoder)
+    buffer = decode_frame (operation, o->frame);
 
-	if (p->audio_stream) 
-        {
-          int sample_count;
-          gegl_audio_fragment_set_sample_rate (o->audio, p->audio_stream->codec->sample_rate);
-          gegl_audio_fragment_set_channels    (o->audio, 2);
-          gegl_audio_fragment_set_channel_layout    (o->audio, GEGL_CH_LAYOUT_STEREO);
+  if (buffer)
+    {
+      GeglRectangle extent = {0,0,p->width,p->height};
+      long sample_start = 0;
+
+      if (p->audio_stream) 
+      {
+        int sample_count;
+        gegl_audio_fragment_set_sample_rate (o->audio, p->audio_stream->codec->sample_rate);
+        gegl_audio_fragment_set_channels    (o->audio, 2);
+        gegl_audio_fragment_set_channel_layout    (o->audio, GEGL_CH_LAYOUT_STEREO);
 
-          sample_count = samples_per_frame (o->frame,
-               o->frame_rate, p->audio_stream->codec->sample_rate,
-               &sample_start);
-          gegl_audio_fragment_set_sample_count (o->audio, sample_count);
+        sample_count = samples_per_frame (o->frame,
+             o->frame_rate, p->audio_stream->codec->sample_rate,
+             &sample_start);
+        gegl_audio_fragment_set_sample_count (o->audio, sample_count);
 
-	  decode_audio (operation, p->prevpts, p->prevpts + 5.0);
+        decode_audio (operation, p->prevpts, p->prevpts + 5.0);
+        {
+          int i;
+          for (i = 0; i < sample_count; i++)
           {
-            int i;
-            for (i = 0; i < sample_count; i++)
-            {
-              get_sample_data (p, sample_start + i, &o->audio->data[0][i],
-                                  &o->audio->data[1][i]);
-            }
+            get_sample_data (p, sample_start + i, &o->audio->data[0][i],
+                                &o->audio->data[1][i]);
           }
         }
-	
-        if (p->video_stream->codec->pix_fmt == AV_PIX_FMT_RGB24)
-        {
-          GeglRectangle extent = {0,0,p->width,p->height};
-          gegl_buffer_set (output, &extent, 0, babl_format("R'G'B' u8"), p->lavc_frame->data[0], GEGL_AUTO_ROWSTRIDE);
-        }
-        else
-        {
-          struct SwsContext *img_convert_ctx;
-          GeglRectangle extent = {0,0,p->width,p->height};
-
-          img_convert_ctx = sws_getContext(p->width, p->height, p->video_stream->codec->pix_fmt,
-                                           p->width, p->height, AV_PIX_FMT_RGB24,
-                                           SWS_BICUBIC, NULL, NULL, NULL);
-          if (!p->rgb_frame)
-            p->rgb_frame = alloc_picture (AV_PIX_FMT_RGB24, p->width, p->height);
-          sws_scale (img_convert_ctx, (void*)p->lavc_frame->data,
-                     p->lavc_frame->linesize, 0, p->height, p->rgb_frame->data, p->rgb_frame->linesize);
-          gegl_buffer_set (output, &extent, 0, babl_format("R'G'B' u8"), p->rgb_frame->data[0], GEGL_AUTO_ROWSTRIDE);
-          sws_freeContext (img_convert_ctx);
-        }
       }
-  }
+
+      gegl_buffer_copy (buffer, &extent, GEGL_ABYSS_NONE, output, &extent);
+      g_object_unref (buffer);
+    }
   return  TRUE;
 }
 
@@ -729,6 +949,8 @@ finalize (GObject *object)
       Priv *p = (Priv*)o->user_data;
       ff_cleanup (o);
       g_free (p->loadedfilename);
+      g_mutex_clear (&p->mutex);
+      g_cond_clear (&p->cond);
 
       g_free (o->user_data);
       o->user_data = NULL;
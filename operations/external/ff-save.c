@@ -90,6 +90,15 @@ property_int (me_subpel_quality, _("me-subpel-quality"), 0)
 #ifndef AV_CODEC_CAP_VARIABLE_FRAME_SIZE
 #define AV_CODEC_CAP_VARIABLE_FRAME_SIZE  CODEC_CAP_VARIABLE_FRAME_SIZE
 #endif
+#ifndef AV_CODEC_CAP_FRAME_THREADS
+#define AV_CODEC_CAP_FRAME_THREADS        CODEC_CAP_FRAME_THREADS
+#endif
+#ifndef AV_CODEC_CAP_SLICE_THREADS
+#define AV_CODEC_CAP_SLICE_THREADS        CODEC_CAP_SLICE_THREADS
+#endif
+
+/* the number of frames process () can get ahead of the encoder thread */
+#define MAX_PENDING_FRAMES 4
 
 typedef struct
 {
@@ -97,15 +106,21 @@ typedef struct
   gdouble    frames;
   gdouble    width;
   gdouble    height;
-  GeglBuffer *input;
 
   AVOutputFormat *fmt;
   AVFormatContext *oc;
   AVStream *video_st;
 
   AVFrame  *picture, *tmp_picture;
-  uint8_t  *video_outbuf;
-  int       frame_count, video_outbuf_size;
+  int       frame_count;
+  struct SwsContext *img_convert_ctx;
+
+  /* the encoder thread, see encoder_thread () */
+  GThread  *encoder;
+  GMutex    mutex;
+  GCond     cond;
+  GQueue    pending_frames;
+  gboolean  quit;
 
     /** the rest is for audio handling within oxide, note that the interface
      * used passes all used functions in the oxide api through the reg_sym api
@@ -135,6 +150,25 @@ typedef struct
   int       next_apts;
 } Priv;
 
+/* A frame handed from process () to the encoder thread, the buffer is a
+ * copy-on-write duplicate of the input and the audio a copy of the audio
+ * fragment that came with it, if any.
+ */
+typedef struct
+{
+  GeglBuffer        *buffer;
+  GeglAudioFragment *audio;
+} PendingFrame;
+
+static void
+pending_frame_free (PendingFrame *pending)
+{
+  g_object_unref (pending->buffer);
+  if (pending->audio)
+    g_object_unref (pending->audio);
+  g_slice_free (PendingFrame, pending);
+}
+
 static void
 clear_audio_track (GeglProperties *o)
 {
@@ -234,6 +268,10 @@ init (GeglProperties *o)
     {
       p = g_new0 (Priv, 1);
       o->user_data = (void*) p;
+
+      g_mutex_init (&p->mutex);
+      g_cond_init (&p->cond);
+      g_queue_init (&p->pending_frames);
     }
 
   if (!inited)
@@ -259,12 +297,14 @@ void        close_audio       (Priv            *p,
                                AVFormatContext *oc,
                                AVStream        *st);
 static int  tfile             (GeglProperties  *o);
-static void write_video_frame (GeglProperties  *o,
-                               AVFormatContext *oc,
-                               AVStream        *st);
-static void write_audio_frame (GeglProperties      *o,
-                               AVFormatContext *oc,
-                               AVStream        *st);
+static void write_video_frame (GeglProperties    *o,
+                               GeglBuffer        *buffer,
+                               AVFormatContext   *oc,
+                               AVStream          *st);
+static void write_audio_frame (GeglProperties    *o,
+                               GeglAudioFragment *audio,
+                               AVFormatContext   *oc,
+                               AVStream          *st);
 
 #define STREAM_FRAME_RATE 25    /* 25 images/s */
 
@@ -351,6 +391,29 @@ open_audio (GeglProperties *o, AVFormatContext * oc, AVStream * st)
     }
 }
 
+/* the audio fragment property is reused by its producer from frame to
+ * frame, so the encoder thread gets a copy of its own
+ */
+static GeglAudioFragment *
+copy_audio_fragment (GeglAudioFragment *audio)
+{
+  GeglAudioFragment *af;
+  int sample_count = gegl_audio_fragment_get_sample_count (audio);
+  int i;
+
+  af = gegl_audio_fragment_new (gegl_audio_fragment_get_sample_rate (audio),
+                                gegl_audio_fragment_get_channels (audio),
+                                gegl_audio_fragment_get_channel_layout (audio),
+                                sample_count);
+  gegl_audio_fragment_set_sample_count (af, sample_count);
+  for (i = 0; i < sample_count; i++)
+    {
+      af->data[0][i] = audio->data[0][i];
+      af->data[1][i] = audio->data[1][i];
+    }
+  return af;
+}
+
 static AVFrame *alloc_audio_frame(enum AVSampleFormat sample_fmt,
                                   uint64_t channel_layout,
                                   int sample_rate, int nb_samples)
@@ -378,8 +441,9 @@ static AVFrame *alloc_audio_frame(enum AVSampleFormat sample_fmt,
   return frame;
 }
 
-void
-write_audio_frame (GeglProperties *o, AVFormatContext * oc, AVStream * st)
+static void
+write_audio_frame (GeglProperties *o, GeglAudioFragment *audio,
+                   AVFormatContext * oc, AVStream * st)
 {
   Priv *p = (Priv*)o->user_data;
   AVCodecContext *c = st->codec;
@@ -392,24 +456,12 @@ write_audio_frame (GeglProperties *o, AVFormatContext * oc, AVStream * st)
   }
 
   /* first we add incoming frames audio samples */
-  if (o->audio)
+  if (audio)
   {
-    int i;
-    GeglAudioFragment *af;
-    sample_count = gegl_audio_fragment_get_sample_count (o->audio);
-    af = gegl_audio_fragment_new (gegl_audio_fragment_get_sample_rate (o->audio),
-                                                     gegl_audio_fragment_get_channels (o->audio),
-                                                     gegl_audio_fragment_get_channel_layout (o->audio),
-                                                     sample_count);
-    gegl_audio_fragment_set_sample_count (af, sample_count);
-    for (i = 0; i < sample_count; i++)
-      {
-        af->data[0][i] = o->audio->data[0][i];
-        af->data[1][i] = o->audio->data[1][i];
-      }
-    gegl_audio_fragment_set_pos (af, p->audio_pos);
+    sample_count = gegl_audio_fragment_get_sample_count (audio);
+    gegl_audio_fragment_set_pos (audio, p->audio_pos);
     p->audio_pos += sample_count;
-    p->audio_track = g_list_append (p->audio_track, af);
+    p->audio_track = g_list_append (p->audio_track, g_object_ref (audio));
   }
   else
   {
@@ -675,6 +727,16 @@ open_video (GeglProperties *o, AVFormatContext * oc, AVStream * st)
       i++;
     }
   }
+  /* let libavcodec spread the encoding over threads of its own, on top
+   * of the encoder thread running alongside the graph
+   */
+  c->thread_count = 0;
+  c->thread_type  = 0;
+  if (codec->capabilities & AV_CODEC_CAP_FRAME_THREADS)
+    c->thread_type |= FF_THREAD_FRAME;
+  if (codec->capabilities & AV_CODEC_CAP_SLICE_THREADS)
+    c->thread_type |= FF_THREAD_SLICE;
+
 #if 0
   if (o->video_preset[0])
     av_dict_set (&codec_options, "preset", o->video_preset, 0);
@@ -687,15 +749,6 @@ open_video (GeglProperties *o, AVFormatContext * oc, AVStream * st)
       exit (1);
     }
 
-  p->video_outbuf = NULL;
-  if (!(oc->oformat->flags & AVFMT_RAWPICTURE))
-    {
-      /* allocate output buffer */
-      /* XXX: API change will be done */
-      p->video_outbuf_size = 200000;
-      p->video_outbuf = malloc (p->video_outbuf_size);
-    }
-
   /* allocate the encoded raw picture */
   p->picture = alloc_picture (c->pix_fmt, c->width, c->height);
   if (!p->picture)
@@ -730,27 +783,30 @@ close_video (Priv * p, AVFormatContext * oc, AVStream * st)
       av_free (p->tmp_picture->data[0]);
       av_free (p->tmp_picture);
     }
-  av_free (p->video_outbuf);
+  if (p->img_convert_ctx)
+    {
+      sws_freeContext (p->img_convert_ctx);
+      p->img_convert_ctx = NULL;
+    }
 }
 
 #include "string.h"
 
 /* prepare a dummy image */
 static void
-fill_rgb_image (GeglProperties *o,
+fill_rgb_image (GeglBuffer *buffer,
                 AVFrame *pict, int frame_index, int width, int height)
 {
-  Priv     *p = (Priv*)o->user_data;
   GeglRectangle rect={0,0,width,height};
-  gegl_buffer_get (p->input, &rect, 1.0, babl_format ("R'G'B' u8"), pict->data[0], GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  gegl_buffer_get (buffer, &rect, 1.0, babl_format ("R'G'B' u8"), pict->data[0], GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 }
 
 static void
-write_video_frame (GeglProperties *o,
+write_video_frame (GeglProperties *o, GeglBuffer *buffer,
                    AVFormatContext *oc, AVStream *st)
 {
   Priv           *p = (Priv*)o->user_data;
-  int             out_size, ret;
+  int             ret;
   AVCodecContext *c;
   AVFrame        *picture_ptr;
 
@@ -758,21 +814,21 @@ write_video_frame (GeglProperties *o,
 
   if (c->pix_fmt != AV_PIX_FMT_RGB24)
     {
-      struct SwsContext *img_convert_ctx;
-      fill_rgb_image (o, p->tmp_picture, p->frame_count, c->width,
+      fill_rgb_image (buffer, p->tmp_picture, p->frame_count, c->width,
                       c->height);
 
-      img_convert_ctx = sws_getContext(c->width, c->height, AV_PIX_FMT_RGB24,
+      p->img_convert_ctx = sws_getCachedContext (p->img_convert_ctx,
+                                       c->width, c->height, AV_PIX_FMT_RGB24,
                                        c->width, c->height, c->pix_fmt,
                                        SWS_BICUBIC, NULL, NULL, NULL);
 
-      if (img_convert_ctx == NULL)
+      if (p->img_convert_ctx == NULL)
         {
           fprintf(stderr, "ff_save: Cannot initialize conversion context.");
         }
       else
         {
-          sws_scale(img_convert_ctx,
+          sws_scale(p->img_convert_ctx,
                     (void*)p->tmp_picture->data,
                     p->tmp_picture->linesize,
                     0,
@@ -782,12 +838,11 @@ write_video_frame (GeglProperties *o,
          p->picture->format = c->pix_fmt;
          p->picture->width = c->width;
          p->picture->height = c->height;
-         sws_freeContext (img_convert_ctx);
         }
     }
   else
     {
-      fill_rgb_image (o, p->picture, p->frame_count, c->width, c->height);
+      fill_rgb_image (buffer, p->picture, p->frame_count, c->width, c->height);
     }
 
   picture_ptr      = p->picture;
@@ -812,31 +867,24 @@ write_video_frame (GeglProperties *o,
     }
   else
     {
-      /* encode the image */
-      out_size =
-        avcodec_encode_video (c,
-                              p->video_outbuf,
-                              p->video_outbuf_size, picture_ptr);
-
-      /* if zero size, it means the image was buffered */
-      if (out_size != 0)
+      AVPacket  pkt = { 0 };
+      int       got_packet = 0;
+
+      av_init_packet (&pkt);
+
+      /* encode the image, the encoder may hold on to it, with frame
+       * threading or reordering, and hand back an earlier one; the
+       * timestamps and key frame flag of the packet are its own
+       */
+      ret = avcodec_encode_video2 (c, &pkt, picture_ptr, &got_packet);
+
+      if (ret == 0 && got_packet)
         {
-          AVPacket  pkt;
-          av_init_packet (&pkt);
-          if (c->coded_frame->key_frame)
-            pkt.flags |= AV_PKT_FLAG_KEY;
           pkt.stream_index = st->index;
-          pkt.data = p->video_outbuf;
-          pkt.size = out_size;
-          pkt.pts = picture_ptr->pts;
-          pkt.dts = picture_ptr->pts;
           av_packet_rescale_ts (&pkt, c->time_base, st->time_base);
           /* write the compressed frame in the media file */
           ret = av_write_frame (oc, &pkt);
-        }
-      else
-        {
-          ret = 0;
+          av_free_packet (&pkt);
         }
     }
   if (ret != 0)
@@ -939,6 +987,76 @@ tfile (GeglProperties *o)
   return 0;
 }
 
+/* Frames are converted, encoded and muxed by a thread of their own, so
+ * that the graph can compute the next frame meanwhile; process () only
+ * queues them, waiting when MAX_PENDING_FRAMES are already queued.
+ */
+static gpointer
+encoder_thread (gpointer data)
+{
+  GeglProperties *o = data;
+  Priv           *p = (Priv*)o->user_data;
+
+  g_mutex_lock (&p->mutex);
+
+  while (TRUE)
+    {
+      PendingFrame *pending;
+
+      while (g_queue_is_empty (&p->pending_frames) && !p->quit)
+        g_cond_wait (&p->cond, &p->mutex);
+
+      /* only quit once the queued frames are written */
+      if (g_queue_is_empty (&p->pending_frames))
+        break;
+
+      pending = g_queue_pop_head (&p->pending_frames);
+      g_cond_broadcast (&p->cond);
+
+      g_mutex_unlock (&p->mutex);
+
+      write_video_frame (o, pending->buffer, p->oc, p->video_st);
+      if (p->audio_st)
+        write_audio_frame (o, pending->audio, p->oc, p->audio_st);
+      pending_frame_free (pending);
+
+      g_mutex_lock (&p->mutex);
+    }
+
+  g_mutex_unlock (&p->mutex);
+
+  return NULL;
+}
+
+static void
+start_encoder (GeglProperties *o)
+{
+  Priv *p = (Priv*)o->user_data;
+
+  p->quit    = FALSE;
+  p->encoder = g_thread_new ("ff-save", encoder_thread, o);
+}
+
+static void
+stop_encoder (GeglProperties *o)
+{
+  Priv *p = (Priv*)o->user_data;
+
+  if (p->encoder)
+    {
+      g_mutex_lock (&p->mutex);
+      p->quit = TRUE;
+      g_cond_broadcast (&p->cond);
+      g_mutex_unlock (&p->mutex);
+
+      g_thread_join (p->encoder);
+      p->encoder = NULL;
+    }
+
+  while (!g_queue_is_empty (&p->pending_frames))
+    pending_frame_free (g_queue_pop_head (&p->pending_frames));
+}
+
 static gboolean
 process (GeglOperation       *operation,
          GeglBuffer          *input,
@@ -947,7 +1065,7 @@ process (GeglOperation       *operation,
 {
   GeglProperties *o = GEGL_PROPERTIES (operation);
   Priv *p = (Priv*)o->user_data;
-  static gint     inited = 0;
+  PendingFrame   *pending;
 
   g_assert (input);
 
@@ -957,17 +1075,27 @@ process (GeglOperation       *operation,
 
   p->width = result->width;
   p->height = result->height;
-  p->input = input;
 
-  if (!inited)
+  if (!p->encoder)
     {
       tfile (o);
-      inited = 1;
+      start_encoder (o);
     }
 
-  write_video_frame (o, p->oc, p->video_st);
-  if (p->audio_st)
-    write_audio_frame (o, p->oc, p->audio_st);
+  /* aligned tiles are shared copy-on-write, rather than copied */
+  pending = g_slice_new (PendingFrame);
+  pending->buffer = gegl_buffer_dup (input);
+  pending->audio  = o->audio ? copy_audio_fragment (o->audio) : NULL;
+
+  g_mutex_lock (&p->mutex);
+
+  while (g_queue_get_length (&p->pending_frames) >= MAX_PENDING_FRAMES)
+    g_cond_wait (&p->cond, &p->mutex);
+
+  g_queue_push_tail (&p->pending_frames, pending);
+  g_cond_broadcast (&p->cond);
+
+  g_mutex_unlock (&p->mutex);
 
   return  TRUE;
 }
@@ -1002,7 +1130,6 @@ static void flush_video (GeglProperties *o)
 {
   Priv *p = (Priv*)o->user_data;
   int got_packet = 0;
-  long ts = p->frame_count;
   do {
     AVPacket  pkt = { 0 };
     int ret;
@@ -1015,8 +1142,6 @@ static void flush_video (GeglProperties *o)
      if (got_packet)
      {
        pkt.stream_index = p->video_st->index;
-       pkt.pts = ts;
-       pkt.dts = ts++;
        av_packet_rescale_ts (&pkt, p->video_st->codec->time_base, p->video_st->time_base);
        av_interleaved_write_frame (p->oc, &pkt);
        av_free_packet (&pkt);
@@ -1031,6 +1156,9 @@ finalize (GObject *object)
   if (o->user_data)
     {
       Priv *p = (Priv*)o->user_data;
+
+      stop_encoder (o);
+
       flush_audio (o);
       flush_video (o);
 
@@ -1044,6 +1172,10 @@ finalize (GObject *object)
       avio_closep (&p->oc->pb);
       avformat_free_context (p->oc);
 
+      clear_audio_track (o);
+      g_mutex_clear (&p->mutex);
+      g_cond_clear (&p->cond);
+
       g_free (o->user_data);
       o->user_data = NULL;
     }
@@ -22,6 +22,14 @@
 
 
 #ifdef GEGL_PROPERTIES
+
+enum_start (gegl_matting_levin_solver)
+  enum_value (GEGL_MATTING_LEVIN_SOLVER_DIRECT, "direct",
+              N_("Direct"))
+  enum_value (GEGL_MATTING_LEVIN_SOLVER_CG,     "conjugate-gradient",
+              N_("Conjugate gradient"))
+enum_end (GeglMattingLevinSolver)
+
 property_int   (epsilon, _("Epsilon"), -6)
    description (_("Log of the error weighting"))
    value_range (-9, -1)
@@ -46,16 +54,25 @@ property_int    (active_levels, _("Active levels"), 2)
    description  (_("Number of levels to perform solving"))
    value_range  (0, 8)
 
+property_enum   (solver, _("Solver"),
+                 GeglMattingLevinSolver, gegl_matting_levin_solver,
+                 GEGL_MATTING_LEVIN_SOLVER_DIRECT)
+   description  (_("Factor the matting laplacian directly, or solve it "
+                   "iteratively without building it, which needs far less "
+                   "memory on large images"))
+
 #else
 
 #define GEGL_OP_COMPOSER
 #define GEGL_OP_C_SOURCE matting-levin.c
 
 #include "gegl-op.h"
+#include "gegl-config.h"
 #include "gegl-debug.h"
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
 /* XXX: We have two options for the two common installation locations of
@@ -1266,21 +1283,532 @@ cleanup:
 }
 
 
+/* Matrix-free solving of the matting laplacian, as an alternative to
+ * building it and factoring it with UMFPACK, which needs memory and time
+ * growing faster than the number of pixels.
+ *
+ * For a window w_k with mean mu_k and regularized inverse covariance S_k,
+ * the window's share of the laplacian's off-diagonal part is
+ *
+ *   W_k[i][j] = (1 + (I_i - mu_k)' S_k (I_j - mu_k)) / |w_k|
+ *
+ * so that W_k x only needs the sum of x over the window, and the 3-vector
+ * S_k sum_j (I_j - mu_k) x_j. The laplacian is applied from these within a
+ * Jacobi preconditioned conjugate gradient, keeping only the window
+ * statistics and a few vectors, all in single precision.
+ */
+#define CG_MAX_ITERATIONS  1000
+#define COMPONENTS_INVERSE 6
+#define COMPONENTS_WINDOW  (1 + COMPONENTS_INPUT)
+
+/* Relative residual at which the conjugate gradient stops */
+static const gdouble CG_TOLERANCE = 1e-6;
+
+typedef struct
+{
+  const GeglRectangle *roi;
+  const gdouble       *image;
+  const gdouble       *trimap;
+  gint                 radius;
+  gint                 window_elems;
+  gdouble              epsilon;
+  gdouble              lambda;
+
+  gfloat              *mean;     /* COMPONENTS_INPUT per window centre */
+  gfloat              *inverse;  /* upper triangle of S_k, row by row */
+  gfloat              *window;   /* sum of x, and S_k sum (I - mu_k) x */
+  gfloat              *diagonal; /* laplacian diagonal, less the W_k */
+  gfloat              *precond;  /* inverse of the laplacian diagonal */
+
+  gfloat              *x, *r, *z, *p, *ap;
+  const gfloat        *in;       /* the vector applied to */
+  gfloat              *out;      /* the laplacian times in */
+  gdouble              alpha, beta;
+} MattingCG;
+
+typedef void (* MattingCGFunc) (MattingCG *cg,
+                                gint       y0,
+                                gint       y1,
+                                gdouble    sums[2]);
+
+static inline gboolean
+matting_cg_window_active (const MattingCG *cg,
+                          gint             x,
+                          gint             y)
+{
+  return x >= cg->radius && x < cg->roi->width  - cg->radius &&
+         y >= cg->radius && y < cg->roi->height - cg->radius &&
+         trimap_masked (cg->trimap, x, y, cg->roi);
+}
+
+/* The right hand side of the system */
+static inline gdouble
+matting_cg_rhs (const MattingCG *cg,
+                gint             i)
+{
+  if (trimap_masked (cg->trimap, i, 0, cg->roi))
+    return 0.0;
+  return cg->lambda * cg->trimap[i * COMPONENTS_AUX + AUX_VALUE];
+}
+
+/* Multiply the symmetric matrix in upper triangle form s with v */
+static inline void
+matting_cg_inverse_mul (const gfloat *restrict s,
+                        const gdouble          v[3],
+                        gdouble                out[3])
+{
+  out[0] = s[0] * v[0] + s[1] * v[1] + s[2] * v[2];
+  out[1] = s[1] * v[0] + s[3] * v[1] + s[4] * v[2];
+  out[2] = s[2] * v[0] + s[4] * v[1] + s[5] * v[2];
+}
+
+/* Compute the mean and inverse covariance of each window */
+static void
+matting_cg_statistics (MattingCG *cg,
+                       gint       y0,
+                       gint       y1,
+                       gdouble    sums[2])
+{
+  const GeglRectangle *roi = cg->roi;
+  gint x, y, wx, wy, c;
+
+  for (y = y0; y < y1; ++y)
+    for (x = 0; x < roi->width; ++x)
+      {
+        gint    k = x + y * roi->width;
+        gdouble mean[COMPONENTS_INPUT] = { 0.0, };
+        gdouble covariance[COMPONENTS_INPUT][COMPONENTS_INPUT] = { { 0.0, }, };
+        gdouble inverse[COMPONENTS_INPUT][COMPONENTS_INPUT];
+        gdouble mean_matrix[COMPONENTS_INPUT][COMPONENTS_INPUT];
+        gfloat *s = cg->inverse + k * COMPONENTS_INVERSE;
+
+        if (!matting_cg_window_active (cg, x, y))
+          continue;
+
+        for (wy = y - cg->radius; wy <= y + cg->radius; ++wy)
+          for (wx = x - cg->radius; wx <= x + cg->radius; ++wx)
+            {
+              const gdouble *pixel = cg->image + offset (wx, wy, roi, COMPONENTS_INPUT);
+
+              for (c = 0; c < COMPONENTS_INPUT; ++c)
+                {
+                  mean[c]          += pixel[c];
+                  covariance[c][0] += pixel[c] * pixel[0];
+                  covariance[c][1] += pixel[c] * pixel[1];
+                  covariance[c][2] += pixel[c] * pixel[2];
+                }
+            }
+
+        for (c = 0; c < COMPONENTS_INPUT; ++c)
+          {
+            mean[c] /= cg->window_elems;
+            covariance[c][0] /= cg->window_elems;
+            covariance[c][1] /= cg->window_elems;
+            covariance[c][2] /= cg->window_elems;
+          }
+
+        matting_vector3_self_product (mean, mean_matrix);
+        matting_matrix3_matrix3_sub  (covariance, mean_matrix, covariance);
+        covariance[0][0] += cg->epsilon / cg->window_elems;
+        covariance[1][1] += cg->epsilon / cg->window_elems;
+        covariance[2][2] += cg->epsilon / cg->window_elems;
+
+        if (!matting_matrix3_inverse (covariance, inverse))
+          memset (inverse, 0, sizeof (inverse));
+
+        for (c = 0; c < COMPONENTS_INPUT; ++c)
+          cg->mean[k * COMPONENTS_INPUT + c] = mean[c];
+
+        s[0] = inverse[0][0]; s[1] = inverse[0][1]; s[2] = inverse[0][2];
+                              s[3] = inverse[1][1]; s[4] = inverse[1][2];
+                                                    s[5] = inverse[2][2];
+      }
+}
+
+/* Compute the diagonal of the laplacian, and the preconditioner */
+static void
+matting_cg_diagonal (MattingCG *cg,
+                     gint       y0,
+                     gint       y1,
+                     gdouble    sums[2])
+{
+  const GeglRectangle *roi = cg->roi;
+  gint x, y, wx, wy, c;
+
+  for (y = y0; y < y1; ++y)
+    for (x = 0; x < roi->width; ++x)
+      {
+        gint           i     = x + y * roi->width;
+        const gdouble *pixel = cg->image + i * COMPONENTS_INPUT;
+        gdouble        count = 0.0,
+                       self  = 0.0,
+                       diagonal;
+
+        for (wy = MAX (y - cg->radius, 0); wy <= MIN (y + cg->radius, roi->height - 1); ++wy)
+          for (wx = MAX (x - cg->radius, 0); wx <= MIN (x + cg->radius, roi->width - 1); ++wx)
+            {
+              gint    k = wx + wy * roi->width;
+              gdouble d[COMPONENTS_INPUT], sd[COMPONENTS_INPUT];
+
+              if (!matting_cg_window_active (cg, wx, wy))
+                continue;
+
+              for (c = 0; c < COMPONENTS_INPUT; ++c)
+                d[c] = pixel[c] - cg->mean[k * COMPONENTS_INPUT + c];
+              matting_cg_inverse_mul (cg->inverse + k * COMPONENTS_INVERSE, d, sd);
+
+              /* each row of W_k sums to one */
+              count += 1.0;
+              self  += 1.0 + d[0] * sd[0] + d[1] * sd[1] + d[2] * sd[2];
+            }
+
+        if (!trimap_masked (cg->trimap, i, 0, roi))
+          count += cg->lambda;
+
+        cg->diagonal[i] = count;
+
+        diagonal = count - self / cg->window_elems;
+        cg->precond[i] = diagonal > 0.0 ? 1.0 / diagonal : 1.0;
+      }
+}
+
+/* Compute the per window terms of the laplacian applied to in */
+static void
+matting_cg_windows (MattingCG *cg,
+                    gint       y0,
+                    gint       y1,
+                    gdouble    sums[2])
+{
+  const GeglRectangle *roi = cg->roi;
+  gint x, y, wx, wy, c;
+
+  for (y = y0; y < y1; ++y)
+    for (x = 0; x < roi->width; ++x)
+      {
+        gint    k = x + y * roi->width;
+        gdouble sum = 0.0,
+                sum_d[COMPONENTS_INPUT] = { 0.0, },
+                v[COMPONENTS_INPUT];
+        gfloat *window = cg->window + k * COMPONENTS_WINDOW;
+
+        if (!matting_cg_window_active (cg, x, y))
+          continue;
+
+        for (wy = y - cg->radius; wy <= y + cg->radius; ++wy)
+          for (wx = x - cg->radius; wx <= x + cg->radius; ++wx)
+            {
+              gint           j     = wx + wy * roi->width;
+              const gdouble *pixel = cg->image + j * COMPONENTS_INPUT;
+              gdouble        value = cg->in[j];
+
+              sum += value;
+              for (c = 0; c < COMPONENTS_INPUT; ++c)
+                sum_d[c] += (pixel[c] - cg->mean[k * COMPONENTS_INPUT + c]) * value;
+            }
+
+        matting_cg_inverse_mul (cg->inverse + k * COMPONENTS_INVERSE, sum_d, v);
+
+        window[0] = sum;
+        window[1] = v[0];
+        window[2] = v[1];
+        window[3] = v[2];
+      }
+}
+
+/* Apply the laplacian to in, from the window terms, summing in . out */
+static void
+matting_cg_apply (MattingCG *cg,
+                  gint       y0,
+                  gint       y1,
+                  gdouble    sums[2])
+{
+  const GeglRectangle *roi = cg->roi;
+  gint x, y, wx, wy;
+
+  for (y = y0; y < y1; ++y)
+    for (x = 0; x < roi->width; ++x)
+      {
+        gint           i     = x + y * roi->width;
+        const gdouble *pixel = cg->image + i * COMPONENTS_INPUT;
+        gdouble        acc   = 0.0;
+
+        for (wy = MAX (y - cg->radius, 0); wy <= MIN (y + cg->radius, roi->height - 1); ++wy)
+          for (wx = MAX (x - cg->radius, 0); wx <= MIN (x + cg->radius, roi->width - 1); ++wx)
+            {
+              gint          k      = wx + wy * roi->width;
+              const gfloat *mean   = cg->mean   + k * COMPONENTS_INPUT;
+              const gfloat *window = cg->window + k * COMPONENTS_WINDOW;
+
+              if (!matting_cg_window_active (cg, wx, wy))
+                continue;
+
+              acc += window[0] +
+                     (pixel[0] - mean[0]) * window[1] +
+                     (pixel[1] - mean[1]) * window[2] +
+                     (pixel[2] - mean[2]) * window[3];
+            }
+
+        cg->out[i] = cg->diagonal[i] * cg->in[i] - acc / cg->window_elems;
+        sums[0]   += cg->in[i] * cg->out[i];
+      }
+}
+
+/* Set up the residual and the first direction from the initial guess */
+static void
+matting_cg_start (MattingCG *cg,
+                  gint       y0,
+                  gint       y1,
+                  gdouble    sums[2])
+{
+  gint i;
+
+  for (i = y0 * cg->roi->width; i < y1 * cg->roi->width; ++i)
+    {
+      gdouble rhs = matting_cg_rhs (cg, i);
+
+      cg->r[i] = rhs - cg->ap[i];
+      cg->z[i] = cg->precond[i] * cg->r[i];
+      cg->p[i] = cg->z[i];
+
+      sums[0] += cg->r[i] * cg->z[i];
+      sums[1] += rhs * rhs;
+    }
+}
+
+static void
+matting_cg_update (MattingCG *cg,
+                   gint       y0,
+                   gint       y1,
+                   gdouble    sums[2])
+{
+  gint i;
+
+  for (i = y0 * cg->roi->width; i < y1 * cg->roi->width; ++i)
+    {
+      cg->x[i] += cg->alpha * cg->p[i];
+      cg->r[i] -= cg->alpha * cg->ap[i];
+      cg->z[i]  = cg->precond[i] * cg->r[i];
+
+      sums[0] += cg->r[i] * cg->z[i];
+      sums[1] += cg->r[i] * cg->r[i];
+    }
+}
+
+static void
+matting_cg_direction (MattingCG *cg,
+                      gint       y0,
+                      gint       y1,
+                      gdouble    sums[2])
+{
+  gint i;
+
+  for (i = y0 * cg->roi->width; i < y1 * cg->roi->width; ++i)
+    cg->p[i] = cg->z[i] + cg->beta * cg->p[i];
+}
+
+typedef struct
+{
+  MattingCGFunc  func;
+  MattingCG     *cg;
+  gint           y0,
+                 y1;
+  gdouble        sums[2];
+  gint          *pending;
+} MattingThreadData;
+
+static void
+matting_thread_process (gpointer thread_data,
+                        gpointer unused)
+{
+  MattingThreadData *data = thread_data;
+
+  data->func (data->cg, data->y0, data->y1, data->sums);
+  g_atomic_int_add (data->pending, -1);
+}
+
+static GThreadPool *
+matting_thread_pool (void)
+{
+  static GThreadPool *pool = NULL;
+  if (!pool)
+    {
+      pool = g_thread_pool_new (matting_thread_process, NULL,
+                                gegl_config_threads (), FALSE, NULL);
+    }
+  return pool;
+}
+
+/* Run func over all the rows, in bands spread over the GEGL threads, and
+ * return the totals of the partial sums of the bands in sums.
+ */
+static void
+matting_cg_parallel (MattingCG     *cg,
+                     MattingCGFunc  func,
+                     gdouble        sums[2])
+{
+  MattingThreadData thread_data[GEGL_MAX_THREADS];
+  gint              height  = cg->roi->height;
+  gint              threads = CLAMP (height / 16, 1, gegl_config_threads ());
+  gint              pending = threads;
+  gint              i;
+
+  for (i = 0; i < threads; ++i)
+    {
+      thread_data[i].func    = func;
+      thread_data[i].cg      = cg;
+      thread_data[i].y0      = height * i / threads;
+      thread_data[i].y1      = height * (i + 1) / threads;
+      thread_data[i].sums[0] = 0.0;
+      thread_data[i].sums[1] = 0.0;
+      thread_data[i].pending = &pending;
+    }
+
+  for (i = 1; i < threads; ++i)
+    g_thread_pool_push (matting_thread_pool (), &thread_data[i], NULL);
+  matting_thread_process (&thread_data[0], NULL);
+
+  while (g_atomic_int_get (&pending)) {};
+
+  if (sums)
+    {
+      sums[0] = sums[1] = 0.0;
+      for (i = 0; i < threads; ++i)
+        {
+          sums[0] += thread_data[i].sums[0];
+          sums[1] += thread_data[i].sums[1];
+        }
+    }
+}
+
+/* Apply the laplacian to in, storing it in out, returns in . out */
+static gdouble
+matting_cg_laplacian (MattingCG    *cg,
+                      const gfloat *in,
+                      gfloat       *out)
+{
+  gdouble sums[2];
+
+  cg->in  = in;
+  cg->out = out;
+  matting_cg_parallel (cg, matting_cg_windows, NULL);
+  matting_cg_parallel (cg, matting_cg_apply, sums);
+
+  return sums[0];
+}
+
+/* Solve the matting laplacian without building it, see MattingCG. The
+ * solution is used as the initial guess.
+ */
+static gboolean
+matting_solve_cg (const gdouble       *restrict image,
+                  const gdouble       *restrict trimap,
+                  gdouble             *restrict solution,
+                  const GeglRectangle *restrict roi,
+                  gint                 radius,
+                  gdouble              epsilon,
+                  gdouble              lambda)
+{
+  MattingCG cg;
+  guint     image_elems, i;
+  gdouble   sums[2],
+            rz, rhs_norm,
+            pap;
+  gint      iteration;
+
+  g_return_val_if_fail (image,    FALSE);
+  g_return_val_if_fail (trimap,   FALSE);
+  g_return_val_if_fail (solution, FALSE);
+
+  g_return_val_if_fail (roi,      FALSE);
+  g_return_val_if_fail (!gegl_rectangle_is_empty (roi), FALSE);
+  image_elems = roi->width * roi->height;
+
+  cg.roi          = roi;
+  cg.image        = image;
+  cg.trimap       = trimap;
+  cg.radius       = radius;
+  cg.window_elems = (radius * 2 + 1) * (radius * 2 + 1);
+  cg.epsilon      = epsilon;
+  cg.lambda       = lambda;
+
+  cg.mean     = g_new (gfloat, image_elems * COMPONENTS_INPUT);
+  cg.inverse  = g_new (gfloat, image_elems * COMPONENTS_INVERSE);
+  cg.window   = g_new (gfloat, image_elems * COMPONENTS_WINDOW);
+  cg.diagonal = g_new (gfloat, image_elems);
+  cg.precond  = g_new (gfloat, image_elems);
+  cg.x        = g_new (gfloat, image_elems);
+  cg.r        = g_new (gfloat, image_elems);
+  cg.z        = g_new (gfloat, image_elems);
+  cg.p        = g_new (gfloat, image_elems);
+  cg.ap       = g_new (gfloat, image_elems);
+
+  for (i = 0; i < image_elems; ++i)
+    cg.x[i] = solution[i];
+
+  matting_cg_parallel (&cg, matting_cg_statistics, NULL);
+  matting_cg_parallel (&cg, matting_cg_diagonal, NULL);
+
+  matting_cg_laplacian (&cg, cg.x, cg.ap);
+  matting_cg_parallel  (&cg, matting_cg_start, sums);
+  rz       = sums[0];
+  rhs_norm = sums[1];
+
+  for (iteration = 0; iteration < CG_MAX_ITERATIONS; ++iteration)
+    {
+      pap = matting_cg_laplacian (&cg, cg.p, cg.ap);
+      if (pap <= 0.0)
+        break;
+
+      cg.alpha = rz / pap;
+      matting_cg_parallel (&cg, matting_cg_update, sums);
+
+      if (sums[1] <= CG_TOLERANCE * CG_TOLERANCE * rhs_norm)
+        break;
+
+      cg.beta = sums[0] / rz;
+      rz      = sums[0];
+      matting_cg_parallel (&cg, matting_cg_direction, NULL);
+    }
+
+  GEGL_NOTE (GEGL_DEBUG_PROCESS,
+             "conjugate gradient stopped after %d iterations for %dx%d\n",
+             iteration, roi->width, roi->height);
+
+  /* Courtesy clamping of the solution to normal alpha range */
+  for (i = 0; i < image_elems; ++i)
+    solution[i] = CLAMP (cg.x[i], 0.0, 1.0);
+
+  g_free (cg.mean);
+  g_free (cg.inverse);
+  g_free (cg.window);
+  g_free (cg.diagonal);
+  g_free (cg.precond);
+  g_free (cg.x);
+  g_free (cg.r);
+  g_free (cg.z);
+  g_free (cg.p);
+  g_free (cg.ap);
+
+  return TRUE;
+}
+
+
 /* Recursively downsample, solve, then upsample the matting laplacian.
  * Perform up to `levels' recursions (provided the image remains large
  * enough), with up to `active_levels' number of full laplacian solves (not
  * just extrapolation).
  */
 static gdouble *
-matting_solve_level (gdouble             *restrict pixels,
-                     gdouble             *restrict trimap,
-                     const GeglRectangle *restrict region,
-                     guint                active_levels,
-                     guint                levels,
-                     guint                radius,
-                     gdouble              epsilon,
-                     gdouble              lambda,
-                     gdouble              threshold)
+matting_solve_level (gdouble               *restrict pixels,
+                     gdouble               *restrict trimap,
+                     const GeglRectangle   *restrict region,
+                     guint                  active_levels,
+                     guint                  levels,
+                     guint                  radius,
+                     gdouble                epsilon,
+                     gdouble                lambda,
+                     gdouble                threshold,
+                     GeglMattingLevinSolver solver)
 {
   gint     i;
   gdouble *new_alpha    = NULL,
@@ -1326,7 +1854,7 @@ matting_solve_level (gdouble             *restrict pixels,
       small_alpha = matting_solve_level (small_pixels, small_trimap,
                                          &small_region, active_levels,
                                          levels - 1, radius, epsilon,
-                                         lambda, threshold);
+                                         lambda, threshold, solver);
 
       new_alpha = matting_upsample_alpha (small_pixels, pixels, small_alpha,
                                           &small_region, region, epsilon,
@@ -1360,8 +1888,24 @@ matting_solve_level (gdouble             *restrict pixels,
       g_free (eroded_alpha);
     }
 
+  /* Iterative solution, warm started from the coarser level's solution
+   * when there is one, or else from the trimap.
+   */
+  if ((active_levels >= levels || levels == 0) &&
+      solver == GEGL_MATTING_LEVIN_SOLVER_CG)
+    {
+      if (!new_alpha)
+        {
+          new_alpha = g_new (gdouble, region->width * region->height);
+          for (i = 0; i < region->width * region->height; ++i)
+            new_alpha[i] = trimap[i * COMPONENTS_AUX + AUX_VALUE];
+        }
+
+      matting_solve_cg (pixels, trimap, new_alpha, region, radius, epsilon,
+                        lambda);
+    }
   /* Ordinary solution of the matting laplacian */
-  if (active_levels >= levels || levels == 0)
+  else if (active_levels >= levels || levels == 0)
     {
       sparse_t *laplacian;
       g_free (new_alpha);
@@ -1419,7 +1963,7 @@ matting_process (GeglOperation       *operation,
   output = matting_solve_level (input, trimap, result,
                                 MIN (o->active_levels, o->levels), o->levels,
                                 o->radius, powf (10, o->epsilon), o->lambda,
-                                o->threshold);
+                                o->threshold, o->solver);
   gegl_buffer_set (output_buf, result, 0, babl_format (FORMAT_OUTPUT), output,
                    GEGL_AUTO_ROWSTRIDE);
 
@@ -1447,6 +1991,8 @@ gegl_op_class_init (GeglOpClass *klass)
   operation_class->prepare                 = matting_prepare;
   operation_class->get_required_for_output = matting_get_required_for_output;
   operation_class->get_cached_region       = matting_get_cached_region;
+  /* the solution is global to the image, the solver threads by itself */
+  operation_class->threaded                = FALSE;
 
   gegl_operation_class_set_keys (operation_class,
   "name",         "gegl:matting-levin",
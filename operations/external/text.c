@@ -55,6 +55,7 @@ property_int    (height, _("Height"), 0)
 #include <cairo.h>
 #include <pango/pango-attributes.h>
 #include <pango/pangocairo.h>
+#include <math.h>
 
 /* XXX: this struct is unneeded and could be folded directly into
  * struct _GeglOp
@@ -88,30 +89,108 @@ GEGL_DEFINE_DYNAMIC_OPERATION (GEGL_TYPE_OPERATION_SOURCE)
 
 
 
-static void text_layout_text (GeglOp *self,
-                              cairo_t   *cr,
-                              gdouble    rowstride,
-                              gdouble   *width,
-                              gdouble   *height)
+/* Layouts are shared by all text operations rendering on a thread and
+ * looked up by everything that affects them, so that a label rendered
+ * again, in another tile, frame or node, is not laid out again. The color
+ * is not part of the layout, it is the cairo source the layout is shown
+ * with.
+ */
+typedef struct {
+  gchar       *string;
+  gchar       *font;
+  gdouble      size;
+  gint         wrap;
+  gint         alignment;
+  PangoLayout *layout;
+} CachedLayout;
+
+#define LAYOUT_CACHE_SIZE 32
+
+static void
+cached_layout_free (CachedLayout *cached)
 {
-  GeglProperties           *o = GEGL_PROPERTIES (self);
+  g_object_unref (cached->layout);
+  g_free (cached->string);
+  g_free (cached->font);
+  g_slice_free (CachedLayout, cached);
+}
+
+static void
+layout_cache_free (gpointer data)
+{
+  g_queue_free_full (data, (GDestroyNotify) cached_layout_free);
+}
+
+/* the cached layouts of a thread, most recently used first; neither pango
+ * layouts nor font maps are thread safe and pango-cairo's default font map
+ * is per thread, so each thread lays out and renders with its own
+ */
+static GPrivate layout_cache_key = G_PRIVATE_INIT (layout_cache_free);
+
+static GQueue *
+text_get_layout_cache (void)
+{
+  GQueue *layout_cache = g_private_get (&layout_cache_key);
+
+  if (!layout_cache)
+    {
+      layout_cache = g_queue_new ();
+      g_private_set (&layout_cache_key, layout_cache);
+    }
+
+  return layout_cache;
+}
+
+static PangoLayout *
+text_get_layout (GeglProperties *o)
+{
+  GQueue               *layout_cache = text_get_layout_cache ();
+  CachedLayout         *cached;
   PangoFontDescription *desc;
-  PangoLayout    *layout;
-  PangoAttrList  *attrs;
-  PangoAttribute *attr  = NULL;
-  gchar          *string;
-  gint            alignment = 0;
+  cairo_surface_t      *surface;
+  cairo_t              *cr;
+  gchar                *string;
+  GList                *link;
+  gint                  alignment = 0;
+
+  for (link = layout_cache->head; link; link = link->next)
+    {
+      cached = link->data;
+
+      if (!strcmp (cached->string, o->string) &&
+          !strcmp (cached->font, o->font) &&
+          cached->size == o->size &&
+          cached->wrap == o->wrap &&
+          cached->alignment == o->alignment)
+        {
+          g_queue_unlink (layout_cache, link);
+          g_queue_push_head_link (layout_cache, link);
+          return cached->layout;
+        }
+    }
+
+  cached = g_slice_new (CachedLayout);
+  cached->string    = g_strdup (o->string);
+  cached->font      = g_strdup (o->font);
+  cached->size      = o->size;
+  cached->wrap      = o->wrap;
+  cached->alignment = o->alignment;
 
   /* Create a PangoLayout, set the font and text */
-  layout = pango_cairo_create_layout (cr);
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, 1, 1);
+  cr = cairo_create (surface);
+  cached->layout = pango_cairo_create_layout (cr);
+  cairo_destroy (cr);
+  cairo_surface_destroy (surface);
 
   string = g_strcompress (o->string);
-  pango_layout_set_text (layout, string, -1);
+  pango_layout_set_text (cached->layout, string, -1);
   g_free (string);
 
   desc = pango_font_description_from_string (o->font);
   pango_font_description_set_absolute_size (desc, o->size * PANGO_SCALE);
-  pango_layout_set_font_description (layout, desc);
+  pango_layout_set_font_description (cached->layout, desc);
+  pango_font_description_free (desc);
 
   switch (o->alignment)
   {
@@ -125,55 +204,49 @@ static void text_layout_text (GeglOp *self,
     alignment = PANGO_ALIGN_RIGHT;
     break;
   }
-  pango_layout_set_alignment (layout, alignment);
-  pango_layout_set_width (layout, o->wrap * PANGO_SCALE);
+  pango_layout_set_alignment (cached->layout, alignment);
+  pango_layout_set_width (cached->layout, o->wrap * PANGO_SCALE);
 
-  attrs = pango_attr_list_new ();
-  if (attrs)
-  {
-    guint16 color[3];
-
-    gegl_color_get_pixel (o->color, babl_format ("R'G'B' u16"), color);
-    attr = pango_attr_foreground_new (color[0], color[1], color[2]);
-
-    if (attr)
-      {
-        attr->start_index = 0;
-        attr->end_index   = -1;
-        pango_attr_list_insert (attrs, attr);
-        pango_layout_set_attributes (layout, attrs);
-      }
-  }
+  g_queue_push_head (layout_cache, cached);
+  if (g_queue_get_length (layout_cache) > LAYOUT_CACHE_SIZE)
+    cached_layout_free (g_queue_pop_tail (layout_cache));
 
-  /* Inform Pango to re-layout the text with the new transformation */
-  pango_cairo_update_layout (cr, layout);
+  return cached->layout;
+}
 
-  if (width && height)
-    {
-      int w, h;
+/* Show the lines of @layout, placed at @x, that have ink in @rect */
+static void
+text_show_lines (PangoLayout         *layout,
+                 cairo_t             *cr,
+                 gdouble              x,
+                 const GeglRectangle *rect)
+{
+  PangoLayoutIter *iter = pango_layout_get_iter (layout);
 
-      pango_layout_get_pixel_size (layout, &w, &h);
-      *width = (gdouble)w;
-      *height = (gdouble)h;
-    }
-  else
+  do
     {
-      /* FIXME: This feels like a hack but it stops the rendered text  */
-      /* from shifting position depending on the value of 'alignment'. */
-      if (o->alignment == 1)
-         cairo_move_to (cr, o->width / 2, 0);
-      else
+      PangoRectangle ink;
+      PangoRectangle logical;
+
+      pango_layout_iter_get_line_extents (iter, &ink, &logical);
+      pango_extents_to_pixels (&ink, NULL);
+
+      if (x + ink.x < rect->x + rect->width &&
+          x + ink.x + ink.width > rect->x &&
+          ink.y < rect->y + rect->height &&
+          ink.y + ink.height > rect->y)
         {
-          if (o->alignment == 2)
-             cairo_move_to (cr, o->width, 0);
+          cairo_move_to (cr,
+                         x + (gdouble) logical.x / PANGO_SCALE,
+                         (gdouble) pango_layout_iter_get_baseline (iter) /
+                         PANGO_SCALE);
+          pango_cairo_show_layout_line (cr,
+                                        pango_layout_iter_get_line_readonly (iter));
         }
-
-      pango_cairo_show_layout (cr, layout);
     }
+  while (pango_layout_iter_next_line (iter));
 
-  pango_font_description_free (desc);
-  pango_attr_list_unref (attrs);
-  g_object_unref (layout);
+  pango_layout_iter_free (iter);
 }
 
 static gboolean
@@ -182,21 +255,48 @@ process (GeglOperation       *operation,
          const GeglRectangle *result,
          gint                 level)
 {
-  GeglOp *self = GEGL_OP (operation);
-
-  guchar          *data = g_new0 (guchar, result->width * result->height * 4);
+  GeglProperties  *o = GEGL_PROPERTIES (operation);
+  PangoLayout     *layout;
+  PangoRectangle   ink;
+  GeglRectangle    inked;
+  gdouble          x = 0.0;
+  gdouble          color[3];
+  guchar          *data;
   cairo_t         *cr;
   cairo_surface_t *surface;
 
+  /* FIXME: This feels like a hack but it stops the rendered text  */
+  /* from shifting position depending on the value of 'alignment'. */
+  if (o->alignment == 1)
+    x = o->width / 2;
+  else if (o->alignment == 2)
+    x = o->width;
+
+  layout = text_get_layout (o);
+  pango_layout_get_pixel_extents (layout, &ink, NULL);
+
+  inked.x      = floor (x) + ink.x;
+  inked.y      = ink.y;
+  inked.width  = ink.width + 1;
+  inked.height = ink.height;
+
+  if (!gegl_rectangle_intersect (NULL, &inked, result))
+    {
+      gegl_buffer_clear (output, result);
+      return TRUE;
+    }
+
+  data = g_new0 (guchar, result->width * result->height * 4);
   surface = cairo_image_surface_create_for_data (data,
                                                  CAIRO_FORMAT_ARGB32,
                                                  result->width,
                                                  result->height,
                                                  result->width * 4);
   cr = cairo_create (surface);
-  cairo_set_source_rgba (cr, 1.0, 1.0, 1.0, 1.0);
+  gegl_color_get_pixel (o->color, babl_format ("R'G'B' double"), color);
+  cairo_set_source_rgb (cr, color[0], color[1], color[2]);
   cairo_translate (cr, -result->x, -result->y);
-  text_layout_text (self, cr, 0, NULL, NULL);
+  text_show_lines (layout, cr, x, result);
 
   gegl_buffer_set (output, result, 0, babl_format ("B'aG'aR'aA u8"), data,
                    GEGL_AUTO_ROWSTRIDE);
@@ -231,15 +331,9 @@ get_bounding_box (GeglOperation *operation)
       extent->wrap != o->wrap ||
       extent->alignment != o->alignment)
     { /* get extents */
-      cairo_t *cr;
-      gdouble width, height;
-
-      cairo_surface_t *surface  = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
-          1, 1);
-      cr = cairo_create (surface);
-      text_layout_text (self, cr, 0, &width, &height);
-      cairo_destroy (cr);
-      cairo_surface_destroy (surface);
+      gint width, height;
+
+      pango_layout_get_pixel_size (text_get_layout (o), &width, &height);
 
       extent->defined.width = width;
       extent->defined.height = height;
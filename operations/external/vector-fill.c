@@ -54,7 +54,9 @@ static void path_changed (GeglPath *path,
                           gpointer userdata);
 
 #include "gegl-op.h"
+#include "gegl-config.h"
 #include <cairo.h>
+#include <math.h>
 
 static void path_changed (GeglPath *path,
                           const GeglRectangle *roi,
@@ -114,6 +116,236 @@ get_bounding_box (GeglOperation *operation)
 static void gegl_path_cairo_play (GeglPath *path,
                                     cairo_t *cr);
 
+/* A segment of the flattened path, clipped to the tile row it is binned
+ * in. Clipping keeps the rendering of every row exact: the pieces of a
+ * subpath that lie above or below the row are replaced by horizontal
+ * lines along its edges, which do not change the winding of any scanline
+ * within it.
+ */
+typedef struct
+{
+  gdouble x0, y0;
+  gdouble x1, y1;
+  gint    subpath;
+} FillSegment;
+
+typedef struct
+{
+  GeglRectangle rect;
+  gint          tile_height;
+  gint          first_row;
+  gint          n_rows;
+  GArray      **rows;
+} FillBins;
+
+/* The path flattens itself lazily, which is not thread safe. This also
+ * guards the list of bins being rendered, kept in the user_data of the
+ * operation.
+ */
+static GMutex bins_mutex;
+
+static gint
+fill_bins_row (FillBins *bins,
+               gdouble   y)
+{
+  return floor (y / bins->tile_height);
+}
+
+static void
+fill_bins_add (FillBins *bins,
+               gint      subpath,
+               gdouble   x0,
+               gdouble   y0,
+               gdouble   x1,
+               gdouble   y1)
+{
+  gdouble min_y = MIN (y0, y1);
+  gdouble max_y = MAX (y0, y1);
+  gdouble slope;
+  gint    first, last, row;
+
+  if (y0 == y1)
+    return;
+
+  first = MAX (fill_bins_row (bins, min_y), bins->first_row);
+  last  = MIN (fill_bins_row (bins, max_y), bins->first_row + bins->n_rows - 1);
+  slope = (x1 - x0) / (y1 - y0);
+
+  for (row = first; row <= last; row++)
+    {
+      gdouble     top    = (gdouble) row * bins->tile_height;
+      gdouble     bottom = top + bins->tile_height;
+      gdouble     from   = MAX (min_y, top);
+      gdouble     to     = MIN (max_y, bottom);
+      FillSegment segment;
+
+      if (to <= from)
+        continue;
+
+      if (y0 > y1)
+        {
+          gdouble tmp = from;
+          from = to;
+          to   = tmp;
+        }
+
+      segment.x0      = x0 + (from - y0) * slope;
+      segment.y0      = from;
+      segment.x1      = x0 + (to - y0) * slope;
+      segment.y1      = to;
+      segment.subpath = subpath;
+
+      if (!bins->rows[row - bins->first_row])
+        bins->rows[row - bins->first_row] =
+          g_array_new (FALSE, FALSE, sizeof (FillSegment));
+      g_array_append_val (bins->rows[row - bins->first_row], segment);
+    }
+}
+
+/* Bin the segments of the flattened @path by the tile rows that @result
+ * spans. Every subpath is closed, as cairo_fill() does.
+ */
+static void
+fill_bins_init (FillBins            *bins,
+                GeglPathList        *path,
+                const GeglRectangle *result)
+{
+  gint     subpath   = 0;
+  gboolean has_point = FALSE;
+  gboolean open      = FALSE;
+  gdouble  start_x = 0, start_y = 0;
+  gdouble  x = 0, y = 0;
+
+  bins->rect        = *result;
+  bins->tile_height = gegl_config ()->tile_height;
+  bins->first_row = fill_bins_row (bins, result->y);
+  bins->n_rows    = fill_bins_row (bins, result->y + result->height - 1) -
+                    bins->first_row + 1;
+  bins->rows      = g_new0 (GArray *, bins->n_rows);
+
+  for (; path; path = path->next)
+    {
+      const GeglPathItem *knot = &path->d;
+
+      switch (knot->type)
+        {
+          case 'M':
+            if (open)
+              fill_bins_add (bins, subpath, x, y, start_x, start_y);
+            subpath++;
+            start_x = x = knot->point[0].x;
+            start_y = y = knot->point[0].y;
+            has_point = open = TRUE;
+            break;
+          case 'L':
+            if (!has_point)
+              {
+                subpath++;
+                start_x = x = knot->point[0].x;
+                start_y = y = knot->point[0].y;
+                has_point = open = TRUE;
+                break;
+              }
+            if (!open)
+              {
+                subpath++;
+                start_x = x;
+                start_y = y;
+                open = TRUE;
+              }
+            fill_bins_add (bins, subpath, x, y,
+                           knot->point[0].x, knot->point[0].y);
+            x = knot->point[0].x;
+            y = knot->point[0].y;
+            break;
+          case 'z':
+            if (open)
+              fill_bins_add (bins, subpath, x, y, start_x, start_y);
+            x = start_x;
+            y = start_y;
+            open = FALSE;
+            break;
+          default:
+            break;
+        }
+    }
+
+  if (open)
+    fill_bins_add (bins, subpath, x, y, start_x, start_y);
+}
+
+static void
+fill_bins_destroy (FillBins *bins)
+{
+  gint i;
+
+  for (i = 0; i < bins->n_rows; i++)
+    if (bins->rows[i])
+      g_array_free (bins->rows[i], TRUE);
+  g_free (bins->rows);
+}
+
+/* The bins made for the whole result of the process call @rect is part
+ * of, to be called with bins_mutex held.
+ */
+static FillBins *
+fill_bins_lookup (GeglProperties      *o,
+                  const GeglRectangle *rect)
+{
+  GSList *iter;
+
+  for (iter = o->user_data; iter; iter = iter->next)
+    {
+      FillBins *bins = iter->data;
+
+      if (gegl_rectangle_contains (&bins->rect, rect))
+        return bins;
+    }
+
+  return NULL;
+}
+
+/* Add the segments binned in the tile rows @rect spans to the path of @cr */
+static void
+fill_bins_play (FillBins            *bins,
+                const GeglRectangle *rect,
+                cairo_t             *cr)
+{
+  gint first = MAX (fill_bins_row (bins, rect->y), bins->first_row);
+  gint last  = MIN (fill_bins_row (bins, rect->y + rect->height - 1),
+                    bins->first_row + bins->n_rows - 1);
+  gint row;
+
+  for (row = first; row <= last; row++)
+    {
+      GArray *segments = bins->rows[row - bins->first_row];
+      gint    subpath  = -1;
+      guint   i;
+
+      if (!segments)
+        continue;
+
+      for (i = 0; i < segments->len; i++)
+        {
+          FillSegment *segment = &g_array_index (segments, FillSegment, i);
+
+          if (segment->subpath != subpath)
+            {
+              if (subpath != -1)
+                cairo_close_path (cr);
+              cairo_move_to (cr, segment->x0, segment->y0);
+              subpath = segment->subpath;
+            }
+          else
+            {
+              cairo_line_to (cr, segment->x0, segment->y0);
+            }
+          cairo_line_to (cr, segment->x1, segment->y1);
+        }
+      cairo_close_path (cr);
+    }
+}
+
 static gboolean
 process (GeglOperation       *operation,
          GeglBuffer          *input,
@@ -143,37 +375,99 @@ process (GeglOperation       *operation,
         need_fill=TRUE;
     }
 
-  if (need_fill)
+  if (need_fill && o->d)
     {
-      static GMutex mutex = { 0, };
-      cairo_t *cr;
-      cairo_surface_t *surface;
-      guchar *data;
-
-      g_mutex_lock (&mutex);
-      data = gegl_buffer_linear_open (output, result, NULL, babl_format ("cairo-ARGB32"));
-      surface = cairo_image_surface_create_for_data (data,
-                                                     CAIRO_FORMAT_ARGB32,
-                                                     result->width,
-                                                     result->height,
-                                                     result->width * 4);
-
-      cr = cairo_create (surface);
-      cairo_translate (cr, -result->x, -result->y);
-      if (g_str_equal (o->fill_rule, "evenodd"))
-          cairo_set_fill_rule (cr, CAIRO_FILL_RULE_EVEN_ODD);
-
-      gegl_path_cairo_play (o->d, cr);
-      cairo_set_source_rgba (cr, color[0], color[1], color[2], color[3]);
-      cairo_fill (cr);
-      cairo_destroy (cr);
-
-      gegl_buffer_linear_close (output, data);
-      g_mutex_unlock (&mutex);
+      GeglBufferIterator *iter;
+      FillBins            own_bins;
+      FillBins           *bins;
+
+      /* The bins are only read from here on, and rendered without a lock */
+      g_mutex_lock (&bins_mutex);
+      bins = fill_bins_lookup (o, result);
+      if (!bins)
+        {
+          fill_bins_init (&own_bins, gegl_path_get_flat_path (o->d), result);
+          bins = &own_bins;
+        }
+      g_mutex_unlock (&bins_mutex);
+
+      iter = gegl_buffer_iterator_new (output, result, 0,
+                                       babl_format ("cairo-ARGB32"),
+                                       GEGL_ACCESS_READWRITE, GEGL_ABYSS_NONE);
+
+      while (gegl_buffer_iterator_next (iter))
+        {
+          const GeglRectangle *roi = &iter->roi[0];
+          cairo_t             *cr;
+          cairo_surface_t     *surface;
+
+          surface = cairo_image_surface_create_for_data (iter->data[0],
+                                                         CAIRO_FORMAT_ARGB32,
+                                                         roi->width,
+                                                         roi->height,
+                                                         roi->width * 4);
+
+          cr = cairo_create (surface);
+          cairo_translate (cr, -roi->x, -roi->y);
+          if (g_str_equal (o->fill_rule, "evenodd"))
+              cairo_set_fill_rule (cr, CAIRO_FILL_RULE_EVEN_ODD);
+
+          fill_bins_play (bins, roi, cr);
+          cairo_set_source_rgba (cr, color[0], color[1], color[2], color[3]);
+          cairo_fill (cr);
+          cairo_destroy (cr);
+          cairo_surface_destroy (surface);
+        }
+
+      if (bins == &own_bins)
+        fill_bins_destroy (&own_bins);
     }
   return  TRUE;
 }
 
+/* Bin the path once for the whole result, rather than in each of the
+ * threads the filter base class splits it among.
+ */
+static gboolean
+operation_process (GeglOperation        *operation,
+                   GeglOperationContext *context,
+                   const gchar          *output_prop,
+                   const GeglRectangle  *result,
+                   gint                  level)
+{
+  GeglProperties     *o = GEGL_PROPERTIES (operation);
+  GeglOperationClass *operation_class;
+  FillBins           *bins = NULL;
+  gboolean            success;
+
+  operation_class = GEGL_OPERATION_CLASS (gegl_op_parent_class);
+
+  if (o->d)
+    {
+      bins = g_slice_new (FillBins);
+
+      g_mutex_lock (&bins_mutex);
+      fill_bins_init (bins, gegl_path_get_flat_path (o->d), result);
+      o->user_data = g_slist_prepend (o->user_data, bins);
+      g_mutex_unlock (&bins_mutex);
+    }
+
+  success = operation_class->process (operation, context, output_prop, result,
+                                      level);
+
+  if (bins)
+    {
+      g_mutex_lock (&bins_mutex);
+      o->user_data = g_slist_remove (o->user_data, bins);
+      g_mutex_unlock (&bins_mutex);
+
+      fill_bins_destroy (bins);
+      g_slice_free (FillBins, bins);
+    }
+
+  return success;
+}
+
 static void foreach_cairo (const GeglPathItem *knot,
                            gpointer              cr)
 {
@@ -266,6 +560,7 @@ gegl_op_class_init (GeglOpClass *klass)
   filter_class    = GEGL_OPERATION_FILTER_CLASS (klass);
 
   filter_class->process = process;
+  operation_class->process = operation_process;
   operation_class->get_bounding_box = get_bounding_box;
   operation_class->prepare = prepare;
   operation_class->detect = detect;
@@ -55,7 +55,9 @@ static void path_changed (GeglPath *path,
                           gpointer userdata);
 
 #include "gegl-op.h"
+#include "gegl-config.h"
 #include <cairo.h>
+#include <math.h>
 
 static void path_changed (GeglPath *path,
                           const GeglRectangle *roi,
@@ -142,6 +144,200 @@ get_cached_region (GeglOperation *operation)
 static void gegl_path_cairo_play (GeglPath *path,
                                     cairo_t *cr);
 
+/* A segment of the flattened path. With round joins and caps a stroke is
+ * the union of the strokes of its segments, so each tile row only needs
+ * the segments that come within half the line width of it; consecutive
+ * segments are kept together to render the joins between them.
+ */
+typedef struct
+{
+  gdouble x0, y0;
+  gdouble x1, y1;
+  gint    index;
+} StrokeSegment;
+
+typedef struct
+{
+  GeglRectangle rect;
+  gint          tile_height;
+  gint          first_row;
+  gint          n_rows;
+  gdouble       margin;
+  GArray      **rows;
+} StrokeBins;
+
+/* The path flattens itself lazily, which is not thread safe. This also
+ * guards the list of bins being rendered, kept in the user_data of the
+ * operation.
+ */
+static GMutex bins_mutex;
+
+static gint
+stroke_bins_row (StrokeBins *bins,
+                 gdouble     y)
+{
+  return floor (y / bins->tile_height);
+}
+
+static void
+stroke_bins_add (StrokeBins *bins,
+                 gint        index,
+                 gdouble     x0,
+                 gdouble     y0,
+                 gdouble     x1,
+                 gdouble     y1)
+{
+  StrokeSegment segment = { x0, y0, x1, y1, index };
+  gint          first, last, row;
+
+  first = MAX (stroke_bins_row (bins, MIN (y0, y1) - bins->margin),
+               bins->first_row);
+  last  = MIN (stroke_bins_row (bins, MAX (y0, y1) + bins->margin),
+               bins->first_row + bins->n_rows - 1);
+
+  for (row = first; row <= last; row++)
+    {
+      if (!bins->rows[row - bins->first_row])
+        bins->rows[row - bins->first_row] =
+          g_array_new (FALSE, FALSE, sizeof (StrokeSegment));
+      g_array_append_val (bins->rows[row - bins->first_row], segment);
+    }
+}
+
+/* Bin the segments of the flattened @path by the tile rows that @result
+ * spans. Segment indices are only consecutive within a subpath.
+ */
+static void
+stroke_bins_init (StrokeBins          *bins,
+                  GeglPathList        *path,
+                  gdouble              line_width,
+                  const GeglRectangle *result)
+{
+  gint     index     = 0;
+  gboolean has_point = FALSE;
+  gboolean open      = FALSE;
+  gdouble  start_x = 0, start_y = 0;
+  gdouble  x = 0, y = 0;
+
+  bins->rect        = *result;
+  bins->tile_height = gegl_config ()->tile_height;
+
+  /* one more pixel for antialiasing */
+  bins->margin    = line_width / 2 + 1;
+  bins->first_row = stroke_bins_row (bins, result->y);
+  bins->n_rows    = stroke_bins_row (bins, result->y + result->height - 1) -
+                    bins->first_row + 1;
+  bins->rows      = g_new0 (GArray *, bins->n_rows);
+
+  for (; path; path = path->next)
+    {
+      const GeglPathItem *knot = &path->d;
+
+      switch (knot->type)
+        {
+          case 'M':
+            index++;
+            start_x = x = knot->point[0].x;
+            start_y = y = knot->point[0].y;
+            has_point = open = TRUE;
+            break;
+          case 'L':
+            if (!has_point)
+              {
+                index++;
+                start_x = x = knot->point[0].x;
+                start_y = y = knot->point[0].y;
+                has_point = open = TRUE;
+                break;
+              }
+            if (!open)
+              {
+                index++;
+                start_x = x;
+                start_y = y;
+                open = TRUE;
+              }
+            stroke_bins_add (bins, index++, x, y,
+                             knot->point[0].x, knot->point[0].y);
+            x = knot->point[0].x;
+            y = knot->point[0].y;
+            break;
+          case 'z':
+            if (open)
+              stroke_bins_add (bins, index++, x, y, start_x, start_y);
+            x = start_x;
+            y = start_y;
+            open = FALSE;
+            break;
+          default:
+            break;
+        }
+    }
+}
+
+static void
+stroke_bins_destroy (StrokeBins *bins)
+{
+  gint i;
+
+  for (i = 0; i < bins->n_rows; i++)
+    if (bins->rows[i])
+      g_array_free (bins->rows[i], TRUE);
+  g_free (bins->rows);
+}
+
+/* The bins made for the whole result of the process call @rect is part
+ * of, to be called with bins_mutex held.
+ */
+static StrokeBins *
+stroke_bins_lookup (GeglProperties      *o,
+                    const GeglRectangle *rect)
+{
+  GSList *iter;
+
+  for (iter = o->user_data; iter; iter = iter->next)
+    {
+      StrokeBins *bins = iter->data;
+
+      if (gegl_rectangle_contains (&bins->rect, rect))
+        return bins;
+    }
+
+  return NULL;
+}
+
+/* Add the segments binned in the tile rows @rect spans to the path of @cr */
+static void
+stroke_bins_play (StrokeBins          *bins,
+                  const GeglRectangle *rect,
+                  cairo_t             *cr)
+{
+  gint first = MAX (stroke_bins_row (bins, rect->y), bins->first_row);
+  gint last  = MIN (stroke_bins_row (bins, rect->y + rect->height - 1),
+                    bins->first_row + bins->n_rows - 1);
+  gint row;
+
+  for (row = first; row <= last; row++)
+    {
+      GArray *segments = bins->rows[row - bins->first_row];
+      gint    index    = -1;
+      guint   i;
+
+      if (!segments)
+        continue;
+
+      for (i = 0; i < segments->len; i++)
+        {
+          StrokeSegment *segment = &g_array_index (segments, StrokeSegment, i);
+
+          if (segment->index != index + 1)
+            cairo_move_to (cr, segment->x0, segment->y0);
+          cairo_line_to (cr, segment->x1, segment->y1);
+          index = segment->index;
+        }
+    }
+}
+
 static gboolean
 process (GeglOperation       *operation,
          GeglBuffer          *input,
@@ -171,39 +367,103 @@ process (GeglOperation       *operation,
           need_stroke=TRUE;
     }
 
-  if (need_stroke)
+  if (need_stroke && o->d)
     {
-      static GMutex mutex = { 0, };
-      cairo_t *cr;
-      cairo_surface_t *surface;
-      guchar *data;
-
-      g_mutex_lock (&mutex);
-      data = gegl_buffer_linear_open (output, result, NULL, babl_format ("cairo-ARGB32"));
-      surface = cairo_image_surface_create_for_data (data,
-                                                     CAIRO_FORMAT_ARGB32,
-                                                     result->width,
-                                                     result->height,
-                                                     result->width * 4);
-
-      cr = cairo_create (surface);
-
-      cairo_translate (cr, -result->x, -result->y);
-
-      cairo_set_line_width  (cr, o->width);
-      cairo_set_line_cap    (cr, CAIRO_LINE_CAP_ROUND);
-      cairo_set_line_join   (cr, CAIRO_LINE_JOIN_ROUND);
-
-      gegl_path_cairo_play (o->d, cr);
-      cairo_set_source_rgba (cr, color[0], color[1], color[2], color[3]);
-      cairo_stroke (cr);
-      cairo_destroy (cr);
-
-      gegl_buffer_linear_close (output, data);
-      g_mutex_unlock (&mutex);
+      GeglBufferIterator *iter;
+      StrokeBins          own_bins;
+      StrokeBins         *bins;
+
+      /* The bins are only read from here on, and rendered without a lock */
+      g_mutex_lock (&bins_mutex);
+      bins = stroke_bins_lookup (o, result);
+      if (!bins)
+        {
+          stroke_bins_init (&own_bins, gegl_path_get_flat_path (o->d),
+                            o->width, result);
+          bins = &own_bins;
+        }
+      g_mutex_unlock (&bins_mutex);
+
+      iter = gegl_buffer_iterator_new (output, result, 0,
+                                       babl_format ("cairo-ARGB32"),
+                                       GEGL_ACCESS_READWRITE, GEGL_ABYSS_NONE);
+
+      while (gegl_buffer_iterator_next (iter))
+        {
+          const GeglRectangle *roi = &iter->roi[0];
+          cairo_t             *cr;
+          cairo_surface_t     *surface;
+
+          surface = cairo_image_surface_create_for_data (iter->data[0],
+                                                         CAIRO_FORMAT_ARGB32,
+                                                         roi->width,
+                                                         roi->height,
+                                                         roi->width * 4);
+
+          cr = cairo_create (surface);
+
+          cairo_translate (cr, -roi->x, -roi->y);
+
+          cairo_set_line_width  (cr, o->width);
+          cairo_set_line_cap    (cr, CAIRO_LINE_CAP_ROUND);
+          cairo_set_line_join   (cr, CAIRO_LINE_JOIN_ROUND);
+
+          stroke_bins_play (bins, roi, cr);
+          cairo_set_source_rgba (cr, color[0], color[1], color[2], color[3]);
+          cairo_stroke (cr);
+          cairo_destroy (cr);
+          cairo_surface_destroy (surface);
+        }
+
+      if (bins == &own_bins)
+        stroke_bins_destroy (&own_bins);
     }
   return  TRUE;
 }
+
+/* Bin the path once for the whole result, rather than in each of the
+ * threads the filter base class splits it among.
+ */
+static gboolean
+operation_process (GeglOperation        *operation,
+                   GeglOperationContext *context,
+                   const gchar          *output_prop,
+                   const GeglRectangle  *result,
+                   gint                  level)
+{
+  GeglProperties     *o = GEGL_PROPERTIES (operation);
+  GeglOperationClass *operation_class;
+  StrokeBins         *bins = NULL;
+  gboolean            success;
+
+  operation_class = GEGL_OPERATION_CLASS (gegl_op_parent_class);
+
+  if (o->d)
+    {
+      bins = g_slice_new (StrokeBins);
+
+      g_mutex_lock (&bins_mutex);
+      stroke_bins_init (bins, gegl_path_get_flat_path (o->d), o->width,
+                        result);
+      o->user_data = g_slist_prepend (o->user_data, bins);
+      g_mutex_unlock (&bins_mutex);
+    }
+
+  success = operation_class->process (operation, context, output_prop, result,
+                                      level);
+
+  if (bins)
+    {
+      g_mutex_lock (&bins_mutex);
+      o->user_data = g_slist_remove (o->user_data, bins);
+      g_mutex_unlock (&bins_mutex);
+
+      stroke_bins_destroy (bins);
+      g_slice_free (StrokeBins, bins);
+    }
+
+  return success;
+}
 static void foreach_cairo (const GeglPathItem *knot,
                            gpointer              cr)
 {
@@ -290,6 +550,7 @@ gegl_op_class_init (GeglOpClass *klass)
   filter_class    = GEGL_OPERATION_FILTER_CLASS (klass);
 
   filter_class->process = process;
+  operation_class->process = operation_process;
   operation_class->get_bounding_box = get_bounding_box;
   operation_class->prepare = prepare;
   operation_class->detect = detect;
@@ -0,0 +1,381 @@
+/* This file is part of GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Vector helpers used by the SSE2 and AVX2 variants of the operations
+ * generated by math.rb, svg-12-blend.rb and svg-12-porter-duff.rb.
+ *
+ * The generators translate the per-component formulas into calls of
+ * the sse2_* and avx2_* functions below, each vector holds one
+ * component of 4 (SSE2) or 8 (AVX2) pixels.  Comparisons return lane
+ * masks which are only consumed by *_select ().
+ *
+ * The helpers follow the C macros for NaN, *_min (a, b) and *_max (a, b)
+ * return b like MIN (a, b) and MAX (a, b) do, and *_clamp () keeps NaN
+ * like CLAMP () does.
+ *
+ * The variants are compiled with target attributes and only installed
+ * when gegl_cpu_accel_get_support () reports the instruction set, so
+ * the rest of the file is built for the baseline architecture.
+ */
+
+#ifndef __GEGL_GENERATED_SIMD_H__
+#define __GEGL_GENERATED_SIMD_H__
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || __GNUC__ >= 5)
+
+#define GEGL_GENERATED_SIMD 1
+
+#include <immintrin.h>
+
+#include "gegl-cpuaccel.h"
+
+#define GEGL_SIMD_SSE2 __attribute__((target ("sse2")))
+#define GEGL_SIMD_AVX2 __attribute__((target ("avx2")))
+
+
+/* SSE2, 4 pixels */
+
+static inline GEGL_SIMD_SSE2 __m128
+sse2_set1 (gfloat a)
+{
+  return _mm_set1_ps (a);
+}
+
+static inline GEGL_SIMD_SSE2 __m128
+sse2_add (__m128 a, __m128 b)
+{
+  return _mm_add_ps (a, b);
+}
+
+static inline GEGL_SIMD_SSE2 __m128
+sse2_sub (__m128 a, __m128 b)
+{
+  return _mm_sub_ps (a, b);
+}
+
+static inline GEGL_SIMD_SSE2 __m128
+sse2_mul (__m128 a, __m128 b)
+{
+  return _mm_mul_ps (a, b);
+}
+
+static inline GEGL_SIMD_SSE2 __m128
+sse2_div (__m128 a, __m128 b)
+{
+  return _mm_div_ps (a, b);
+}
+
+static inline GEGL_SIMD_SSE2 __m128
+sse2_neg (__m128 a)
+{
+  return _mm_sub_ps (_mm_setzero_ps (), a);
+}
+
+static inline GEGL_SIMD_SSE2 __m128
+sse2_min (__m128 a, __m128 b)
+{
+  return _mm_min_ps (a, b);
+}
+
+static inline GEGL_SIMD_SSE2 __m128
+sse2_max (__m128 a, __m128 b)
+{
+  return _mm_max_ps (a, b);
+}
+
+static inline GEGL_SIMD_SSE2 __m128
+sse2_sqrt (__m128 a)
+{
+  return _mm_sqrt_ps (a);
+}
+
+static inline GEGL_SIMD_SSE2 __m128
+sse2_lt (__m128 a, __m128 b)
+{
+  return _mm_cmplt_ps (a, b);
+}
+
+static inline GEGL_SIMD_SSE2 __m128
+sse2_le (__m128 a, __m128 b)
+{
+  return _mm_cmple_ps (a, b);
+}
+
+static inline GEGL_SIMD_SSE2 __m128
+sse2_gt (__m128 a, __m128 b)
+{
+  return _mm_cmpgt_ps (a, b);
+}
+
+static inline GEGL_SIMD_SSE2 __m128
+sse2_ge (__m128 a, __m128 b)
+{
+  return _mm_cmpge_ps (a, b);
+}
+
+static inline GEGL_SIMD_SSE2 __m128
+sse2_eq (__m128 a, __m128 b)
+{
+  return _mm_cmpeq_ps (a, b);
+}
+
+static inline GEGL_SIMD_SSE2 __m128
+sse2_ne (__m128 a, __m128 b)
+{
+  return _mm_cmpneq_ps (a, b);
+}
+
+static inline GEGL_SIMD_SSE2 __m128
+sse2_select (__m128 mask, __m128 a, __m128 b)
+{
+  return _mm_or_ps (_mm_and_ps (mask, a), _mm_andnot_ps (mask, b));
+}
+
+/* like CLAMP (), NaN is passed through: minps and maxps return their
+ * second operand when either one is NaN
+ */
+static inline GEGL_SIMD_SSE2 __m128
+sse2_clamp (__m128 a, __m128 lo, __m128 hi)
+{
+  return _mm_max_ps (lo, _mm_min_ps (hi, a));
+}
+
+/* loads 4 RGBA pixels as one vector per component */
+static inline GEGL_SIMD_SSE2 void
+sse2_load (const gfloat *p,
+           __m128       *c0,
+           __m128       *c1,
+           __m128       *c2,
+           __m128       *c3)
+{
+  __m128 r0 = _mm_loadu_ps (p);
+  __m128 r1 = _mm_loadu_ps (p + 4);
+  __m128 r2 = _mm_loadu_ps (p + 8);
+  __m128 r3 = _mm_loadu_ps (p + 12);
+
+  _MM_TRANSPOSE4_PS (r0, r1, r2, r3);
+
+  *c0 = r0;
+  *c1 = r1;
+  *c2 = r2;
+  *c3 = r3;
+}
+
+/* loads 4 RGB pixels as one vector per component */
+static inline GEGL_SIMD_SSE2 void
+sse2_load3 (const gfloat *p,
+            __m128       *c0,
+            __m128       *c1,
+            __m128       *c2)
+{
+  *c0 = _mm_setr_ps (p[0], p[3], p[6], p[9]);
+  *c1 = _mm_setr_ps (p[1], p[4], p[7], p[10]);
+  *c2 = _mm_setr_ps (p[2], p[5], p[8], p[11]);
+}
+
+static inline GEGL_SIMD_SSE2 void
+sse2_store (gfloat *p,
+            __m128  c0,
+            __m128  c1,
+            __m128  c2,
+            __m128  c3)
+{
+  _MM_TRANSPOSE4_PS (c0, c1, c2, c3);
+
+  _mm_storeu_ps (p,      c0);
+  _mm_storeu_ps (p + 4,  c1);
+  _mm_storeu_ps (p + 8,  c2);
+  _mm_storeu_ps (p + 12, c3);
+}
+
+
+/* AVX2, 8 pixels
+ *
+ * The transpose works within the two 128 bit lanes, the lanes of a
+ * component vector hold pixels 0, 2, 4, 6, 1, 3, 5, 7 in that order;
+ * avx2_store () transposes back, only avx2_load3 () has to follow it.
+ */
+
+static inline GEGL_SIMD_AVX2 __m256
+avx2_set1 (gfloat a)
+{
+  return _mm256_set1_ps (a);
+}
+
+static inline GEGL_SIMD_AVX2 __m256
+avx2_add (__m256 a, __m256 b)
+{
+  return _mm256_add_ps (a, b);
+}
+
+static inline GEGL_SIMD_AVX2 __m256
+avx2_sub (__m256 a, __m256 b)
+{
+  return _mm256_sub_ps (a, b);
+}
+
+static inline GEGL_SIMD_AVX2 __m256
+avx2_mul (__m256 a, __m256 b)
+{
+  return _mm256_mul_ps (a, b);
+}
+
+static inline GEGL_SIMD_AVX2 __m256
+avx2_div (__m256 a, __m256 b)
+{
+  return _mm256_div_ps (a, b);
+}
+
+static inline GEGL_SIMD_AVX2 __m256
+avx2_neg (__m256 a)
+{
+  return _mm256_sub_ps (_mm256_setzero_ps (), a);
+}
+
+static inline GEGL_SIMD_AVX2 __m256
+avx2_min (__m256 a, __m256 b)
+{
+  return _mm256_min_ps (a, b);
+}
+
+static inline GEGL_SIMD_AVX2 __m256
+avx2_max (__m256 a, __m256 b)
+{
+  return _mm256_max_ps (a, b);
+}
+
+static inline GEGL_SIMD_AVX2 __m256
+avx2_sqrt (__m256 a)
+{
+  return _mm256_sqrt_ps (a);
+}
+
+static inline GEGL_SIMD_AVX2 __m256
+avx2_lt (__m256 a, __m256 b)
+{
+  return _mm256_cmp_ps (a, b, _CMP_LT_OQ);
+}
+
+static inline GEGL_SIMD_AVX2 __m256
+avx2_le (__m256 a, __m256 b)
+{
+  return _mm256_cmp_ps (a, b, _CMP_LE_OQ);
+}
+
+static inline GEGL_SIMD_AVX2 __m256
+avx2_gt (__m256 a, __m256 b)
+{
+  return _mm256_cmp_ps (a, b, _CMP_GT_OQ);
+}
+
+static inline GEGL_SIMD_AVX2 __m256
+avx2_ge (__m256 a, __m256 b)
+{
+  return _mm256_cmp_ps (a, b, _CMP_GE_OQ);
+}
+
+static inline GEGL_SIMD_AVX2 __m256
+avx2_eq (__m256 a, __m256 b)
+{
+  return _mm256_cmp_ps (a, b, _CMP_EQ_OQ);
+}
+
+static inline GEGL_SIMD_AVX2 __m256
+avx2_ne (__m256 a, __m256 b)
+{
+  return _mm256_cmp_ps (a, b, _CMP_NEQ_UQ);
+}
+
+static inline GEGL_SIMD_AVX2 __m256
+avx2_select (__m256 mask, __m256 a, __m256 b)
+{
+  return _mm256_blendv_ps (b, a, mask);
+}
+
+static inline GEGL_SIMD_AVX2 __m256
+avx2_clamp (__m256 a, __m256 lo, __m256 hi)
+{
+  return _mm256_max_ps (lo, _mm256_min_ps (hi, a));
+}
+
+static inline GEGL_SIMD_AVX2 void
+avx2_transpose (__m256 *r0,
+                __m256 *r1,
+                __m256 *r2,
+                __m256 *r3)
+{
+  __m256 t0 = _mm256_unpacklo_ps (*r0, *r1);
+  __m256 t1 = _mm256_unpackhi_ps (*r0, *r1);
+  __m256 t2 = _mm256_unpacklo_ps (*r2, *r3);
+  __m256 t3 = _mm256_unpackhi_ps (*r2, *r3);
+
+  *r0 = _mm256_shuffle_ps (t0, t2, _MM_SHUFFLE (1, 0, 1, 0));
+  *r1 = _mm256_shuffle_ps (t0, t2, _MM_SHUFFLE (3, 2, 3, 2));
+  *r2 = _mm256_shuffle_ps (t1, t3, _MM_SHUFFLE (1, 0, 1, 0));
+  *r3 = _mm256_shuffle_ps (t1, t3, _MM_SHUFFLE (3, 2, 3, 2));
+}
+
+/* loads 8 RGBA pixels as one vector per component */
+static inline GEGL_SIMD_AVX2 void
+avx2_load (const gfloat *p,
+           __m256       *c0,
+           __m256       *c1,
+           __m256       *c2,
+           __m256       *c3)
+{
+  *c0 = _mm256_loadu_ps (p);
+  *c1 = _mm256_loadu_ps (p + 8);
+  *c2 = _mm256_loadu_ps (p + 16);
+  *c3 = _mm256_loadu_ps (p + 24);
+
+  avx2_transpose (c0, c1, c2, c3);
+}
+
+/* loads 8 RGB pixels as one vector per component, in the lane order
+ * avx2_load () produces
+ */
+static inline GEGL_SIMD_AVX2 void
+avx2_load3 (const gfloat *p,
+            __m256       *c0,
+            __m256       *c1,
+            __m256       *c2)
+{
+  *c0 = _mm256_setr_ps (p[0], p[6], p[12], p[18],
+                        p[3], p[9], p[15], p[21]);
+  *c1 = _mm256_setr_ps (p[1], p[7], p[13], p[19],
+                        p[4], p[10], p[16], p[22]);
+  *c2 = _mm256_setr_ps (p[2], p[8], p[14], p[20],
+                        p[5], p[11], p[17], p[23]);
+}
+
+static inline GEGL_SIMD_AVX2 void
+avx2_store (gfloat *p,
+            __m256  c0,
+            __m256  c1,
+            __m256  c2,
+            __m256  c3)
+{
+  avx2_transpose (&c0, &c1, &c2, &c3);
+
+  _mm256_storeu_ps (p,      c0);
+  _mm256_storeu_ps (p + 8,  c1);
+  _mm256_storeu_ps (p + 16, c2);
+  _mm256_storeu_ps (p + 24, c3);
+}
+
+#endif
+
+#endif /* __GEGL_GENERATED_SIMD_H__ */
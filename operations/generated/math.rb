@@ -1,6 +1,8 @@
 #!/usr/bin/env ruby
 # -*- coding: utf-8 -*-
 
+require_relative 'simd'
+
 copyright = '
 /* !!!! AUTOGENERATED FILE generated by math.rb !!!!!
  *
@@ -34,6 +36,79 @@ a = [
 #     ['invert',    'result = 1.0-c']
     ]
 
+# SSE2 / AVX2 variants of process, formulas without a vector version
+# (gamma) only get the scalar one.
+def math_variants(formula)
+  expression = formula.sub(/\A\s*result\s*=\s*/, '')
+  return '' unless Simd.vectorizable?(expression)
+
+  code = "
+#ifdef GEGL_GENERATED_SIMD
+"
+  Simd::TARGETS.each do
+    |t|
+    w = t.width
+    code += "
+static inline #{t.attr} #{t.type}
+formula_#{t.name} (#{t.type} input,
+#{' ' * "formula_#{t.name} (".length}#{t.type} value)
+{
+  return #{Simd.translate(expression, t)};
+}
+
+#{Simd.prototype(t, 'process')}
+{
+  gfloat *in  = in_buf;
+  gfloat *out = out_buf;
+  gfloat *aux = aux_buf;
+  glong   i;
+
+  if (aux == NULL)
+    {
+      #{t.type} value = #{t.name}_set1 (GEGL_PROPERTIES (op)->value);
+
+      for (i = 0; i + #{w} <= n_pixels; i += #{w})
+        {
+          #{t.type} r, g, b, a;
+
+          #{t.name}_load (in, &r, &g, &b, &a);
+          #{t.name}_store (out,
+                      formula_#{t.name} (r, value),
+                      formula_#{t.name} (g, value),
+                      formula_#{t.name} (b, value),
+                      a);
+          in  += 4 * #{w};
+          out += 4 * #{w};
+        }
+    }
+  else
+    {
+      for (i = 0; i + #{w} <= n_pixels; i += #{w})
+        {
+          #{t.type} r, g, b, a;
+          #{t.type} vr, vg, vb;
+
+          #{t.name}_load (in, &r, &g, &b, &a);
+          #{t.name}_load3 (aux, &vr, &vg, &vb);
+          #{t.name}_store (out,
+                      formula_#{t.name} (r, vr),
+                      formula_#{t.name} (g, vg),
+                      formula_#{t.name} (b, vb),
+                      a);
+          in  += 4 * #{w};
+          aux += 3 * #{w};
+          out += 4 * #{w};
+        }
+    }
+
+  return process (op, in, aux, out, n_pixels - i, roi, level);
+}
+"
+  end
+  code + "#endif
+"
+end
+
 a.each do
     |item|
 
@@ -47,6 +122,8 @@ a.each do
     capitalized = name.capitalize
     swapcased   = name.swapcase
     formula     = item[1]
+    variants    = math_variants(formula)
+    dispatch    = variants.empty? ? '' : Simd.dispatch
 
     file.write copyright
     file.write "
@@ -66,6 +143,7 @@ property_double (value, _(\"Value\"), #{item[2]})
 #define GEGL_OP_C_FILE       \"#{filename}\"
 
 #include \"gegl-op.h\"
+#include \"generated-simd.h\"
 
 #include <math.h>
 #ifdef _MSC_VER
@@ -137,7 +215,7 @@ process (GeglOperation       *op,
 
   return TRUE;
 }
-
+#{variants}
 static void
 gegl_op_class_init (GeglOpClass *klass)
 {
@@ -149,7 +227,7 @@ gegl_op_class_init (GeglOpClass *klass)
 
   point_composer_class->process = process;
   operation_class->prepare = prepare;
-
+#{dispatch}
   gegl_operation_class_set_keys (operation_class,
   \"name\"        , \"gegl:#{name}\",
   \"title\"       , \"#{name.capitalize}\",
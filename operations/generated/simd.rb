@@ -0,0 +1,269 @@
+# encoding: utf-8
+#
+# Translation of the per-component formulas used by the generators in
+# this directory into calls of the vector helpers in generated-simd.h,
+# and emission of the SSE2 / AVX2 variants of point composer process
+# functions built on top of them.
+#
+# A formula like 'MIN (cA * aB, cB * aA) + cA * (1 - aB)' becomes
+# 'sse2_add (sse2_min (sse2_mul (cA, aB), ...), ...)', identifiers are
+# kept as they are and expected to be vectors of the target's type.
+# Formulas using anything the helpers do not provide (powf and other
+# libm calls) raise Simd::Unsupported, the generators then only emit
+# the scalar process function.
+
+module Simd
+  class Unsupported < StandardError; end
+
+  Target = Struct.new(:name, :type, :width, :attr, :flag)
+
+  # in order of preference for the run-time dispatch
+  TARGETS = [
+    Target.new('avx2', '__m256', 8, 'GEGL_SIMD_AVX2', 'GEGL_CPU_ACCEL_X86_AVX2'),
+    Target.new('sse2', '__m128', 4, 'GEGL_SIMD_SSE2', 'GEGL_CPU_ACCEL_X86_SSE2')
+  ]
+
+  BINARY = {
+    '+'  => 'add', '-'  => 'sub', '*'  => 'mul', '/'  => 'div',
+    '<'  => 'lt',  '<=' => 'le',  '>'  => 'gt',  '>=' => 'ge',
+    '==' => 'eq',  '!=' => 'ne'
+  }
+
+  CALLS = { 'MIN' => ['min', 2], 'MAX' => ['max', 2], 'sqrt' => ['sqrt', 1] }
+
+  TOKEN = /\s*(\d+\.\d*f?|\d+f?|[A-Za-z_]\w*|==|!=|<=|>=|[-+*\/?:<>(),])/
+
+  class Parser
+    def initialize(formula, prefix)
+      @prefix = prefix
+      @tokens = []
+      rest = formula.strip
+      until rest.empty?
+        m = TOKEN.match(rest)
+        raise Unsupported, "can not tokenize '#{rest}'" unless m && m.begin(0) == 0
+        @tokens << m[1]
+        rest = m.post_match.strip
+      end
+      @pos = 0
+    end
+
+    def parse
+      expr = ternary
+      raise Unsupported, "trailing '#{peek}'" if peek
+      expr
+    end
+
+    private
+
+    def peek
+      @tokens[@pos]
+    end
+
+    def take(expected = nil)
+      token = @tokens[@pos]
+      if expected && token != expected
+        raise Unsupported, "expected '#{expected}', got '#{token}'"
+      end
+      @pos += 1
+      token
+    end
+
+    def op(name, *args)
+      "#{@prefix}_#{name} (#{args.join(', ')})"
+    end
+
+    def ternary
+      cond = binary(0)
+      return cond unless peek == '?'
+      take
+      a = ternary
+      take(':')
+      b = ternary
+      op('select', cond, a, b)
+    end
+
+    LEVELS = [['==', '!='], ['<', '<=', '>', '>='], ['+', '-'], ['*', '/']]
+
+    def binary(level)
+      return unary if level == LEVELS.length
+      a = binary(level + 1)
+      while LEVELS[level].include?(peek)
+        operator = take
+        a = op(BINARY[operator], a, binary(level + 1))
+      end
+      a
+    end
+
+    def unary
+      if peek == '-'
+        take
+        return op('neg', unary)
+      end
+      primary
+    end
+
+    def primary
+      token = take
+      case token
+      when nil
+        raise Unsupported, 'unexpected end of formula'
+      when '('
+        expr = ternary
+        take(')')
+        expr
+      when /\A\d/
+        value = token.sub(/f\z/, '')
+        value += '.0' unless value.include?('.')
+        value += '0' if value.end_with?('.')
+        op('set1', value + 'f')
+      when /\A[A-Za-z_]/
+        return token unless peek == '('
+        raise Unsupported, "no vector version of #{token} ()" unless CALLS[token]
+        name, arity = CALLS[token]
+        take
+        args = [ternary]
+        while peek == ','
+          take
+          args << ternary
+        end
+        take(')')
+        raise Unsupported, "#{token} () takes #{arity} arguments" if args.length != arity
+        op(name, *args)
+      else
+        raise Unsupported, "unexpected '#{token}'"
+      end
+    end
+  end
+
+  def self.translate(formula, target)
+    Parser.new(formula, target.name).parse
+  end
+
+  def self.vectorizable?(*formulas)
+    formulas.each { |f| translate(f, TARGETS[0]) }
+    true
+  rescue Unsupported
+    false
+  end
+
+  def self.prototype(target, name)
+    pad = ' ' * "#{name}_#{target.name} (".length
+    "static #{target.attr} gboolean
+#{name}_#{target.name} (GeglOperation       *op,
+#{pad}void                *in_buf,
+#{pad}void                *aux_buf,
+#{pad}void                *out_buf,
+#{pad}glong                n_pixels,
+#{pad}const GeglRectangle *roi,
+#{pad}gint                 level)"
+  end
+
+  # Installs the best variant in class_init, the scalar process stays
+  # in place when none of them is supported.
+  def self.dispatch(klass = 'point_composer_class', name = 'process')
+    code = "
+#ifdef GEGL_GENERATED_SIMD
+"
+    TARGETS.each_with_index do
+      |t, i|
+      code += "  #{i == 0 ? 'if' : 'else if'} (gegl_cpu_accel_get_support () & #{t.flag})
+    #{klass}->#{name} = #{name}_#{t.name};
+"
+    end
+    code + "#endif
+"
+  end
+
+  # Variants of a point composer on premultiplied RGBA float pixels
+  # computing out[j] = c_formula for the color components and
+  # out[3] = a_formula, from cA, cB, aA and aB as named in the
+  # svg-12-*.rb generators.  With clamp the color components are
+  # clamped to [0, aD].  Without aux either everything is computed with
+  # the aux components set to 0 (aux_less) or nothing is done.  The
+  # pixels left over by the vector loop go through the scalar process.
+  def self.composer_variants(c_formula, a_formula, clamp, aux_less)
+    code = "
+#ifdef GEGL_GENERATED_SIMD
+"
+    TARGETS.each do
+      |t|
+      w     = t.width
+      color = translate(c_formula, t)
+      color = "#{t.name}_clamp (#{color},
+#{' ' * "  return #{t.name}_clamp (".length}#{t.name}_set1 (0.0f), aD)" if clamp
+
+      loop_body = lambda do
+        |src_a|
+        "
+          #{t.type} rA, gA, bA, aA;
+          #{t.type} rB, gB, bB, aB;
+          #{t.type} aD;
+
+          #{src_a}
+          #{t.name}_load (in, &rB, &gB, &bB, &aB);
+          aD = alpha_#{t.name} (aA, aB);
+          #{t.name}_store (out,
+                      component_#{t.name} (rA, rB, aA, aB, aD),
+                      component_#{t.name} (gA, gB, aA, aB, aD),
+                      component_#{t.name} (bA, bB, aA, aB, aD),
+                      aD);"
+      end
+
+      code += "
+static inline #{t.attr} #{t.type}
+alpha_#{t.name} (#{t.type} aA,
+#{' ' * "alpha_#{t.name} (".length}#{t.type} aB)
+{
+  return #{translate(a_formula, t)};
+}
+
+static inline #{t.attr} #{t.type}
+component_#{t.name} (#{t.type} cA,
+#{' ' * "component_#{t.name} (".length}#{t.type} cB,
+#{' ' * "component_#{t.name} (".length}#{t.type} aA,
+#{' ' * "component_#{t.name} (".length}#{t.type} aB,
+#{' ' * "component_#{t.name} (".length}#{t.type} aD)
+{
+  return #{color};
+}
+
+#{prototype(t, 'process')}
+{
+  gfloat *in  = in_buf;
+  gfloat *aux = aux_buf;
+  gfloat *out = out_buf;
+  glong   i;
+"
+      if aux_less
+        code += "
+  if (!aux)
+    {
+      for (i = 0; i + #{w} <= n_pixels; i += #{w})
+        {#{loop_body.call("rA = gA = bA = aA = #{t.name}_set1 (0.0f);")}
+          in  += 4 * #{w};
+          out += 4 * #{w};
+        }
+      return process (op, in, NULL, out, n_pixels - i, roi, level);
+    }
+"
+      else
+        code += "
+  if (!aux)
+    return TRUE;
+"
+      end
+      code += "
+  for (i = 0; i + #{w} <= n_pixels; i += #{w})
+    {#{loop_body.call("#{t.name}_load (aux, &rA, &gA, &bA, &aA);").gsub(/^    /, '')}
+      in  += 4 * #{w};
+      aux += 4 * #{w};
+      out += 4 * #{w};
+    }
+  return process (op, in, aux, out, n_pixels - i, roi, level);
+}
+"
+    end
+    code + "#endif
+"
+  end
+end
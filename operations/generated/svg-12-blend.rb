@@ -1,6 +1,8 @@
 #!/usr/bin/env ruby
 # -*- coding: utf-8 -*-
 
+require_relative 'simd'
+
 copyright = '
 /* !!!! AUTOGENERATED FILE generated by svg-12-blend.rb !!!!!
  *
@@ -164,10 +166,12 @@ process (GeglOperation       *op,
      return TRUE;
 '
 
-file_tail1 = '
+file_tail0 = '
   return TRUE;
 }
+'
 
+file_tail1 = '
 static void
 gegl_op_class_init (GeglOpClass *klass)
 {
@@ -211,6 +215,7 @@ a.each do
 #define GEGL_OP_C_FILE        \"#{filename}\"
 
 #include \"gegl-op.h\"
+#include \"generated-simd.h\"
 "
     file.write file_head2
     file.write "
@@ -237,7 +242,10 @@ a.each do
       out += 4;
     }
 "
+  file.write file_tail0
+  file.write Simd.composer_variants(formula1, 'aA + aB - aA * aB', true, false)
   file.write file_tail1
+  file.write Simd.dispatch
   file.write "
   gegl_operation_class_set_keys (operation_class,
   \"name\"        , \"svg:#{name}\",
@@ -273,6 +281,7 @@ b.each do
 #define GEGL_OP_C_FILE       \"#{filename}\"
 
 #include \"gegl-op.h\"
+#include \"generated-simd.h\"
 "
     file.write file_head2
     file.write "
@@ -302,7 +311,11 @@ b.each do
       out += 4;
     }
 "
+  file.write file_tail0
+  file.write Simd.composer_variants("(#{cond1}) ? (#{formula1}) : (#{formula2})",
+                                    'aA + aB - aA * aB', true, false)
   file.write file_tail1
+  file.write Simd.dispatch
   file.write "
   gegl_operation_class_set_keys (operation_class,
   \"name\"        , \"svg:#{name}\",
@@ -341,6 +354,7 @@ c.each do
 #define GEGL_OP_C_FILE       \"#{filename}\"
 
 #include \"gegl-op.h\"
+#include \"generated-simd.h\"
 #include <math.h>
 "
     file.write file_head2
@@ -373,7 +387,12 @@ c.each do
       out += 4;
     }
 "
+  file.write file_tail0
+  file.write Simd.composer_variants("(#{cond1}) ? (#{formula1}) : " +
+                                    "(#{cond2}) ? (#{formula2}) : (#{formula3})",
+                                    'aA + aB - aA * aB', true, false)
   file.write file_tail1
+  file.write Simd.dispatch
   file.write "
   gegl_operation_class_set_keys (operation_class,
   \"name\"        , \"gegl:#{name}\",
@@ -408,6 +427,7 @@ d.each do
 #define GEGL_OP_C_FILE       \"#{filename}\"
 
 #include \"gegl-op.h\"
+#include \"generated-simd.h\"
 "
     file.write file_head2
     file.write "
@@ -434,7 +454,10 @@ d.each do
       out += 4;
     }
 "
+  file.write file_tail0
+  file.write Simd.composer_variants(formula1, formula2, true, false)
   file.write file_tail1
+  file.write Simd.dispatch
   file.write "
 
   gegl_operation_class_set_keys (operation_class,
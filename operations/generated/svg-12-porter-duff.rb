@@ -1,6 +1,8 @@
 #!/usr/bin/env ruby
 # encoding: utf-8
 
+require_relative 'simd'
+
 copyright = '
 /* !!!! AUTOGENERATED FILE generated by svg-12-porter-duff.rb !!!!!
  *
@@ -90,14 +92,19 @@ file_head2 = '
 static void prepare (GeglOperation *operation)
 {
   const Babl *format;
+  const Babl *aux_format;
 
   if (GEGL_PROPERTIES (operation)->srgb)
     format = babl_format ("R\'aG\'aB\'aA float");
   else
     format = babl_format ("RaGaBaA float");
 
+  aux_format = format;
+  format = gegl_operation_point_composer_select_format (operation, format,
+                                                        &aux_format);
+
   gegl_operation_set_format (operation, "input", format);
-  gegl_operation_set_format (operation, "aux", format);
+  gegl_operation_set_format (operation, "aux", aux_format);
   gegl_operation_set_format (operation, "output", format);
 }
 
@@ -130,8 +137,106 @@ gegl_op_class_init (GeglOpClass *klass)
   point_composer_class->process = process;
   operation_class->prepare = prepare;
 
+  gegl_operation_point_composer_class_add_format (point_composer_class,
+                                                  "RaGaBaA u8", NULL,
+                                                  process_u8);
+  gegl_operation_point_composer_class_add_format (point_composer_class,
+                                                  "R\'aG\'aB\'aA u8", NULL,
+                                                  process_u8);
+  gegl_operation_point_composer_class_add_format (point_composer_class,
+                                                  "RaGaBaA u16", NULL,
+                                                  process_u16);
+  gegl_operation_point_composer_class_add_format (point_composer_class,
+                                                  "R\'aG\'aB\'aA u16", NULL,
+                                                  process_u16);
 '
 
+# Variants of process working directly on premultiplied integer pixels,
+# the components are normalized to compute the formulas in float.
+def int_variants(c_formula, a_formula, aux_less)
+  variants = ''
+  [['u8', 'guint8', '255.0f'], ['u16', 'guint16', '65535.0f']].each do
+    |type, ctype, max|
+
+    variants += "
+static gboolean
+process_#{type} (GeglOperation       *op,
+#{' ' * type.length}          void                *in_buf,
+#{' ' * type.length}          void                *aux_buf,
+#{' ' * type.length}          void                *out_buf,
+#{' ' * type.length}          glong                n_pixels,
+#{' ' * type.length}          const GeglRectangle *roi,
+#{' ' * type.length}          gint                 level)
+{
+  gint i;
+  #{ctype} *in = in_buf;
+  #{ctype} *aux = aux_buf;
+  #{ctype} *out = out_buf;
+"
+    if aux_less
+      variants += "
+  if (!aux)
+    {
+      for (i = 0; i < n_pixels; i++)
+        {
+          gint   j;
+          gfloat aA G_GNUC_UNUSED, aB G_GNUC_UNUSED, aD G_GNUC_UNUSED;
+
+          aB = in[3] * (1.0f / #{max});
+          aA = 0.0f;
+          aD = #{a_formula};
+
+          for (j = 0; j < 3; j++)
+            {
+              gfloat cA G_GNUC_UNUSED, cB G_GNUC_UNUSED;
+
+              cB = in[j] * (1.0f / #{max});
+              cA = 0.0f;
+              out[j] = CLAMP ((#{c_formula}) * #{max} + 0.5f, 0.0f, #{max});
+            }
+          out[3] = CLAMP (aD * #{max} + 0.5f, 0.0f, #{max});
+          in  += 4;
+          out += 4;
+        }
+      return TRUE;
+    }
+"
+    else
+      variants += "
+  if (!aux)
+    return TRUE;
+"
+    end
+    variants += "
+  for (i = 0; i < n_pixels; i++)
+    {
+      gint   j;
+      gfloat aA G_GNUC_UNUSED, aB G_GNUC_UNUSED, aD G_GNUC_UNUSED;
+
+      aB = in[3] * (1.0f / #{max});
+      aA = aux[3] * (1.0f / #{max});
+      aD = #{a_formula};
+
+      for (j = 0; j < 3; j++)
+        {
+          gfloat cA G_GNUC_UNUSED, cB G_GNUC_UNUSED;
+
+          cB = in[j] * (1.0f / #{max});
+          cA = aux[j] * (1.0f / #{max});
+          out[j] = CLAMP ((#{c_formula}) * #{max} + 0.5f, 0.0f, #{max});
+        }
+      out[3] = CLAMP (aD * #{max} + 0.5f, 0.0f, #{max});
+      in  += 4;
+      aux += 4;
+      out += 4;
+    }
+  return TRUE;
+}
+"
+  end
+  variants
+end
+
 file_tail2 = ' 
 
 }
@@ -161,6 +266,7 @@ a.each do
 #define GEGL_OP_C_FILE        \"#{filename}\"
 
 #include \"gegl-op.h\"
+#include \"generated-simd.h\"
 "
     file.write file_head2
 
@@ -226,7 +332,10 @@ a.each do
   return TRUE;
 }
 "
+  file.write Simd.composer_variants(c_formula, a_formula, false, item[3])
+  file.write int_variants(c_formula, a_formula, item[3])
   file.write file_tail1
+  file.write Simd.dispatch
   file.write "
   gegl_operation_class_set_keys (operation_class,
     \"name\"       , \"svg:#{name}\",
@@ -267,6 +376,7 @@ b.each do
 #define GEGL_OP_C_FILE        \"#{filename}\"
 
 #include \"gegl-op.h\"
+#include \"generated-simd.h\"
 "
     file.write file_head2
     file.write "
@@ -304,9 +414,11 @@ static GeglRectangle get_bounding_box (GeglOperation *self)
   return *in_rect;
 }
 
-
 "
+  file.write Simd.composer_variants(c_formula, a_formula, false, false)
+  file.write int_variants(c_formula, a_formula, false)
   file.write file_tail1
+  file.write Simd.dispatch
   file.write "
   operation_class->get_bounding_box = get_bounding_box;
 
@@ -52,12 +52,59 @@ property_string (error_msg, _("Error message"), "")
 
 typedef struct SCProps_
 {
-  GMutex         mutex;
-  gboolean       first_processing;
-  gboolean       is_valid;
-  GeglScContext *context;
+  GMutex               mutex;
+  gboolean             first_processing;
+  gboolean             is_valid;
+  GeglScContext       *context;
+
+  /* The mesh only depends on the aux input, so moving the paste around
+   * only samples the boundary colors again. mesh_dirty is set when the
+   * node feeding aux is invalidated.
+   */
+  gint                 mesh_dirty;
+  gint                 max_refine_scale;
+  GeglScCreationError  error;
+  GeglNode            *aux_node;
+  gulong               aux_handler;
 } SCProps;
 
+static void
+aux_invalidated (GeglNode            *node,
+                 const GeglRectangle *rect,
+                 SCProps             *props)
+{
+  g_atomic_int_set (&props->mesh_dirty, TRUE);
+}
+
+static void
+watch_aux_node (SCProps  *props,
+                GeglNode *aux_node)
+{
+  if (aux_node == props->aux_node)
+    return;
+
+  if (props->aux_node)
+    {
+      g_signal_handler_disconnect (props->aux_node, props->aux_handler);
+      g_object_remove_weak_pointer (G_OBJECT (props->aux_node),
+                                    (gpointer*) &props->aux_node);
+    }
+
+  props->aux_node = aux_node;
+  props->aux_handler = 0;
+
+  if (aux_node)
+    {
+      props->aux_handler = g_signal_connect (aux_node, "invalidated",
+                                             G_CALLBACK (aux_invalidated),
+                                             props);
+      g_object_add_weak_pointer (G_OBJECT (aux_node),
+                                 (gpointer*) &props->aux_node);
+    }
+
+  g_atomic_int_set (&props->mesh_dirty, TRUE);
+}
+
 static GeglRectangle
 get_required_for_output (GeglOperation       *operation,
                          const gchar         *input_pad,
@@ -99,10 +146,16 @@ prepare (GeglOperation *operation)
       props->first_processing = TRUE;
       props->is_valid = FALSE;
       props->context = NULL;
+      props->mesh_dirty = TRUE;
+      props->max_refine_scale = o->max_refine_scale;
+      props->error = GEGL_SC_CREATION_ERROR_NONE;
+      props->aux_node = NULL;
+      props->aux_handler = 0;
       o->user_data = props;
     }
   props->first_processing = TRUE;
   props->is_valid = FALSE;
+  watch_aux_node (props, gegl_operation_get_source_node (operation, "aux"));
   gegl_operation_set_format (operation, "input",  format);
   gegl_operation_set_format (operation, "aux",    format);
   gegl_operation_set_format (operation, "output", format);
@@ -115,6 +168,7 @@ static void finalize (GObject *object)
   if (o->user_data)
     {
       SCProps *props = (SCProps*) o->user_data;
+      watch_aux_node (props, NULL);
       g_mutex_clear (&props->mutex);
       if (props->context)
         gegl_sc_context_free (props->context);
@@ -135,7 +189,6 @@ process (GeglOperation       *operation,
   gboolean  return_val;
   GeglProperties *o = GEGL_PROPERTIES (operation);
   SCProps *props;
-  GeglScCreationError error;
   GeglScRenderInfo info;
 
   g_assert (o->user_data != NULL);
@@ -154,26 +207,40 @@ process (GeglOperation       *operation,
   if (props->first_processing)
     {
       const gchar *error_msg = "";
+
+      if (props->context != NULL &&
+          props->max_refine_scale != o->max_refine_scale)
+        {
+          gegl_sc_context_free (props->context);
+          props->context = NULL;
+        }
+
       if (props->context == NULL)
         {
+          g_atomic_int_set (&props->mesh_dirty, FALSE);
+          props->max_refine_scale = o->max_refine_scale;
           props->context = gegl_sc_context_new (aux,
                                                 gegl_operation_source_get_bounding_box (operation, "aux"),
                                                 0.5,
                                                 o->max_refine_scale,
-                                                &error);
-          gegl_sc_context_set_uvt_cache (props->context, TRUE);
+                                                &props->error);
+          if (props->context)
+            gegl_sc_context_set_uvt_cache (props->context, TRUE);
         }
-      else
+      else if (g_atomic_int_get (&props->mesh_dirty))
         {
+          g_atomic_int_set (&props->mesh_dirty, FALSE);
           gegl_sc_context_update (props->context,
                                   aux,
                                   gegl_operation_source_get_bounding_box (operation, "aux"),
                                   0.5,
                                   o->max_refine_scale,
-                                  &error);
+                                  &props->error);
         }
+      /* else only the offset or the background changed, and the mesh
+       * of the last update is still good */
 
-      switch (error)
+      switch (props->error)
         {
           case GEGL_SC_CREATION_ERROR_NONE:
             props->is_valid = TRUE;
@@ -188,7 +255,7 @@ process (GeglOperation       *operation,
             error_msg = _("The foreground contains holes and/or several unconnected parts");
             break;
           default:
-            g_warning ("Unknown preprocessing status %d", error);
+            g_warning ("Unknown preprocessing status %d", props->error);
             break;
         }
 
@@ -215,25 +282,6 @@ process (GeglOperation       *operation,
   return  return_val;
 }
 
-static void
-notify (GObject    *object,
-        GParamSpec *pspec)
-{
-  if (strcmp (pspec->name, "max-refine-steps") == 0)
-    {
-      GeglProperties *o = GEGL_PROPERTIES (object);
-
-      if (o->user_data)
-        {
-          g_free (o->user_data);
-          o->user_data = NULL;
-        }
-    }
-
-  if (G_OBJECT_CLASS (gegl_op_parent_class)->notify)
-    G_OBJECT_CLASS (gegl_op_parent_class)->notify (object, pspec);
-}
-
 static void
 gegl_op_class_init (GeglOpClass *klass)
 {
@@ -241,7 +289,6 @@ gegl_op_class_init (GeglOpClass *klass)
   GeglOperationComposerClass *composer_class  = GEGL_OPERATION_COMPOSER_CLASS (klass);
 
   G_OBJECT_CLASS (klass)->finalize = finalize;
-  G_OBJECT_CLASS (klass)->notify   = notify;
 
   operation_class->prepare         = prepare;
   composer_class->process          = process;
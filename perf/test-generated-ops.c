@@ -0,0 +1,107 @@
+#include "test-common.h"
+
+/* the operations generated by the scripts in operations/generated, those
+ * with a meaningful aux == NULL path are run a second time without aux
+ */
+static const struct
+{
+  const gchar *name;
+  gboolean     without_aux;
+} ops[] =
+{
+  { "gegl:add",         TRUE  },
+  { "gegl:subtract",    TRUE  },
+  { "gegl:multiply",    TRUE  },
+  { "gegl:divide",      TRUE  },
+  { "gegl:gamma",       TRUE  },
+
+  { "svg:clear",        FALSE },
+  { "svg:src",          FALSE },
+  { "svg:dst",          TRUE  },
+  { "svg:dst-over",     TRUE  },
+  { "svg:dst-in",       FALSE },
+  { "svg:src-in",       FALSE },
+  { "svg:src-out",      FALSE },
+  { "svg:dst-out",      TRUE  },
+  { "svg:src-atop",     TRUE  },
+  { "svg:dst-atop",     FALSE },
+  { "svg:xor",          TRUE  },
+
+  { "svg:multiply",     FALSE },
+  { "svg:screen",       FALSE },
+  { "svg:darken",       FALSE },
+  { "svg:lighten",      FALSE },
+  { "svg:difference",   FALSE },
+  { "svg:exclusion",    FALSE },
+  { "svg:overlay",      FALSE },
+  { "svg:color-dodge",  FALSE },
+  { "svg:color-burn",   FALSE },
+  { "svg:hard-light",   FALSE },
+  { "gegl:soft-light",  FALSE },
+  { "svg:plus",         FALSE }
+};
+
+static const gchar *op_name;
+static GeglBuffer  *aux_buffer;
+
+void composite (GeglBuffer *buffer);
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  GeglBuffer *buffer;
+  GeglBuffer *aux;
+  gint        i;
+
+  gegl_init (&argc, &argv);
+
+  buffer = test_buffer (2048, 1024, babl_format ("RGBA float"));
+  aux    = test_buffer (2048, 1024, babl_format ("RGBA float"));
+
+  for (i = 0; i < G_N_ELEMENTS (ops); i++)
+    {
+      gchar *id;
+
+      op_name    = ops[i].name;
+      aux_buffer = aux;
+      bench (op_name, buffer, &composite);
+
+      if (ops[i].without_aux)
+        {
+          id = g_strdup_printf ("%s (no aux)", op_name);
+          aux_buffer = NULL;
+          bench (id, buffer, &composite);
+          g_free (id);
+        }
+    }
+
+  g_object_unref (aux);
+  g_object_unref (buffer);
+
+  return 0;
+}
+
+void composite (GeglBuffer *buffer)
+{
+  GeglBuffer *buffer2;
+  GeglNode   *gegl, *source, *node, *sink;
+
+  gegl = gegl_node_new ();
+  source = gegl_node_new_child (gegl, "operation", "gegl:buffer-source", "buffer", buffer, NULL);
+  node = gegl_node_new_child (gegl, "operation", op_name, NULL);
+  sink = gegl_node_new_child (gegl, "operation", "gegl:buffer-sink", "buffer", &buffer2, NULL);
+
+  gegl_node_link_many (source, node, sink, NULL);
+
+  if (aux_buffer)
+    {
+      GeglNode *aux = gegl_node_new_child (gegl, "operation", "gegl:buffer-source", "buffer", aux_buffer, NULL);
+
+      gegl_node_connect_to (aux, "output", node, "aux");
+    }
+
+  gegl_node_process (sink);
+  g_object_unref (gegl);
+  g_object_unref (buffer2);
+}
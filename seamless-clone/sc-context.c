@@ -18,6 +18,7 @@
  */
 
 #include <gegl.h>
+#include "gegl-config.h"
 #include <poly2tri-c/refine/refine.h>
 #include <poly2tri-c/render/mesh-render.h>
 
@@ -26,6 +27,42 @@
 #include "sc-common.h"
 #include "sc-sample.h"
 
+/* The samplers of one thread sampling the color differences, the
+ * samplers of gegl_buffer_sample () are shared and serialize all the
+ * threads on one lock.
+ */
+typedef struct
+{
+  GeglScRenderInfo *info;
+  GeglSampler      *fg;
+  GeglSampler      *bg;
+} GeglScSamplers;
+
+/* A mesh point whose color should be sampled */
+typedef struct
+{
+  P2trPoint        *pt;
+  GeglScSampleList *sl;
+  GeglScColor      *color;
+} GeglScPointSample;
+
+/* A part of the points to sample, see gegl_sc_sample_points () */
+typedef struct
+{
+  GeglScRenderInfo  *info;
+  GeglScPointSample *samples;
+  guint              n_samples;
+  gboolean           success;
+} GeglScSamplePart;
+
+/* A part of the UVT cache to compute, see gegl_sc_compute_uvt_part () */
+typedef struct
+{
+  P2trMesh      *mesh;
+  GeglBuffer    *uvt;
+  GeglRectangle  roi;
+} GeglScUvtPart;
+
 static GeglScOutline*  gegl_sc_context_create_outline             (GeglBuffer          *input,
                                                                    const GeglRectangle *roi,
                                                                    gdouble              threshold,
@@ -42,12 +79,12 @@ static void            gegl_sc_context_update_from_outline        (GeglScContext
 static gboolean        gegl_sc_context_render_cache_pt2col_update (GeglScContext       *context,
                                                                    GeglScRenderInfo    *info);
 
-static gboolean        gegl_sc_context_sample_color_difference    (GeglScRenderInfo    *info,
+static gboolean        gegl_sc_context_sample_color_difference    (GeglScSamplers      *samplers,
                                                                    gdouble              x,
                                                                    gdouble              y,
                                                                    GeglScColor         *dest);
 
-static gboolean        gegl_sc_context_sample_point               (GeglScRenderInfo    *info,
+static gboolean        gegl_sc_context_sample_point               (GeglScSamplers      *samplers,
                                                                    GeglScSampleList    *sl,
                                                                    P2trPoint           *point,
                                                                    GeglScColor         *dest);
@@ -63,6 +100,75 @@ static void            gegl_sc_point_to_color_func                (P2trPoint
 
 static void            gegl_sc_context_render_cache_free          (GeglScContext       *context);
 
+static void            gegl_sc_parallel                           (GFunc                func,
+                                                                   gpointer             parts,
+                                                                   gsize                part_size,
+                                                                   gint                 n_parts);
+
+typedef struct
+{
+  GFunc     func;
+  gpointer  part;
+  gint     *pending;
+} GeglScThreadData;
+
+static void
+gegl_sc_thread_process (gpointer thread_data,
+                        gpointer unused)
+{
+  GeglScThreadData *data = thread_data;
+
+  data->func (data->part, NULL);
+  g_atomic_int_add (data->pending, -1);
+}
+
+static GThreadPool *
+gegl_sc_thread_pool (void)
+{
+  static GThreadPool *pool = NULL;
+  if (!pool)
+    {
+      pool = g_thread_pool_new (gegl_sc_thread_process, NULL,
+                                gegl_config_threads (), FALSE, NULL);
+    }
+  return pool;
+}
+
+/**
+ * gegl_sc_parallel:
+ * @func: The function to call on each part
+ * @parts: An array of @n_parts parts, each @part_size bytes large
+ * @n_parts: The number of parts, at most GEGL_MAX_THREADS
+ *
+ * Call @func on each of the parts, spread over the GEGL threads, and
+ * return once all the parts were processed.
+ */
+static void
+gegl_sc_parallel (GFunc    func,
+                  gpointer parts,
+                  gsize    part_size,
+                  gint     n_parts)
+{
+  GeglScThreadData thread_data[GEGL_MAX_THREADS];
+  gint             pending = n_parts;
+  gint             i;
+
+  g_assert (n_parts <= GEGL_MAX_THREADS);
+
+  for (i = 0; i < n_parts; i++)
+    {
+      thread_data[i].func    = func;
+      thread_data[i].part    = (guchar*) parts + i * part_size;
+      thread_data[i].pending = &pending;
+    }
+
+  for (i = 1; i < n_parts; i++)
+    g_thread_pool_push (gegl_sc_thread_pool (), &thread_data[i], NULL);
+  gegl_sc_thread_process (&thread_data[0], NULL);
+
+  while (g_atomic_int_get (&pending)) {};
+}
+
 GeglScContext*
 gegl_sc_context_new (GeglBuffer          *input,
                      const GeglRectangle *roi,
@@ -305,6 +411,44 @@ gegl_sc_context_prepare_render (GeglScContext    *context,
   return TRUE;
 }
 
+/**
+ * Sample the colors of one part of the mesh points, with samplers of
+ * its own.
+ */
+static void
+gegl_sc_sample_points (gpointer part_p,
+                       gpointer unused)
+{
+  GeglScSamplePart *part   = part_p;
+  const Babl       *format = babl_format (GEGL_SC_COLOR_BABL_NAME);
+  GeglScSamplers    samplers;
+  guint             i;
+
+  if (part->n_samples == 0)
+    return;
+
+  samplers.info = part->info;
+  samplers.fg   = gegl_buffer_sampler_new (part->info->fg, format,
+                                           GEGL_SAMPLER_NEAREST);
+  samplers.bg   = gegl_buffer_sampler_new (part->info->bg, format,
+                                           GEGL_SAMPLER_NEAREST);
+
+  for (i = 0; i < part->n_samples; i++)
+    {
+      GeglScPointSample *sample = &part->samples[i];
+
+      if (! gegl_sc_context_sample_point (&samplers, sample->sl,
+                                          sample->pt, sample->color))
+        {
+          part->success = FALSE;
+          break;
+        }
+    }
+
+  g_object_unref (samplers.fg);
+  g_object_unref (samplers.bg);
+}
+
 /**
  * Compute the color assigned to all the points in the color difference
  * mesh. If the color can not be computed for one or more points (due to
@@ -323,6 +467,12 @@ gegl_sc_context_render_cache_pt2col_update (GeglScContext    *context,
   P2trPoint        *pt            = NULL;
   GeglScSampleList *sl            = NULL;
   GHashTable       *pt2col;
+  GArray           *samples;
+  GeglScSamplePart  parts[GEGL_MAX_THREADS];
+  gint              n_parts;
+  guint             per_part;
+  gboolean          success = TRUE;
+  gint              i;
 
   /* If this is the first time we compute the colors, we need to
    * allocate the color map */
@@ -346,12 +496,17 @@ gegl_sc_context_render_cache_pt2col_update (GeglScContext    *context,
    *    deleted point), we would want to remove it from the mesh
    */
 
+  samples = g_array_sized_new (FALSE, FALSE, sizeof (GeglScPointSample),
+                                g_hash_table_size (context->sampling));
+
   /* Iterate over the current sampling */
   g_hash_table_iter_init (&iter, context->sampling);
   while (g_hash_table_iter_next (&iter,
                                  (gpointer*) &pt,
                                  (gpointer*) &sl))
     {
+      GeglScPointSample sample;
+
       /* See if we have a pt2col entry for this point? */
       if (! g_hash_table_lookup_extended (pt2col, pt, NULL,
                                           (gpointer*) &color_current))
@@ -362,21 +517,46 @@ gegl_sc_context_render_cache_pt2col_update (GeglScContext    *context,
                                color_current);
         }
 
-      /* Now, actually find the color for this point and update it
-       * directly in the color buffer (which is already held in the
-       * mapping).
+      /* The color is sampled later on, directly into the color buffer
+       * (which is already held in the mapping).
        *
        * Note that we first insert the allocated color and reffed point,
        * and only then we allow ourselves to fail. If we would fail
        * after allocating/reffing but before inserting, we would have a
        * memory leak!
        */
-      if (! gegl_sc_context_sample_point (info, sl, pt, color_current))
-        {
-          return FALSE;
-        }
+      sample.pt    = pt;
+      sample.sl    = sl;
+      sample.color = color_current;
+      g_array_append_val (samples, sample);
+    }
+
+  /* Now, actually find the colors of the points, a few hundred points
+   * per thread at least so that small meshes don't pay for threads */
+  n_parts  = CLAMP (samples->len / 256, 1, gegl_config_threads ());
+  per_part = (samples->len + n_parts - 1) / n_parts;
+
+  for (i = 0; i < n_parts; i++)
+    {
+      guint first = MIN (i * per_part, samples->len);
+
+      parts[i].info      = info;
+      parts[i].samples   = &g_array_index (samples, GeglScPointSample, first);
+      parts[i].n_samples = MIN (per_part, samples->len - first);
+      parts[i].success   = TRUE;
     }
 
+  gegl_sc_parallel (gegl_sc_sample_points, parts,
+                    sizeof (GeglScSamplePart), n_parts);
+
+  g_array_free (samples, TRUE);
+
+  for (i = 0; i < n_parts; i++)
+    success = success && parts[i].success;
+
+  if (! success)
+    return FALSE;
+
   /* Now, lets see if there were any additional points in the mapping, that
    * we should remove now */
   if (g_hash_table_size (context->sampling) < g_hash_table_size (pt2col))
@@ -408,12 +588,12 @@ gegl_sc_context_render_cache_pt2col_update (GeglScContext    *context,
  * THIS FUNCTION USES GEGL_SC_COLORA_CHANNEL_COUNT CHANNELS! (WITH ALPHA!)
  */
 static gboolean
-gegl_sc_context_sample_color_difference (GeglScRenderInfo *info,
+gegl_sc_context_sample_color_difference (GeglScSamplers   *samplers,
                                          gdouble           x,
                                          gdouble           y,
                                          GeglScColor      *dest)
 {
-  const Babl   *format  = babl_format (GEGL_SC_COLOR_BABL_NAME);
+  GeglScRenderInfo *info = samplers->info;
 
   GeglScColor fg_c[GEGL_SC_COLORA_CHANNEL_COUNT];
   GeglScColor bg_c[GEGL_SC_COLORA_CHANNEL_COUNT];
@@ -438,16 +618,14 @@ gegl_sc_context_sample_color_difference (GeglScRenderInfo *info,
       return FALSE;
     }
 
-  gegl_buffer_sample (info->fg,
-                      x, y,
-                      NULL, fg_c, format,
-                      GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
+  gegl_sampler_get (samplers->fg,
+                    x, y,
+                    NULL, fg_c, GEGL_ABYSS_NONE);
 
   /* Sample the BG with the offset */
-  gegl_buffer_sample (info->bg,
-                      x + info->xoff, y + info->yoff,
-                      NULL, bg_c, format,
-                      GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
+  gegl_sampler_get (samplers->bg,
+                    x + info->xoff, y + info->yoff,
+                    NULL, bg_c, GEGL_ABYSS_NONE);
 
 #define gegl_sc_color_expr(I)  dest[I] = (bg_c[I] - fg_c[I])
   gegl_sc_color_process();
@@ -465,7 +643,7 @@ gegl_sc_context_sample_color_difference (GeglScRenderInfo *info,
  * RENDERING PROCESS!
  */
 static gboolean
-gegl_sc_context_sample_point (GeglScRenderInfo *info,
+gegl_sc_context_sample_point (GeglScSamplers   *samplers,
                               GeglScSampleList *sl,
                               P2trPoint        *point,
                               GeglScColor      *dest)
@@ -473,7 +651,7 @@ gegl_sc_context_sample_point (GeglScRenderInfo *info,
   /* If this is a direct sample, we can easily finish */
   if (sl->direct_sample)
     {
-      return gegl_sc_context_sample_color_difference (info, point->c.x, point->c.y, dest);
+      return gegl_sc_context_sample_color_difference (samplers, point->c.x, point->c.y, dest);
     }
   else
     {
@@ -492,7 +670,7 @@ gegl_sc_context_sample_point (GeglScRenderInfo *info,
           gdouble weight = g_array_index (sl->weights, gdouble, i);
           GeglScColor raw_color[GEGL_SC_COLORA_CHANNEL_COUNT];
 
-          if (! gegl_sc_context_sample_color_difference (info, pt->x, pt->y, raw_color))
+          if (! gegl_sc_context_sample_color_difference (samplers, pt->x, pt->y, raw_color))
             continue;
 
 #define gegl_sc_color_expr(I)  dest_c[I] += weight * raw_color[I]
@@ -538,17 +716,19 @@ gegl_sc_context_render_cache_pt2col_free (GeglScContext *context)
   context->render_cache->pt2col = NULL;
 }
 
-static GeglBuffer*
-gegl_sc_compute_uvt_cache (P2trMesh            *mesh,
-                           const GeglRectangle *area)
+static void
+gegl_sc_compute_uvt_part (gpointer part_p,
+                          gpointer unused)
 {
-  GeglBuffer         *uvt;
+  GeglScUvtPart      *part = part_p;
   GeglBufferIterator *iter;
   P2trImageConfig     config;
 
-  uvt = gegl_buffer_new (area, GEGL_SC_BABL_UVT_FORMAT);
+  if (gegl_rectangle_is_empty (&part->roi))
+    return;
 
-  iter = gegl_buffer_iterator_new (uvt, area, 0, GEGL_SC_BABL_UVT_FORMAT,
+  iter = gegl_buffer_iterator_new (part->uvt, &part->roi, 0,
+                                   GEGL_SC_BABL_UVT_FORMAT,
                                    GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
 
   config.step_x = config.step_y = 1;
@@ -560,13 +740,43 @@ gegl_sc_compute_uvt_cache (P2trMesh            *mesh,
       config.min_y = iter->roi[0].y;
       config.x_samples = iter->roi[0].width;
       config.y_samples = iter->roi[0].height;
-      p2tr_mesh_render_cache_uvt_exact (mesh,
+      p2tr_mesh_render_cache_uvt_exact (part->mesh,
                                         (P2trUVT*) iter->data[0],
                                         iter->length,
                                         &config);
     }
 
   /* No need to free the iterator */
+}
+
+/* The UVT cache is computed in horizontal bands, one per thread */
+static GeglBuffer*
+gegl_sc_compute_uvt_cache (P2trMesh            *mesh,
+                           const GeglRectangle *area)
+{
+  GeglBuffer    *uvt;
+  GeglScUvtPart  parts[GEGL_MAX_THREADS];
+  gint           n_parts;
+  gint           band;
+  gint           i;
+
+  uvt = gegl_buffer_new (area, GEGL_SC_BABL_UVT_FORMAT);
+
+  n_parts = CLAMP (area->height / 64, 1, gegl_config_threads ());
+  band    = (area->height + n_parts - 1) / n_parts;
+
+  for (i = 0; i < n_parts; i++)
+    {
+      gint y0 = MIN (area->y + i * band, area->y + area->height);
+      gint y1 = MIN (y0 + band, area->y + area->height);
+
+      parts[i].mesh = mesh;
+      parts[i].uvt  = uvt;
+      gegl_rectangle_set (&parts[i].roi, area->x, y0, area->width, y1 - y0);
+    }
+
+  gegl_sc_parallel (gegl_sc_compute_uvt_part, parts,
+                    sizeof (GeglScUvtPart), n_parts);
 
   return uvt;
 }
@@ -0,0 +1,104 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <string.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define WIDTH    300
+#define HEIGHT   200
+
+static void
+job_finished (GeglBlitJob *job,
+              gboolean     completed,
+              gpointer     user_data)
+{
+  g_main_loop_quit (user_data);
+}
+
+int main(int argc, char *argv[])
+{
+  int          result = SUCCESS;
+  GeglColor   *color;
+  GeglNode    *graph;
+  GeglNode    *node;
+  GeglBlitJob *job;
+  GMainLoop   *loop;
+  guchar      *pixels;
+  gint         i;
+
+  gegl_init (&argc, &argv);
+
+  pixels = g_new0 (guchar, WIDTH * HEIGHT * 4);
+  loop   = g_main_loop_new (NULL, FALSE);
+  color  = gegl_color_new ("rgb(0.0, 0.0, 1.0)");
+  graph  = gegl_node_new ();
+  node   = gegl_node_new_child (graph,
+                                "operation", "gegl:color",
+                                "value",     color,
+                                NULL);
+
+  /* Spans several tiles, starting off the tile grid */
+  job = gegl_node_blit_async (node, 1.0, GEGL_RECTANGLE (-10, 30, WIDTH, HEIGHT),
+                              babl_format ("R'G'B'A u8"), pixels,
+                              GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT,
+                              G_PRIORITY_DEFAULT, job_finished, loop);
+  g_main_loop_run (loop);
+
+  if (!gegl_blit_job_is_done (job) || !gegl_blit_job_wait (job))
+    {
+      g_printerr ("The job did not complete\n");
+      result = FAILURE;
+      goto abort;
+    }
+  gegl_blit_job_unref (job);
+  job = NULL;
+
+  for (i = 0; i < WIDTH * HEIGHT; i++)
+    if (pixels[i * 4 + 2] != 255 || pixels[i * 4 + 3] != 255)
+      {
+        g_printerr ("Pixel %i was not rendered\n", i);
+        result = FAILURE;
+        goto abort;
+      }
+
+  /* Far more tiles than can be rendered before we cancel */
+  job = gegl_node_blit_async (node, 1.0, GEGL_RECTANGLE (0, 0, 8192, 8192),
+                              babl_format ("R'G'B'A u8"), NULL,
+                              GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT,
+                              G_PRIORITY_LOW, NULL, NULL);
+  gegl_blit_job_cancel (job);
+
+  if (gegl_blit_job_wait (job))
+    {
+      g_printerr ("The cancelled job completed\n");
+      result = FAILURE;
+    }
+
+abort:
+  if (job)
+    gegl_blit_job_unref (job);
+  g_object_unref (graph);
+  g_object_unref (color);
+  g_main_loop_unref (loop);
+  g_free (pixels);
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,106 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <string.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define N_REQUESTS 5
+#define TILE       32
+
+int main(int argc, char *argv[])
+{
+  int              result = SUCCESS;
+  GeglBlitRequest  requests[N_REQUESTS];
+  guchar           batched[N_REQUESTS][TILE * TILE * 4];
+  guchar           expected[TILE * TILE * 4];
+  GeglColor       *color;
+  GeglNode        *graph;
+  GeglNode        *source;
+  GeglNode        *crop;
+  GeglNode        *blur;
+  GeglNode        *opacity;
+  gint             i;
+
+  gegl_init (&argc, &argv);
+
+  color   = gegl_color_new ("rgb(0.0, 1.0, 0.0)");
+  graph   = gegl_node_new ();
+  source  = gegl_node_new_child (graph,
+                                 "operation", "gegl:color",
+                                 "value",     color,
+                                 NULL);
+  crop    = gegl_node_new_child (graph,
+                                 "operation", "gegl:crop",
+                                 "width",     100.0,
+                                 "height",    100.0,
+                                 NULL);
+  blur    = gegl_node_new_child (graph,
+                                 "operation", "gegl:gaussian-blur",
+                                 "std-dev-x", 4.0,
+                                 "std-dev-y", 4.0,
+                                 NULL);
+  opacity = gegl_node_new_child (graph,
+                                 "operation", "gegl:opacity",
+                                 "value",     0.5,
+                                 NULL);
+  gegl_node_link_many (source, crop, blur, opacity, NULL);
+
+  /* Tiles of the output and of an intermediate node, one of them far
+   * away from the others, and one at a coarser level.
+   */
+  for (i = 0; i < N_REQUESTS; i++)
+    {
+      requests[i].node            = opacity;
+      requests[i].scale           = 1.0;
+      requests[i].format          = babl_format ("R'G'B'A u8");
+      requests[i].destination_buf = batched[i];
+      requests[i].rowstride       = GEGL_AUTO_ROWSTRIDE;
+    }
+  requests[0].roi  = *GEGL_RECTANGLE (80, 80, TILE, TILE);
+  requests[1].roi  = *GEGL_RECTANGLE (80 + TILE, 80, TILE, TILE);
+  requests[2].node = blur;
+  requests[2].roi  = *GEGL_RECTANGLE (90, 90, TILE, TILE);
+  requests[3].roi  = *GEGL_RECTANGLE (-1000, -1000, TILE, TILE);
+  requests[4].scale = 0.5;
+  requests[4].roi  = *GEGL_RECTANGLE (20, 20, TILE, TILE);
+
+  memset (batched, 0, sizeof (batched));
+  gegl_node_blit_many (requests, N_REQUESTS);
+
+  for (i = 0; i < N_REQUESTS; i++)
+    {
+      memset (expected, 0, sizeof (expected));
+      gegl_node_blit (requests[i].node, requests[i].scale, &requests[i].roi,
+                      requests[i].format, expected, GEGL_AUTO_ROWSTRIDE,
+                      GEGL_BLIT_DEFAULT);
+
+      if (memcmp (expected, batched[i], sizeof (expected)))
+        {
+          g_printerr ("Request %i differs from rendering it on its own\n", i);
+          result = FAILURE;
+        }
+    }
+
+  g_object_unref (graph);
+  g_object_unref (color);
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,224 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <string.h>
+
+#include "gegl.h"
+#include "process/gegl-buffer-pool.h"
+#include "process/gegl-graph-traversal.h"
+#include "process/gegl-graph-traversal-private.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define N_PASSES 4
+
+/* Fill @buffer so that leftovers show up */
+static void
+fill (GeglBuffer *buffer)
+{
+  const GeglRectangle *extent = gegl_buffer_get_extent (buffer);
+  gfloat              *pixels = g_new (gfloat, extent->width * extent->height * 4);
+  gint                 i;
+
+  for (i = 0; i < extent->width * extent->height * 4; i++)
+    pixels[i] = 1.0f;
+
+  gegl_buffer_set (buffer, extent, 0, babl_format ("RGBA float"),
+                   pixels, GEGL_AUTO_ROWSTRIDE);
+  g_free (pixels);
+}
+
+static gboolean
+test_pool (void)
+{
+  GeglRectangle   extent  = { 0, 0, 64, 64 };
+  const Babl     *format  = babl_format ("RGBA float");
+  GeglBufferPool *pool    = gegl_buffer_pool_new ();
+  gboolean        success = TRUE;
+  GeglBuffer     *first;
+  GeglBuffer     *second;
+  gfloat          pixel[4];
+
+  /* Handed to a context, like gegl_operation_context_take_object does */
+  first = gegl_buffer_pool_get (pool, &extent, format);
+  gegl_buffer_pool_hold (pool, first);
+  fill (first);
+  gegl_buffer_pool_release (pool, first);
+
+  second = gegl_buffer_pool_get (pool, &extent, format);
+  if (second != first)
+    {
+      g_printerr ("A released buffer was not reused\n");
+      success = FALSE;
+    }
+
+  /* It comes from another node, nothing of it may show through */
+  gegl_buffer_get (second, GEGL_RECTANGLE (0, 0, 1, 1), 1.0, format,
+                   pixel, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  if (pixel[3] != 0.0f)
+    {
+      g_printerr ("A reused buffer was not cleared\n");
+      success = FALSE;
+    }
+
+  /* Two contexts hold it, one of them is still using it */
+  gegl_buffer_pool_hold (pool, second);
+  gegl_buffer_pool_hold (pool, second);
+  g_object_ref (second);
+  gegl_buffer_pool_release (pool, second);
+
+  first = gegl_buffer_pool_get (pool, &extent, format);
+  if (first == second)
+    {
+      g_printerr ("A buffer still held was reused\n");
+      success = FALSE;
+    }
+
+  /* Kept outside of the contexts, the pool must let it go */
+  g_object_ref (second);
+  gegl_buffer_pool_release (pool, second);
+
+  if (gegl_buffer_pool_get_n_buffers (pool) != 0)
+    {
+      g_printerr ("A buffer still referenced was taken back\n");
+      success = FALSE;
+    }
+
+  g_object_unref (first);
+  g_object_unref (second);
+  gegl_buffer_pool_free (pool);
+
+  return success;
+}
+
+int main(int argc, char *argv[])
+{
+  int                 result = SUCCESS;
+  GeglRectangle       roi    = { 0, 0, 4, 1 };
+  guchar              pixels[4 * 4];
+  GeglNode           *graph;
+  GeglNode           *color;
+  GeglNode           *crop;
+  GeglNode           *first;
+  GeglNode           *second;
+  GeglNode           *third;
+  GeglGraphTraversal *path;
+  guint               n_buffers;
+  gint                i;
+
+  gegl_init (&argc, &argv);
+
+  if (!test_pool ())
+    {
+      result = FAILURE;
+      gegl_exit ();
+      return result;
+    }
+
+  graph  = gegl_node_new ();
+  color  = gegl_node_new_child (graph,
+                                "operation", "gegl:color",
+                                NULL);
+  crop   = gegl_node_new_child (graph,
+                                "operation", "gegl:crop",
+                                "width",     4.0,
+                                "height",    1.0,
+                                NULL);
+  first  = gegl_node_new_child (graph,
+                                "operation", "gegl:opacity",
+                                "value",     0.5,
+                                NULL);
+  second = gegl_node_new_child (graph,
+                                "operation", "gegl:opacity",
+                                "value",     0.5,
+                                NULL);
+  third  = gegl_node_new_child (graph,
+                                "operation", "gegl:opacity",
+                                "value",     0.5,
+                                NULL);
+
+  gegl_node_link_many (color, crop, first, second, third, NULL);
+
+  /* The intermediate buffers of one pass are recycled by the next one,
+   * none of the previous contents may show through.
+   */
+  for (i = 0; i < N_PASSES; i++)
+    {
+      GeglColor *value = gegl_color_new (i % 2 ? "rgb(0.0, 1.0, 0.0)"
+                                               : "rgb(1.0, 0.0, 0.0)");
+      gint       x;
+
+      gegl_node_set (color, "value", value, NULL);
+      g_object_unref (value);
+
+      memset (pixels, 0, sizeof (pixels));
+      gegl_node_blit (third, 1.0, &roi, babl_format ("R'G'B'A u8"),
+                      pixels, GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+      for (x = 0; x < roi.width; x++)
+        {
+          guchar *pixel = pixels + x * 4;
+
+          if (pixel[0] != (i % 2 ? 0 : 255) ||
+              pixel[1] != (i % 2 ? 255 : 0) ||
+              ABS (pixel[3] - 32) > 1)
+            {
+              g_printerr ("Pass %i: wrong pixel at %i: %i %i %i %i\n",
+                          i, x, pixel[0], pixel[1], pixel[2], pixel[3]);
+              result = FAILURE;
+              goto abort;
+            }
+        }
+    }
+
+  /* After a pass the intermediate outputs wait in the pool of the
+   * traversal, and the next pass takes them from there instead of
+   * allocating more.
+   */
+  path = gegl_graph_build (third);
+  n_buffers = 0;
+
+  for (i = 0; i < 2; i++)
+    {
+      gegl_graph_prepare (path);
+      gegl_graph_prepare_request (path, &roi, 0);
+      g_object_unref (gegl_graph_process (path, 0));
+
+      if (i == 0)
+        n_buffers = gegl_buffer_pool_get_n_buffers (path->pool);
+    }
+
+  if (n_buffers == 0)
+    {
+      g_printerr ("No intermediate buffer was kept for the next pass\n");
+      result = FAILURE;
+    }
+  else if (gegl_buffer_pool_get_n_buffers (path->pool) != n_buffers)
+    {
+      g_printerr ("The second pass did not reuse the %u kept buffers\n",
+                  n_buffers);
+      result = FAILURE;
+    }
+
+  gegl_graph_free (path);
+
+abort:
+  g_object_unref (graph);
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,134 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <string.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define N_DABS   100
+
+static void
+count_invalidated (GeglNode            *node,
+                   const GeglRectangle *rect,
+                   gpointer             user_data)
+{
+  (*(gint *) user_data)++;
+}
+
+int main(int argc, char *argv[])
+{
+  int            result        = SUCCESS;
+  GeglRectangle  extent        = { 0, 0, 128, 128 };
+  GeglRectangle  roi           = { 10, 10, 1, 1 };
+  guchar         white[4]      = { 255, 255, 255, 255 };
+  guchar         red[4]        = { 255, 0, 0, 255 };
+  guchar         blue[4]       = { 0, 0, 255, 255 };
+  guchar         pixel[4]      = { 0, };
+  gint           n_invalidated = 0;
+  GeglBuffer    *buffer;
+  GeglNode      *graph;
+  GeglNode      *source;
+  GeglNode      *opacity;
+  GeglProcessor *processor;
+  gint           i;
+
+  gegl_init (&argc, &argv);
+
+  buffer  = gegl_buffer_new (&extent, babl_format ("R'G'B'A u8"));
+  graph   = gegl_node_new ();
+  source  = gegl_node_new_child (graph,
+                                 "operation",           "gegl:buffer-source",
+                                 "buffer",              buffer,
+                                 "defer-invalidations", TRUE,
+                                 NULL);
+  opacity = gegl_node_new_child (graph,
+                                 "operation", "gegl:opacity",
+                                 NULL);
+  gegl_node_link (source, opacity);
+
+  gegl_node_blit (opacity, 1.0, &roi, babl_format ("R'G'B'A u8"),
+                  pixel, GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_CACHE);
+
+  g_signal_connect (opacity, "invalidated",
+                    G_CALLBACK (count_invalidated), &n_invalidated);
+
+  /* A row of small dabs */
+  for (i = 0; i < N_DABS; i++)
+    gegl_buffer_set (buffer, GEGL_RECTANGLE (i, 10, 1, 1), 0,
+                     babl_format ("R'G'B'A u8"), white, GEGL_AUTO_ROWSTRIDE);
+
+  if (n_invalidated != 0)
+    {
+      g_printerr ("Invalidations were propagated before flushing\n");
+      result = FAILURE;
+      goto abort;
+    }
+
+  gegl_node_flush_invalidations (source);
+
+  if (n_invalidated == 0 || n_invalidated >= N_DABS)
+    {
+      g_printerr ("Expected the dabs to be coalesced, got %i invalidations\n",
+                  n_invalidated);
+      result = FAILURE;
+      goto abort;
+    }
+
+  /* Rendering flushes by itself */
+  gegl_node_blit (opacity, 1.0, &roi, babl_format ("R'G'B'A u8"),
+                  pixel, GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_CACHE);
+  gegl_buffer_set (buffer, &roi, 0, babl_format ("R'G'B'A u8"),
+                   red, GEGL_AUTO_ROWSTRIDE);
+  memset (pixel, 0, sizeof (pixel));
+  gegl_node_blit (opacity, 1.0, &roi, babl_format ("R'G'B'A u8"),
+                  pixel, GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_CACHE);
+
+  if (pixel[0] != 255 || pixel[1] != 0 || pixel[3] != 255)
+    {
+      g_printerr ("The cached result was not invalidated before rendering\n");
+      result = FAILURE;
+      goto abort;
+    }
+
+  /* So does a processor, before it trusts the cache of its node */
+  gegl_buffer_set (buffer, &roi, 0, babl_format ("R'G'B'A u8"),
+                   blue, GEGL_AUTO_ROWSTRIDE);
+  processor = gegl_node_new_processor (opacity, &roi);
+  while (gegl_processor_work (processor, NULL));
+  g_object_unref (processor);
+
+  memset (pixel, 0, sizeof (pixel));
+  gegl_node_blit (opacity, 1.0, &roi, babl_format ("R'G'B'A u8"),
+                  pixel, GEGL_AUTO_ROWSTRIDE,
+                  GEGL_BLIT_CACHE | GEGL_BLIT_DIRTY);
+
+  if (pixel[0] != 0 || pixel[2] != 255 || pixel[3] != 255)
+    {
+      g_printerr ("The processor left a stale result in the cache\n");
+      result = FAILURE;
+      goto abort;
+    }
+
+abort:
+  g_object_unref (graph);
+  g_object_unref (buffer);
+  gegl_exit ();
+
+  return result;
+}
@@ -130,7 +130,7 @@ static gboolean
 test_opacity_linear_002 (void)
 {
   return test_opacity_common (babl_format ("RGBA u8"),
-                              babl_format ("RGBA float"));
+                              babl_format ("RGBA u8"));
 }
 
 static gboolean
@@ -144,7 +144,7 @@ static gboolean
 test_opacity_linear_004 (void)
 {
   return test_opacity_common (babl_format ("RaGaBaA u8"),
-                              babl_format ("RaGaBaA float"));
+                              babl_format ("RaGaBaA u8"));
 }
 
 static gboolean
@@ -158,7 +158,7 @@ static gboolean
 test_opacity_gamma_002 (void)
 {
   return test_opacity_common (babl_format ("R'G'B'A u8"),
-                              babl_format ("R'G'B'A float"));
+                              babl_format ("R'G'B'A u8"));
 }
 
 static gboolean
@@ -172,7 +172,342 @@ static gboolean
 test_opacity_gamma_004 (void)
 {
   return test_opacity_common (babl_format ("R'aG'aB'aA u8"),
-                              babl_format ("R'aG'aB'aA float"));
+                              babl_format ("R'aG'aB'aA u8"));
+}
+
+static gboolean
+test_invert_gamma_u8 (void)
+{
+  /* Validate that gegl:invert-gamma processes R'G'B'A u8 without
+   * converting it to float
+   */
+  gboolean result = TRUE;
+
+  GeglNode *ptn, *src, *invert, *sink;
+  GeglBuffer *src_buffer;
+  GeglBuffer *sink_buffer = NULL;
+  guint8 pixels[4 * 4] = {0, 1, 2, 3, 64, 128, 192, 255,
+                          255, 254, 253, 0, 17, 34, 51, 68};
+  guint8 inverted[4 * 4];
+  gint i;
+
+  src_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, 2, 2), babl_format ("R'G'B'A u8"));
+  gegl_buffer_set (src_buffer, NULL, 0, babl_format ("R'G'B'A u8"), pixels,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  ptn  = gegl_node_new ();
+
+  src  = gegl_node_new_child (ptn,
+                              "operation", "gegl:buffer-source",
+                              "buffer", src_buffer,
+                              NULL);
+
+  invert = gegl_node_new_child (ptn,
+                                "operation", "gegl:invert-gamma",
+                                NULL);
+
+  sink = gegl_node_new_child (ptn,
+                              "operation", "gegl:buffer-sink",
+                              "buffer", &sink_buffer,
+                              "format", NULL,
+                              NULL);
+
+  gegl_node_link_many (src, invert, sink, NULL);
+
+  gegl_node_blit_buffer (sink, NULL, NULL, 0, GEGL_ABYSS_NONE);
+
+  if (gegl_buffer_get_format (src_buffer) != gegl_buffer_get_format (sink_buffer))
+    {
+      printf ("Got %s expected %s\n", babl_get_name (gegl_buffer_get_format (sink_buffer)),
+                                      babl_get_name (gegl_buffer_get_format (src_buffer)));
+      result = FALSE;
+    }
+
+  gegl_buffer_get (sink_buffer, GEGL_RECTANGLE (0, 0, 2, 2), 1.0,
+                   babl_format ("R'G'B'A u8"), inverted,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  for (i = 0; i < 4 * 4; i++)
+    {
+      guint8 expected = (i % 4 == 3) ? pixels[i] : 255 - pixels[i];
+
+      if (inverted[i] != expected)
+        {
+          printf ("Component %d is %d expected %d\n", i, inverted[i], expected);
+          result = FALSE;
+        }
+    }
+
+  g_object_unref (ptn);
+  g_object_unref (src_buffer);
+  g_object_unref (sink_buffer);
+
+  return result;
+}
+
+static gboolean
+test_over_u8 (void)
+{
+  /* Validate that gegl:over composites R'aG'aB'aA u8 in that format, with
+   * the same result as in float
+   */
+  gboolean result = TRUE;
+
+  GeglNode *ptn, *src, *aux, *over, *sink;
+  GeglBuffer *src_buffer, *aux_buffer;
+  GeglBuffer *sink_buffer = NULL;
+  const Babl *format = babl_format ("R'aG'aB'aA u8");
+  guint8 in_pixel[4]  = {200, 100, 50, 220};
+  guint8 aux_pixel[4] = {30, 60, 90, 120};
+  guint8 in_pixels[10 * 10 * 4];
+  guint8 aux_pixels[10 * 10 * 4];
+  guint8 out_pixel[4];
+  gint i;
+
+  for (i = 0; i < 10 * 10 * 4; i++)
+    {
+      in_pixels[i]  = in_pixel[i % 4];
+      aux_pixels[i] = aux_pixel[i % 4];
+    }
+
+  src_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, 10, 10), format);
+  aux_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, 10, 10), format);
+  gegl_buffer_set (src_buffer, NULL, 0, format, in_pixels, GEGL_AUTO_ROWSTRIDE);
+  gegl_buffer_set (aux_buffer, NULL, 0, format, aux_pixels, GEGL_AUTO_ROWSTRIDE);
+
+  ptn  = gegl_node_new ();
+
+  src  = gegl_node_new_child (ptn,
+                              "operation", "gegl:buffer-source",
+                              "buffer", src_buffer,
+                              NULL);
+
+  aux  = gegl_node_new_child (ptn,
+                              "operation", "gegl:buffer-source",
+                              "buffer", aux_buffer,
+                              NULL);
+
+  over = gegl_node_new_child (ptn,
+                              "operation", "gegl:over",
+                              "srgb", TRUE,
+                              NULL);
+
+  sink = gegl_node_new_child (ptn,
+                              "operation", "gegl:buffer-sink",
+                              "buffer", &sink_buffer,
+                              "format", NULL,
+                              NULL);
+
+  gegl_node_link_many (src, over, sink, NULL);
+  gegl_node_connect_to (aux, "output", over, "aux");
+
+  gegl_node_blit_buffer (sink, NULL, NULL, 0, GEGL_ABYSS_NONE);
+
+  if (format != gegl_buffer_get_format (sink_buffer))
+    {
+      printf ("Got %s expected %s\n", babl_get_name (gegl_buffer_get_format (sink_buffer)),
+                                      babl_get_name (format));
+      result = FALSE;
+    }
+
+  gegl_buffer_get (sink_buffer, GEGL_RECTANGLE (5, 5, 1, 1), 1.0,
+                   format, out_pixel,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  for (i = 0; i < 4; i++)
+    {
+      gfloat expected = aux_pixel[i] + in_pixel[i] * (1.0f - aux_pixel[3] / 255.0f);
+
+      if (ABS (out_pixel[i] - expected) > 0.5f)
+        {
+          printf ("Component %d is %d expected %f\n", i, out_pixel[i], expected);
+          result = FALSE;
+        }
+    }
+
+  g_object_unref (ptn);
+  g_object_unref (src_buffer);
+  g_object_unref (aux_buffer);
+  g_object_unref (sink_buffer);
+
+  return result;
+}
+
+static gboolean
+test_over_u8_float_aux (void)
+{
+  /* Validate that gegl:over does not quantize a float aux to the u8
+   * format of its input
+   */
+  gboolean result = TRUE;
+
+  GeglNode *ptn, *src, *aux, *over, *sink;
+  GeglBuffer *src_buffer, *aux_buffer;
+  GeglBuffer *sink_buffer = NULL;
+  const Babl *format       = babl_format ("R'aG'aB'aA u8");
+  const Babl *float_format = babl_format ("R'aG'aB'aA float");
+  guint8 in_pixel[4]  = {0, 0, 0, 0};
+  gfloat aux_pixel[4] = {0.001f, 0.002f, 0.003f, 0.004f};
+  guint8 in_pixels[10 * 10 * 4];
+  gfloat aux_pixels[10 * 10 * 4];
+  gfloat out_pixel[4];
+  gint i;
+
+  for (i = 0; i < 10 * 10 * 4; i++)
+    {
+      in_pixels[i]  = in_pixel[i % 4];
+      aux_pixels[i] = aux_pixel[i % 4];
+    }
+
+  src_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, 10, 10), format);
+  aux_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, 10, 10), float_format);
+  gegl_buffer_set (src_buffer, NULL, 0, format, in_pixels, GEGL_AUTO_ROWSTRIDE);
+  gegl_buffer_set (aux_buffer, NULL, 0, float_format, aux_pixels, GEGL_AUTO_ROWSTRIDE);
+
+  ptn  = gegl_node_new ();
+
+  src  = gegl_node_new_child (ptn,
+                              "operation", "gegl:buffer-source",
+                              "buffer", src_buffer,
+                              NULL);
+
+  aux  = gegl_node_new_child (ptn,
+                              "operation", "gegl:buffer-source",
+                              "buffer", aux_buffer,
+                              NULL);
+
+  over = gegl_node_new_child (ptn,
+                              "operation", "gegl:over",
+                              "srgb", TRUE,
+                              NULL);
+
+  sink = gegl_node_new_child (ptn,
+                              "operation", "gegl:buffer-sink",
+                              "buffer", &sink_buffer,
+                              "format", NULL,
+                              NULL);
+
+  gegl_node_link_many (src, over, sink, NULL);
+  gegl_node_connect_to (aux, "output", over, "aux");
+
+  gegl_node_blit_buffer (sink, NULL, NULL, 0, GEGL_ABYSS_NONE);
+
+  if (float_format != gegl_buffer_get_format (sink_buffer))
+    {
+      printf ("Got %s expected %s\n", babl_get_name (gegl_buffer_get_format (sink_buffer)),
+                                      babl_get_name (float_format));
+      result = FALSE;
+    }
+
+  gegl_buffer_get (sink_buffer, GEGL_RECTANGLE (5, 5, 1, 1), 1.0,
+                   float_format, out_pixel,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  /* transparent input, so the aux comes through */
+  for (i = 0; i < 4; i++)
+    {
+      if (ABS (out_pixel[i] - aux_pixel[i]) > 0.0001f)
+        {
+          printf ("Component %d is %f expected %f\n", i, out_pixel[i], aux_pixel[i]);
+          result = FALSE;
+        }
+    }
+
+  g_object_unref (ptn);
+  g_object_unref (src_buffer);
+  g_object_unref (aux_buffer);
+  g_object_unref (sink_buffer);
+
+  return result;
+}
+
+static GeglBuffer *
+brightness_contrast (GeglBuffer *src_buffer)
+{
+  GeglNode *ptn, *src, *filter, *sink;
+  GeglBuffer *sink_buffer = NULL;
+
+  ptn  = gegl_node_new ();
+
+  src  = gegl_node_new_child (ptn,
+                              "operation", "gegl:buffer-source",
+                              "buffer", src_buffer,
+                              NULL);
+
+  filter = gegl_node_new_child (ptn,
+                                "operation", "gegl:brightness-contrast",
+                                "contrast", 1.3,
+                                "brightness", 0.1,
+                                NULL);
+
+  sink = gegl_node_new_child (ptn,
+                              "operation", "gegl:buffer-sink",
+                              "buffer", &sink_buffer,
+                              "format", NULL,
+                              NULL);
+
+  gegl_node_link_many (src, filter, sink, NULL);
+
+  gegl_node_blit_buffer (sink, NULL, NULL, 0, GEGL_ABYSS_NONE);
+
+  g_object_unref (ptn);
+
+  return sink_buffer;
+}
+
+static gboolean
+test_brightness_contrast_u8 (void)
+{
+  /* Validate that gegl:brightness-contrast keeps RGBA u8, with the same
+   * result as processing in float
+   */
+  gboolean result = TRUE;
+
+  const Babl *format = babl_format ("RGBA u8");
+  GeglBuffer *src_buffer, *float_buffer;
+  GeglBuffer *u8_result, *float_result;
+  guint8 pixels[64 * 4];
+  guint8 u8_pixels[64 * 4];
+  guint8 float_pixels[64 * 4];
+  gint i;
+
+  for (i = 0; i < 64 * 4; i++)
+    pixels[i] = i;
+
+  src_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, 8, 8), format);
+  gegl_buffer_set (src_buffer, NULL, 0, format, pixels, GEGL_AUTO_ROWSTRIDE);
+  float_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, 8, 8), babl_format ("RGBA float"));
+  gegl_buffer_set (float_buffer, NULL, 0, format, pixels, GEGL_AUTO_ROWSTRIDE);
+
+  u8_result    = brightness_contrast (src_buffer);
+  float_result = brightness_contrast (float_buffer);
+
+  if (format != gegl_buffer_get_format (u8_result))
+    {
+      printf ("Got %s expected %s\n", babl_get_name (gegl_buffer_get_format (u8_result)),
+                                      babl_get_name (format));
+      result = FALSE;
+    }
+
+  gegl_buffer_get (u8_result, GEGL_RECTANGLE (0, 0, 8, 8), 1.0, format,
+                   u8_pixels, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  gegl_buffer_get (float_result, GEGL_RECTANGLE (0, 0, 8, 8), 1.0, format,
+                   float_pixels, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  for (i = 0; i < 64 * 4; i++)
+    if (u8_pixels[i] != float_pixels[i])
+      {
+        printf ("Component %d is %d expected %d\n", i, u8_pixels[i], float_pixels[i]);
+        result = FALSE;
+        break;
+      }
+
+  g_object_unref (src_buffer);
+  g_object_unref (float_buffer);
+  g_object_unref (u8_result);
+  g_object_unref (float_result);
+
+  return result;
 }
 
 #define RUN_TEST(test_name) \
@@ -207,6 +542,10 @@ int main(int argc, char *argv[])
   RUN_TEST (test_opacity_gamma_002)
   RUN_TEST (test_opacity_gamma_003)
   RUN_TEST (test_opacity_gamma_004)
+  RUN_TEST (test_invert_gamma_u8)
+  RUN_TEST (test_over_u8)
+  RUN_TEST (test_over_u8_float_aux)
+  RUN_TEST (test_brightness_contrast_u8)
 
   gegl_exit ();
 
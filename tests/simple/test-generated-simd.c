@@ -0,0 +1,220 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <math.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+/* Rows of 13 pixels leave a scalar tail after both the 4 and the 8
+ * pixel vector loops.
+ */
+#define WIDTH    13
+#define HEIGHT   3
+
+/* the scalar formulas may be evaluated in double */
+#define EPSILON  1e-5
+
+/* the operations generated by the scripts in operations/generated */
+static const gchar *ops[] =
+{
+  "gegl:add",
+  "gegl:subtract",
+  "gegl:multiply",
+  "gegl:divide",
+  "gegl:gamma",
+
+  "svg:clear",
+  "svg:src",
+  "svg:dst",
+  "svg:dst-over",
+  "svg:dst-in",
+  "svg:src-in",
+  "svg:src-out",
+  "svg:dst-out",
+  "svg:src-atop",
+  "svg:dst-atop",
+  "svg:xor",
+
+  "svg:multiply",
+  "svg:screen",
+  "svg:darken",
+  "svg:lighten",
+  "svg:difference",
+  "svg:exclusion",
+  "svg:overlay",
+  "svg:color-dodge",
+  "svg:color-burn",
+  "svg:hard-light",
+  "gegl:soft-light",
+  "svg:plus"
+};
+
+/* Covers both sides of the conditions in the blend formulas, out of
+ * range values, transparent pixels and NaN.
+ */
+static GeglBuffer *
+make_buffer (gint seed)
+{
+  GeglRectangle  extent = { 0, 0, WIDTH, HEIGHT };
+  gfloat         pixels[WIDTH * HEIGHT * 4];
+  GeglBuffer    *buffer;
+  GRand         *rand = g_rand_new_with_seed (seed);
+  gint           i;
+
+  for (i = 0; i < WIDTH * HEIGHT * 4; i++)
+    pixels[i] = g_rand_double_range (rand, -0.1, 1.1);
+
+  pixels[4 * 3 + 3]  = 0.0f;
+  pixels[4 * 5 + 3]  = 1.0f;
+  pixels[4 * 7 + 0]  = 0.0f;
+  pixels[4 * 7 + 1]  = 1.0f;
+  pixels[4 * 11 + 2] = NAN;
+
+  buffer = gegl_buffer_new (&extent, babl_format ("RGBA float"));
+  gegl_buffer_set (buffer, &extent, 0, babl_format ("RGBA float"),
+                   pixels, GEGL_AUTO_ROWSTRIDE);
+
+  g_rand_free (rand);
+
+  return buffer;
+}
+
+static GeglNode *
+make_graph (const gchar *operation,
+            GeglBuffer  *input,
+            GeglBuffer  *aux,
+            GeglNode   **node)
+{
+  GeglNode *graph = gegl_node_new ();
+  GeglNode *source;
+
+  source = gegl_node_new_child (graph,
+                                "operation", "gegl:buffer-source",
+                                "buffer",    input,
+                                NULL);
+  *node  = gegl_node_new_child (graph,
+                                "operation", operation,
+                                NULL);
+  gegl_node_link (source, *node);
+
+  if (aux)
+    {
+      GeglNode *aux_source = gegl_node_new_child (graph,
+                                                  "operation", "gegl:buffer-source",
+                                                  "buffer",    aux,
+                                                  NULL);
+
+      gegl_node_connect_to (aux_source, "output", *node, "aux");
+    }
+
+  return graph;
+}
+
+static gboolean
+same_value (gfloat a,
+            gfloat b)
+{
+  if (isnan (a) || isnan (b))
+    return isnan (a) && isnan (b);
+
+  if (isinf (a) || isinf (b))
+    return a == b;
+
+  return fabs (a - b) <= EPSILON * MAX (1.0, fabs (b));
+}
+
+/* Rendering all pixels at once goes through the vector variant, if the
+ * CPU has one, while rendering them one at a time only ever runs the
+ * scalar process the variants hand their tail to.
+ */
+static gboolean
+test_operation (const gchar *operation,
+                GeglBuffer  *input,
+                GeglBuffer  *aux)
+{
+  GeglRectangle  roi     = { 0, 0, WIDTH, HEIGHT };
+  gboolean       success = TRUE;
+  gfloat         vector[WIDTH * HEIGHT * 4];
+  gfloat         scalar[WIDTH * HEIGHT * 4];
+  const Babl    *format;
+  GeglNode      *graph;
+  GeglNode      *node;
+  gint           x, y, c;
+
+  /* separate graphs, the scalar pixels must not come from a cache */
+  graph = make_graph (operation, input, aux, &node);
+  gegl_node_get_bounding_box (node);
+  format = gegl_operation_get_format (gegl_node_get_gegl_operation (node),
+                                      "output");
+  gegl_node_blit (node, 1.0, &roi, format,
+                  vector, GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+  g_object_unref (graph);
+
+  graph = make_graph (operation, input, aux, &node);
+  for (y = 0; y < HEIGHT; y++)
+    for (x = 0; x < WIDTH; x++)
+      gegl_node_blit (node, 1.0, GEGL_RECTANGLE (x, y, 1, 1), format,
+                      scalar + (y * WIDTH + x) * 4, GEGL_AUTO_ROWSTRIDE,
+                      GEGL_BLIT_DEFAULT);
+  g_object_unref (graph);
+
+  for (x = 0; x < WIDTH * HEIGHT && success; x++)
+    for (c = 0; c < 4; c++)
+      if (!same_value (vector[x * 4 + c], scalar[x * 4 + c]))
+        {
+          g_printerr ("%s%s: component %i of pixel %i is %f instead of %f\n",
+                      operation, aux ? "" : " (no aux)", c, x,
+                      vector[x * 4 + c], scalar[x * 4 + c]);
+          success = FALSE;
+          break;
+        }
+
+  return success;
+}
+
+int main(int argc, char *argv[])
+{
+  int         result = SUCCESS;
+  GeglBuffer *input;
+  GeglBuffer *aux;
+  gint        i;
+
+  gegl_init (&argc, &argv);
+
+  g_object_set (gegl_config (), "threads", 1, NULL);
+
+  input = make_buffer (1);
+  aux   = make_buffer (2);
+
+  for (i = 0; i < G_N_ELEMENTS (ops); i++)
+    {
+      if (!test_operation (ops[i], input, aux))
+        result = FAILURE;
+
+      if (!test_operation (ops[i], input, NULL))
+        result = FAILURE;
+    }
+
+  g_object_unref (input);
+  g_object_unref (aux);
+
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,117 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <string.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+static void
+blit_pixel (GeglNode *node,
+            guchar   *pixel)
+{
+  GeglRectangle roi = { 1, 1, 1, 1 };
+
+  memset (pixel, 0, 4);
+  gegl_node_blit (node, 1.0, &roi, babl_format ("R'G'B'A u8"),
+                  pixel, GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+}
+
+int main(int argc, char *argv[])
+{
+  int            result = SUCCESS;
+  GeglRectangle  extent = { 0, 0, 4, 4 };
+  guchar         red[4] = { 255, 0, 0, 255 };
+  guchar         pixel[4];
+  GeglColor     *color;
+  GeglBuffer    *buffer;
+  GeglNode      *graph;
+  GeglNode      *source;
+  GeglNode      *crop;
+  GeglNode      *opacity;
+  GeglNode      *levels;
+  GeglNode      *output;
+
+  gegl_init (&argc, &argv);
+
+  color  = gegl_color_new ("rgb(1.0, 0.0, 0.0)");
+  buffer = gegl_buffer_new (&extent, babl_format ("R'G'B'A u8"));
+  gegl_buffer_set_color (buffer, &extent, color);
+
+  graph   = gegl_node_new ();
+  source  = gegl_node_new_child (graph,
+                                 "operation", "gegl:buffer-source",
+                                 "buffer",    buffer,
+                                 NULL);
+  crop    = gegl_node_new_child (graph,
+                                 "operation", "gegl:crop",
+                                 "width",     4.0,
+                                 "height",    4.0,
+                                 NULL);
+  opacity = gegl_node_new_child (graph,
+                                 "operation", "gegl:opacity",
+                                 "value",     1.0,
+                                 NULL);
+  levels  = gegl_node_new_child (graph,
+                                 "operation", "gegl:levels",
+                                 NULL);
+  output  = gegl_node_new_child (graph,
+                                 "operation", "gegl:nop",
+                                 NULL);
+
+  gegl_node_link_many (source, crop, opacity, levels, output, NULL);
+
+  /* Every node but the source is an identity */
+  blit_pixel (output, pixel);
+  if (memcmp (pixel, red, 4))
+    {
+      g_printerr ("Identity nodes changed the image: %i %i %i %i\n",
+                  pixel[0], pixel[1], pixel[2], pixel[3]);
+      result = FAILURE;
+      goto abort;
+    }
+
+  /* No longer an identity once its properties change */
+  gegl_node_set (levels, "out-high", 0.0, NULL);
+  blit_pixel (output, pixel);
+  if (pixel[0] != 0 || pixel[3] != 255)
+    {
+      g_printerr ("Levels was still elided: %i %i %i %i\n",
+                  pixel[0], pixel[1], pixel[2], pixel[3]);
+      result = FAILURE;
+      goto abort;
+    }
+
+  gegl_node_set (crop, "width", 1.0, NULL);
+  blit_pixel (output, pixel);
+  if (pixel[3] != 0)
+    {
+      g_printerr ("Crop was still elided: %i %i %i %i\n",
+                  pixel[0], pixel[1], pixel[2], pixel[3]);
+      result = FAILURE;
+      goto abort;
+    }
+
+abort:
+  g_object_unref (graph);
+  g_object_unref (buffer);
+  g_object_unref (color);
+  gegl_exit ();
+
+  return result;
+}
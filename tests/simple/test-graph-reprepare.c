@@ -0,0 +1,138 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <string.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+/* Blit the single pixel at (x, 0) of @node as RGBA u8 */
+static void
+blit_pixel (GeglNode *node,
+            gint      x,
+            guchar   *pixel)
+{
+  GeglRectangle roi = { x, 0, 1, 1 };
+
+  memset (pixel, 0, 4);
+  gegl_node_blit (node, 1.0, &roi, babl_format ("R'G'B'A u8"),
+                  pixel, GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+}
+
+int main(int argc, char *argv[])
+{
+  int        result = SUCCESS;
+  GeglNode  *graph;
+  GeglNode  *red;
+  GeglNode  *blue;
+  GeglNode  *crop;
+  GeglNode  *opacity;
+  GeglColor *red_color;
+  GeglColor *blue_color;
+  GeglColor *green_color;
+  guchar     pixel[4];
+
+  gegl_init (&argc, &argv);
+
+  red_color   = gegl_color_new ("rgb(1.0, 0.0, 0.0)");
+  blue_color  = gegl_color_new ("rgb(0.0, 0.0, 1.0)");
+  green_color = gegl_color_new ("rgb(0.0, 1.0, 0.0)");
+
+  graph   = gegl_node_new ();
+  red     = gegl_node_new_child (graph,
+                                 "operation", "gegl:color",
+                                 "value",     red_color,
+                                 NULL);
+  blue    = gegl_node_new_child (graph,
+                                 "operation", "gegl:color",
+                                 "value",     blue_color,
+                                 NULL);
+  crop    = gegl_node_new_child (graph,
+                                 "operation", "gegl:crop",
+                                 "width",     2.0,
+                                 "height",    1.0,
+                                 NULL);
+  opacity = gegl_node_new_child (graph,
+                                 "operation", "gegl:opacity",
+                                 "value",     1.0,
+                                 NULL);
+
+  gegl_node_link_many (red, crop, opacity, NULL);
+
+  blit_pixel (opacity, 1, pixel);
+  if (pixel[0] != 255 || pixel[3] != 255)
+    {
+      g_printerr ("Initial processing failed\n");
+      result = FAILURE;
+      goto abort;
+    }
+
+  /* A property change upstream must update the downstream have rect
+   * without the traversal being rebuilt.
+   */
+  gegl_node_set (crop, "width", 1.0, NULL);
+  blit_pixel (opacity, 1, pixel);
+  if (pixel[3] != 0)
+    {
+      g_printerr ("Shrinking the crop did not reach the output\n");
+      result = FAILURE;
+      goto abort;
+    }
+
+  /* A change of data only */
+  gegl_node_set (red, "value", green_color, NULL);
+  blit_pixel (opacity, 0, pixel);
+  if (pixel[0] != 0 || pixel[1] != 255)
+    {
+      g_printerr ("Changing the color did not reach the output\n");
+      result = FAILURE;
+      goto abort;
+    }
+
+  /* A change of topology */
+  gegl_node_connect_to (blue, "output", crop, "input");
+  blit_pixel (opacity, 0, pixel);
+  if (pixel[1] != 0 || pixel[2] != 255)
+    {
+      g_printerr ("Reconnecting the crop did not reach the output\n");
+      result = FAILURE;
+      goto abort;
+    }
+
+  /* Dropping a node of the last traversal after disconnecting it, the
+   * traversal must be rebuilt without looking at the dropped node.
+   */
+  gegl_node_disconnect (crop, "input");
+  gegl_node_remove_child (graph, blue);
+  blit_pixel (opacity, 0, pixel);
+  if (pixel[3] != 0)
+    {
+      g_printerr ("Disconnecting the crop did not reach the output\n");
+      result = FAILURE;
+      goto abort;
+    }
+
+abort:
+  g_object_unref (graph);
+  g_object_unref (red_color);
+  g_object_unref (blue_color);
+  g_object_unref (green_color);
+  gegl_exit ();
+
+  return result;
+}
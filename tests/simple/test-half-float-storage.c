@@ -0,0 +1,222 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <math.h>
+
+#include "gegl.h"
+#include "gegl-node-private.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+static const gfloat values[] =
+{
+  0.0f, 1.0f, -2.5f, 0.1f,
+  0.333f, 1e-5f, 1000.0f, 65504.0f
+};
+
+static gboolean
+test_buffer_roundtrip (void)
+{
+  GeglRectangle  rect    = { 0, 0, 2, 1 };
+  gboolean       success = TRUE;
+  GeglBuffer    *buffer;
+  gfloat         out[8];
+  gint           i;
+
+  buffer = gegl_buffer_new (&rect, babl_format ("RGBA half"));
+
+  if (babl_format_get_bytes_per_pixel (gegl_buffer_get_format (buffer)) != 8)
+    {
+      g_printerr ("RGBA half is not 8 bytes per pixel\n");
+      success = FALSE;
+    }
+
+  gegl_buffer_set (buffer, &rect, 0, babl_format ("RGBA float"),
+                   values, GEGL_AUTO_ROWSTRIDE);
+  gegl_buffer_get (buffer, &rect, 1.0, babl_format ("RGBA float"),
+                   out, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  /* half floats keep 11 significant bits */
+  for (i = 0; i < G_N_ELEMENTS (values); i++)
+    if (fabsf (out[i] - values[i]) > fabsf (values[i]) / 1024.0f + 1e-7f)
+      {
+        g_printerr ("%f stored as half reads back as %f\n", values[i], out[i]);
+        success = FALSE;
+      }
+
+  g_object_unref (buffer);
+
+  return success;
+}
+
+static gboolean
+test_node_cache (gboolean node_property)
+{
+  GeglRectangle  roi     = { 0, 0, 4, 1 };
+  gboolean       success = TRUE;
+  guchar         pixels[4 * 4];
+  GeglNode      *graph;
+  GeglNode      *color;
+  GeglNode      *crop;
+  GeglNode      *opacity;
+  GeglColor     *red;
+  const Babl    *format;
+  gint           x;
+
+  red   = gegl_color_new ("rgb(1.0, 0.0, 0.0)");
+  graph = gegl_node_new ();
+  color = gegl_node_new_child (graph,
+                               "operation", "gegl:color",
+                               "value",     red,
+                               NULL);
+  crop  = gegl_node_new_child (graph,
+                               "operation", "gegl:crop",
+                               "width",     4.0,
+                               "height",    1.0,
+                               NULL);
+  opacity = gegl_node_new_child (graph,
+                                 "operation",          "gegl:opacity",
+                                 "value",              0.5,
+                                 "half-float-storage", node_property,
+                                 NULL);
+  g_object_unref (red);
+
+  gegl_node_link_many (color, crop, opacity, NULL);
+
+  gegl_node_blit (opacity, 1.0, &roi, babl_format ("R'G'B'A u8"),
+                  pixels, GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_CACHE);
+
+  for (x = 0; x < roi.width; x++)
+    {
+      guchar *pixel = pixels + x * 4;
+
+      if (pixel[0] != 255 || pixel[1] != 0 || pixel[2] != 0 ||
+          ABS (pixel[3] - 128) > 1)
+        {
+          g_printerr ("wrong pixel at %i: %i %i %i %i\n",
+                      x, pixel[0], pixel[1], pixel[2], pixel[3]);
+          success = FALSE;
+        }
+    }
+
+  format = gegl_buffer_get_format (GEGL_BUFFER (gegl_node_get_cache (opacity)));
+
+  if (babl_format_get_type (format, 0) != babl_type ("half"))
+    {
+      g_printerr ("the cache is stored as %s\n", babl_get_name (format));
+      success = FALSE;
+    }
+
+  g_object_unref (graph);
+
+  return success;
+}
+
+/* Large enough for the point operations to split it between threads,
+ * which then write float results into half float targets.
+ */
+static gboolean
+test_threaded_targets (void)
+{
+  GeglRectangle  roi     = { 0, 0, 128, 128 };
+  gboolean       success = TRUE;
+  guchar        *pixels;
+  GeglNode      *graph;
+  GeglNode      *color;
+  GeglNode      *crop;
+  GeglNode      *invert;
+  GeglNode      *opacity;
+  GeglColor     *red;
+  gint           x;
+
+  pixels = g_new0 (guchar, roi.width * roi.height * 4);
+
+  red    = gegl_color_new ("rgb(1.0, 0.0, 0.0)");
+  graph  = gegl_node_new ();
+  color  = gegl_node_new_child (graph,
+                                "operation", "gegl:color",
+                                "value",     red,
+                                NULL);
+  crop   = gegl_node_new_child (graph,
+                                "operation", "gegl:crop",
+                                "width",     (gdouble) roi.width,
+                                "height",    (gdouble) roi.height,
+                                NULL);
+  invert = gegl_node_new_child (graph,
+                                "operation",          "gegl:invert-linear",
+                                "half-float-storage", TRUE,
+                                NULL);
+  opacity = gegl_node_new_child (graph,
+                                 "operation",          "gegl:opacity",
+                                 "value",              0.5,
+                                 "half-float-storage", TRUE,
+                                 NULL);
+  g_object_unref (red);
+
+  gegl_node_link_many (color, crop, invert, opacity, NULL);
+
+  gegl_node_blit (opacity, 1.0, &roi, babl_format ("R'G'B'A u8"),
+                  pixels, GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  for (x = 0; x < roi.width * roi.height; x++)
+    {
+      guchar *pixel = pixels + x * 4;
+
+      if (pixel[0] != 0 || pixel[1] != 255 || pixel[2] != 255 ||
+          ABS (pixel[3] - 128) > 1)
+        {
+          g_printerr ("wrong threaded pixel at %i: %i %i %i %i\n",
+                      x, pixel[0], pixel[1], pixel[2], pixel[3]);
+          success = FALSE;
+          break;
+        }
+    }
+
+  g_object_unref (graph);
+  g_free (pixels);
+
+  return success;
+}
+
+int main(int argc, char *argv[])
+{
+  int result = SUCCESS;
+
+  gegl_init (&argc, &argv);
+
+  if (!test_buffer_roundtrip ())
+    result = FAILURE;
+
+  if (!test_node_cache (TRUE))
+    result = FAILURE;
+
+  g_object_set (gegl_config (), "half-float-storage", TRUE, NULL);
+
+  if (!test_node_cache (FALSE))
+    result = FAILURE;
+
+  g_object_set (gegl_config (), "half-float-storage", FALSE, NULL);
+
+  g_object_set (gegl_config (), "threads", 4, NULL);
+
+  if (!test_threaded_targets ())
+    result = FAILURE;
+
+  gegl_exit ();
+
+  return result;
+}
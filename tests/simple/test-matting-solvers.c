@@ -0,0 +1,181 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <math.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define SIZE     48
+
+/* the solvers stop at a relative residual, not at the exact solution */
+#define EPSILON  1e-3
+
+/* A dark background blending into a bright foreground across the middle
+ * of the image, with the trimap leaving the blend unknown.
+ */
+static void
+make_image (GeglBuffer **image,
+            GeglBuffer **trimap)
+{
+  GeglRectangle  extent = { 0, 0, SIZE, SIZE };
+  gdouble       *pixels = g_new (gdouble, SIZE * SIZE * 3);
+  gdouble       *values = g_new (gdouble, SIZE * SIZE * 2);
+  gint           x, y;
+
+  for (y = 0; y < SIZE; y++)
+    for (x = 0; x < SIZE; x++)
+      {
+        gdouble  t     = CLAMP ((x - 16) / 16.0, 0.0, 1.0);
+        gdouble *pixel = pixels + (y * SIZE + x) * 3;
+        gdouble *value = values + (y * SIZE + x) * 2;
+
+        pixel[0] = 0.1 + 0.8 * t;
+        pixel[1] = 0.2 + 0.6 * t + 0.05 * sin (y * 0.5);
+        pixel[2] = 0.6 - 0.4 * t;
+
+        if (x < 10)
+          {
+            value[0] = 0.0;
+            value[1] = 1.0;
+          }
+        else if (x >= SIZE - 10)
+          {
+            value[0] = 1.0;
+            value[1] = 1.0;
+          }
+        else
+          {
+            value[0] = 0.0;
+            value[1] = 0.0;
+          }
+      }
+
+  *image  = gegl_buffer_new (&extent, babl_format ("R'G'B' double"));
+  *trimap = gegl_buffer_new (&extent, babl_format ("Y'A double"));
+
+  gegl_buffer_set (*image, &extent, 0, babl_format ("R'G'B' double"),
+                   pixels, GEGL_AUTO_ROWSTRIDE);
+  gegl_buffer_set (*trimap, &extent, 0, babl_format ("Y'A double"),
+                   values, GEGL_AUTO_ROWSTRIDE);
+
+  g_free (pixels);
+  g_free (values);
+}
+
+/* Solve on a single level, so that both solvers get the same system */
+static void
+solve (GeglBuffer  *image,
+       GeglBuffer  *trimap,
+       const gchar *solver,
+       gdouble     *alpha)
+{
+  GeglRectangle  roi = { 0, 0, SIZE, SIZE };
+  GeglNode      *graph;
+  GeglNode      *input;
+  GeglNode      *aux;
+  GeglNode      *matting;
+  GParamSpec    *pspec;
+  GEnumValue    *value;
+
+  graph   = gegl_node_new ();
+  input   = gegl_node_new_child (graph,
+                                 "operation", "gegl:buffer-source",
+                                 "buffer",    image,
+                                 NULL);
+  aux     = gegl_node_new_child (graph,
+                                 "operation", "gegl:buffer-source",
+                                 "buffer",    trimap,
+                                 NULL);
+  matting = gegl_node_new_child (graph,
+                                 "operation",     "gegl:matting-levin",
+                                 "levels",        0,
+                                 "active-levels", 0,
+                                 NULL);
+
+  /* the enum type is registered by the operation */
+  pspec = gegl_node_find_property (matting, "solver");
+  value = g_enum_get_value_by_nick (G_PARAM_SPEC_ENUM (pspec)->enum_class,
+                                    solver);
+  gegl_node_set (matting, "solver", value->value, NULL);
+
+  gegl_node_connect_to (input, "output", matting, "input");
+  gegl_node_connect_to (aux,   "output", matting, "aux");
+
+  gegl_node_blit (matting, 1.0, &roi, babl_format ("Y' double"),
+                  alpha, GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  g_object_unref (graph);
+}
+
+int main(int argc, char *argv[])
+{
+  int         result = SUCCESS;
+  GeglBuffer *image;
+  GeglBuffer *trimap;
+  gdouble    *direct;
+  gdouble    *iterative;
+  gint        i;
+
+  gegl_init (&argc, &argv);
+
+  /* only built along with the direct solver it is checked against */
+  if (!gegl_has_operation ("gegl:matting-levin"))
+    {
+      gegl_exit ();
+      return SUCCESS;
+    }
+
+  make_image (&image, &trimap);
+
+  direct    = g_new0 (gdouble, SIZE * SIZE);
+  iterative = g_new0 (gdouble, SIZE * SIZE);
+
+  solve (image, trimap, "direct", direct);
+  solve (image, trimap, "conjugate-gradient", iterative);
+
+  for (i = 0; i < SIZE * SIZE; i++)
+    {
+      if (fabs (direct[i] - iterative[i]) > EPSILON)
+        {
+          g_printerr ("conjugate gradient gave %f instead of %f at %i,%i\n",
+                      iterative[i], direct[i], i % SIZE, i / SIZE);
+          result = FAILURE;
+          break;
+        }
+    }
+
+  /* and the solution is a matte, not some agreement on garbage */
+  if (direct[SIZE / 2 * SIZE + 2] > 0.1 ||
+      direct[SIZE / 2 * SIZE + SIZE - 3] < 0.9)
+    {
+      g_printerr ("unexpected matte: %f at the background, %f at the foreground\n",
+                  direct[SIZE / 2 * SIZE + 2],
+                  direct[SIZE / 2 * SIZE + SIZE - 3]);
+      result = FAILURE;
+    }
+
+  g_free (direct);
+  g_free (iterative);
+  g_object_unref (image);
+  g_object_unref (trimap);
+
+  gegl_exit ();
+
+  return result;
+}
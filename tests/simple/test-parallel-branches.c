@@ -0,0 +1,184 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <string.h>
+
+#include "gegl.h"
+#include "process/gegl-graph-traversal.h"
+#include "process/gegl-graph-traversal-private.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define SIZE     256
+
+/* Two branches with work of their own meeting in an over, the input
+ * branch turns red into cyan and the aux branch makes blue half
+ * transparent.
+ */
+static GeglNode *
+make_graph (GeglNode **output)
+{
+  GeglNode      *graph;
+  GeglNode      *red, *red_crop, *invert;
+  GeglNode      *blue, *blue_crop, *opacity;
+  GeglNode      *over;
+  GeglColor     *color;
+
+  graph = gegl_node_new ();
+
+  color    = gegl_color_new ("rgb(1.0, 0.0, 0.0)");
+  red      = gegl_node_new_child (graph,
+                                  "operation", "gegl:color",
+                                  "value",     color,
+                                  NULL);
+  g_object_unref (color);
+  red_crop = gegl_node_new_child (graph,
+                                  "operation", "gegl:crop",
+                                  "width",     (gdouble) SIZE,
+                                  "height",    (gdouble) SIZE,
+                                  NULL);
+  invert   = gegl_node_new_child (graph,
+                                  "operation", "gegl:invert-linear",
+                                  NULL);
+
+  color     = gegl_color_new ("rgb(0.0, 0.0, 1.0)");
+  blue      = gegl_node_new_child (graph,
+                                   "operation", "gegl:color",
+                                   "value",     color,
+                                   NULL);
+  g_object_unref (color);
+  blue_crop = gegl_node_new_child (graph,
+                                   "operation", "gegl:crop",
+                                   "width",     (gdouble) SIZE,
+                                   "height",    (gdouble) SIZE,
+                                   NULL);
+  opacity   = gegl_node_new_child (graph,
+                                   "operation", "gegl:opacity",
+                                   "value",     0.5,
+                                   NULL);
+
+  over = gegl_node_new_child (graph,
+                              "operation", "svg:src-over",
+                              NULL);
+
+  gegl_node_link_many (red, red_crop, invert, over, NULL);
+  gegl_node_link_many (blue, blue_crop, opacity, NULL);
+  gegl_node_connect_to (opacity, "output", over, "aux");
+
+  *output = over;
+
+  return graph;
+}
+
+static void
+render (guchar *pixels)
+{
+  GeglRectangle  roi = { 0, 0, SIZE, SIZE };
+  GeglNode      *graph;
+  GeglNode      *over;
+
+  graph = make_graph (&over);
+
+  gegl_node_blit (over, 1.0, &roi, babl_format ("R'G'B'A u8"),
+                  pixels, GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  g_object_unref (graph);
+}
+
+/* Whether processing the graph went through the parallel scheduler */
+static gboolean
+ran_in_parallel (void)
+{
+  GeglRectangle       roi = { 0, 0, SIZE, SIZE };
+  GeglNode           *graph;
+  GeglNode           *over;
+  GeglGraphTraversal *path;
+  gboolean            parallel;
+
+  graph = make_graph (&over);
+
+  path = gegl_graph_build (over);
+  gegl_graph_prepare (path);
+  gegl_graph_prepare_request (path, &roi, 0);
+  g_object_unref (gegl_graph_process (path, 0));
+
+  parallel = path->parallel_passes > 0;
+
+  gegl_graph_free (path);
+  g_object_unref (graph);
+
+  return parallel;
+}
+
+int main(int argc, char *argv[])
+{
+  int     result = SUCCESS;
+  guchar *sequential;
+  guchar *parallel;
+  gint    i;
+
+  gegl_init (&argc, &argv);
+
+  sequential = g_new0 (guchar, SIZE * SIZE * 4);
+  parallel   = g_new0 (guchar, SIZE * SIZE * 4);
+
+  g_object_set (gegl_config (), "threads", 1, NULL);
+  render (sequential);
+
+  if (ran_in_parallel ())
+    {
+      g_printerr ("the branches were processed in parallel with one thread\n");
+      result = FAILURE;
+    }
+
+  g_object_set (gegl_config (), "threads", 4, NULL);
+  render (parallel);
+
+  if (!ran_in_parallel ())
+    {
+      g_printerr ("the branches were not processed in parallel\n");
+      result = FAILURE;
+    }
+
+  /* half blue over cyan */
+  for (i = 0; i < SIZE * SIZE; i++)
+    {
+      guchar *pixel = sequential + i * 4;
+
+      if (pixel[0] != 0 || ABS (pixel[1] - 188) > 1 ||
+          pixel[2] != 255 || pixel[3] != 255)
+        {
+          g_printerr ("wrong pixel at %i: %i %i %i %i\n",
+                      i, pixel[0], pixel[1], pixel[2], pixel[3]);
+          result = FAILURE;
+          break;
+        }
+    }
+
+  if (memcmp (sequential, parallel, SIZE * SIZE * 4))
+    {
+      g_printerr ("the branches processed in parallel gave a different result\n");
+      result = FAILURE;
+    }
+
+  g_free (sequential);
+  g_free (parallel);
+
+  gegl_exit ();
+
+  return result;
+}
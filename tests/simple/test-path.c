@@ -94,6 +94,25 @@ test_path_calc (GeglPath *path, gdouble pos,
     }
   return TRUE;
 }
+
+static int
+test_path_closest_point (GeglPath *path, gdouble x, gdouble y,
+                         gdouble exp_pos, gdouble exp_x, gdouble exp_y)
+{
+  gdouble pos, on_x=0.0, on_y=0.0;
+
+  pos = gegl_path_closest_point(path,x,y,&on_x,&on_y,NULL);
+
+  if (! (equals(pos,exp_pos) && equals(on_x,exp_x) && equals(on_y,exp_y)) )
+    {
+      g_printerr("test_path_closest_point()\n");
+      g_printerr("Closest point to %f,%f incorrect.\n", x, y);
+      printf("pos=%f exp_pos=%f  x=%f exp_x=%f  y=%f exp_y=%f\n",
+              pos, exp_pos, on_x, exp_x, on_y, exp_y);
+      return FALSE;
+    }
+  return TRUE;
+}
 int main(int argc, char *argv[])
 {
   gdouble exp_x[NSMP],exp_y[NSMP];
@@ -167,6 +186,36 @@ int main(int argc, char *argv[])
       result += FAILURE;
     }
 
+  i++;
+
+  /* a long line of 200 segments */
+  path = gegl_path_new ();
+  gegl_path_append (path, 'M', 0.0, 0.0);
+  for ( j=1;j<=200;j++)
+    gegl_path_append (path, 'L', j * 10.0, 0.0);
+  if(! test_path_closest_point(path, 1005.0, 20.0, 1005.0, 1005.0, 0.0) )
+    {
+      g_printerr("The gegl_path_closest_point() test #%d.1 failed.\n",i);
+      result += FAILURE;
+    }
+  if(! test_path_closest_point(path, -5.0, -5.0, 0.0, 0.0, 0.0) )
+    {
+      g_printerr("The gegl_path_closest_point() test #%d.2 failed.\n",i);
+      result += FAILURE;
+    }
+  if(! test_path_calc(path, 1995.0, 1995.0, 0.0) )
+    {
+      g_printerr("The gegl_path_calc() test #%d failed.\n",i);
+      result += FAILURE;
+    }
+  /* the index follows changes of the path */
+  gegl_path_append (path, 'L', 2000.0, 100.0);
+  if(! test_path_closest_point(path, 2010.0, 50.0, 2050.0, 2000.0, 50.0) )
+    {
+      g_printerr("The gegl_path_closest_point() test #%d.3 failed.\n",i);
+      result += FAILURE;
+    }
+
   /* path1   :    |--+--+--|--+--+--|
    * path2   :    |--+--+--|
    *                       |--+--+--|
@@ -0,0 +1,120 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <math.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+/* With one tile for the whole image, each of the threads gets a slice
+ * of 128 rows, several times what fits the point operation scratch
+ * buffers in one band.
+ */
+#define SIZE     512
+#define THREADS  4
+
+/* the results are stored as half floats */
+#define EPSILON  2e-3
+
+static gdouble
+channel (gint x,
+         gint y,
+         gint c)
+{
+  switch (c)
+    {
+      case 0:  return x / (gdouble) SIZE;
+      case 1:  return y / (gdouble) SIZE;
+      case 2:  return ((x + y) % 256) / 255.0;
+      default: return 1.0;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+  int            result = SUCCESS;
+  GeglRectangle  roi    = { 0, 0, SIZE, SIZE };
+  GeglBuffer    *buffer;
+  GeglNode      *graph;
+  GeglNode      *source;
+  GeglNode      *invert;
+  gdouble       *pixels;
+  gint           x, y, c;
+
+  gegl_init (&argc, &argv);
+
+  g_object_set (gegl_config (),
+                "tile-width",  SIZE,
+                "tile-height", SIZE,
+                "threads",     THREADS,
+                NULL);
+
+  pixels = g_new (gdouble, SIZE * SIZE * 4);
+
+  for (y = 0; y < SIZE; y++)
+    for (x = 0; x < SIZE; x++)
+      for (c = 0; c < 4; c++)
+        pixels[(y * SIZE + x) * 4 + c] = channel (x, y, c);
+
+  buffer = gegl_buffer_new (&roi, babl_format ("R'G'B'A double"));
+  gegl_buffer_set (buffer, &roi, 0, babl_format ("R'G'B'A double"),
+                   pixels, GEGL_AUTO_ROWSTRIDE);
+
+  /* the input is converted to float for the operation, and the float
+   * results are converted again to the half float target
+   */
+  graph  = gegl_node_new ();
+  source = gegl_node_new_child (graph,
+                                "operation", "gegl:buffer-source",
+                                "buffer",    buffer,
+                                NULL);
+  invert = gegl_node_new_child (graph,
+                                "operation",          "gegl:invert-gamma",
+                                "half-float-storage", TRUE,
+                                NULL);
+
+  gegl_node_link (source, invert);
+
+  gegl_node_blit (invert, 1.0, &roi, babl_format ("R'G'B'A double"),
+                  pixels, GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  for (y = 0; y < SIZE && result == SUCCESS; y++)
+    for (x = 0; x < SIZE && result == SUCCESS; x++)
+      for (c = 0; c < 4; c++)
+        {
+          gdouble expected = c < 3 ? 1.0 - channel (x, y, c)
+                                   : channel (x, y, c);
+          gdouble value    = pixels[(y * SIZE + x) * 4 + c];
+
+          if (fabs (value - expected) > EPSILON)
+            {
+              g_printerr ("channel %i at %i,%i is %f instead of %f\n",
+                          c, x, y, value, expected);
+              result = FAILURE;
+              break;
+            }
+        }
+
+  g_object_unref (graph);
+  g_object_unref (buffer);
+  g_free (pixels);
+
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,94 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <string.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+static gint n_prefetched = 0;
+
+/* Emitted from the render thread for prefetched rectangles */
+static void
+computed (GeglNode            *node,
+          const GeglRectangle *rect,
+          gpointer             user_data)
+{
+  const GeglRectangle *visible = user_data;
+
+  if (!gegl_rectangle_intersect (NULL, rect, visible))
+    g_atomic_int_inc (&n_prefetched);
+}
+
+int main(int argc, char *argv[])
+{
+  int            result  = SUCCESS;
+  GeglRectangle  visible = { 128, 128, 64, 64 };
+  guchar         pixel[64 * 64 * 4];
+  GeglColor     *color;
+  GeglNode      *graph;
+  GeglNode      *source;
+  GeglNode      *crop;
+  GeglNode      *opacity;
+  gint           i;
+
+  gegl_init (&argc, &argv);
+
+  color   = gegl_color_new ("rgb(0.0, 1.0, 0.0)");
+  graph   = gegl_node_new ();
+  source  = gegl_node_new_child (graph,
+                                 "operation", "gegl:color",
+                                 "value",     color,
+                                 NULL);
+  crop    = gegl_node_new_child (graph,
+                                 "operation", "gegl:crop",
+                                 "width",     512.0,
+                                 "height",    512.0,
+                                 NULL);
+  opacity = gegl_node_new_child (graph,
+                                 "operation", "gegl:opacity",
+                                 "value",     0.5,
+                                 "prefetch",  TRUE,
+                                 NULL);
+  gegl_node_link_many (source, crop, opacity, NULL);
+
+  g_signal_connect (opacity, "computed", G_CALLBACK (computed), &visible);
+
+  gegl_node_blit (opacity, 1.0, &visible, babl_format ("R'G'B'A u8"),
+                  pixel, GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_CACHE);
+
+  /* Give the background thread time to render the neighbours */
+  for (i = 0; i < 500 && !g_atomic_int_get (&n_prefetched); i++)
+    g_usleep (10000);
+
+  if (!g_atomic_int_get (&n_prefetched))
+    {
+      g_printerr ("Nothing around the visible rectangle was prefetched\n");
+      result = FAILURE;
+    }
+
+  /* Cancels what is still being prefetched */
+  g_object_set (opacity, "prefetch", FALSE, NULL);
+  g_signal_handlers_disconnect_by_func (opacity, computed, &visible);
+
+  g_object_unref (graph);
+  g_object_unref (color);
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,111 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <string.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+static void
+computed (GeglNode            *node,
+          const GeglRectangle *rect,
+          gpointer             user_data)
+{
+  GeglRectangle *covered = user_data;
+
+  gegl_rectangle_bounding_box (covered, covered, rect);
+}
+
+int main(int argc, char *argv[])
+{
+  int            result   = SUCCESS;
+  GeglRectangle  roi      = { 0, 0, 512, 512 };
+  GeglRectangle  covered  = { 0, };
+  gdouble        progress = 0.0;
+  gdouble        shown_at = -1.0;
+  guchar         pixel[4];
+  GeglColor     *color;
+  GeglNode      *graph;
+  GeglNode      *source;
+  GeglNode      *crop;
+  GeglNode      *opacity;
+  GeglProcessor *processor;
+
+  /* Coarse passes are skipped unless they are cheaper */
+  g_setenv ("GEGL_MIPMAP_RENDERING", "1", TRUE);
+
+  gegl_init (&argc, &argv);
+
+  color   = gegl_color_new ("rgb(0.0, 1.0, 0.0)");
+  graph   = gegl_node_new ();
+  source  = gegl_node_new_child (graph,
+                                 "operation", "gegl:color",
+                                 "value",     color,
+                                 NULL);
+  crop    = gegl_node_new_child (graph,
+                                 "operation", "gegl:crop",
+                                 "width",     512.0,
+                                 "height",    512.0,
+                                 NULL);
+  opacity = gegl_node_new_child (graph,
+                                 "operation", "gegl:opacity",
+                                 "value",     0.5,
+                                 NULL);
+  gegl_node_link_many (source, crop, opacity, NULL);
+
+  g_signal_connect (opacity, "computed", G_CALLBACK (computed), &covered);
+
+  processor = gegl_node_new_processor (opacity, &roi);
+  gegl_processor_set_progressive (processor, 2);
+
+  while (gegl_processor_work (processor, &progress))
+    {
+      if (shown_at < 0.0 && gegl_rectangle_equal (&covered, &roi))
+        shown_at = progress;
+    }
+
+  if (shown_at < 0.0 || shown_at > 0.5)
+    {
+      g_printerr ("The whole rectangle was not shown early, but at %f\n",
+                  shown_at);
+      result = FAILURE;
+      goto abort;
+    }
+
+  /* The placeholders must all have been refined */
+  memset (pixel, 0, sizeof (pixel));
+  gegl_node_blit (opacity, 1.0, GEGL_RECTANGLE (300, 300, 1, 1),
+                  babl_format ("R'G'B'A u8"), pixel, GEGL_AUTO_ROWSTRIDE,
+                  GEGL_BLIT_CACHE);
+
+  if (pixel[1] != 255 || pixel[3] < 127 || pixel[3] > 128)
+    {
+      g_printerr ("Unexpected pixel after refining: %i %i %i %i\n",
+                  pixel[0], pixel[1], pixel[2], pixel[3]);
+      result = FAILURE;
+      goto abort;
+    }
+
+abort:
+  g_object_unref (processor);
+  g_object_unref (graph);
+  g_object_unref (color);
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,75 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "config.h"
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define LENGTH   1000
+
+int main(int argc, char *argv[])
+{
+  int         result = SUCCESS;
+  gint        n_steps[] = { 0, 1, 4, 16, -3 };
+  gint        xs[] = { 0, -517, 123456 };
+  guint32     ints[LENGTH];
+  gint32      ranged[LENGTH];
+  gfloat      floats[LENGTH];
+  GeglRandom *rand;
+  gint        s, j, i;
+
+  gegl_init (&argc, &argv);
+
+  rand = gegl_random_new_with_seed (42);
+
+  for (s = 0; s < G_N_ELEMENTS (n_steps); s++)
+    for (j = 0; j < G_N_ELEMENTS (xs); j++)
+      {
+        gint x = xs[j];
+        gint y = 77 - j * 100;
+        gint n = 5 + j;
+
+        gegl_random_int_span (rand, x, y, 0, n, n_steps[s], LENGTH, ints);
+        gegl_random_int_range_span (rand, x, y, 0, n, n_steps[s],
+                                    -10, 10, LENGTH, ranged);
+        gegl_random_float_span (rand, x, y, 0, n, n_steps[s], LENGTH, floats);
+
+        for (i = 0; i < LENGTH; i++)
+          {
+            gint xi = x + i;
+            gint ni = n + i * n_steps[s];
+
+            if (ints[i] != gegl_random_int (rand, xi, y, 0, ni) ||
+                ranged[i] != gegl_random_int_range (rand, xi, y, 0, ni,
+                                                    -10, 10) ||
+                floats[i] != gegl_random_float (rand, xi, y, 0, ni))
+              {
+                g_printerr ("Span differs at x=%i y=%i n=%i\n", xi, y, ni);
+                result = FAILURE;
+                goto abort;
+              }
+          }
+      }
+
+abort:
+  gegl_random_free (rand);
+  gegl_exit ();
+
+  return result;
+}
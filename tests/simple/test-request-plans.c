@@ -0,0 +1,145 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <string.h>
+
+#include "gegl.h"
+#include "process/gegl-graph-traversal.h"
+#include "process/gegl-graph-traversal-private.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define N_TILES  4
+
+static gboolean
+check_row (GeglNode     *node,
+           const guchar *expected)
+{
+  guchar pixel[4];
+  gint   i;
+
+  /* The same rectangles every time, as a viewer repainting would */
+  for (i = 0; i < N_TILES; i++)
+    {
+      memset (pixel, 0, sizeof (pixel));
+      gegl_node_blit (node, 1.0, GEGL_RECTANGLE (i * 8, 0, 1, 1),
+                      babl_format ("R'G'B'A u8"), pixel,
+                      GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_CACHE);
+
+      if (memcmp (pixel, expected, 4))
+        {
+          g_printerr ("Pixel %i is %i %i %i %i\n",
+                      i, pixel[0], pixel[1], pixel[2], pixel[3]);
+          return FALSE;
+        }
+    }
+
+  return TRUE;
+}
+
+int main(int argc, char *argv[])
+{
+  int            result = SUCCESS;
+  GeglRectangle  extent = { 0, 0, 8 * N_TILES, 1 };
+  guchar         white[4] = { 255, 255, 255, 255 };
+  guchar         red[4]   = { 255, 0, 0, 255 };
+  guchar        *row;
+  GeglBuffer    *buffer;
+  GeglNode      *graph;
+  GeglNode      *source;
+  GeglNode      *opacity;
+  gint           i;
+
+  gegl_init (&argc, &argv);
+
+  row = g_new (guchar, extent.width * 4);
+  for (i = 0; i < extent.width; i++)
+    memcpy (row + i * 4, white, 4);
+
+  buffer = gegl_buffer_new (&extent, babl_format ("R'G'B'A u8"));
+  gegl_buffer_set (buffer, &extent, 0, babl_format ("R'G'B'A u8"),
+                   row, GEGL_AUTO_ROWSTRIDE);
+
+  graph   = gegl_node_new ();
+  source  = gegl_node_new_child (graph,
+                                 "operation", "gegl:buffer-source",
+                                 "buffer",    buffer,
+                                 NULL);
+  opacity = gegl_node_new_child (graph,
+                                 "operation", "gegl:opacity",
+                                 "value",     1.0,
+                                 NULL);
+  gegl_node_link (source, opacity);
+
+  /* Computed, then served from the cache */
+  if (!check_row (opacity, white) || !check_row (opacity, white))
+    {
+      result = FAILURE;
+      goto abort;
+    }
+
+  /* The plans from before must not claim the cache is still valid */
+  for (i = 0; i < extent.width; i++)
+    memcpy (row + i * 4, red, 4);
+  gegl_buffer_set (buffer, &extent, 0, babl_format ("R'G'B'A u8"),
+                   row, GEGL_AUTO_ROWSTRIDE);
+
+  if (!check_row (opacity, red))
+    {
+      result = FAILURE;
+      goto abort;
+    }
+
+  /* A data change leaves the plans of a traversal in place, a property
+   * change drops them.
+   */
+  {
+    GeglGraphTraversal *path = gegl_graph_build (opacity);
+
+    gegl_graph_prepare (path);
+    gegl_graph_prepare_request (path, &extent, 0);
+
+    gegl_buffer_set (buffer, &extent, 0, babl_format ("R'G'B'A u8"),
+                     row, GEGL_AUTO_ROWSTRIDE);
+    gegl_graph_prepare (path);
+
+    if (g_hash_table_size (path->request_plans) != 1)
+      {
+        g_printerr ("The plan was dropped by an invalidation\n");
+        result = FAILURE;
+      }
+
+    gegl_node_set (opacity, "value", 0.5, NULL);
+    gegl_graph_prepare (path);
+
+    if (g_hash_table_size (path->request_plans) != 0)
+      {
+        g_printerr ("The plan survived a property change\n");
+        result = FAILURE;
+      }
+
+    gegl_graph_free (path);
+  }
+
+abort:
+  g_object_unref (graph);
+  g_object_unref (buffer);
+  g_free (row);
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,123 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <string.h>
+
+#include "gegl.h"
+#include "property-types/gegl-path.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define SIZE     256
+
+/* Crosses itself and has curves spanning many tile rows */
+#define PATH "M20,128 C20,20 236,20 236,128 C236,236 20,236 20,128 z " \
+             "M60,40 L200,220 L220,60 L40,200 z"
+
+static void
+render (const gchar *operation,
+        gint         tile_size,
+        gint         threads,
+        guchar      *pixels)
+{
+  GeglRectangle  roi = { 0, 0, SIZE, SIZE };
+  GeglNode      *graph;
+  GeglNode      *node;
+  GeglPath      *path;
+
+  g_object_set (gegl_config (),
+                "tile-width",  tile_size,
+                "tile-height", tile_size,
+                "threads",     threads,
+                NULL);
+
+  path  = gegl_path_new_from_string (PATH);
+  graph = gegl_node_new ();
+  node  = gegl_node_new_child (graph,
+                               "operation", operation,
+                               "d",         path,
+                               NULL);
+  if (g_str_equal (operation, "gegl:vector-stroke"))
+    gegl_node_set (node, "width", 9.0, NULL);
+
+  gegl_node_blit (node, 1.0, &roi, babl_format ("R'G'B'A u8"),
+                  pixels, GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  g_object_unref (graph);
+  g_object_unref (path);
+}
+
+/* Rendering in tile rows split among threads must give what rendering
+ * the whole path at once does.
+ */
+static int
+test_operation (const gchar *operation)
+{
+  int     result = SUCCESS;
+  guchar *untiled;
+  guchar *tiled;
+  gint    covered = 0;
+  gint    i;
+
+  untiled = g_new0 (guchar, SIZE * SIZE * 4);
+  tiled   = g_new0 (guchar, SIZE * SIZE * 4);
+
+  render (operation, 2 * SIZE, 1, untiled);
+  render (operation, 32, 4, tiled);
+
+  for (i = 0; i < SIZE * SIZE * 4; i++)
+    {
+      if (ABS (untiled[i] - tiled[i]) > 1)
+        {
+          g_printerr ("%s: pixel %i differs when tiled: %i instead of %i\n",
+                      operation, i / 4, tiled[i], untiled[i]);
+          result = FAILURE;
+          break;
+        }
+
+      if (i % 4 == 3 && untiled[i])
+        covered++;
+    }
+
+  if (covered == 0)
+    {
+      g_printerr ("%s: nothing was rendered\n", operation);
+      result = FAILURE;
+    }
+
+  g_free (untiled);
+  g_free (tiled);
+
+  return result;
+}
+
+int main(int argc, char *argv[])
+{
+  int result = SUCCESS;
+
+  gegl_init (&argc, &argv);
+
+  if (test_operation ("gegl:fill-path") != SUCCESS)
+    result = FAILURE;
+
+  if (test_operation ("gegl:vector-stroke") != SUCCESS)
+    result = FAILURE;
+
+  gegl_exit ();
+
+  return result;
+}